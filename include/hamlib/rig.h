@@ -1056,6 +1056,15 @@ enum multicast_item_e {
     RIG_MULTICAST_SPECTRUM      // spectrum data will be included
 };
 
+/**
+ * \brief Multicast packet format
+ * JSON text, or the compact binary format decoded by rig_snapshot_decode()
+ */
+enum multicast_format_e {
+    RIG_MULTICAST_FORMAT_JSON,      // one JSON document per packet
+    RIG_MULTICAST_FORMAT_BINARY     // fixed header followed by TLV fields
+};
+
 //! @cond Doxygen_Suppress
 #define RIG_PARM_FLOAT_LIST (RIG_PARM_BACKLIGHT|RIG_PARM_BAT|RIG_PARM_KEYLIGHT)
 #define RIG_PARM_READONLY_LIST (RIG_PARM_BAT)
@@ -1725,6 +1734,138 @@ struct rig_spectrum_line
     unsigned char *spectrum_data; /*!< 8-bit spectrum data covering bandwidth of either the span_freq in center mode or from low edge to high edge in fixed mode. A higher value represents higher signal strength. */
 };
 
+//! @cond Doxygen_Suppress
+#define HAMLIB_SNAPSHOT_MAX_VFOS 4 /* max number of VFOs in a decoded snapshot */
+//! @endcond
+
+/**
+ * \brief VFO state of a decoded binary multicast snapshot
+ */
+struct rig_snapshot_vfo
+{
+    vfo_t vfo;          /*!< VFO the state below belongs to */
+    int cached;         /*!< freq, mode and width are valid */
+    freq_t freq;        /*!< Frequency in Hz */
+    rmode_t mode;       /*!< Mode */
+    pbwidth_t width;    /*!< Passband width in Hz */
+    int ptt;            /*!< PTT is on */
+    int rx;             /*!< VFO is used for receive */
+    int tx;             /*!< VFO is used for transmit */
+};
+
+/**
+ * \brief Decoded binary multicast snapshot
+ *
+ * Filled in by rig_snapshot_decode() without any memory allocation, and
+ * kept up to date by the delta packets that follow a keyframe.
+ * spectrum.spectrum_data points into the packet buffer passed to the
+ * decoder, so it is only valid as long as that buffer is.
+ */
+struct rig_snapshot
+{
+    unsigned int seq;           /*!< Sequence number of the last packet */
+    int keyframe;               /*!< Last packet was a keyframe */
+    int synced;                 /*!< A keyframe was decoded and no packet was lost since */
+    unsigned int packets;       /*!< Packets decoded */
+    unsigned int lost;          /*!< Packets missed, from sequence number gaps */
+    rig_model_t model;          /*!< Rig model of the publisher */
+    char name[32];              /*!< Rig model name */
+    int status;                 /*!< Rig port is open */
+    split_t split;              /*!< Split mode */
+    vfo_t split_vfo;            /*!< Split TX VFO */
+    int satmode;                /*!< Satellite mode */
+    int vfo_count;              /*!< Number of valid entries in vfos */
+    struct rig_snapshot_vfo vfos[HAMLIB_SNAPSHOT_MAX_VFOS]; /*!< VFO states */
+    int has_spectrum;           /*!< spectrum is valid */
+    struct rig_spectrum_line spectrum; /*!< Spectrum line, if any */
+};
+
+//! @cond Doxygen_Suppress
+#define HAMLIB_SPECTRUM_RING_SIZE 64 /* number of recent spectrum lines kept by the rig state */
+//! @endcond
+
+/**
+ * \brief Spectrum line borrowed from the rig's spectrum ring
+ *
+ * See rig_get_spectrum_lines() and rig_spectrum_ref_valid().
+ */
+struct rig_spectrum_ref
+{
+    const struct rig_spectrum_line *line; /*!< The line, owned by the ring */
+    uint64_t seq;                          /*!< Number of the line, counting from 0 */
+};
+
+/**
+ * \brief Priority of the rig transactions of a thread
+ *
+ * When several threads use a rig, the one with the highest priority gets
+ * the rig port when the current transaction is done.  See
+ * rig_set_priority().
+ */
+enum rig_priority_e
+{
+    RIG_PRIO_URGENT = 0,        /*!< PTT, CW and split changes */
+    RIG_PRIO_USER,              /*!< Application requests, the default */
+    RIG_PRIO_BACKGROUND,        /*!< Polls, e.g. by the poll routine */
+};
+
+//! @cond Doxygen_Suppress
+#define RIG_PRIO_N 3
+//! @endcond
+
+/**
+ * \brief How long the transactions of a priority waited for the rig port
+ *
+ * See rig_get_transaction_stats().
+ */
+struct rig_transaction_stats
+{
+    unsigned long count;        /*!< Transactions */
+    double wait_total_ms;       /*!< Sum of their waits */
+    double wait_max_ms;         /*!< Longest wait */
+};
+
+//! @cond Doxygen_Suppress
+#define RIG_STATS_BUCKETS 20
+#define RIG_STATS_BUCKET_US(k) (16ULL << (k))
+//! @endcond
+
+/**
+ * \brief Latency histogram
+ *
+ * bucket[k] counts what took more than RIG_STATS_BUCKET_US(k - 1) and at
+ * most RIG_STATS_BUCKET_US(k) microseconds, from 16 us to 8.4 s.  Anything
+ * slower is only in count.
+ */
+struct rig_latency_hist
+{
+    uint64_t count;                         /*!< Calls timed */
+    uint64_t sum_us;                        /*!< Sum of their times */
+    uint64_t bucket[RIG_STATS_BUCKETS];     /*!< Calls per time range */
+};
+
+/**
+ * \brief Latency of a function of a rig, see rig_get_call_stats()
+ */
+struct rig_call_stats
+{
+    const char *name;                   /*!< e.g. "rig_get_freq", or a backend transaction like "icom_one_transaction" */
+    struct rig_latency_hist latency;    /*!< Time from call to return */
+    uint64_t cache_hits;                /*!< Answered from the cache */
+    uint64_t cache_misses;              /*!< Asked to the rig */
+};
+
+/**
+ * \brief Reads of the port of a rig, see rig_get_port_stats()
+ */
+struct rig_port_stats
+{
+    struct rig_latency_hist latency;    /*!< Time from read_string/read_block to the reply */
+    uint64_t timeouts;                  /*!< Reads that timed out */
+    uint64_t retries;                   /*!< Reads tried again as the port was busy */
+    uint64_t errors;                    /*!< Reads that failed otherwise */
+};
+
 /**
  * \brief Rig data structure.
  *
@@ -2339,11 +2480,68 @@ typedef hamlib_port_t_deprecated port_t_deprecated;
 typedef hamlib_port_t port_t;
 #endif
 
+/**
+ * \brief Completion callback of an asynchronous port transaction
+ * \param p The port
+ * \param status Length of the reply, or a negative RIG_E* error code
+ * \param reply The reply, NUL terminated, valid during the callback only
+ * \param arg The done_arg of the transaction
+ *
+ * Called from the transaction thread of the port, without the transaction
+ * lock of the rig.  It must not call port_transaction_wait().
+ */
+typedef void (*port_transaction_done_t)(hamlib_port_t *p, int status,
+                                        const unsigned char *reply,
+                                        rig_ptr_t arg);
+
+/**
+ * \brief Reply matcher of an asynchronous port transaction
+ * \param reply The bytes received so far
+ * \param len Number of bytes received so far
+ * \param arg The match_arg of the transaction
+ *
+ * \return 1 once reply holds a complete reply, 0 to read another byte, or
+ * a negative RIG_E* error code to fail the transaction.
+ */
+typedef int (*port_transaction_match_t)(const unsigned char *reply, size_t len,
+                                        rig_ptr_t arg);
+
+/**
+ * \brief Asynchronous port transaction
+ *
+ * A command and the way to tell its reply is complete, handed to
+ * port_transaction_submit().  The reply is complete at the first byte in
+ * \a stopset, after \a reply_len bytes, or when \a match says so,
+ * whichever is set.  If none is set, the transaction is done once the
+ * command has been written.
+ *
+ * Transactions take turns with the rig_* API only on rigs whose backend
+ * does its port I/O under the transaction lock, which the Icom, Kenwood
+ * and newer Yaesu (newcat) backends do.  With other backends, do not call
+ * the rig_* API of the rig while its transactions are pending.
+ */
+struct port_transaction
+{
+    const unsigned char *cmd;   /*!< Command to send, copied by port_transaction_submit() */
+    size_t cmd_len;             /*!< Length of cmd, may be 0 to only read */
+    const char *stopset;        /*!< Reply terminators, or NULL */
+    int stopset_len;            /*!< Length of stopset */
+    size_t reply_len;           /*!< Fixed reply length, or 0 */
+    port_transaction_match_t match; /*!< Reply matcher, or NULL */
+    rig_ptr_t match_arg;        /*!< Passed to match */
+    size_t reply_max;           /*!< Maximum reply length, 0 for 1024 */
+    int timeout;                /*!< Reply timeout in ms, 0 for the port timeout */
+    int flush;                  /*!< Flush the port before sending cmd */
+    port_transaction_done_t done; /*!< Completion callback, or NULL */
+    rig_ptr_t done_arg;         /*!< Passed to done */
+};
+
 #define HAMLIB_ELAPSED_GET 0
 #define HAMLIB_ELAPSED_SET 1
 #define HAMLIB_ELAPSED_INVALIDATE 2
 
 #define HAMLIB_CACHE_ALWAYS (-1) /*< value to set cache timeout to always use cache */
+#define HAMLIB_CACHE_INHERIT (-2) /*< per-setting cache timeout follows its LEVEL/FUNC/PARM class */
 
 typedef enum {
     HAMLIB_CACHE_ALL, // to set all cache timeouts at once
@@ -2352,7 +2550,10 @@ typedef enum {
     HAMLIB_CACHE_MODE,
     HAMLIB_CACHE_PTT,
     HAMLIB_CACHE_SPLIT,
-    HAMLIB_CACHE_WIDTH
+    HAMLIB_CACHE_WIDTH,
+    HAMLIB_CACHE_LEVEL, // levels, funcs and parms are cached separately and are
+    HAMLIB_CACHE_FUNC,  // not touched by HAMLIB_CACHE_ALL -- their timeouts
+    HAMLIB_CACHE_PARM   // default to 0 (no caching)
 } hamlib_cache_t;
 
 typedef enum {
@@ -2368,6 +2569,9 @@ typedef enum {
 struct rig_cache {
     int timeout_ms;  // the cache timeout for invalidating itself
     vfo_t vfo;
+    // The per-VFO freq/mode/width fields and their time_ fields below are no
+    // longer updated -- they moved to rig_state.cache_slot and only remain to
+    // keep the structure layout.  Use rig_get_cache() to read them.
     //freq_t freq; // to be deprecated in 4.1 when full Main/Sub/A/B caching is implemented in 4.1
     // other abstraction here is based on dual vfo rigs and mapped to all others
     // So we have four possible states of rig
@@ -2440,6 +2644,32 @@ struct rig_cache {
 };
 
 
+/**
+ * \brief One VFO's entry in the rig cache
+ *
+ * The frequency, mode and width of a VFO are kept together with their
+ * update times so a cache lookup touches a single entry.
+ */
+//! @cond Doxygen_Suppress
+#define HAMLIB_CACHE_VFO_SLOTS 9
+//! @endcond
+struct rig_cache_slot {
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    struct timespec time_freq;
+    struct timespec time_mode;
+    struct timespec time_width;
+};
+
+//! @cond Doxygen_Suppress
+struct rig_setting_cache;
+struct rig_spectrum_ring;
+struct rig_stats;
+struct port_private;
+//! @endcond
+
+
 /**
  * \brief Rig state containing live data and customized fields.
  *
@@ -2565,6 +2795,16 @@ struct rig_state {
     int use_cached_mode; /*<! flag instructing rig_get_mode to use cached values when asyncio is in use */
     int use_cached_ptt;  /*<! flag instructing rig_get_ptt to use cached values when asyncio is in use */
     int depth; /*<! a depth counter to use for debug indentation and such */
+    volatile unsigned int cache_seq; /*<! seqlock sequence for the cache, odd while a writer is updating it */
+    struct rig_cache_slot cache_slot[HAMLIB_CACHE_VFO_SLOTS]; /*<! per-VFO freq/mode/width cache indexed by vfo, see src/cache.h */
+    struct rig_setting_cache *setting_cache; /*<! level/func/parm cache, only allocated once a timeout is set */
+    int multicast_format; /*<! multicast packet format, see enum multicast_format_e */
+    int multicast_keyframe_interval_ms; /*<! binary multicast sends a full snapshot this often, deltas in between */
+    struct rig_spectrum_ring *spectrum_ring; /*<! recent spectrum lines, see rig_get_spectrum_lines() */
+    int poll_budget; /*<! most CAT polls per second of the poll routine, 0 for no limit */
+    struct rig_prio_lock *transaction_lock; /*<! grants the port to transactions by priority, replaces mutex_set_transaction */
+    struct rig_stats *stats; /*<! latency of the calls and the port reads, see rig_get_call_stats() */
+    struct port_private *rigport_private; /*<! receive buffer, writer and transactions of rigport, see src/iofunc.h */
 };
 
 //! @cond Doxygen_Suppress
@@ -3270,10 +3510,18 @@ rig_need_debug HAMLIB_PARAMS((enum rig_debug_level_e debug_level));
 extern HAMLIB_EXPORT_VAR(char) debugmsgsave[DEBUGMSGSAVE_SIZE];  // last debug msg
 extern HAMLIB_EXPORT_VAR(char) debugmsgsave2[DEBUGMSGSAVE_SIZE];  // last-1 debug msg
 extern HAMLIB_EXPORT_VAR(char) debugmsgsave3[DEBUGMSGSAVE_SIZE];  // last-2 debug msg
+// highest level rig_debug() does anything with, printed, recorded or saved
+extern HAMLIB_EXPORT_VAR(int) rig_debug_gate_level;
+
+// build with e.g. -DRIG_DEBUG_COMPILED_MAX=RIG_DEBUG_WARN to leave out the rest
+#ifndef RIG_DEBUG_COMPILED_MAX
+#define RIG_DEBUG_COMPILED_MAX RIG_DEBUG_CACHE
+#endif
+
 #ifndef __cplusplus
 #ifdef __GNUC__
-// doing the debug macro with a dummy sprintf allows gcc to check the format string
-#define rig_debug(debug_level,fmt,...) do { strncpy(debugmsgsave3, debugmsgsave2,sizeof(debugmsgsave3));strncpy(debugmsgsave2, debugmsgsave, sizeof(debugmsgsave2));snprintf(debugmsgsave,sizeof(debugmsgsave),fmt,__VA_ARGS__);rig_debug(debug_level,fmt,##__VA_ARGS__); } while(0);
+// test the level before the call, so a message nobody wants costs a compare and its arguments are not evaluated
+#define rig_debug(debug_level,fmt,...) do { if ((debug_level) <= RIG_DEBUG_COMPILED_MAX && (int)(debug_level) <= rig_debug_gate_level) { rig_debug(debug_level,fmt,##__VA_ARGS__); } } while(0);
 #endif
 #endif
 
@@ -3286,7 +3534,18 @@ extern HAMLIB_EXPORT_VAR(char) debugmsgsave3[DEBUGMSGSAVE_SIZE];  // last-2 debu
 
 extern HAMLIB_EXPORT(void)
 rig_debug HAMLIB_PARAMS((enum rig_debug_level_e debug_level,
-                         const char *fmt, ...));
+                         const char *fmt, ...))
+#ifdef __GNUC__
+__attribute__((format(printf, 2, 3)))
+#endif
+;
+
+extern HAMLIB_EXPORT(int)
+rig_set_debug_trace HAMLIB_PARAMS((enum rig_debug_level_e debug_level,
+                                   int entries));
+
+extern HAMLIB_EXPORT(int)
+rig_debug_trace_dump HAMLIB_PARAMS((FILE *stream));
 
 extern HAMLIB_EXPORT(vprintf_cb_t)
 rig_set_debug_callback HAMLIB_PARAMS((vprintf_cb_t cb,
@@ -3328,6 +3587,11 @@ rig_probe_all HAMLIB_PARAMS((hamlib_port_t *p,
 extern HAMLIB_EXPORT(rig_model_t)
 rig_probe HAMLIB_PARAMS((hamlib_port_t *p));
 
+extern HAMLIB_EXPORT(int)
+rig_probe_ports HAMLIB_PARAMS((hamlib_port_t *ports[],
+                               int nports,
+                               rig_model_t models[]));
+
 
 /* Misc calls */
 extern HAMLIB_EXPORT(const char *) rig_strrmode(rmode_t mode);
@@ -3365,6 +3629,23 @@ extern HAMLIB_EXPORT(void) rig_no_restore_ai();
 
 extern HAMLIB_EXPORT(int) rig_get_cache_timeout_ms(RIG *rig, hamlib_cache_t selection);
 extern HAMLIB_EXPORT(int) rig_set_cache_timeout_ms(RIG *rig, hamlib_cache_t selection, int ms);
+extern HAMLIB_EXPORT(int) rig_get_setting_cache_timeout_ms(RIG *rig, hamlib_cache_t selection, setting_t setting);
+extern HAMLIB_EXPORT(int) rig_set_setting_cache_timeout_ms(RIG *rig, hamlib_cache_t selection, setting_t setting, int ms);
+
+extern HAMLIB_EXPORT(int) rig_snapshot_decode(const unsigned char *buffer, size_t length, struct rig_snapshot *snapshot);
+
+extern HAMLIB_EXPORT(int) rig_get_spectrum_lines(RIG *rig, uint64_t *cursor, struct rig_spectrum_ref *refs, int max);
+extern HAMLIB_EXPORT(int) rig_spectrum_ref_valid(RIG *rig, const struct rig_spectrum_ref *ref);
+
+extern HAMLIB_EXPORT(int) rig_set_priority(int priority);
+extern HAMLIB_EXPORT(int) rig_get_priority(void);
+extern HAMLIB_EXPORT(int) rig_get_transaction_stats(RIG *rig, int priority, struct rig_transaction_stats *stats);
+extern HAMLIB_EXPORT(int) rig_get_call_stats(RIG *rig, int n, struct rig_call_stats *stats);
+extern HAMLIB_EXPORT(int) rig_get_port_stats(RIG *rig, struct rig_port_stats *stats);
+extern HAMLIB_EXPORT(int) rig_stats_prometheus(RIG *rig, FILE *stream);
+
+extern HAMLIB_EXPORT(int) port_transaction_submit(hamlib_port_t *p, const struct port_transaction *transaction);
+extern HAMLIB_EXPORT(int) port_transaction_wait(hamlib_port_t *p);
 
 extern HAMLIB_EXPORT(int) rig_set_vfo_opt(RIG *rig, int status);
 extern HAMLIB_EXPORT(int) rig_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode, pbwidth_t *width, split_t *split, int *satmode);
@@ -45,6 +45,7 @@
 #define MAXXMLLEN 8192
 #define MAXARGLEN 128
 #define MAXBANDWIDTHLEN 4096
+#define FLRIG_MAX_MULTICALL 8
 
 #define DEFAULTPATH "127.0.0.1:12345"
 
@@ -99,6 +100,8 @@ static int flrig_power2mW(RIG *rig, unsigned int *mwpower, float power,
                           freq_t freq, rmode_t mode);
 static int flrig_mW2power(RIG *rig, float *power, unsigned int mwpower,
                           freq_t freq, rmode_t mode);
+static int flrig_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                              pbwidth_t *width, split_t *split);
 
 struct flrig_priv_data
 {
@@ -117,11 +120,28 @@ struct flrig_priv_data
     int has_get_modeA; /* True if this function is available */
     int has_get_bwA; /* True if this function is available */
     int has_verify_cmds; // has the verify cmd in FLRig 1.3.54.1 or higher
+    int has_multicall; /* False once flrig refused a system.multicall */
+    int resync; /* a reply was left unread, flush before the next request */
     float powermeter_scale;  /* So we can scale power meter to 0-1 */
     value_t parms[RIG_SETTING_MAX];
     struct ext_list *ext_parms;
 };
 
+/* one value of a response, see xml_extract() */
+struct xml_value
+{
+    char *value;        /* scalars found, pipe delimited */
+    int value_len;
+    int fault;          /* a faultCode/faultString struct instead of a value */
+};
+
+/* one of the calls of flrig_multicall() */
+struct flrig_call
+{
+    const char *cmd;
+    char value[MAXARGLEN];
+};
+
 /* level's and parm's tokens */
 #define TOK_FLRIG_VERIFY_FREQ    TOKEN_BACKEND(1)
 #define TOK_FLRIG_VERIFY_PTT     TOKEN_BACKEND(2)
@@ -142,7 +162,7 @@ const struct rig_caps flrig_caps =
     RIG_MODEL(RIG_MODEL_FLRIG),
     .model_name = "FLRig",
     .mfg_name = "FLRig",
-    .version = "20220205.0",
+    .version = "20261016.0",
     .copyright = "LGPL",
     .status = RIG_STATUS_STABLE,
     .rig_type = RIG_TYPE_TRANSCEIVER,
@@ -211,6 +231,7 @@ const struct rig_caps flrig_caps =
     .get_ext_parm =  flrig_get_ext_parm,
     .power2mW =   flrig_power2mW,
     .mW2power =   flrig_mW2power,
+    .rig_get_vfo_info = flrig_get_vfo_info,
     .hamlib_check_rig_caps = HAMLIB_CHECK_RIG_CAPS
 };
 
@@ -287,7 +308,8 @@ static char *xml_build(RIG *rig, char *cmd, char *value, char *xmlbuf,
 
     header =
         "POST /RPC2 HTTP/1.1\r\n" "User-Agent: XMLRPC++ 0.8\r\n"
-        "Host: 127.0.0.1:12345\r\n" "Content-type: text/xml\r\n";
+        "Host: 127.0.0.1:12345\r\n" "Connection: keep-alive\r\n"
+        "Content-type: text/xml\r\n";
     SNPRINTF(xmlbuf, xmlbuflen, "%s", header);
 
     SNPRINTF(xml, sizeof(xml),
@@ -300,10 +322,10 @@ static char *xml_build(RIG *rig, char *cmd, char *value, char *xmlbuf,
 
     if (value && strlen(value) > 0)
     {
-        strncat(xml, value, sizeof(xml) - 1);
+        strncat(xml, value, sizeof(xml) - strlen(xml) - 1);
     }
 
-    strncat(xml, "</methodCall>\r\n", sizeof(xml) - 1);
+    strncat(xml, "</methodCall>\r\n", sizeof(xml) - strlen(xml) - 1);
     strncat(xmlbuf, "Content-length: ", xmlbuflen - 1);
     SNPRINTF(tmp, sizeof(tmp), "%d\r\n\r\n", (int)strlen(xml));
     strncat(xmlbuf, tmp, xmlbuflen - 1);
@@ -311,192 +333,213 @@ static char *xml_build(RIG *rig, char *cmd, char *value, char *xmlbuf,
     return xmlbuf;
 }
 
-/*This is a very crude xml parse specific to what we need from FLRig
-* This works for strings, doubles, I4-type values, and arrays
-* Arrays are returned pipe delimited
+/*
+* xml_scalar
+* True for the elements whose text is a value
 */
-static char *xml_parse2(char *xml, char *value, int valueLen)
+static int xml_scalar(const char *name, size_t len)
 {
-    char *delims = "<>\r\n ";
-    char *xmltmp = strdup(xml);
-    //rig_debug(RIG_DEBUG_TRACE, "%s: xml='%s'\n", __func__,xml);
-    char *pr = xml;
-    char *p = strtok_r(xmltmp, delims, &pr);
-    value[0] = 0;
-
-    while (p)
+    static const char *const scalars[] =
     {
-        if (streq(p, "value"))
-        {
-            p = strtok_r(NULL, delims, &pr);
-
-            if (streq(p, "array")) { continue; }
-
-            if (streq(p, "/value")) { continue; } // empty value
-
-            if (streq(p, "i4") || streq(p, "double") || streq(p, "int")
-                    || streq(p, " string"))
-            {
-                p = strtok_r(NULL, delims, &pr);
-            }
-            else if (streq(p, "array"))
-            {
-                strtok_r(NULL, delims, &pr);
-                p = strtok_r(NULL, delims, &pr);
-            }
-
-            if (strlen(value) + strlen(p) + 1 < valueLen)
-            {
-                if (value[0] != 0) { strcat(value, "|"); }
+        "value", "string", "i4", "int", "double", "boolean", NULL
+    };
+    int i;
 
-                strcat(value, p);
-            }
-            else   // we'll just stop adding stuff
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s: max value length exceeded\n", __func__);
-            }
-        }
-        else
+    for (i = 0; scalars[i]; i++)
+    {
+        if (strlen(scalars[i]) == len && strncmp(name, scalars[i], len) == 0)
         {
-            p = strtok_r(NULL, delims, &pr);
+            return 1;
         }
     }
 
-    rig_debug(RIG_DEBUG_TRACE, "%s: value returned='%s'\n", __func__, value);
+    return 0;
+}
 
-    if (rig_need_debug(RIG_DEBUG_WARN) && value != NULL && strlen(value) == 0)
+/*
+* xml_append
+* Adds text to the pipe delimited value
+*/
+static void xml_append(struct xml_value *v, const char *text, size_t len)
+{
+    size_t used = strlen(v->value);
+
+    if (used + len + 2 > (size_t) v->value_len)
     {
-        rig_debug(RIG_DEBUG_ERR, "%s: xml='%s'\n", __func__, xml);
+        rig_debug(RIG_DEBUG_ERR, "%s: max value length exceeded\n", __func__);
+        return;
     }
 
-    free(xmltmp);
-    return value;
+    if (used > 0) { v->value[used++] = '|'; }
+
+    memcpy(v->value + used, text, len);
+    v->value[used + len] = 0;
 }
 
-/*
-* xml_parse
-* Assumes xml!=NULL, value!=NULL, value_len big enough
-* returns the string value contained in the xml string
+/*This is a very crude xml parse specific to what we need from FLRig
+* xml_extract makes a single pass over the body of a response without
+* copying it.  Each <value> element at depth group_depth starts the next
+* entry of values, and the text of the scalars inside it is added to that
+* entry.  group_depth is 1 for the response of one call, where arrays come
+* back pipe delimited, and 2 for the responses of a system.multicall.
+* Returns the number of entries seen, or -1 for a fault response.
 */
-static char *xml_parse(char *xml, char *value, int value_len)
+static int xml_extract(const char *xml, struct xml_value *values, int nvalues,
+                       int group_depth)
 {
-    char *next;
-    char *pxml;
+    const char *p = xml;
+    const char *text = NULL;
+    int depth = 0;
+    int n = 0;
+    int fault = 0;
+    int i;
 
-    /* first off we should have an OK on the 1st line */
-    if (strstr(xml, " 200 OK") == NULL)
+    for (i = 0; i < nvalues; i++)
     {
-        return (NULL);
+        values[i].value[0] = 0;
+        values[i].fault = 0;
     }
 
-    rig_debug(RIG_DEBUG_TRACE, "%s XML:\n%s\n", __func__, xml);
+    while ((p = strchr(p, '<')) != NULL)
+    {
+        const char *name = p + 1;
+        const char *end;
+        int closing = 0;
+        size_t len;
 
-    // find the xml skipping the other stuff above it
-    pxml = strstr(xml, "<?xml");
+        if (*name == '/')
+        {
+            closing = 1;
+            name++;
+        }
 
-    if (pxml == NULL)
-    {
-        return (NULL);
-    }
+        end = strchr(name, '>');
 
-    next = strchr(pxml + 1, '<');
+        if (end == NULL) { break; }
 
-    if (value != NULL)
-    {
-        xml_parse2(next, value, value_len);
-    }
+        len = strcspn(name, " \t\r\n/>");
 
-    if (value && strstr(value, "faultString"))
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s error:\n%s\n", __func__, value);
-        value[0] = 0; /* truncate to give empty response */
+        if (*name == '?' || *name == '!')
+        {
+            /* <?xml ...?> and comments */
+        }
+        else if (!closing)
+        {
+            if (len == 5 && strncmp(name, "value", 5) == 0 && end[-1] != '/')
+            {
+                if (++depth == group_depth) { n++; }
+            }
+            else if (len == 5 && strncmp(name, "fault", 5) == 0)
+            {
+                fault = 1;
+            }
+            else if (len == 6 && strncmp(name, "struct", 6) == 0
+                     && depth >= group_depth && n > 0 && n <= nvalues)
+            {
+                /* a struct is only returned as faultCode/faultString */
+                values[n - 1].fault = 1;
+            }
+
+            text = end[-1] == '/' ? NULL : end + 1;
+        }
+        else
+        {
+            /* the text of a leaf element */
+            if (text && depth >= group_depth && n > 0 && n <= nvalues
+                    && xml_scalar(name, len))
+            {
+                xml_append(&values[n - 1], text, p - text);
+            }
+
+            if (len == 5 && strncmp(name, "value", 5) == 0) { depth--; }
+
+            text = NULL;
+        }
+
+        p = end + 1;
     }
 
-    return (value);
+    return fault ? -1 : n;
 }
 
 /*
 * read_transaction
+* Reads the HTTP header of a response, then as much body as it announces,
+* so no time is spent looking for the end of the XML
 * Assumes rig!=NULL, xml!=NULL, xml_len>=MAXXMLLEN
 */
 static int read_transaction(RIG *rig, char *xml, int xml_len)
 {
-    int retval;
-    int retry;
-    char *delims;
-    char *terminator = "</methodResponse>";
     struct rig_state *rs = &rig->state;
+    struct flrig_priv_data *priv = (struct flrig_priv_data *) rs->priv;
+    char line[MAXARGLEN * 2];
+    int content_length = -1;
+    int first = 1;
+    int len;
 
     ENTERFUNC;
 
-    retry = 2;
-    delims = "\n";
     xml[0] = 0;
 
-    do
+    for (;;)
     {
-        char tmp_buf[MAXXMLLEN];        // plenty big for expected flrig responses hopefully
+        len = read_string(&rs->rigport, (unsigned char *) line, sizeof(line), "\n", 1,
+                          0, 1);
 
-        if (retry < 2)
+        if (len <= 0)
         {
-            rig_debug(RIG_DEBUG_WARN, "%s: retry needed? retry=%d\n", __func__, retry);
+            rig_debug(RIG_DEBUG_ERR, "%s: read_string error=%d\n", __func__, len);
+            priv->resync = 1;
+            RETURNFUNC(len < 0 ? len : -RIG_ETIMEOUT);
         }
 
-        int len = read_string(&rs->rigport, (unsigned char *) tmp_buf, sizeof(tmp_buf),
-                              delims,
-                              strlen(delims), 0, 1);
-        rig_debug(RIG_DEBUG_TRACE, "%s: string='%s'\n", __func__, tmp_buf);
+        rig_debug(RIG_DEBUG_TRACE, "%s: header='%s'\n", __func__, line);
 
-        // if our first response we should see the HTTP header
-        if (strlen(xml) == 0 && strstr(tmp_buf, "HTTP/1.1 200 OK") == NULL)
+        if (first)
         {
-            rig_debug(RIG_DEBUG_ERR, "%s: Expected 'HTTP/1.1 200 OK', got '%s'\n", __func__,
-                      tmp_buf);
-            continue; // we'll try again
-        }
-
-        if (len > 0) { retry = 3; }
+            if (strncmp(line, "HTTP/1.", 7) != 0 || strstr(line, " 200 ") == NULL)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: Expected 'HTTP/1.1 200 OK', got '%s'\n", __func__,
+                          line);
+                priv->resync = 1;
+                RETURNFUNC(-RIG_EPROTO);
+            }
 
-        if (len <= 0)
-        {
-            rig_debug(RIG_DEBUG_ERR, "%s: read_string error=%d\n", __func__, len);
-            continue;
+            first = 0;
         }
-
-        if (strlen(xml) + strlen(tmp_buf) < xml_len - 1)
+        else if (line[0] == '\r' || line[0] == '\n')
         {
-            strncat(xml, tmp_buf, xml_len - 1);
+            break;
         }
-        else
+        else if (strncasecmp(line, "Content-length:", 15) == 0)
         {
-            rig_debug(RIG_DEBUG_ERR,
-                      "%s: xml buffer overflow!!\nTrying to add len=%d\nTo len=%d\n", __func__,
-                      (int)strlen(tmp_buf), (int)strlen(xml));
-            RETURNFUNC(-RIG_EPROTO);
+            content_length = atoi(line + 15);
         }
     }
-    while (retry-- > 0 && strstr(xml, terminator) == NULL);
 
-    if (retry == 0)
+    if (content_length <= 0 || content_length >= xml_len)
     {
-        rig_debug(RIG_DEBUG_WARN, "%s: retry timeout\n", __func__);
-        RETURNFUNC(-RIG_ETIMEOUT);
+        rig_debug(RIG_DEBUG_ERR, "%s: bad Content-length %d\n", __func__,
+                  content_length);
+        priv->resync = 1;
+        RETURNFUNC(-RIG_EPROTO);
     }
 
-    if (strstr(xml, terminator))
-    {
-        rig_debug(RIG_DEBUG_TRACE, "%s: got %s\n", __func__, terminator);
-        // Slow down just a bit -- not sure this is needed anymore but not a big deal here
-        hl_usleep(2 * 1000);
-        retval = RIG_OK;
-    }
-    else
+    len = read_block(&rs->rigport, (unsigned char *) xml, content_length);
+
+    if (len != content_length)
     {
-        rig_debug(RIG_DEBUG_VERBOSE, "%s: did not get %s\n", __func__, terminator);
-        retval = -(101 + RIG_EPROTO);
+        rig_debug(RIG_DEBUG_ERR, "%s: got %d of %d bytes\n", __func__, len,
+                  content_length);
+        xml[0] = 0;
+        priv->resync = 1;
+        RETURNFUNC(len < 0 ? len : -RIG_ETIMEOUT);
     }
 
-    RETURNFUNC(retval);
+    xml[len] = 0;
+    rig_debug(RIG_DEBUG_TRACE, "%s XML:\n%s\n", __func__, xml);
+
+    RETURNFUNC(RIG_OK);
 }
 
 /*
@@ -511,6 +554,7 @@ static int write_transaction(RIG *rig, char *xml, int xml_len)
     int retval = -RIG_EPROTO;
 
     struct rig_state *rs = &rig->state;
+    struct flrig_priv_data *priv = (struct flrig_priv_data *) rs->priv;
 
     ENTERFUNC;
 
@@ -522,9 +566,12 @@ static int write_transaction(RIG *rig, char *xml, int xml_len)
         RETURNFUNC(retval);
     }
 
-    // appears we can lose sync if we don't clear things out
-    // shouldn't be anything for us now anyways
-    rig_flush(&rig->state.rigport);
+    // the rest of a response we gave up on would be taken for the next one
+    if (priv->resync)
+    {
+        rig_flush(&rig->state.rigport);
+        priv->resync = 0;
+    }
 
     while (try-- >= 0 && retval != RIG_OK)
         {
@@ -543,6 +590,7 @@ static int flrig_transaction(RIG *rig, char *cmd, char *cmd_arg, char *value,
                              int value_len)
 {
     char xml[MAXXMLLEN];
+    struct xml_value v;
     int retry = 3;
 
     ENTERFUNC;
@@ -555,6 +603,9 @@ static int flrig_transaction(RIG *rig, char *cmd, char *cmd_arg, char *value,
         value[0] = 0;
     }
 
+    v.value = value;
+    v.value_len = value_len;
+
     do
     {
         char *pxml;
@@ -579,14 +630,16 @@ static int flrig_transaction(RIG *rig, char *cmd, char *cmd_arg, char *value,
             hl_usleep(50 * 1000); // 50ms sleep if error
         }
 
-        read_transaction(rig, xml, sizeof(xml)); // this might time out -- that's OK
-
-        // we get an uknown response if function does not exist
-        if (strstr(xml, "unknown")) { set_transaction_inactive(rig); RETURNFUNC(RIG_ENAVAIL); }
+        // this might time out -- that's OK
+        if (read_transaction(rig, xml, sizeof(xml)) != RIG_OK) { continue; }
 
-        if (value)
+        if (xml_extract(xml, &v, value ? 1 : 0, 1) < 0)
         {
-            xml_parse(xml, value, value_len);
+            // we get an uknown response if function does not exist
+            if (strstr(xml, "unknown")) { set_transaction_inactive(rig); RETURNFUNC(RIG_ENAVAIL); }
+
+            rig_debug(RIG_DEBUG_ERR, "%s error:\n%s\n", __func__, xml);
+            set_transaction_inactive(rig); RETURNFUNC(-RIG_EPROTO);
         }
     }
     while (((value && strlen(value) == 0) || (strlen(xml) == 0))
@@ -603,6 +656,97 @@ static int flrig_transaction(RIG *rig, char *cmd, char *cmd_arg, char *value,
     RETURNFUNC(RIG_OK);
 }
 
+/*
+* flrig_multicall
+* Sends calls, which take no argument, in a single system.multicall request
+* so they cost one round trip instead of one each
+* Returns -RIG_ENAVAIL if flrig does not take multicalls
+*/
+static int flrig_multicall(RIG *rig, struct flrig_call *calls, int ncalls)
+{
+    struct flrig_priv_data *priv = (struct flrig_priv_data *) rig->state.priv;
+    struct xml_value values[FLRIG_MAX_MULTICALL];
+    char xml[MAXXMLLEN];
+    char arg[2048];
+    char *pxml;
+    int retval;
+    int i;
+
+    ENTERFUNC;
+
+    if (ncalls > FLRIG_MAX_MULTICALL)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    SNPRINTF(arg, sizeof(arg), "<params><param><value><array><data>\r\n");
+
+    for (i = 0; i < ncalls; i++)
+    {
+        size_t len = strlen(arg);
+
+        SNPRINTF(arg + len, sizeof(arg) - len,
+                 "<value><struct><member><name>methodName</name><value>%s</value></member>"
+                 "<member><name>params</name><value><array><data></data></array></value></member>"
+                 "</struct></value>\r\n", calls[i].cmd);
+    }
+
+    strncat(arg, "</data></array></value></param></params>\r\n",
+            sizeof(arg) - strlen(arg) - 1);
+
+    set_transaction_active(rig);
+
+    pxml = xml_build(rig, "system.multicall", arg, xml, sizeof(xml));
+    retval = write_transaction(rig, pxml, strlen(pxml));
+
+    if (retval == RIG_OK)
+    {
+        retval = read_transaction(rig, xml, sizeof(xml));
+    }
+
+    set_transaction_inactive(rig);
+
+    if (retval != RIG_OK)
+    {
+        RETURNFUNC(retval);
+    }
+
+    for (i = 0; i < ncalls; i++)
+    {
+        values[i].value = calls[i].value;
+        values[i].value_len = sizeof(calls[i].value);
+    }
+
+    retval = xml_extract(xml, values, ncalls, 2);
+
+    if (retval < 0)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: system.multicall is not available\n",
+                  __func__);
+        priv->has_multicall = 0;
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    if (retval != ncalls)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: %d responses to %d calls\n", __func__, retval,
+                  ncalls);
+        RETURNFUNC(-RIG_EPROTO);
+    }
+
+    for (i = 0; i < ncalls; i++)
+    {
+        if (values[i].fault || calls[i].value[0] == 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: %s failed: %s\n", __func__, calls[i].cmd,
+                      calls[i].value);
+            RETURNFUNC(-RIG_ENAVAIL);
+        }
+    }
+
+    RETURNFUNC(RIG_OK);
+}
+
 /*
 * flrig_init
 * Assumes rig!=NULL
@@ -789,6 +933,10 @@ static int flrig_open(RIG *rig)
     ENTERFUNC;
     rig_debug(RIG_DEBUG_VERBOSE, "%s version %s\n", __func__, rig->caps->version);
 
+    /* a new connection, nothing left to flush; try multicalls again */
+    priv->resync = 0;
+    priv->has_multicall = 1;
+
     retval = flrig_transaction(rig, "main.get_version", NULL, value, sizeof(value));
 
     if (retval != RIG_OK)
@@ -1273,7 +1421,6 @@ static int flrig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
 static int flrig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 {
     char value[MAXCMDLEN];
-    char xml[MAXXMLLEN];
     struct flrig_priv_data *priv = (struct flrig_priv_data *) rig->state.priv;
 
     ENTERFUNC;
@@ -1289,7 +1436,6 @@ static int flrig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
         RETURNFUNC(retval);
     }
 
-    xml_parse(xml, value, sizeof(value));
     *ptt = atoi(value);
     rig_debug(RIG_DEBUG_TRACE, "%s: '%s'\n", __func__, value);
 
@@ -1957,6 +2103,82 @@ static int flrig_get_split_vfo(RIG *rig, vfo_t vfo, split_t *split,
     RETURNFUNC(RIG_OK);
 }
 
+/*
+* flrig_get_vfo_info
+* Reads frequency, mode, width and split in one system.multicall
+* assumes rig!=NULL, rig->state.priv!=NULL
+*/
+static int flrig_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                              pbwidth_t *width, split_t *split)
+{
+    struct flrig_priv_data *priv = (struct flrig_priv_data *) rig->state.priv;
+    struct flrig_call calls[4];
+    char *p;
+    int retval;
+
+    ENTERFUNC;
+
+    if (vfo == RIG_VFO_CURR)
+    {
+        vfo = rig->state.current_vfo;
+    }
+
+    // the older calls need VFO swapping, and while transmitting get_mode
+    // answers from priv, so leave those to the individual gets
+    if (!priv->has_multicall || !priv->has_get_modeA || !priv->has_get_bwA
+            || priv->ptt || (vfo != RIG_VFO_A && vfo != RIG_VFO_B))
+    {
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    calls[0].cmd = vfo == RIG_VFO_A ? "rig.get_vfoA" : "rig.get_vfoB";
+    calls[1].cmd = vfo == RIG_VFO_A ? "rig.get_modeA" : "rig.get_modeB";
+    calls[2].cmd = vfo == RIG_VFO_A ? "rig.get_bwA" : "rig.get_bwB";
+    calls[3].cmd = "rig.get_split";
+
+    retval = flrig_multicall(rig, calls, 4);
+
+    if (retval != RIG_OK)
+    {
+        RETURNFUNC(retval);
+    }
+
+    *freq = atof(calls[0].value);
+
+    if (*freq == 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: freq==0??\nvalue=%s\n", __func__,
+                  calls[0].value);
+        RETURNFUNC(-RIG_EPROTO);
+    }
+
+    *mode = modeMapGetHamlib(calls[1].value);
+
+    /* we might get two values and then we want the 2nd one */
+    p = strchr(calls[2].value, '|');
+    *width = atoi(p ? p + 1 : calls[2].value);
+
+    *split = atoi(calls[3].value);
+    priv->split = *split;
+
+    if (vfo == RIG_VFO_A)
+    {
+        priv->curr_freqA = *freq;
+        priv->curr_modeA = *mode;
+        priv->curr_widthA = *width;
+    }
+    else
+    {
+        priv->curr_freqB = *freq;
+        priv->curr_modeB = *mode;
+        priv->curr_widthB = *width;
+    }
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: freq=%.0f mode=%s width=%d split=%d\n",
+              __func__, *freq, rig_strrmode(*mode), (int) *width, *split);
+    RETURNFUNC(RIG_OK);
+}
+
 /*
 * flrig_set_split_freq_mode
 * assumes rig!=NULL
@@ -423,6 +423,7 @@ int icom_transaction(RIG *rig, int cmd, int subcmd,
     int retval, retry;
 
     ENTERFUNC;
+    ELAPSED1;
     rig_debug(RIG_DEBUG_VERBOSE,
               "%s: cmd=0x%02x, subcmd=0x%02x, payload_len=%d\n", __func__,
               cmd, subcmd, payload_len);
@@ -455,6 +456,198 @@ int icom_transaction(RIG *rig, int cmd, int subcmd,
     RETURNFUNC(retval);
 }
 
+/*
+ * Find the request a reply frame answers: the oldest one in flight with the
+ * same command and subcommand, or the oldest one for an ACK/NAK, since the
+ * rig answers in order.  Returns -1 if none matches.
+ */
+static int icom_pipeline_match(const struct icom_pipeline_cmd *cmds,
+                               const int *answered, int sent,
+                               const unsigned char *buf, int frm_len)
+{
+    int i;
+
+    for (i = 0; i < sent; i++)
+    {
+        if (answered[i])
+        {
+            continue;
+        }
+
+        if (buf[4] == ACK || buf[4] == NAK)
+        {
+            return i;
+        }
+
+        if (buf[4] == cmds[i].cmd
+                && (cmds[i].subcmd == -1
+                    || (frm_len > ACKFRMLEN && buf[5] == (cmds[i].subcmd & 0xff))))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * icom_pipeline_transaction
+ *
+ * Runs several requests with up to priv->pipeline_depth of them in flight,
+ * instead of waiting for each reply before sending the next command.  The
+ * frames read back are sorted out as they come: echoes of our own frames
+ * are dropped, transceive frames go to icom_process_async_frame() and
+ * replies are matched to their request with icom_pipeline_match().
+ *
+ * Each request gets its own retval and reply in data/data_len.  Requests
+ * left unanswered, e.g. after a collision or a lost frame, are retried
+ * one at a time with icom_transaction().
+ *
+ * return RIG_OK if all requests were run, their retval telling how each
+ * went, or a negative value if the port failed.
+ */
+int icom_pipeline_transaction(RIG *rig, struct icom_pipeline_cmd *cmds,
+                              int count)
+{
+    struct rig_state *rs = &rig->state;
+    struct icom_priv_data *priv = (struct icom_priv_data *) rs->priv;
+    const struct icom_priv_caps *priv_caps =
+        (const struct icom_priv_caps *) rig->caps->priv;
+    unsigned char sendbuf[ICOM_MAX_PIPELINE * MAXFRAMELEN];
+    unsigned char buf[MAXFRAMELEN];
+    int answered[ICOM_MAX_PIPELINE];
+    struct timeval start_time, current_time, elapsed_time;
+    unsigned char ctrl_id;
+    int depth = priv->pipeline_depth;
+    int sent = 0, done = 0;
+    int retval = RIG_OK;
+    int i;
+
+    ENTERFUNC;
+
+    if (count < 1 || count > ICOM_MAX_PIPELINE)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    if (depth > ICOM_MAX_PIPELINE) { depth = ICOM_MAX_PIPELINE; }
+
+    memset(answered, 0, sizeof(answered));
+
+    for (i = 0; i < count; i++)
+    {
+        cmds[i].data_len = 0;
+        cmds[i].retval = -RIG_ETIMEOUT;
+    }
+
+    if (depth > 1)
+    {
+        ctrl_id = priv_caps->serial_full_duplex == 0 ? CTRLID : 0x80;
+
+        set_transaction_active(rig);
+        rig_flush(&rs->rigport);
+        gettimeofday(&start_time, NULL);
+
+        while (done < count)
+        {
+            int len = 0;
+            int frm_len;
+
+            /* top up the window, all new frames in one write */
+            while (sent < count && sent - done < depth)
+            {
+                len += make_cmd_frame(sendbuf + len, priv->re_civ_addr, ctrl_id,
+                                      cmds[sent].cmd, cmds[sent].subcmd,
+                                      cmds[sent].payload, cmds[sent].payload_len);
+                sent++;
+            }
+
+            if (len > 0 && (retval = write_block(&rs->rigport, sendbuf, len)) != RIG_OK)
+            {
+                break;
+            }
+
+            frm_len = read_icom_frame(&rs->rigport, buf, sizeof(buf));
+
+            if (frm_len < 0)
+            {
+                rig_debug(RIG_DEBUG_WARN, "%s: %d of %d answered: %s\n", __func__, done,
+                          count, rigerror(frm_len));
+                break;
+            }
+
+            if (frm_len < ACKFRMLEN || icom_frame_fix_preamble(frm_len, buf) < 0
+                    || buf[frm_len - 1] != FI)
+            {
+                /* collision or garbage, what is still in flight is lost */
+                rig_debug(RIG_DEBUG_WARN, "%s: bad frame, len=%d\n", __func__, frm_len);
+                break;
+            }
+
+            if (buf[2] == priv->re_civ_addr && buf[3] == ctrl_id)
+            {
+                continue;   /* echo of a request */
+            }
+
+            if (icom_is_async_frame(rig, frm_len, buf))
+            {
+                icom_process_async_frame(rig, frm_len, buf);
+            }
+            else if ((i = icom_pipeline_match(cmds, answered, sent, buf, frm_len)) >= 0)
+            {
+                answered[i] = 1;
+                done++;
+                cmds[i].data_len = frm_len - (ACKFRMLEN - 1);
+                memcpy(cmds[i].data, buf + 4, cmds[i].data_len);
+                cmds[i].retval = buf[4] == NAK ? -RIG_ERJCTED : RIG_OK;
+                gettimeofday(&start_time, NULL);
+                continue;
+            }
+            else
+            {
+                rig_debug(RIG_DEBUG_WARN, "%s: unexpected reply 0x%02x\n", __func__, buf[4]);
+            }
+
+            gettimeofday(&current_time, NULL);
+            timersub(&current_time, &start_time, &elapsed_time);
+
+            if (elapsed_time.tv_sec * 1000 + elapsed_time.tv_usec / 1000
+                    > rs->rigport.timeout)
+            {
+                break;
+            }
+        }
+
+        set_transaction_inactive(rig);
+
+        if (retval != RIG_OK)
+        {
+            RETURNFUNC(retval);
+        }
+    }
+
+    /* whatever the pipeline did not get an answer for */
+    for (i = 0; i < count; i++)
+    {
+        if (answered[i])
+        {
+            continue;
+        }
+
+        cmds[i].data_len = sizeof(cmds[i].data);
+        cmds[i].retval = icom_transaction(rig, cmds[i].cmd, cmds[i].subcmd,
+                                          cmds[i].payload, cmds[i].payload_len,
+                                          cmds[i].data, &cmds[i].data_len);
+
+        if (cmds[i].retval != RIG_OK && cmds[i].retval != -RIG_ERJCTED)
+        {
+            RETURNFUNC(cmds[i].retval);
+        }
+    }
+
+    RETURNFUNC(RIG_OK);
+}
+
 /* used in read_icom_frame as end of block */
 static const char icom_block_end[2] = { FI, COL};
 #define icom_block_end_length 2
@@ -34,6 +34,22 @@ int make_cmd_frame(unsigned char frame[], unsigned char re_id, unsigned char ctr
 int icom_frame_fix_preamble(int frame_len, unsigned char *frame);
 
 int icom_transaction (RIG *rig, int cmd, int subcmd, const unsigned char *payload, int payload_len, unsigned char *data, int *data_len);
+
+#define ICOM_MAX_PIPELINE 8 /* most requests kept in flight */
+
+/* one request of icom_pipeline_transaction() */
+struct icom_pipeline_cmd
+{
+    int cmd;
+    int subcmd;                         /* -1 if none */
+    const unsigned char *payload;
+    int payload_len;
+    unsigned char data[MAXFRAMELEN];    /* Cn,Sc,data of the reply, as icom_transaction */
+    int data_len;
+    int retval;
+};
+
+int icom_pipeline_transaction(RIG *rig, struct icom_pipeline_cmd *cmds, int count);
 int read_icom_frame(hamlib_port_t *p, const unsigned char rxbuffer[], size_t rxbuffer_len);
 int read_icom_frame_direct(hamlib_port_t *p, const unsigned char rxbuffer[], size_t rxbuffer_len);
 
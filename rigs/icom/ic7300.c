@@ -277,6 +277,7 @@ static const struct icom_priv_caps IC7300_priv_caps =
     0,      /* 731 mode */
     1,      /* no XCHG to avoid display flickering */
     ic7300_ts_sc_list,
+    .pipeline_depth = 4,  /* on USB; set civ_pipeline=1 on a shared CI-V bus */
     .agc_levels_present = 1,
     .agc_levels = {
         { .level = RIG_AGC_FAST, .icom_level = 1 },
@@ -373,6 +374,7 @@ static const struct icom_priv_caps IC9700_priv_caps =
     0,      /* 731 mode */
     1,      /* no XCHG to avoid display flickering */
     ic9700_ts_sc_list,
+    .pipeline_depth = 4,  /* on USB; set civ_pipeline=1 on a shared CI-V bus */
     .serial_USB_echo_check = 1,  /* USB CI-V may not echo */
     .agc_levels_present = 1,
     .agc_levels = {
@@ -420,6 +422,7 @@ static const struct icom_priv_caps IC705_priv_caps =
     0,      /* 731 mode */
     1,      /* no XCHG to avoid display flickering */
     ic705_ts_sc_list,
+    .pipeline_depth = 4,  /* on USB; set civ_pipeline=1 on a shared CI-V bus */
     .serial_USB_echo_check = 1,  /* USB CI-V may not echo */
     .agc_levels_present = 1,
     .agc_levels = {
@@ -758,6 +761,7 @@ const struct rig_caps ic7300_caps =
     .get_split_mode =  icom_get_split_mode,
     .set_split_vfo =  icom_set_split_vfo,
     .get_split_vfo =  icom_get_split_vfo,
+    .rig_get_vfo_info =  icom_get_vfo_info,
     .set_powerstat = icom_set_powerstat,
     .get_powerstat = icom_get_powerstat,
     .power2mW = icom_power2mW,
@@ -1072,6 +1076,7 @@ const struct rig_caps ic9700_caps =
     .get_split_mode =  icom_get_split_mode,
     .set_split_vfo =  icom_set_split_vfo,
     .get_split_vfo =  icom_get_split_vfo,
+    .rig_get_vfo_info =  icom_get_vfo_info,
     .set_powerstat = icom_set_powerstat,
     .power2mW = icom_power2mW,
     .mW2power = icom_mW2power,
@@ -1336,6 +1341,7 @@ const struct rig_caps ic705_caps =
     .get_split_mode =  icom_get_split_mode,
     .set_split_vfo =  icom_set_split_vfo,
     .get_split_vfo =  icom_get_split_vfo,
+    .rig_get_vfo_info =  icom_get_vfo_info,
     .set_powerstat = icom_set_powerstat,
     .get_powerstat = icom_get_powerstat,
     .power2mW = icom_power2mW,
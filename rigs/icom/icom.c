@@ -37,6 +37,8 @@
 #include <cal.h>
 #include <token.h>
 #include <register.h>
+#include <cache.h>
+#include <probe.h>
 
 #include "icom.h"
 #include "icom_defs.h"
@@ -428,6 +430,7 @@ struct icom_addr
 #define TOK_CIVADDR TOKEN_BACKEND(1)
 #define TOK_MODE731 TOKEN_BACKEND(2)
 #define TOK_NOXCHG TOKEN_BACKEND(3)
+#define TOK_PIPELINE TOKEN_BACKEND(4)
 
 const struct confparams icom_cfg_params[] =
 {
@@ -445,6 +448,11 @@ const struct confparams icom_cfg_params[] =
         "Don't Use VFO XCHG to set other VFO mode and Frequency",
         "0", RIG_CONF_CHECKBUTTON
     },
+    {
+        TOK_PIPELINE, "civ_pipeline", "CI-V pipeline depth",
+        "Requests sent ahead of the replies, 1 for none, 0 for the rig default; use 1 on a shared CI-V bus",
+        "0", RIG_CONF_NUMERIC, {.n = {0, ICOM_MAX_PIPELINE, 1}}
+    },
     {RIG_CONF_END, NULL,}
 };
 
@@ -672,6 +680,7 @@ int icom_init(RIG *rig)
     priv->re_civ_addr = priv_caps->re_civ_addr;
     priv->civ_731_mode = priv_caps->civ_731_mode;
     priv->no_xchg = priv_caps->no_xchg;
+    priv->pipeline_depth = priv_caps->pipeline_depth > 0 ? priv_caps->pipeline_depth : 1;
     priv->tx_vfo = RIG_VFO_NONE;
     priv->rx_vfo = RIG_VFO_NONE;
     rig->state.current_vfo = RIG_VFO_NONE;
@@ -1806,6 +1815,40 @@ int icom_set_xit_new(RIG *rig, vfo_t vfo, shortfreq_t ts)
 
 int filtericom[] = { 50, 100, 150, 200, 250, 300, 350, 400, 450, 500, 600, 700, 800, 900, 1000, 1100, 1200, 1300, 1400, 1500, 1600, 1700, 1800, 1900, 2000, 2100, 2200, 2300, 2400, 2500, 2600, 2700, 2800, 2900, 3000, 3100, 3200, 3300, 3400, 3500, 3600 };
 
+/* width in Hz from the reply to $1A$03, 0 if not known */
+static pbwidth_t icom_dsp_flt_width(rmode_t mode, const unsigned char *resbuf,
+                                    int res_len)
+{
+    if (res_len == 3 && resbuf[0] == C_CTL_MEM)
+    {
+        int i;
+        i = (int) from_bcd(resbuf + 2, 2);
+        rig_debug(RIG_DEBUG_TRACE, "%s: i=%d, [0]=%02x, [1]=%02x, [2]=%02x, [3]=%02x\n",
+                  __func__, i, resbuf[0], resbuf[1], resbuf[2], resbuf[3]);
+
+        if (mode & RIG_MODE_AM)
+        {
+            if (i > 49)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: Expected max 49, got %d for filter\n", __func__,
+                          i);
+                return (-RIG_EPROTO);
+            }
+
+            return ((i + 1) * 200); /* All Icoms that we know of */
+        }
+        else if (mode &
+                 (RIG_MODE_CW | RIG_MODE_USB | RIG_MODE_LSB | RIG_MODE_RTTY |
+                  RIG_MODE_RTTYR | RIG_MODE_PKTUSB | RIG_MODE_PKTLSB))
+        {
+            rig_debug(RIG_DEBUG_TRACE, "%s: using filtericom width=%d\n", __func__, i);
+            return (filtericom[i]);
+        }
+    }
+
+    return (RIG_OK);
+}
+
 pbwidth_t icom_get_dsp_flt(RIG *rig, rmode_t mode)
 {
 
@@ -1872,34 +1915,7 @@ pbwidth_t icom_get_dsp_flt(RIG *rig, rmode_t mode)
         return (RIG_OK);        /* use default */
     }
 
-    if (res_len == 3 && resbuf[0] == C_CTL_MEM)
-    {
-        int i;
-        i = (int) from_bcd(resbuf + 2, 2);
-        rig_debug(RIG_DEBUG_TRACE, "%s: i=%d, [0]=%02x, [1]=%02x, [2]=%02x, [3]=%02x\n",
-                  __func__, i, resbuf[0], resbuf[1], resbuf[2], resbuf[3]);
-
-        if (mode & RIG_MODE_AM)
-        {
-            if (i > 49)
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s: Expected max 49, got %d for filter\n", __func__,
-                          i);
-                RETURNFUNC2(-RIG_EPROTO);
-            }
-
-            return ((i + 1) * 200); /* All Icoms that we know of */
-        }
-        else if (mode &
-                 (RIG_MODE_CW | RIG_MODE_USB | RIG_MODE_LSB | RIG_MODE_RTTY |
-                  RIG_MODE_RTTYR | RIG_MODE_PKTUSB | RIG_MODE_PKTLSB))
-        {
-            rig_debug(RIG_DEBUG_TRACE, "%s: using filtericom width=%d\n", __func__, i);
-            RETURNFUNC2(filtericom[i]);
-        }
-    }
-
-    RETURNFUNC2(RIG_OK);
+    RETURNFUNC2(icom_dsp_flt_width(mode, resbuf, res_len));
 }
 
 int icom_set_dsp_flt(RIG *rig, rmode_t mode, pbwidth_t width)
@@ -2499,9 +2515,9 @@ int icom_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
 
         // use cache for the non-selected VFO -- can't get it by VFO
         // this avoids vfo swapping but accurate answers for these rigs
-        *width = rig->state.cache.widthMainB;
+        *width = rig->state.cache_slot[CACHE_SLOT_MAIN_B].width;
 
-        if (vfo == RIG_VFO_SUB_B) { *width = rig->state.cache.widthSubB; }
+        if (vfo == RIG_VFO_SUB_B) { *width = rig->state.cache_slot[CACHE_SLOT_SUB_B].width; }
 
         // then get non-selected VFO mode/width
         retval = icom_transaction(rig, 0x26, vfosel, NULL, 0, modebuf, &mode_len);
@@ -2613,7 +2629,7 @@ int icom_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
                       rig_strvfo(vfo), rig_strrmode(*mode));
         }
     }
-    else if (rig->state.cache.widthMainB == 0)
+    else if (rig->state.cache_slot[CACHE_SLOT_MAIN_B].width == 0)
     {
         // we need to swap vfos to get the bandwidth -- yuck
         // so we read it once and will let set_mode and transceive capability (4.3 hamlib) update it
@@ -2629,11 +2645,11 @@ int icom_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
             retval = icom_get_dsp_flt(rig, *mode);
             *width = retval;
 
-            if (*width == 0) { *width = rig->state.cache.widthMainA; } // we'll use VFOA's width
+            if (*width == 0) { *width = rig->state.cache_slot[CACHE_SLOT_MAIN_A].width; } // we'll use VFOA's width
 
             // dont' really care about cache time here
             // this is just to prevent vfo swapping while getting width
-            rig->state.cache.widthMainB = retval;
+            rig->state.cache_slot[CACHE_SLOT_MAIN_B].width = retval;
             rig_debug(RIG_DEBUG_TRACE, "%s(%d): vfosave=%s, currvfo=%s\n", __func__,
                       __LINE__, rig_strvfo(vfo), rig_strvfo(rig->state.current_vfo));
             //TRACE;
@@ -2653,6 +2669,230 @@ int icom_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
     RETURNFUNC2(RIG_OK);
 }
 
+/*
+ * icom_get_vfo_info
+ *
+ * Frequency, mode, width and split of the current VFO with the requests
+ * pipelined by icom_pipeline_transaction(), i.e. in about one round trip
+ * instead of four or five.  Returns -RIG_ENAVAIL when this cannot be done,
+ * for the frontend to fall back to get_freq/get_mode/get_split_vfo.
+ * Assumes rig!=NULL, rig->state.priv!=NULL
+ */
+int icom_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                      pbwidth_t *width, split_t *split)
+{
+    struct icom_priv_data *priv = (struct icom_priv_data *) rig->state.priv;
+    const struct icom_priv_caps *priv_caps =
+        (const struct icom_priv_caps *) rig->caps->priv;
+    struct icom_pipeline_cmd cmds[5];
+    struct icom_pipeline_cmd *freq_cmd, *mode_cmd, *data_cmd = NULL,
+                                  *flt_cmd = NULL, *split_cmd;
+    vfo_t vfocurr = vfo_fixup(rig, rig->state.current_vfo, 0);
+    int use_x26 = (rig->caps->targetable_vfo & RIG_TARGETABLE_MODE)
+                  && rig->caps->rig_model != RIG_MODEL_IC7800;
+    unsigned char md, flt;
+    int datamode = 0;
+    int n = 0;
+    int retval;
+
+    ENTERFUNC;
+
+    vfo = vfo_fixup(rig, vfo, 0);
+
+    if (priv->pipeline_depth <= 1 || priv->civ_731_mode
+            || vfocurr == RIG_VFO_MEM || vfocurr == RIG_VFO_NONE
+            || (vfo != RIG_VFO_CURR && vfo != vfocurr))
+    {
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    memset(cmds, 0, sizeof(cmds));
+
+    freq_cmd = &cmds[n++];
+    freq_cmd->cmd = C_RD_FREQ;
+    freq_cmd->subcmd = -1;
+
+    mode_cmd = &cmds[n++];
+
+    if (use_x26)
+    {
+        /* mode, data mode and filter of the selected VFO */
+        mode_cmd->cmd = 0x26;
+        mode_cmd->subcmd = 0x00;
+    }
+    else
+    {
+        mode_cmd->cmd = C_RD_MODE;
+        mode_cmd->subcmd = -1;
+
+        if (rig->caps->get_mode == icom_get_mode_with_data)
+        {
+            data_cmd = &cmds[n++];
+            data_cmd->cmd = C_CTL_MEM;
+            data_cmd->subcmd = RIG_MODEL_IC7200 == rig->caps->rig_model ? 0x04 :
+                               S_MEM_DATA_MODE;
+        }
+    }
+
+    /* same exceptions as icom_get_mode() and icom_get_dsp_flt() */
+    if (priv->no_1a_03_cmd != ENUM_1A_03_NO
+            && rig->caps->rig_model != RIG_MODEL_IC910
+            && rig->caps->rig_model != RIG_MODEL_OMNIVIP
+            && rig->caps->rig_model != RIG_MODEL_IC706
+            && rig->caps->rig_model != RIG_MODEL_IC706MKII
+            && rig->caps->rig_model != RIG_MODEL_IC706MKIIG
+            && rig->caps->rig_model != RIG_MODEL_ICR30
+            && rig->caps->rig_model != RIG_MODEL_X108G)
+    {
+        flt_cmd = &cmds[n++];
+        flt_cmd->cmd = C_CTL_MEM;
+        flt_cmd->subcmd = RIG_MODEL_IC7200 == rig->caps->rig_model ? 0x02 :
+                          S_MEM_FILT_WDTH;
+    }
+
+    split_cmd = &cmds[n++];
+    split_cmd->cmd = C_CTL_SPLT;
+    split_cmd->subcmd = -1;
+
+    retval = icom_pipeline_transaction(rig, cmds, n);
+
+    if (retval != RIG_OK)
+    {
+        RETURNFUNC(retval);
+    }
+
+    if (freq_cmd->retval != RIG_OK || mode_cmd->retval != RIG_OK
+            || split_cmd->retval != RIG_OK
+            || (data_cmd && data_cmd->retval != RIG_OK))
+    {
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    /* frequency: Cn,BCD */
+    if (freq_cmd->data_len != 6)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: wrong freq frame len=%d\n", __func__,
+                  freq_cmd->data_len);
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    *freq = from_bcd(freq_cmd->data + 1, 10);
+
+    /* mode: Cn,mode,filter or 0x26,Sc,mode,data,filter */
+    if (use_x26)
+    {
+        if (mode_cmd->data_len != 5)
+        {
+            RETURNFUNC(-RIG_ENAVAIL);
+        }
+
+        md = mode_cmd->data[2];
+        datamode = mode_cmd->data[3];
+        flt = mode_cmd->data[4];
+    }
+    else
+    {
+        if (mode_cmd->data_len != 3)
+        {
+            RETURNFUNC(-RIG_ENAVAIL);
+        }
+
+        md = mode_cmd->data[1];
+        flt = mode_cmd->data[2];
+
+        if (data_cmd)
+        {
+            /* Cn,Sc,D0[,D1] */
+            if (data_cmd->data_len < 3 || data_cmd->data_len > 4)
+            {
+                RETURNFUNC(-RIG_ENAVAIL);
+            }
+
+            datamode = data_cmd->data[2];
+        }
+    }
+
+    priv->filter = flt;
+    priv->datamode = datamode;
+
+    if (priv_caps->i2r_mode != NULL)
+    {
+        priv_caps->i2r_mode(rig, md, flt, mode, width);
+    }
+    else
+    {
+        icom2rig_mode(rig, md, flt, mode, width);
+    }
+
+    if (datamode)
+    {
+        switch (*mode)
+        {
+        case RIG_MODE_USB: *mode = RIG_MODE_PKTUSB; break;
+
+        case RIG_MODE_LSB: *mode = RIG_MODE_PKTLSB; break;
+
+        case RIG_MODE_AM: *mode = RIG_MODE_PKTAM; break;
+
+        case RIG_MODE_FM: *mode = RIG_MODE_PKTFM; break;
+
+        default: break;
+        }
+    }
+
+    if (flt_cmd)
+    {
+        if (flt_cmd->retval == -RIG_ERJCTED
+                && priv->no_1a_03_cmd == ENUM_1A_03_UNK)
+        {
+            priv->no_1a_03_cmd = ENUM_1A_03_NO;  /* do not keep asking */
+            *width = 0;
+        }
+        else if (rig_has_get_func(rig, RIG_FUNC_RF)
+                 && (*mode & (RIG_MODE_RTTY | RIG_MODE_RTTYR)))
+        {
+            /* the RTTY filter may be in use, let the long way sort it out */
+            *width = icom_get_dsp_flt(rig, *mode);
+        }
+        else if (flt_cmd->retval == RIG_OK)
+        {
+            *width = icom_dsp_flt_width(*mode, flt_cmd->data, flt_cmd->data_len);
+        }
+        else
+        {
+            *width = 0;
+        }
+
+        if (*width < 0) { *width = 0; }
+    }
+
+    /* split: Cn,Sc */
+    switch (split_cmd->data_len == 2 ? split_cmd->data[1] : -1)
+    {
+    case S_SPLT_ON:
+        *split = RIG_SPLIT_ON;
+        break;
+
+    case S_SPLT_OFF:
+    case S_DUP_M:
+    case S_DUP_P:
+    case S_DUP_DD_RPS:
+        *split = RIG_SPLIT_OFF;
+        break;
+
+    default:
+        rig_debug(RIG_DEBUG_ERR, "%s: unsupported split reply\n", __func__);
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    priv->split_on = RIG_SPLIT_ON == *split;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: freq=%.0f mode=%s width=%d split=%d\n",
+              __func__, *freq, rig_strrmode(*mode), (int) *width, *split);
+
+    RETURNFUNC(RIG_OK);
+}
+
 #if 0
 // this seems to work but not for cqrlog and user twiddling VFO knob.
 // may be able to use twiddle but will disable for now
@@ -4825,6 +5065,26 @@ int icom_set_conf(RIG *rig, token_t token, const char *val)
         priv->no_xchg = atoi(val) ? 1 : 0;
         break;
 
+    case TOK_PIPELINE:
+    {
+        const struct icom_priv_caps *priv_caps =
+            (const struct icom_priv_caps *) rig->caps->priv;
+
+        priv->pipeline_depth = atoi(val);
+
+        /* 0 is back to the default of the rig */
+        if (priv->pipeline_depth == 0)
+        {
+            priv->pipeline_depth = priv_caps->pipeline_depth;
+        }
+
+        if (priv->pipeline_depth < 1) { priv->pipeline_depth = 1; }
+
+        if (priv->pipeline_depth > ICOM_MAX_PIPELINE) { priv->pipeline_depth = ICOM_MAX_PIPELINE; }
+
+        break;
+    }
+
     default:
         RETURNFUNC(-RIG_EINVAL);
     }
@@ -4858,6 +5118,9 @@ int icom_get_conf2(RIG *rig, token_t token, char *val, int val_len)
     case TOK_NOXCHG: SNPRINTF(val, val_len, "%d", priv->no_xchg);
         break;
 
+    case TOK_PIPELINE: SNPRINTF(val, val_len, "%d", priv->pipeline_depth);
+        break;
+
     default: RETURNFUNC(-RIG_EINVAL);
     }
 
@@ -9339,6 +9602,9 @@ DECLARE_PROBERIG_BACKEND(icom)
     port->write_delay = port->post_write_delay = 0;
     port->retry = 1;
 
+    /* the rate the port is set to is the likeliest */
+    rig_probe_rate_first(port, rates);
+
     /*
      * try for all different baud rates
      */
@@ -228,6 +228,7 @@ struct icom_priv_caps
     int serial_full_duplex;     /*!< Whether RXD&TXD are not tied together */
     int offs_len;               /*!< Number of bytes in offset frequency field. 0 defaults to 3 */
     int serial_USB_echo_check;  /*!< Flag to test USB echo state */
+    int pipeline_depth;         /*!< Requests the rig takes at once on its USB port, 0 for one at a time */
     int agc_levels_present;     /*!< Flag to indicate that agc_levels array is populated */
     struct icom_agc_level agc_levels[RIG_AGC_LAST + 1]; /*!< Icom rig-specific AGC levels, the last entry should have level -1 */
     struct icom_spectrum_scope_caps spectrum_scope_caps; /*!< Icom spectrum scope capabilities, if supported by the rig. Main/Sub scopes in Icom rigs have the same caps. */
@@ -267,6 +268,7 @@ struct icom_priv_data
     struct icom_spectrum_scope_cache spectrum_scope_cache[HAMLIB_MAX_SPECTRUM_SCOPES]; /*!< Cached Icom spectrum scope data used during reception of the data. The array index must match the scope ID. */
     freq_t other_freq; /*!< Our other freq depending on which vfo is selected */
     int vfo_flag; // used to skip vfo check when frequencies are equal
+    int pipeline_depth; /*!< Requests kept in flight by icom_pipeline_transaction, 1 for none */
 };
 
 extern const struct ts_sc_list r8500_ts_sc_list[];
@@ -294,6 +296,8 @@ rtty_fil[];  /* rtty filter passband width; available on 746pro and 756pro rigs
 
 pbwidth_t icom_get_dsp_flt(RIG *rig, rmode_t mode);
 
+int icom_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                      pbwidth_t *width, split_t *split);
 int icom_init(RIG *rig);
 int icom_rig_open(RIG *rig);
 int icom_rig_close(RIG *rig);
@@ -33,6 +33,10 @@
 #include "serial.h"
 #include "register.h"
 #include "cal.h"
+#include "cache.h"
+#include "event.h"
+#include "iofunc.h"
+#include "probe.h"
 
 #include "kenwood.h"
 #include "ts990s.h"
@@ -209,6 +213,53 @@ struct confparams kenwood_cfg_params[] =
 };
 
 
+/* the rigs whose DA command puts the current mode into its DATA sub-mode */
+static int kenwood_has_data_mode(const RIG *rig)
+{
+    return RIG_IS_TS590S || RIG_IS_TS590SG || RIG_IS_TS950S || RIG_IS_TS950SDX;
+}
+
+
+/* mode with the DATA sub-mode on or off */
+static rmode_t kenwood_data_mode(rmode_t mode, int data)
+{
+    switch (mode)
+    {
+    case RIG_MODE_USB:
+    case RIG_MODE_PKTUSB: return data ? RIG_MODE_PKTUSB : RIG_MODE_USB;
+
+    case RIG_MODE_LSB:
+    case RIG_MODE_PKTLSB: return data ? RIG_MODE_PKTLSB : RIG_MODE_LSB;
+
+    case RIG_MODE_FM:
+    case RIG_MODE_PKTFM: return data ? RIG_MODE_PKTFM : RIG_MODE_FM;
+
+    case RIG_MODE_AM:
+    case RIG_MODE_PKTAM: return data ? RIG_MODE_PKTAM : RIG_MODE_AM;
+
+    default: return mode;
+    }
+}
+
+
+/*
+ * kenwood_set_async_wait
+ * Sets the reply prefixes kenwood_is_async_frame() checks from the async
+ * reader thread.  Only the thread holding the port writes them, so the
+ * sequence count just tells the reader to copy them again.
+ */
+static void kenwood_set_async_wait(struct kenwood_priv_data *priv,
+                                   const char *wait)
+{
+    unsigned int seq = priv->async_wait_seq;
+
+    CACHE_SEQ_STORE(&priv->async_wait_seq, seq + 1);
+    CACHE_SEQ_WFENCE();
+    SNPRINTF(priv->async_wait, sizeof(priv->async_wait), "%s", wait);
+    CACHE_SEQ_STORE(&priv->async_wait_seq, seq + 2);
+}
+
+
 /**
  * kenwood_transaction
  * Assumes rig!=NULL rig->state!=NULL rig->caps!=NULL
@@ -235,6 +286,7 @@ int kenwood_transaction(RIG *rig, const char *cmdstr, char *data,
                                        verification may need a longer
                                        buffer than the user supplied one */
     char cmdtrm_str[2];   /* Default Command/Reply termination char */
+    char wait[3];
     int retval = -RIG_EINTERNAL;
     char *cmd;
     int len;
@@ -244,6 +296,7 @@ int kenwood_transaction(RIG *rig, const char *cmdstr, char *data,
     struct rig_state *rs;
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
+    ELAPSED1;
 
     if ((!cmdstr && !datasize) || (datasize && !data))
     {
@@ -252,8 +305,6 @@ int kenwood_transaction(RIG *rig, const char *cmdstr, char *data,
 
     rs = &rig->state;
 
-    rs->transaction_active = 1;
-
     /* Emulators don't need any post_write_delay */
     if (priv->is_emulation) { rs->rigport.post_write_delay = 0; }
 
@@ -288,8 +339,16 @@ int kenwood_transaction(RIG *rig, const char *cmdstr, char *data,
     cmdtrm_str[0] = caps->cmdtrm;
     cmdtrm_str[1] = '\0';
 
+    /* keeps the other threads and port_transaction_submit() off the port */
+    set_transaction_active(rig);
+
 transaction_write:
 
+    /* before the reply can arrive, see kenwood_is_async_frame() */
+    SNPRINTF(wait, sizeof(wait), "%.2s",
+             datasize ? (cmdstr ? cmdstr : "") : priv->verify_cmd);
+    kenwood_set_async_wait(priv, wait);
+
     if (cmdstr)
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: cmdstr = %s\n", __func__, cmdstr);
@@ -346,7 +405,12 @@ transaction_write:
     }
 
     // Malachite SDR cannot send ID after FA
-    if (!datasize && priv->no_id) { RETURNFUNC2(RIG_OK); }
+    if (!datasize && priv->no_id)
+    {
+        kenwood_set_async_wait(priv, "");
+        set_transaction_inactive(rig);
+        RETURNFUNC2(RIG_OK);
+    }
 
     if (!datasize)
     {
@@ -581,7 +645,8 @@ transaction_quit:
         strncpy(priv->last_if_response, buffer, caps->if_len);
     }
 
-    rs->transaction_active = 0;
+    kenwood_set_async_wait(priv, "");
+    set_transaction_inactive(rig);
     RETURNFUNC2(retval);
 }
 
@@ -655,6 +720,160 @@ int kenwood_safe_transaction(RIG *rig, const char *cmd, char *buf,
     RETURNFUNC2(err);
 }
 
+/**
+ * kenwood_transaction_batch
+ * Sends several read commands in a single write and reads their replies,
+ * which the rig returns in the same order, so a batch costs one round trip
+ * instead of one per command.
+ *
+ * Parameters:
+ *  batch     Commands to send; each reply is stored with the command
+ *  count     Number of commands, at most KENWOOD_MAX_BATCH
+ *
+ * Returns:
+ *   RIG_OK -   if every command was answered.  A command the rig refused
+ *          has the error in its retval and an empty reply.
+ *   Error from write_block() or read_string(), or RIG_EPROTO if the
+ *          replies got out of step, once retries are exhausted.
+ */
+int kenwood_transaction_batch(RIG *rig, struct kenwood_batch_cmd *batch,
+                              int count)
+{
+    char cmdbuf[KENWOOD_MAX_BUF_LEN];
+    char buffer[KENWOOD_MAX_BUF_LEN];
+    char cmdtrm_str[2];
+    char wait[KENWOOD_MAX_BATCH * 2 + 1];
+    struct kenwood_priv_data *priv = rig->state.priv;
+    struct kenwood_priv_caps *caps = kenwood_caps(rig);
+    struct rig_state *rs = &rig->state;
+    size_t len = 0;
+    int retry = 0;
+    int retval;
+    int i;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s called, count=%d\n", __func__, count);
+
+    if (count < 1 || count > KENWOOD_MAX_BATCH)
+    {
+        RETURNFUNC2(-RIG_EINVAL);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        size_t cmdlen = batch[i].cmd ? strlen(batch[i].cmd) : 0;
+
+        if (cmdlen < 2 || len + cmdlen + 2 > sizeof(cmdbuf))
+        {
+            RETURNFUNC2(-RIG_EINVAL);
+        }
+
+        memcpy(cmdbuf + len, batch[i].cmd, cmdlen);
+        len += cmdlen;
+        cmdbuf[len++] = caps->cmdtrm;
+    }
+
+    cmdbuf[len] = '\0';
+    cmdtrm_str[0] = caps->cmdtrm;
+    cmdtrm_str[1] = '\0';
+
+    /* see kenwood_is_async_frame() */
+    for (i = 0; i < count; i++)
+    {
+        memcpy(wait + 2 * i, batch[i].cmd, 2);
+    }
+
+    wait[2 * count] = '\0';
+    kenwood_set_async_wait(priv, wait);
+
+    /* Emulators don't need any post_write_delay */
+    if (priv->is_emulation) { rs->rigport.post_write_delay = 0; }
+
+    set_transaction_active(rig);
+
+    do
+    {
+        rig_debug(RIG_DEBUG_TRACE, "%s: cmdstr = %s\n", __func__, cmdbuf);
+
+        /* flush anything in the read buffer before the batch is sent */
+        rig_flush(&rs->rigport);
+
+        retval = write_block(&rs->rigport, (unsigned char *) cmdbuf, len);
+
+        for (i = 0; retval == RIG_OK && i < count; i++)
+        {
+            struct kenwood_batch_cmd *b = &batch[i];
+            int n;
+
+            n = read_string(&rs->rigport, (unsigned char *) buffer, sizeof(buffer),
+                            cmdtrm_str, 1, 0, 1);
+
+            if (n < 0)
+            {
+                retval = n;
+                break;
+            }
+
+            if (n < 2 || buffer[n - 1] != caps->cmdtrm)
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: Command is not correctly terminated '%s'\n",
+                          __func__, buffer);
+                retval = -RIG_EPROTO;
+                break;
+            }
+
+            buffer[--n] = '\0';
+            b->reply[0] = '\0';
+
+            /* a refused command is answered in its place */
+            if (n == 1)
+            {
+                switch (buffer[0])
+                {
+                case 'N': b->retval = -RIG_ENAVAIL; break;
+
+                case '?': b->retval = -RIG_ERJCTED; break;
+
+                case 'E': b->retval = -RIG_EIO; break;
+
+                default: b->retval = -RIG_EPROTO; break;
+                }
+
+                rig_debug(RIG_DEBUG_VERBOSE, "%s: '%s' for '%s'\n", __func__, buffer,
+                          b->cmd);
+                continue;
+            }
+
+            if (buffer[0] != b->cmd[0] || buffer[1] != b->cmd[1])
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: wrong reply %c%c for command %c%c\n",
+                          __func__, buffer[0], buffer[1], b->cmd[0], b->cmd[1]);
+                retval = -RIG_EPROTO;
+                break;
+            }
+
+            memcpy(b->reply, buffer, n + 1);
+            b->retval = RIG_OK;
+
+            if (strcmp(b->cmd, "IF") == 0)
+            {
+                elapsed_ms(&priv->cache_start, HAMLIB_ELAPSED_SET);
+                strncpy(priv->last_if_response, b->reply, caps->if_len);
+            }
+        }
+
+        if (retval != RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: batch failed: %s, retry=%d of %d\n", __func__,
+                      rigerror(retval), retry, rs->rigport.retry);
+        }
+    }
+    while (retval != RIG_OK && retry++ < rs->rigport.retry);
+
+    kenwood_set_async_wait(priv, "");
+    set_transaction_inactive(rig);
+    RETURNFUNC2(retval);
+}
+
 rmode_t kenwood2rmode(unsigned char mode, const rmode_t mode_table[])
 {
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
@@ -726,6 +945,7 @@ int kenwood_init(RIG *rig)
     priv->curr_mode = 0;
     priv->micgain_min = -1;
     priv->micgain_max = -1;
+    priv->async_data = -1;
 
     /* default mode_table */
     if (caps->mode_table == NULL)
@@ -951,9 +1171,23 @@ int kenwood_open(RIG *rig)
             /* get current AI state so it can be restored */
             kenwood_get_trn(rig, &priv->trn_state);  /* ignore errors */
 
-            /* Currently we cannot cope with AI mode so turn it off in
+            if (rig->state.async_data_enabled)
+            {
+                char dabuf[6];
+
+                /* the async data handler takes the rig's reports */
+                kenwood_set_trn(rig, RIG_TRN_RIG); /* ignore status */
+
+                /* DA is only reported when it changes, see kenwood_async_mode() */
+                if (kenwood_has_data_mode(rig)
+                        && kenwood_safe_transaction(rig, "DA", dabuf, sizeof(dabuf), 3) == RIG_OK)
+                {
+                    priv->async_data = dabuf[2] == '1';
+                }
+            }
+            /* Without it we cannot cope with AI mode so turn it off in
                case last client left it on */
-            if (priv->trn_state != RIG_TRN_OFF)
+            else if (priv->trn_state != RIG_TRN_OFF)
             {
                 kenwood_set_trn(rig, RIG_TRN_OFF); /* ignore status in case
                                                       it's not supported */
@@ -1014,6 +1248,12 @@ int kenwood_close(RIG *rig)
                                                  it's not supported */
     }
 
+    /* no more reports once the async data handler stops */
+    rig->state.use_cached_freq = 0;
+    rig->state.use_cached_mode = 0;
+    rig->state.use_cached_ptt = 0;
+    priv->async_data = -1;
+
     if (priv->poweron != 0 && rig->state.auto_power_off)
     {
         rig_debug(RIG_DEBUG_TRACE, "%s: got PS1 so powerdown\n", __func__);
@@ -1467,7 +1707,7 @@ int kenwood_set_split_vfo(RIG *rig, vfo_t vfo, split_t split, vfo_t txvfo)
             || rig->caps->rig_model == RIG_MODEL_KX2
             || rig->caps->rig_model == RIG_MODEL_KX3)
     {
-        rig_set_freq(rig, RIG_VFO_B, rig->state.cache.freqMainA);
+        rig_set_freq(rig, RIG_VFO_B, rig->state.cache_slot[CACHE_SLOT_MAIN_A].freq);
     }
 
     if (retval != RIG_OK)
@@ -2685,6 +2925,107 @@ int kenwood_get_mode_if(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width)
     RETURNFUNC(RIG_OK);
 }
 
+/*
+ * Reads the frequency, mode and split of the current VFO with one batch
+ * of FA/FB, MD, DA and IF.  Returns -RIG_ENAVAIL when the rig needs more
+ * than that, e.g. the VFO is not the current one or the filter width has
+ * to be read, and the frontend then uses the individual get functions.
+ */
+int kenwood_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                         pbwidth_t *width, split_t *split)
+{
+    struct kenwood_batch_cmd batch[4];
+    struct kenwood_priv_data *priv = rig->state.priv;
+    struct kenwood_priv_caps *caps = kenwood_caps(rig);
+    int datamode = RIG_IS_TS590S || RIG_IS_TS590SG || RIG_IS_TS950S
+                   || RIG_IS_TS950SDX;
+    int count = 0;
+    int kmode;
+    int retval;
+    int i;
+
+    ENTERFUNC;
+
+    if (vfo == RIG_VFO_CURR || vfo == RIG_VFO_VFO) { vfo = rig->state.current_vfo; }
+
+    /* MD reads the mode of the current VFO only */
+    if ((vfo != RIG_VFO_A && vfo != RIG_VFO_B) || vfo != rig->state.current_vfo
+            || priv->is_emulation || RIG_IS_TS990S || RIG_IS_TS480 || RIG_IS_HPSDR)
+    {
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    batch[count++].cmd = vfo == RIG_VFO_A ? "FA" : "FB";
+    batch[count++].cmd = "MD";
+    batch[count++].cmd = "IF";
+
+    if (datamode) { batch[count++].cmd = "DA"; }
+
+    retval = kenwood_transaction_batch(rig, batch, count);
+
+    if (retval != RIG_OK)
+    {
+        RETURNFUNC(retval);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (batch[i].retval != RIG_OK)
+        {
+            RETURNFUNC(-RIG_ENAVAIL);
+        }
+    }
+
+    if (strlen(batch[0].reply) != 13 || strlen(batch[1].reply) != 3
+            || strlen(batch[2].reply) != caps->if_len
+            || (datamode && strlen(batch[3].reply) != 3))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: unexpected reply length\n", __func__);
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    sscanf(batch[0].reply + 2, "%"SCNfreq, freq);
+
+    kmode = batch[1].reply[2] <= '9' ? batch[1].reply[2] - '0' :
+            batch[1].reply[2] - 'A' + 10;
+    *mode = kenwood2rmode(kmode, caps->mode_table);
+
+    if (datamode)
+    {
+        int data = batch[3].reply[2] == '1';
+
+        if (vfo == RIG_VFO_A) { priv->datamodeA = data; }
+        else { priv->datamodeB = data; }
+
+        if (data)
+        {
+            switch (*mode)
+            {
+            case RIG_MODE_USB: *mode = RIG_MODE_PKTUSB; break;
+
+            case RIG_MODE_LSB: *mode = RIG_MODE_PKTLSB; break;
+
+            case RIG_MODE_FM: *mode = RIG_MODE_PKTFM; break;
+
+            case RIG_MODE_AM: *mode = RIG_MODE_PKTAM; break;
+
+            default: break;
+            }
+        }
+    }
+
+    *width = rig_passband_normal(rig, *mode);
+
+    if (vfo == RIG_VFO_A) { priv->modeA = *mode; }
+    else { priv->modeB = *mode; }
+
+    memcpy(priv->info, batch[2].reply, caps->if_len + 1);
+    *split = priv->info[32] == '1' ? RIG_SPLIT_ON : RIG_SPLIT_OFF;
+    priv->split = *split;
+
+    RETURNFUNC(RIG_OK);
+}
+
 /* kenwood_get_micgain_minmax
  * Kenwood rigs have different micgain levels
  * This routine relies on the idea that setting the micgain
@@ -4643,11 +4984,23 @@ int kenwood_set_trn(RIG *rig, int trn)
     char buf[5];
     ENTERFUNC;
 
+    if (trn != RIG_TRN_RIG)
+    {
+        /* the cache no longer follows the rig, see kenwood_process_async_frame() */
+        rig->state.use_cached_freq = 0;
+        rig->state.use_cached_mode = 0;
+        rig->state.use_cached_ptt = 0;
+    }
+
     switch (rig->caps->rig_model)
     {
     case RIG_MODEL_POWERSDR: // powersdr doesn't have AI command
         RETURNFUNC(-RIG_ENAVAIL);
 
+    case RIG_MODEL_TS2000:
+    case RIG_MODEL_TS590S:
+    case RIG_MODEL_TS590SG:
+    case RIG_MODEL_TS890S:
     case RIG_MODEL_TS990S:
         RETURNFUNC(kenwood_transaction(rig, (trn == RIG_TRN_RIG) ? "AI2" : "AI0", NULL,
                                        0));
@@ -4711,6 +5064,177 @@ int kenwood_get_trn(RIG *rig, int *trn)
     RETURNFUNC(RIG_OK);
 }
 
+/*
+ * kenwood_read_frame_direct
+ * Reads one answer from the rig for the async data handler.
+ */
+int kenwood_read_frame_direct(RIG *rig, size_t buffer_length,
+                              const unsigned char *buffer)
+{
+    struct kenwood_priv_caps *caps = kenwood_caps(rig);
+    char cmdtrm_str[2];
+
+    cmdtrm_str[0] = caps->cmdtrm;
+    cmdtrm_str[1] = '\0';
+
+    return read_string_direct(&rig->state.rigport, (unsigned char *) buffer,
+                              buffer_length, cmdtrm_str, 1, 0, 1);
+}
+
+/*
+ * kenwood_is_async_frame
+ * With AI on, the rig's reports of changes come mixed with the replies to
+ * our commands and look just the same.  An answer is a reply when a
+ * transaction is waiting for that command or for any answer at all, as
+ * with an error reply, and a report otherwise.
+ */
+int kenwood_is_async_frame(RIG *rig, size_t frame_length,
+                           const unsigned char *frame)
+{
+    struct kenwood_priv_data *priv = rig->state.priv;
+    char buf[sizeof(priv->async_wait)];
+    const char *wait = buf;
+    unsigned int seq;
+
+    /* a copy that no transaction was changing meanwhile */
+    do
+    {
+        while ((seq = CACHE_SEQ_LOAD(&priv->async_wait_seq)) & 1)
+        {
+            /* kenwood_set_async_wait() is in the middle of an update */
+        }
+
+        memcpy(buf, priv->async_wait, sizeof(buf));
+        CACHE_SEQ_FENCE();
+    }
+    while (CACHE_SEQ_LOAD(&priv->async_wait_seq) != seq);
+
+    buf[sizeof(buf) - 1] = '\0';
+
+    if (wait[0] == '\0')
+    {
+        return 1;
+    }
+
+    /* "?;", "N;" etc. */
+    if (frame_length <= 2)
+    {
+        return 0;
+    }
+
+    for (; wait[0] != '\0' && wait[1] != '\0'; wait += 2)
+    {
+        if (frame[0] == wait[0] && frame[1] == wait[1])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Fires the mode event of an MD, IF or DA report.  MD and IF give the mode
+ * without the DATA sub-mode, so on rigs that have one the cache only
+ * answers rig_get_mode once the DA reply read at open or a DA report told
+ * whether it is on.
+ */
+static void kenwood_async_mode(RIG *rig, rmode_t mode)
+{
+    struct kenwood_priv_data *priv = rig->state.priv;
+
+    if (kenwood_has_data_mode(rig))
+    {
+        priv->async_mode = mode;
+
+        if (mode == RIG_MODE_NONE || priv->async_data < 0)
+        {
+            return;
+        }
+
+        mode = kenwood_data_mode(mode, priv->async_data);
+    }
+
+    rig_fire_mode_event(rig, RIG_VFO_CURR, mode, rig_passband_normal(rig, mode));
+    rig->state.use_cached_mode = 1;
+}
+
+
+/*
+ * kenwood_process_async_frame
+ * Decodes the reports that matter to the rig cache and fires the matching
+ * events; while AI is on, rig_get_freq, rig_get_mode and rig_get_ptt then
+ * answer from the cache.  Other reports are ignored.
+ */
+int kenwood_process_async_frame(RIG *rig, size_t frame_length,
+                                const unsigned char *frame)
+{
+    struct kenwood_priv_data *priv = rig->state.priv;
+    struct kenwood_priv_caps *caps = kenwood_caps(rig);
+    struct rig_state *rs = &rig->state;
+    char buf[KENWOOD_MAX_BUF_LEN];
+    size_t len;
+    freq_t freq;
+    int kmode;
+
+    if (frame_length < 2 || frame_length > sizeof(buf))
+    {
+        return -RIG_EPROTO;
+    }
+
+    /* without the terminator */
+    len = frame_length - 1;
+    memcpy(buf, frame, len);
+    buf[len] = '\0';
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: '%s'\n", __func__, buf);
+
+    if ((strncmp(buf, "FA", 2) == 0 || strncmp(buf, "FB", 2) == 0) && len == 13)
+    {
+        sscanf(buf + 2, "%"SCNfreq, &freq);
+        rig_fire_freq_event(rig, buf[1] == 'A' ? RIG_VFO_A : RIG_VFO_B, freq);
+        rs->use_cached_freq = 1;
+    }
+    else if (strncmp(buf, "MD", 2) == 0 && len == 3)
+    {
+        kmode = buf[2] <= '9' ? buf[2] - '0' : buf[2] - 'A' + 10;
+        kenwood_async_mode(rig, kenwood2rmode(kmode, caps->mode_table));
+    }
+    else if (strncmp(buf, "DA", 2) == 0 && len == 3 && kenwood_has_data_mode(rig))
+    {
+        priv->async_data = buf[2] == '1';
+        kenwood_async_mode(rig, priv->async_mode);
+    }
+    else if (strncmp(buf, "IF", 2) == 0 && len == caps->if_len)
+    {
+        memcpy(priv->info, buf, len + 1);
+        memcpy(priv->last_if_response, buf, len + 1);
+        elapsed_ms(&priv->cache_start, HAMLIB_ELAPSED_SET);
+        priv->split = buf[32] == '1' ? RIG_SPLIT_ON : RIG_SPLIT_OFF;
+
+        sscanf(buf + 2, "%11"SCNfreq, &freq);
+        rig_fire_freq_event(rig, RIG_VFO_CURR, freq);
+        kenwood_async_mode(rig, kenwood2rmode(buf[29] - '0', caps->mode_table));
+        rig_fire_ptt_event(rig, RIG_VFO_CURR,
+                           buf[28] == '0' ? RIG_PTT_OFF : RIG_PTT_ON);
+        rs->use_cached_freq = 1;
+        rs->use_cached_ptt = 1;
+    }
+    else if (strncmp(buf, "TX", 2) == 0 || strcmp(buf, "RX") == 0
+             || strcmp(buf, "RX0") == 0)
+    {
+        rig_fire_ptt_event(rig, RIG_VFO_CURR,
+                           buf[0] == 'T' ? RIG_PTT_ON : RIG_PTT_OFF);
+        rs->use_cached_ptt = 1;
+    }
+    else
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: report %.2s ignored\n", __func__, buf);
+    }
+
+    return RIG_OK;
+}
+
 /*
  * kenwood_set_powerstat
  */
@@ -5520,6 +6044,9 @@ DECLARE_PROBERIG_BACKEND(kenwood)
     port->parm.serial.stop_bits = 2;
     port->retry = 0;
 
+    /* the rate the port is set to is the likeliest */
+    rig_probe_rate_first(port, rates);
+
     /*
      * try for all different baud rates
      */
@@ -5541,9 +6068,9 @@ DECLARE_PROBERIG_BACKEND(kenwood)
         id_len = read_string(port, (unsigned char *) idbuf, IDBUFSZ, ";\r", 2, 0, 1);
         close(port->fd);
 
-        if (retval != RIG_OK || id_len < 0)
+        if (retval == RIG_OK && id_len > 0)
         {
-            continue;
+            break;
         }
     }
 
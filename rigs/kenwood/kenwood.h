@@ -35,6 +35,7 @@
 
 #define KENWOOD_MODE_TABLE_MAX  24
 #define KENWOOD_MAX_BUF_LEN   128 /* max answer len, arbitrary */
+#define KENWOOD_MAX_BATCH     8   /* commands sent in one write */
 
 
 /* Tokens for Parameters common to multiple rigs.
@@ -170,6 +171,10 @@ struct kenwood_priv_data
     rmode_t modeB;
     int datamodeA; // datamode status from get_mode or set_mode
     int datamodeB; // datamode status from get_mode or set_mode
+    char async_wait[KENWOOD_MAX_BATCH * 2 + 1]; /* prefixes of the replies being waited for, see kenwood_is_async_frame */
+    unsigned int async_wait_seq; /* odd while async_wait is being changed */
+    rmode_t async_mode; /* last mode reported with AI, without the DATA sub-mode */
+    int async_data; /* DATA sub-mode reported with AI, -1 until known */
 };
 
 
@@ -185,6 +190,17 @@ int kenwood_transaction(RIG *rig, const char *cmdstr, char *data, size_t datasiz
 int kenwood_safe_transaction(RIG *rig, const char *cmd, char *buf,
                              size_t buf_size, size_t expected);
 
+/* one read command of kenwood_transaction_batch() */
+struct kenwood_batch_cmd
+{
+    const char *cmd;                  /* e.g. "FA", without terminator */
+    char reply[KENWOOD_MAX_BUF_LEN];  /* reply without terminator */
+    int retval;                       /* RIG_OK or error reply of the rig */
+};
+
+int kenwood_transaction_batch(RIG *rig, struct kenwood_batch_cmd *batch,
+                              int count);
+
 rmode_t kenwood2rmode(unsigned char mode, const rmode_t mode_table[]);
 char rmode2kenwood(rmode_t mode, const rmode_t mode_table[]);
 
@@ -212,6 +228,8 @@ int kenwood_get_xit(RIG *rig, vfo_t vfo, shortfreq_t *rit);
 int kenwood_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width);
 int kenwood_get_mode(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width);
 int kenwood_get_mode_if(RIG *rig, vfo_t vfo, rmode_t *mode, pbwidth_t *width);
+int kenwood_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                         pbwidth_t *width, split_t *split);
 int kenwood_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val);
 int kenwood_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val);
 int kenwood_set_func(RIG *rig, vfo_t vfo, setting_t func, int status);
@@ -247,6 +265,12 @@ int kenwood_get_if(RIG *rig);
 
 int kenwood_set_trn(RIG *rig, int trn);
 int kenwood_get_trn(RIG *rig, int *trn);
+int kenwood_read_frame_direct(RIG *rig, size_t buffer_length,
+                              const unsigned char *buffer);
+int kenwood_is_async_frame(RIG *rig, size_t frame_length,
+                           const unsigned char *frame);
+int kenwood_process_async_frame(RIG *rig, size_t frame_length,
+                                const unsigned char *frame);
 
 int kenwood_power2mW(RIG * rig, unsigned int *mwpower, float power, freq_t freq, rmode_t mode);
 int kenwood_mW2power(RIG * rig, float *power, unsigned int mwpower, freq_t freq, rmode_t mode);
@@ -33,6 +33,7 @@
 #include "th.h"
 #include "serial.h"
 #include "misc.h"
+#include "cache.h"
 #include "num_stdio.h"
 
 /* Note: Currently the code assumes the command termination is a
@@ -41,6 +42,12 @@
 
 #define ACKBUF_LEN  64
 
+/* the VFO of band 0 or 1 in the transceive reports */
+static vfo_t th_band_vfo(int band)
+{
+    return band == 0 ? RIG_VFO_A : RIG_VFO_B;
+}
+
 /*
  * th_decode_event is called by sa_sigio, when some asynchronous
  * data has been received from the rig.
@@ -71,12 +78,12 @@ th_decode_event(RIG *rig)
 
         vfo_t vfo;
         freq_t freq, offset;
-        int mode;
+        int band, mode;
         int step, shift, rev, tone, ctcss, tonefq, ctcssfq;
 
         retval = num_sscanf(asyncbuf,
                             "BUF %d,%"SCNfreq",%X,%d,%d,%d,%d,,%d,,%d,%"SCNfreq",%d",
-                            &vfo, &freq, &step, &shift, &rev, &tone,
+                            &band, &freq, &step, &shift, &rev, &tone,
                             &ctcss, &tonefq, &ctcssfq, &offset, &mode);
 
         if (retval != 11)
@@ -87,7 +94,7 @@ th_decode_event(RIG *rig)
         }
 
         /* Calibration and conversions */
-        vfo = (vfo == 0) ? RIG_VFO_A : RIG_VFO_B;
+        vfo = th_band_vfo(band);
         mode = (mode == 0) ? RIG_MODE_FM : RIG_MODE_AM;
 
         rig_debug(RIG_DEBUG_TRACE, "%s: Buffer (vfo %d, freq %"PRIfreq" Hz, mode %d)\n",
@@ -115,8 +122,9 @@ th_decode_event(RIG *rig)
     {
 
         vfo_t vfo;
-        int lev;
-        retval = sscanf(asyncbuf, "SM %d,%d", &vfo, &lev);
+        int band, lev;
+        value_t rawstr;
+        retval = sscanf(asyncbuf, "SM %d,%d", &band, &lev);
 
         if (retval != 2)
         {
@@ -126,11 +134,15 @@ th_decode_event(RIG *rig)
         }
 
         /* Calibration and conversions */
-        vfo = (vfo == 0) ? RIG_VFO_A : RIG_VFO_B;
+        vfo = th_band_vfo(band);
 
         rig_debug(RIG_DEBUG_TRACE, "%s: Signal strength event - signal = %.3f\n",
                   __func__, (float)(lev / 5.0));
 
+        /* the next get_level RAWSTR can be answered from the cache */
+        rawstr.i = lev;
+        rig_set_cache_setting(rig, HAMLIB_CACHE_LEVEL, vfo, RIG_LEVEL_RAWSTR, rawstr);
+
         /* Callback execution */
 #if STILLHAVETOADDCALLBACK
 
@@ -145,9 +157,9 @@ th_decode_event(RIG *rig)
     {
 
         vfo_t vfo;
-        int busy;
+        int band, busy;
 
-        retval = sscanf(asyncbuf, "BY %d,%d", &vfo, &busy);
+        retval = sscanf(asyncbuf, "BY %d,%d", &band, &busy);
 
         if (retval != 2)
         {
@@ -156,9 +168,9 @@ th_decode_event(RIG *rig)
             return -RIG_ERJCTED;
         }
 
-        vfo = (vfo == 0) ? RIG_VFO_A : RIG_VFO_B;
-        rig_debug(RIG_DEBUG_TRACE, "%s: Busy event - status = '%s'\n",
-                  __func__, (busy == 0) ? "OFF" : "ON");
+        vfo = th_band_vfo(band);
+        rig_debug(RIG_DEBUG_TRACE, "%s: Busy event - vfo = %s, status = '%s'\n",
+                  __func__, rig_strvfo(vfo), (busy == 0) ? "OFF" : "ON");
         return -RIG_ENIMPL;
         /* This event does not have a callback. */
 
@@ -167,7 +179,8 @@ th_decode_event(RIG *rig)
     {
 
         vfo_t vfo;
-        retval = sscanf(asyncbuf, "BC %d", &vfo);
+        int band;
+        retval = sscanf(asyncbuf, "BC %d", &band);
 
         if (retval != 1)
         {
@@ -176,7 +189,7 @@ th_decode_event(RIG *rig)
             return -RIG_ERJCTED;
         }
 
-        vfo = (vfo == 0) ? RIG_VFO_A : RIG_VFO_B;
+        vfo = th_band_vfo(band);
 
         rig_debug(RIG_DEBUG_TRACE, "%s: VFO event - vfo = %d\n", __func__, vfo);
 
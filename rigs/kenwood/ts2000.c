@@ -295,6 +295,11 @@ const struct rig_caps ts2000_caps =
     .get_vfo =  kenwood_get_vfo_if,
     .set_split_vfo = kenwood_set_split_vfo,
     .get_split_vfo = kenwood_get_split_vfo_if,
+    .rig_get_vfo_info = kenwood_get_vfo_info,
+    .async_data_supported = 1,
+    .read_frame_direct = kenwood_read_frame_direct,
+    .is_async_frame = kenwood_is_async_frame,
+    .process_async_frame = kenwood_process_async_frame,
     .set_ctcss_tone =  kenwood_set_ctcss_tone_tn,
     .get_ctcss_tone =  kenwood_get_ctcss_tone,
     .set_ctcss_sql =  kenwood_set_ctcss_sql,
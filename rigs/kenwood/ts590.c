@@ -221,6 +221,11 @@ const struct rig_caps ts590_caps =
     .get_vfo = kenwood_get_vfo_if,
     .set_split_vfo = kenwood_set_split_vfo,
     .get_split_vfo = kenwood_get_split_vfo_if,
+    .rig_get_vfo_info = kenwood_get_vfo_info,
+    .async_data_supported = 1,
+    .read_frame_direct = kenwood_read_frame_direct,
+    .is_async_frame = kenwood_is_async_frame,
+    .process_async_frame = kenwood_process_async_frame,
     .get_ptt = kenwood_get_ptt,
     .set_ptt = kenwood_set_ptt,
     .get_dcd = kenwood_get_dcd,
@@ -392,6 +397,11 @@ const struct rig_caps ts590sg_caps =
     .get_vfo = kenwood_get_vfo_if,
     .set_split_vfo = kenwood_set_split_vfo,
     .get_split_vfo = kenwood_get_split_vfo_if,
+    .rig_get_vfo_info = kenwood_get_vfo_info,
+    .async_data_supported = 1,
+    .read_frame_direct = kenwood_read_frame_direct,
+    .is_async_frame = kenwood_is_async_frame,
+    .process_async_frame = kenwood_process_async_frame,
     .get_ptt = kenwood_get_ptt,
     .set_ptt = kenwood_set_ptt,
     .get_dcd = kenwood_get_dcd,
@@ -210,6 +210,11 @@ const struct rig_caps ftdx101mp_caps =
     .get_ptt =            newcat_get_ptt,
     .set_split_vfo =      newcat_set_split_vfo,
     .get_split_vfo =      newcat_get_split_vfo,
+    .rig_get_vfo_info =   newcat_get_vfo_info,
+    .async_data_supported = 1,
+    .read_frame_direct =  newcat_read_frame_direct,
+    .is_async_frame =     newcat_is_async_frame,
+    .process_async_frame = newcat_process_async_frame,
     .set_rit =            newcat_set_rit,
     .get_rit =            newcat_get_rit,
     .set_xit =            newcat_set_xit,
@@ -38,6 +38,8 @@
 #include "iofunc.h"
 #include "misc.h"
 #include "cal.h"
+#include "cache.h"
+#include "event.h"
 #include "newcat.h"
 
 /* global variables */
@@ -549,9 +551,14 @@ int newcat_open(RIG *rig)
     rig->state.rigport.timeout = 100;
     newcat_get_trn(rig, &priv->trn_state);  /* ignore errors */
 
-    /* Currently we cannot cope with AI mode so turn it off in case
+    if (rig->state.async_data_enabled)
+    {
+        /* the async data handler takes the rig's reports */
+        newcat_set_trn(rig, RIG_TRN_RIG); /* ignore status */
+    }
+    /* Without it we cannot cope with AI mode so turn it off in case
        last client left it on */
-    if (priv->trn_state > 0)
+    else if (priv->trn_state > 0)
     {
         newcat_set_trn(rig, RIG_TRN_OFF);
     } /* ignore status in case it's not supported */
@@ -619,6 +626,11 @@ int newcat_close(RIG *rig)
                                                    supported */
     }
 
+    /* no more reports once the async data handler stops */
+    rig_s->use_cached_freq = 0;
+    rig_s->use_cached_mode = 0;
+    rig_s->use_cached_ptt = 0;
+
     if (priv->poweron != 0 && rig_s->auto_power_off)
     {
         rig_set_powerstat(rig, 0);
@@ -2477,6 +2489,93 @@ int newcat_get_split_vfo(RIG *rig, vfo_t vfo, split_t *split, vfo_t *tx_vfo)
     RETURNFUNC(RIG_OK);
 }
 
+/*
+ * Reads frequency, mode and split with one batch of FA/FB, MD and FT
+ * instead of one command each; the filter width still takes its own
+ * command as it depends on the mode.  Returns -RIG_ENAVAIL when the rig
+ * needs the individual get functions, which the frontend then uses.
+ */
+int newcat_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                        pbwidth_t *width, split_t *split)
+{
+    struct newcat_batch_cmd batch[3];
+    char md_cmd[] = "MD0;";
+    int err;
+    int i;
+
+    ENTERFUNC;
+
+    err = newcat_set_vfo_from_alias(rig, &vfo);
+
+    if (err < 0)
+    {
+        RETURNFUNC(err);
+    }
+
+    if (vfo == RIG_VFO_B || vfo == RIG_VFO_SUB)
+    {
+        batch[0].cmd = "FB;";
+        md_cmd[2] = rig->caps->targetable_vfo & RIG_TARGETABLE_MODE ? '1' : '0';
+    }
+    else if (vfo == RIG_VFO_A || vfo == RIG_VFO_MAIN)
+    {
+        batch[0].cmd = "FA;";
+    }
+    else
+    {
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    batch[1].cmd = md_cmd;
+    /* The DX101D returns FT0 when in split and not transmitting */
+    batch[2].cmd = is_ftdx101d || is_ftdx101mp ? "ST;" : "FT;";
+
+    /* MD0 is the mode of the current VFO; a rig that cannot read VFOA
+       while transmitting on VFOB is left to rig_get_freq */
+    if ((md_cmd[2] == '0' && vfo != rig->state.current_vfo)
+            || (is_ftdx101d && rig->state.cache.split)
+            || !newcat_valid_command(rig, "FA") || !newcat_valid_command(rig, "FB")
+            || !newcat_valid_command(rig, "MD")
+            || !newcat_valid_command(rig, is_ftdx101d || is_ftdx101mp ? "ST" : "FT"))
+    {
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    err = newcat_get_cmd_batch(rig, batch, 3);
+
+    if (err != RIG_OK)
+    {
+        RETURNFUNC(err);
+    }
+
+    for (i = 0; i < 3; i++)
+    {
+        if (batch[i].retval != RIG_OK || strlen(batch[i].reply) < 4)
+        {
+            RETURNFUNC(-RIG_ENAVAIL);
+        }
+    }
+
+    sscanf(batch[0].reply + 2, "%"SCNfreq, freq);
+
+    *width = RIG_PASSBAND_NORMAL;
+    *mode = newcat_rmode_width(rig, vfo, batch[1].reply[3], width);
+
+    if (*mode == '0')
+    {
+        RETURNFUNC(-RIG_ENAVAIL);
+    }
+
+    if (RIG_PASSBAND_NORMAL == *width)
+    {
+        *width = rig_passband_normal(rig, *mode);
+    }
+
+    *split = batch[2].reply[2] == '1' ? RIG_SPLIT_ON : RIG_SPLIT_OFF;
+
+    RETURNFUNC(newcat_get_rx_bandwidth(rig, vfo, *mode, width));
+}
+
 int newcat_set_rit(RIG *rig, vfo_t vfo, shortfreq_t rit)
 {
     struct newcat_priv_data *priv = (struct newcat_priv_data *)rig->state.priv;
@@ -6721,6 +6820,11 @@ int newcat_set_trn(RIG *rig, int trn)
     if (trn  == RIG_TRN_OFF)
     {
         c = '0';
+
+        /* the cache no longer follows the rig, see newcat_process_async_frame() */
+        rig->state.use_cached_freq = 0;
+        rig->state.use_cached_mode = 0;
+        rig->state.use_cached_ptt = 0;
     }
     else
     {
@@ -6777,6 +6881,121 @@ int newcat_get_trn(RIG *rig, int *trn)
     RETURNFUNC(RIG_OK);
 }
 
+/*
+ * Reads one answer from the rig for the async data handler.
+ */
+int newcat_read_frame_direct(RIG *rig, size_t buffer_length,
+                             const unsigned char *buffer)
+{
+    return read_string_direct(&rig->state.rigport, (unsigned char *) buffer,
+                              buffer_length, &cat_term, sizeof(cat_term), 0, 1);
+}
+
+
+/*
+ * An answer is a reply when a command waits for it, or for any answer at
+ * all as with an error reply, and a report of the rig otherwise.
+ */
+int newcat_is_async_frame(RIG *rig, size_t frame_length,
+                          const unsigned char *frame)
+{
+    struct newcat_priv_data *priv = (struct newcat_priv_data *)rig->state.priv;
+    const char *wait = priv->async_wait;
+
+    if (wait[0] == '\0')
+    {
+        return 1;
+    }
+
+    /* "?;" */
+    if (frame_length <= 2)
+    {
+        return 0;
+    }
+
+    for (; wait[0] != '\0' && wait[1] != '\0'; wait += 2)
+    {
+        if (frame[0] == wait[0] && frame[1] == wait[1])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/*
+ * Decodes the reports that matter to the rig cache and fires the matching
+ * events; while AI is on, rig_get_freq, rig_get_mode and rig_get_ptt then
+ * answer from the cache.  Other reports are ignored.
+ */
+int newcat_process_async_frame(RIG *rig, size_t frame_length,
+                               const unsigned char *frame)
+{
+    struct newcat_priv_data *priv = (struct newcat_priv_data *)rig->state.priv;
+    struct rig_state *rs = &rig->state;
+    char buf[NEWCAT_DATA_LEN];
+    freq_t freq;
+    rmode_t mode;
+
+    if (frame_length < 2 || frame_length >= sizeof(buf))
+    {
+        return -RIG_EPROTO;
+    }
+
+    memcpy(buf, frame, frame_length);
+    buf[frame_length] = '\0';
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: '%s'\n", __func__, buf);
+
+    if (strncmp(buf, "FA", 2) == 0 || strncmp(buf, "FB", 2) == 0)
+    {
+        if (sscanf(buf + 2, "%"SCNfreq, &freq) == 1)
+        {
+            rig_fire_freq_event(rig, buf[1] == 'A' ? RIG_VFO_A : RIG_VFO_B, freq);
+            rs->use_cached_freq = 1;
+        }
+    }
+    else if (strncmp(buf, "MD", 2) == 0 && frame_length == 5)
+    {
+        mode = newcat_rmode(buf[3]);
+        rig_fire_mode_event(rig, buf[2] == '1' ? RIG_VFO_SUB : RIG_VFO_CURR, mode,
+                            rig_passband_normal(rig, mode));
+        rs->use_cached_mode = 1;
+    }
+    else if (strncmp(buf, "IF", 2) == 0
+             && (frame_length == 27 || frame_length == 28))
+    {
+        /* FT-450 has an 8 digit frequency, the others 9 */
+        int width = frame_length == 27 ? 8 : 9;
+
+        strcpy(priv->last_if_response, buf);
+        elapsed_ms(&priv->cache_start, 1);
+
+        buf[5 + width] = '\0';
+        freq = atof(buf + 5);
+        rig_fire_freq_event(rig, RIG_VFO_CURR, freq);
+        mode = newcat_rmode(priv->last_if_response[width + 12]);
+        rig_fire_mode_event(rig, RIG_VFO_CURR, mode, rig_passband_normal(rig, mode));
+        rs->use_cached_freq = 1;
+        rs->use_cached_mode = 1;
+    }
+    else if (strncmp(buf, "TX", 2) == 0 && frame_length == 4)
+    {
+        rig_fire_ptt_event(rig, RIG_VFO_CURR,
+                           buf[2] == '0' ? RIG_PTT_OFF : RIG_PTT_ON);
+        rs->use_cached_ptt = 1;
+    }
+    else
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: report %.2s ignored\n", __func__, buf);
+    }
+
+    return RIG_OK;
+}
+
+
 
 int newcat_decode_event(RIG *rig)
 {
@@ -10032,7 +10251,7 @@ int newcat_vfomem_toggle(RIG *rig)
  * "?;" busy please wait response; the command is not resent but up to
  * 'retry' retries to receive a valid response are made.
  */
-int newcat_get_cmd(RIG *rig)
+static int newcat_get_cmd_sync(RIG *rig)
 {
     struct rig_state *state = &rig->state;
     struct newcat_priv_data *priv = (struct newcat_priv_data *)rig->state.priv;
@@ -10263,6 +10482,151 @@ int newcat_get_cmd(RIG *rig)
     RETURNFUNC(rc);
 }
 
+/*
+ * With AI on, the rig's reports of changes come mixed with the replies to
+ * our commands.  While a command runs, priv->async_wait tells
+ * newcat_is_async_frame() which answers are its replies.
+ */
+int newcat_get_cmd(RIG *rig)
+{
+    struct newcat_priv_data *priv = (struct newcat_priv_data *)rig->state.priv;
+    int rc;
+
+    ELAPSED1;
+    /* keeps the other threads and port_transaction_submit() off the port */
+    set_transaction_active(rig);
+    SNPRINTF(priv->async_wait, sizeof(priv->async_wait), "%.2s", priv->cmd_str);
+    rc = newcat_get_cmd_sync(rig);
+    priv->async_wait[0] = '\0';
+    set_transaction_inactive(rig);
+
+    return rc;
+}
+
+/*
+ * Writes several read commands in  a single write and reads the replies,
+ * which the  rig returns in  the same order.  A command  the rig refused
+ * gets its error in retval, as the  rig answers it in its place with "?;"
+ * or similar.  Returns an error if the replies did not all arrive or got
+ * out of step after 'retry' attempts of the whole batch.
+ */
+int newcat_get_cmd_batch(RIG *rig, struct newcat_batch_cmd *batch, int count)
+{
+    struct rig_state *state = &rig->state;
+    struct newcat_priv_data *priv = (struct newcat_priv_data *)rig->state.priv;
+    char cmdbuf[NEWCAT_DATA_LEN];
+    size_t len = 0;
+    int retry_count = 0;
+    int rc;
+    int i;
+
+    ENTERFUNC;
+
+    if (count < 1 || count > NEWCAT_MAX_BATCH)
+    {
+        RETURNFUNC(-RIG_EINVAL);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        size_t cmdlen = batch[i].cmd ? strlen(batch[i].cmd) : 0;
+
+        if (cmdlen < 3 || batch[i].cmd[cmdlen - 1] != cat_term
+                || len + cmdlen >= sizeof(cmdbuf))
+        {
+            RETURNFUNC(-RIG_EINVAL);
+        }
+
+        memcpy(cmdbuf + len, batch[i].cmd, cmdlen);
+        len += cmdlen;
+    }
+
+    cmdbuf[len] = '\0';
+
+    /* see newcat_get_cmd() */
+    set_transaction_active(rig);
+
+    for (i = 0; i < count; i++)
+    {
+        memcpy(priv->async_wait + 2 * i, batch[i].cmd, 2);
+    }
+
+    priv->async_wait[2 * count] = '\0';
+
+    do
+    {
+        rig_flush(&state->rigport);  /* discard any unsolicited data */
+
+        rig_debug(RIG_DEBUG_TRACE, "cmd_str = %s\n", cmdbuf);
+
+        rc = write_block(&state->rigport, (unsigned char *) cmdbuf, len);
+
+        for (i = 0; rc == RIG_OK && i < count; i++)
+        {
+            struct newcat_batch_cmd *b = &batch[i];
+            int n;
+
+            n = read_string(&state->rigport, (unsigned char *) b->reply,
+                            sizeof(b->reply), &cat_term, sizeof(cat_term), 0, 1);
+
+            if (n <= 0)
+            {
+                rc = n < 0 ? n : -RIG_ETIMEOUT;
+                break;
+            }
+
+            if (cat_term != b->reply[n - 1])
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: Command is not correctly terminated '%s'\n",
+                          __func__, b->reply);
+                rc = -RIG_EPROTO;
+                break;
+            }
+
+            b->retval = RIG_OK;
+
+            if (n == 2)
+            {
+                switch (b->reply[0])
+                {
+                case 'N': b->retval = -RIG_ENAVAIL; break;
+
+                case '?': b->retval = -RIG_ERJCTED; break;
+
+                case 'E': b->retval = -RIG_EIO; break;
+
+                default: b->retval = -RIG_EPROTO; break;
+                }
+
+                rig_debug(RIG_DEBUG_VERBOSE, "%s: '%s' for '%s'\n", __func__, b->reply,
+                          b->cmd);
+                continue;
+            }
+
+            /* verify that reply was to the command we sent */
+            if (b->reply[0] != b->cmd[0] || b->reply[1] != b->cmd[1])
+            {
+                rig_debug(RIG_DEBUG_ERR, "%s: wrong reply %.2s for command %.2s\n",
+                          __func__, b->reply, b->cmd);
+                rc = -RIG_EPROTO;
+                break;
+            }
+
+            // update the cache
+            if (strcmp(b->cmd, "IF;") == 0)
+            {
+                elapsed_ms(&priv->cache_start, 1);
+                strcpy(priv->last_if_response, b->reply);
+            }
+        }
+    }
+    while (rc != RIG_OK && retry_count++ < state->rigport.retry);
+
+    priv->async_wait[0] = '\0';
+    set_transaction_inactive(rig);
+    RETURNFUNC(rc);
+}
+
 /*
  * This tries to set and read to validate the set command actually worked
  * returns RIG_OK if set, -RIG_EIMPL if not implemented yet, or -RIG_EPROTO if unsuccessful
@@ -10434,7 +10798,7 @@ int newcat_set_cmd_validate(RIG *rig)
  * "?;" busy please wait response; the command is not resent but up to
  * 'retry' retries to receive a valid response are made.
  */
-int newcat_set_cmd(RIG *rig)
+static int newcat_set_cmd_sync(RIG *rig)
 {
     struct rig_state *state = &rig->state;
     struct newcat_priv_data *priv = (struct newcat_priv_data *)rig->state.priv;
@@ -10611,6 +10975,25 @@ int newcat_set_cmd(RIG *rig)
     RETURNFUNC(rc);
 }
 
+/* see newcat_get_cmd() */
+int newcat_set_cmd(RIG *rig)
+{
+    struct newcat_priv_data *priv = (struct newcat_priv_data *)rig->state.priv;
+    int rc;
+
+    ELAPSED1;
+
+    set_transaction_active(rig);
+    /* the validation reads the setting back, then the ID/AI verify command */
+    SNPRINTF(priv->async_wait, sizeof(priv->async_wait), "%.2s%s", priv->cmd_str,
+             RIG_MODEL_FT9000 == rig->caps->rig_model ? "AI" : "ID");
+    rc = newcat_set_cmd_sync(rig);
+    priv->async_wait[0] = '\0';
+    set_transaction_inactive(rig);
+
+    return rc;
+}
+
 struct
 {
     rmode_t mode;
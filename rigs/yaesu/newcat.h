@@ -54,6 +54,7 @@ typedef char ncboolean;
 
 /* Hopefully large enough for future use, 128 chars plus '\0' */
 #define NEWCAT_DATA_LEN                 129
+#define NEWCAT_MAX_BATCH                8   /* commands sent in one write */
 
 /* arbitrary value for now.  11 bits (8N2+1) == 2.2917 mS @ 4800 bps */
 #define NEWCAT_DEFAULT_READ_TIMEOUT     (NEWCAT_DATA_LEN * 5)
@@ -116,6 +117,7 @@ struct newcat_priv_data
     char last_if_response[NEWCAT_DATA_LEN];
     int poweron; /* to prevent powering on more than once */
     int question_mark_response_means_rejected; /* the question mark response has multiple meanings */
+    char async_wait[NEWCAT_MAX_BATCH * 2 + 1]; /* prefixes of the replies being waited for, see newcat_is_async_frame */
 };
 
 /*
@@ -153,6 +155,17 @@ struct newcat_priv_data
 int newcat_get_cmd(RIG *rig);
 int newcat_set_cmd(RIG *rig);
 
+
+/* one read command of newcat_get_cmd_batch() */
+struct newcat_batch_cmd
+{
+    const char *cmd;                /* e.g. "FA;", with terminator */
+    char reply[NEWCAT_DATA_LEN];    /* reply with terminator */
+    int retval;                     /* RIG_OK or error reply of the rig */
+};
+
+int newcat_get_cmd_batch(RIG *rig, struct newcat_batch_cmd *batch, int count);
+
 int newcat_init(RIG *rig);
 int newcat_cleanup(RIG *rig);
 int newcat_open(RIG *rig);
@@ -195,6 +208,8 @@ int newcat_power2mW(RIG * rig, unsigned int *mwpower, float power, freq_t freq,
 int newcat_mW2power(RIG * rig, float *power, unsigned int mwpower, freq_t freq, rmode_t mode);
 int newcat_set_split_vfo(RIG * rig, vfo_t vfo, split_t split, vfo_t tx_vfo);
 int newcat_get_split_vfo(RIG * rig, vfo_t vfo, split_t * split, vfo_t *tx_vfo);
+int newcat_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq, rmode_t *mode,
+                        pbwidth_t *width, split_t *split);
 int newcat_set_rptr_shift(RIG * rig, vfo_t vfo, rptr_shift_t rptr_shift);
 int newcat_get_rptr_shift(RIG * rig, vfo_t vfo, rptr_shift_t * rptr_shift);
 int newcat_set_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t offs);
@@ -209,6 +224,12 @@ int newcat_set_ts(RIG * rig, vfo_t vfo, shortfreq_t ts);
 int newcat_get_ts(RIG * rig, vfo_t vfo, shortfreq_t * ts);
 int newcat_set_trn(RIG * rig, int trn);
 int newcat_get_trn(RIG * rig, int *trn);
+int newcat_read_frame_direct(RIG *rig, size_t buffer_length,
+                             const unsigned char *buffer);
+int newcat_is_async_frame(RIG *rig, size_t frame_length,
+                          const unsigned char *frame);
+int newcat_process_async_frame(RIG *rig, size_t frame_length,
+                               const unsigned char *frame);
 int newcat_set_channel(RIG * rig, vfo_t vfo, const channel_t * chan);
 int newcat_get_channel(RIG * rig, vfo_t vfo, channel_t * chan, int read_only);
 rmode_t newcat_rmode(char mode);
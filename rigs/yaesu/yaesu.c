@@ -33,6 +33,7 @@
 #include "serial.h"
 #include "misc.h"
 #include "register.h"
+#include "probe.h"
 
 #include "yaesu.h"
 
@@ -133,7 +134,7 @@ DECLARE_PROBERIG_BACKEND(yaesu)
     static const unsigned char cmd[YAESU_CMD_LENGTH] = { 0x00, 0x00, 0x00, 0x00, 0xfa};
     int id_len = -1, i, id1, id2;
     int retval = -1;
-    static const int rates[] = { 4800, 57600, 9600, 38400, 0 };  /* possible baud rates */
+    int rates[] = { 4800, 57600, 9600, 38400, 0 };  /* possible baud rates */
     int rates_idx;
 
     if (!port)
@@ -150,6 +151,9 @@ DECLARE_PROBERIG_BACKEND(yaesu)
     port->parm.serial.stop_bits = 2;
     port->retry = 1;
 
+    /* the rate the port is set to is the likeliest */
+    rig_probe_rate_first(port, rates);
+
     /*
      * try for all different baud rates
      */
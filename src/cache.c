@@ -20,6 +20,8 @@
  *
  */
 
+#include <stdlib.h>
+
 #include "cache.h"
 #include "misc.h"
 
@@ -32,6 +34,9 @@
 
 int rig_set_cache_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 {
+    struct rig_cache_slot *slot;
+    int i;
+
     ENTERFUNC;
 
     rig_cache_show(rig, __func__, __LINE__);
@@ -47,54 +52,39 @@ int rig_set_cache_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 
     if (vfo == RIG_VFO_SUB && rig->state.cache.satmode) { vfo = RIG_VFO_SUB_A; };
 
-    switch (vfo)
+    if (vfo == RIG_VFO_ALL) // we'll use ALL to reset all VFO caches
     {
-    case RIG_VFO_ALL: // we'll use NONE to reset all VFO caches
-        elapsed_ms(&rig->state.cache.time_modeMainA, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_modeMainB, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_modeMainC, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_widthMainA, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_widthMainB, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_widthMainC, HAMLIB_ELAPSED_INVALIDATE);
-        break;
-
-    case RIG_VFO_A:
-    case RIG_VFO_VFO:
-    case RIG_VFO_MAIN:
-    case RIG_VFO_MAIN_A:
-        rig->state.cache.modeMainA = mode;
+        rig_cache_write_begin(rig);
 
-        if (width > 0) { rig->state.cache.widthMainA = width; }
-
-        elapsed_ms(&rig->state.cache.time_modeMainA, HAMLIB_ELAPSED_SET);
-        elapsed_ms(&rig->state.cache.time_widthMainA, HAMLIB_ELAPSED_SET);
-        break;
+        for (i = 0; i < HAMLIB_CACHE_VFO_SLOTS; i++)
+        {
+            slot = &rig->state.cache_slot[i];
+            elapsed_ms(&slot->time_mode, HAMLIB_ELAPSED_INVALIDATE);
+            elapsed_ms(&slot->time_width, HAMLIB_ELAPSED_INVALIDATE);
+        }
 
-    case RIG_VFO_B:
-    case RIG_VFO_SUB:
-    case RIG_VFO_MAIN_B:
-        rig->state.cache.modeMainB = mode;
+        rig_cache_write_end(rig);
+        RETURNFUNC(RIG_OK);
+    }
 
-        if (width > 0) { rig->state.cache.widthMainB = width; }
+    i = rig_cache_slot_index(vfo);
 
-        elapsed_ms(&rig->state.cache.time_modeMainB, HAMLIB_ELAPSED_SET);
-        elapsed_ms(&rig->state.cache.time_widthMainB, HAMLIB_ELAPSED_SET);
-        break;
+    if (i < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: unknown vfo=%s\n", __func__, rig_strvfo(vfo));
+        RETURNFUNC(-RIG_EINTERNAL);
+    }
 
-    case RIG_VFO_C:
-    case RIG_VFO_MAIN_C:
-        rig->state.cache.modeMainC = mode;
+    slot = &rig->state.cache_slot[i];
 
-        if (width > 0) { rig->state.cache.widthMainC = width; }
+    rig_cache_write_begin(rig);
+    slot->mode = mode;
 
-        elapsed_ms(&rig->state.cache.time_modeMainC, HAMLIB_ELAPSED_SET);
-        elapsed_ms(&rig->state.cache.time_widthMainC, HAMLIB_ELAPSED_SET);
-        break;
+    if (width > 0) { slot->width = width; }
 
-    default:
-        rig_debug(RIG_DEBUG_ERR, "%s: unknown vfo=%s\n", __func__, rig_strvfo(vfo));
-        RETURNFUNC(-RIG_EINTERNAL);
-    }
+    elapsed_ms(&slot->time_mode, HAMLIB_ELAPSED_SET);
+    elapsed_ms(&slot->time_width, HAMLIB_ELAPSED_SET);
+    rig_cache_write_end(rig);
 
     rig_cache_show(rig, __func__, __LINE__);
     RETURNFUNC(RIG_OK);
@@ -102,7 +92,9 @@ int rig_set_cache_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
 
 int rig_set_cache_freq(RIG *rig, vfo_t vfo, freq_t freq)
 {
+    struct rig_cache_slot *slot;
     int flag = HAMLIB_ELAPSED_SET;
+    int i;
 
     if (rig_need_debug(RIG_DEBUG_CACHE))
     {
@@ -132,74 +124,41 @@ int rig_set_cache_freq(RIG *rig, vfo_t vfo, freq_t freq)
                   rig_strvfo(vfo), freq);
     }
 
-    switch (vfo)
+    if (vfo == RIG_VFO_ALL) // we'll use ALL to reset all VFO caches
     {
-    case RIG_VFO_ALL: // we'll use NONE to reset all VFO caches
-        elapsed_ms(&rig->state.cache.time_freqMainA, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_freqMainB, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_freqMainC, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_freqSubA, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_freqSubB, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_freqSubC, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_freqMem, HAMLIB_ELAPSED_INVALIDATE);
+        rig_cache_write_begin(rig);
+
+        for (i = 0; i < HAMLIB_CACHE_VFO_SLOTS; i++)
+        {
+            slot = &rig->state.cache_slot[i];
+            elapsed_ms(&slot->time_freq, HAMLIB_ELAPSED_INVALIDATE);
+            elapsed_ms(&slot->time_mode, HAMLIB_ELAPSED_INVALIDATE);
+            elapsed_ms(&slot->time_width, HAMLIB_ELAPSED_INVALIDATE);
+        }
+
         elapsed_ms(&rig->state.cache.time_vfo, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_modeMainA, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_modeMainB, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_modeMainC, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_widthMainA, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_widthMainB, HAMLIB_ELAPSED_INVALIDATE);
-        elapsed_ms(&rig->state.cache.time_widthMainC, HAMLIB_ELAPSED_INVALIDATE);
         elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_INVALIDATE);
         elapsed_ms(&rig->state.cache.time_split, HAMLIB_ELAPSED_INVALIDATE);
-        break;
-
-    case RIG_VFO_A:
-    case RIG_VFO_VFO:
-    case RIG_VFO_MAIN:
-    case RIG_VFO_MAIN_A:
-        rig->state.cache.freqMainA = freq;
-        elapsed_ms(&rig->state.cache.time_freqMainA, flag);
-        break;
-
-    case RIG_VFO_B:
-    case RIG_VFO_MAIN_B:
-    case RIG_VFO_SUB:
-        rig->state.cache.freqMainB = freq;
-        elapsed_ms(&rig->state.cache.time_freqMainB, flag);
-        break;
-
-    case RIG_VFO_C:
-    case RIG_VFO_MAIN_C:
-        rig->state.cache.freqMainC = freq;
-        elapsed_ms(&rig->state.cache.time_freqMainC, flag);
-        break;
-
-    case RIG_VFO_SUB_A:
-        rig->state.cache.freqSubA = freq;
-        elapsed_ms(&rig->state.cache.time_freqSubA, flag);
-        break;
-
-    case RIG_VFO_SUB_B:
-        rig->state.cache.freqSubB = freq;
-        elapsed_ms(&rig->state.cache.time_freqSubB, flag);
-        break;
-
-    case RIG_VFO_SUB_C:
-        rig->state.cache.freqSubC = freq;
-        elapsed_ms(&rig->state.cache.time_freqSubC, flag);
-        break;
-
-    case RIG_VFO_MEM:
-        rig->state.cache.freqMem = freq;
-        elapsed_ms(&rig->state.cache.time_freqMem, flag);
-        break;
-
-    default:
+        rig_cache_write_end(rig);
+        return (RIG_OK);
+    }
+
+    i = rig_cache_slot_index(vfo);
+
+    if (i < 0)
+    {
         rig_debug(RIG_DEBUG_ERR, "%s: unknown vfo?, vfo=%s\n", __func__,
                   rig_strvfo(vfo));
         return (-RIG_EINVAL);
     }
 
+    slot = &rig->state.cache_slot[i];
+
+    rig_cache_write_begin(rig);
+    slot->freq = freq;
+    elapsed_ms(&slot->time_freq, flag);
+    rig_cache_write_end(rig);
+
     if (rig_need_debug(RIG_DEBUG_CACHE))
     {
         rig_cache_show(rig, __func__, __LINE__);
@@ -209,43 +168,18 @@ int rig_set_cache_freq(RIG *rig, vfo_t vfo, freq_t freq)
     return (RIG_OK);
 }
 
-/**
- * \brief get cached values for a VFO
- * \param rig           The rig handle
- * \param vfo           The VFO to get information from
- * \param freq          The frequency is stored here
- * \param cache_ms_freq The age of the last frequency update in ms
- * \param mode          The mode is stored here
- * \param cache_ms_mode The age of the last mode update in ms
- * \param width         The width is stored here
- * \param cache_ms_width The age of the last width update in ms
- *
- * Use this to query the cache and then determine to actually fetch data from
- * the rig.
- *
- * \note All pointers must be given. No pointer can be left at NULL
- *
- * \return RIG_OK if the operation has been successful, otherwise
- * a negative value if an error occurred (in which case, cause is
- * set appropriately).
- *
+/*
+ * Take a consistent copy of the cached freq/mode/width of one VFO together
+ * with split and ptt.  Lock free: if a writer updates the cache while we
+ * copy it we just copy it again.
  */
-int rig_get_cache(RIG *rig, vfo_t vfo, freq_t *freq, int *cache_ms_freq,
-                  rmode_t *mode, int *cache_ms_mode, pbwidth_t *width, int *cache_ms_width)
+int rig_get_cache_snapshot(RIG *rig, vfo_t vfo, struct rig_cache_snapshot *snap)
 {
-    if (CHECK_RIG_ARG(rig) || !freq || !cache_ms_freq ||
-            !mode || !cache_ms_mode || !width || !cache_ms_width)
-    {
-        RETURNFUNC(-RIG_EINVAL);
-    }
-
-    if (rig_need_debug(RIG_DEBUG_CACHE))
-    {
-        ENTERFUNC2;
-    }
-
-    rig_debug(RIG_DEBUG_CACHE, "%s:  vfo=%s, current_vfo=%s\n", __func__,
-              rig_strvfo(vfo), rig_strvfo(rig->state.current_vfo));
+    struct rig_cache *cache = &rig->state.cache;
+    struct rig_cache_slot slot;
+    struct timespec time_vfo, time_split, time_ptt;
+    unsigned int seq;
+    int i;
 
     if (vfo == RIG_VFO_CURR)
     {
@@ -295,131 +229,114 @@ int rig_get_cache(RIG *rig, vfo_t vfo, freq_t *freq, int *cache_ms_freq,
     // pick a sane default
     if (vfo == RIG_VFO_CURR || vfo == RIG_VFO_NONE) { vfo = RIG_VFO_A; }
 
-    // If we're in satmode we map SUB to SUB_A
-    if (vfo == RIG_VFO_SUB && rig->state.cache.satmode) { vfo = RIG_VFO_SUB_A; };
+    do
+    {
+        seq = rig_cache_read_begin(rig);
+
+        snap->vfo = vfo;
+        snap->satmode = cache->satmode;
+
+        // If we're in satmode we map SUB to SUB_A
+        if (vfo == RIG_VFO_SUB && snap->satmode) { snap->vfo = RIG_VFO_SUB_A; };
 
-    switch (vfo)
+        i = rig_cache_slot_index(snap->vfo);
+
+        if (i >= 0)
+        {
+            slot = rig->state.cache_slot[i];
+        }
+
+        snap->split = cache->split;
+        snap->split_vfo = cache->split_vfo;
+        snap->ptt = cache->ptt;
+        snap->curr_vfo = cache->vfo;
+        time_vfo = cache->time_vfo;
+        time_split = cache->time_split;
+        time_ptt = cache->time_ptt;
+    }
+    while (rig_cache_read_retry(rig, seq));
+
+    snap->cache_ms_vfo = elapsed_ms(&time_vfo, HAMLIB_ELAPSED_GET);
+    snap->cache_ms_split = elapsed_ms(&time_split, HAMLIB_ELAPSED_GET);
+    snap->cache_ms_ptt = elapsed_ms(&time_ptt, HAMLIB_ELAPSED_GET);
+
+    if (i < 0)
     {
-    case RIG_VFO_CURR:
-        *freq = rig->state.cache.freqCurr;
-        *mode = rig->state.cache.modeCurr;
-        *width = rig->state.cache.widthCurr;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqCurr,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeCurr,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthCurr,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    case RIG_VFO_OTHER:
-        *freq = rig->state.cache.freqOther;
-        *mode = rig->state.cache.modeOther;
-        *width = rig->state.cache.widthOther;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqOther,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeOther,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthOther,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    case RIG_VFO_A:
-    case RIG_VFO_VFO:
-    case RIG_VFO_MAIN:
-    case RIG_VFO_MAIN_A:
-        *freq = rig->state.cache.freqMainA;
-        *mode = rig->state.cache.modeMainA;
-        *width = rig->state.cache.widthMainA;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqMainA,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeMainA,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthMainA,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    case RIG_VFO_B:
-    case RIG_VFO_SUB:
-    case RIG_VFO_MAIN_B:
-        *freq = rig->state.cache.freqMainB;
-        *mode = rig->state.cache.modeMainB;
-        *width = rig->state.cache.widthMainB;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqMainB,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeMainB,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthMainB,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    case RIG_VFO_SUB_A:
-        *freq = rig->state.cache.freqSubA;
-        *mode = rig->state.cache.modeSubA;
-        *width = rig->state.cache.widthSubA;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqSubA,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeSubA,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthSubA,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    case RIG_VFO_SUB_B:
-        *freq = rig->state.cache.freqSubB;
-        *mode = rig->state.cache.modeSubB;
-        *width = rig->state.cache.widthSubB;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqSubB,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeSubB,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthSubB,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    case RIG_VFO_C:
-        //case RIG_VFO_MAINC: // not used by any rig yet
-        *freq = rig->state.cache.freqMainC;
-        *mode = rig->state.cache.modeMainC;
-        *width = rig->state.cache.widthMainC;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqMainC,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeMainC,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthMainC,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    case RIG_VFO_SUB_C:
-        *freq = rig->state.cache.freqSubC;
-        *mode = rig->state.cache.modeSubC;
-        *width = rig->state.cache.widthSubC;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqSubC,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeSubC,
-                                    HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthSubC,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    case RIG_VFO_MEM:
-        *freq = rig->state.cache.freqMem;
-        *mode = rig->state.cache.modeMem;
-        *width = rig->state.cache.widthMem;
-        *cache_ms_freq = elapsed_ms(&rig->state.cache.time_freqMem, HAMLIB_ELAPSED_GET);
-        *cache_ms_mode = elapsed_ms(&rig->state.cache.time_modeMem, HAMLIB_ELAPSED_GET);
-        *cache_ms_width = elapsed_ms(&rig->state.cache.time_widthMem,
-                                     HAMLIB_ELAPSED_GET);
-        break;
-
-    default:
         rig_debug(RIG_DEBUG_ERR, "%s: unknown vfo?, vfo=%s\n", __func__,
-                  rig_strvfo(vfo));
+                  rig_strvfo(snap->vfo));
+        return -RIG_EINVAL;
+    }
+
+    snap->freq = slot.freq;
+    snap->mode = slot.mode;
+    snap->width = slot.width;
+
+    // ages are computed on our copy so readers never write to the cache
+    snap->cache_ms_freq = elapsed_ms(&slot.time_freq, HAMLIB_ELAPSED_GET);
+    snap->cache_ms_mode = elapsed_ms(&slot.time_mode, HAMLIB_ELAPSED_GET);
+    snap->cache_ms_width = elapsed_ms(&slot.time_width, HAMLIB_ELAPSED_GET);
+
+    return RIG_OK;
+}
+
+/**
+ * \brief get cached values for a VFO
+ * \param rig           The rig handle
+ * \param vfo           The VFO to get information from
+ * \param freq          The frequency is stored here
+ * \param cache_ms_freq The age of the last frequency update in ms
+ * \param mode          The mode is stored here
+ * \param cache_ms_mode The age of the last mode update in ms
+ * \param width         The width is stored here
+ * \param cache_ms_width The age of the last width update in ms
+ *
+ * Use this to query the cache and then determine to actually fetch data from
+ * the rig.  The values returned always belong to the same cache update, even
+ * when another thread is updating the cache at the same time.
+ *
+ * \note All pointers must be given. No pointer can be left at NULL
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ */
+int rig_get_cache(RIG *rig, vfo_t vfo, freq_t *freq, int *cache_ms_freq,
+                  rmode_t *mode, int *cache_ms_mode, pbwidth_t *width, int *cache_ms_width)
+{
+    struct rig_cache_snapshot snap;
+    int retval;
+
+    if (CHECK_RIG_ARG(rig) || !freq || !cache_ms_freq ||
+            !mode || !cache_ms_mode || !width || !cache_ms_width)
+    {
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    if (rig_need_debug(RIG_DEBUG_CACHE))
+    {
+        ENTERFUNC2;
+    }
+
+    rig_debug(RIG_DEBUG_CACHE, "%s:  vfo=%s, current_vfo=%s\n", __func__,
+              rig_strvfo(vfo), rig_strvfo(rig->state.current_vfo));
+
+    retval = rig_get_cache_snapshot(rig, vfo, &snap);
+
+    if (retval != RIG_OK)
+    {
+        RETURNFUNC(retval);
+    }
+
+    *freq = snap.freq;
+    *mode = snap.mode;
+    *width = snap.width;
+    *cache_ms_freq = snap.cache_ms_freq;
+    *cache_ms_mode = snap.cache_ms_mode;
+    *cache_ms_width = snap.cache_ms_width;
+
     rig_debug(RIG_DEBUG_CACHE, "%s: vfo=%s, freq=%.0f, mode=%s, width=%d\n",
-              __func__, rig_strvfo(vfo),
+              __func__, rig_strvfo(snap.vfo),
               (double)*freq, rig_strrmode(*mode), (int)*width);
 
     if (rig_need_debug(RIG_DEBUG_CACHE))
@@ -430,27 +347,335 @@ int rig_get_cache(RIG *rig, vfo_t vfo, freq_t *freq, int *cache_ms_freq,
     return RIG_OK;
 }
 
+/*
+ * Level, func and parm cache.
+ *
+ * Entries are keyed by the VFO's cache slot and the setting's bit number so
+ * a lookup is two array indexes.  Each class has a timeout and every setting
+ * can override it, e.g. to cache RIG_LEVEL_STRENGTH for 100ms but
+ * RIG_LEVEL_AF for 5s.  A successful set_* invalidates the setting on every
+ * VFO and transceive handlers can refresh it with rig_set_cache_setting().
+ */
+#define SETTING_CLASSES 3
+
+struct rig_setting_cache_entry
+{
+    value_t val;
+    struct timespec time;   /* all zero while nothing is cached */
+};
+
+struct rig_setting_cache
+{
+    int timeout_ms[SETTING_CLASSES];
+    int setting_timeout_ms[SETTING_CLASSES][RIG_SETTING_MAX];
+    struct rig_setting_cache_entry level[HAMLIB_CACHE_VFO_SLOTS][RIG_SETTING_MAX];
+    struct rig_setting_cache_entry func[HAMLIB_CACHE_VFO_SLOTS][RIG_SETTING_MAX];
+    struct rig_setting_cache_entry parm[RIG_SETTING_MAX];
+};
+
+static int setting_class(hamlib_cache_t selection)
+{
+    switch (selection)
+    {
+    case HAMLIB_CACHE_LEVEL: return 0;
+
+    case HAMLIB_CACHE_FUNC: return 1;
+
+    case HAMLIB_CACHE_PARM: return 2;
+
+    default: return -1;
+    }
+}
+
+/* bit number of a single setting, -1 for none or several */
+static int setting_index(setting_t setting)
+{
+    int idx;
+
+    if (setting == 0 || (setting & (setting - 1)) != 0) { return -1; }
+
+#if defined(__GNUC__)
+    idx = __builtin_ctzll(setting);
+#else
+
+    for (idx = 0; !(setting & 1); setting >>= 1) { idx++; }
+
+#endif
+    return idx;
+}
+
+/*
+ * The setting cache of rig, NULL until a timeout is set.  It may be made
+ * by one thread while the transceive thread of the backend refreshes it.
+ */
+static struct rig_setting_cache *setting_cache(const RIG *rig)
+{
+    return CACHE_SEQ_LOAD(&rig->state.setting_cache);
+}
+
+/* the cache entry for (vfo, setting), NULL if it is not cacheable */
+static struct rig_setting_cache_entry *setting_entry(RIG *rig,
+        struct rig_setting_cache *sc, int cls, vfo_t vfo, int idx)
+{
+    int slot;
+
+    if (cls == 2) { return &sc->parm[idx]; }
+
+    if (vfo == RIG_VFO_CURR || vfo == RIG_VFO_NONE) { vfo = rig->state.current_vfo; }
+
+    if (vfo == RIG_VFO_CURR || vfo == RIG_VFO_NONE) { vfo = RIG_VFO_A; }
+
+    slot = rig_cache_slot_index(vfo);
+
+    if (slot < 0) { return NULL; }
+
+    return cls == 0 ? &sc->level[slot][idx] : &sc->func[slot][idx];
+}
+
+/**
+ * \brief set the cache timeout of a level, func or parm
+ * \param rig       The rig handle
+ * \param selection HAMLIB_CACHE_LEVEL, HAMLIB_CACHE_FUNC or HAMLIB_CACHE_PARM
+ * \param setting   A single RIG_LEVEL_x, RIG_FUNC_x or RIG_PARM_x, or 0 to
+ * set the default of the whole class
+ * \param ms        Timeout in ms, 0 disables caching, HAMLIB_CACHE_ALWAYS
+ * keeps values until they are set, HAMLIB_CACHE_INHERIT makes the setting use
+ * its class default again
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_get_setting_cache_timeout_ms(), rig_set_cache_timeout_ms()
+ */
+int HAMLIB_API rig_set_setting_cache_timeout_ms(RIG *rig,
+        hamlib_cache_t selection, setting_t setting, int ms)
+{
+    struct rig_setting_cache *sc;
+    int cls = setting_class(selection);
+    int idx = setting_index(setting);
+    int i;
+
+    rig_debug(RIG_DEBUG_TRACE, "%s: called selection=%d, setting=0x%llx, ms=%d\n",
+              __func__, selection, (unsigned long long)setting, ms);
+
+    if (!rig || cls < 0 || (setting != 0 && idx < 0))
+    {
+        return -RIG_EINVAL;
+    }
+
+    sc = setting_cache(rig);
+
+    if (sc == NULL)
+    {
+        struct rig_setting_cache *none = NULL;
+
+        if (ms == 0) { return RIG_OK; } // nothing cached yet, nothing to turn off
+
+        sc = calloc(1, sizeof(struct rig_setting_cache));
+
+        if (sc == NULL) { return -RIG_ENOMEM; }
+
+        for (i = 0; i < RIG_SETTING_MAX; i++)
+        {
+            sc->setting_timeout_ms[0][i] = HAMLIB_CACHE_INHERIT;
+            sc->setting_timeout_ms[1][i] = HAMLIB_CACHE_INHERIT;
+            sc->setting_timeout_ms[2][i] = HAMLIB_CACHE_INHERIT;
+        }
+
+        /* published once filled in, another thread may have been first */
+        CACHE_SEQ_WFENCE();
+
+        if (!CACHE_SEQ_CAS(&rig->state.setting_cache, &none, sc))
+        {
+            free(sc);
+            sc = setting_cache(rig);
+        }
+    }
+
+    // setting 0 sets the class timeout
+    if (setting == 0)
+    {
+        if (ms == HAMLIB_CACHE_INHERIT) { return -RIG_EINVAL; }
+
+        sc->timeout_ms[cls] = ms;
+    }
+    else
+    {
+        sc->setting_timeout_ms[cls][idx] = ms;
+    }
+
+    return RIG_OK;
+}
+
+/**
+ * \brief get the cache timeout of a level, func or parm
+ * \param rig       The rig handle
+ * \param selection HAMLIB_CACHE_LEVEL, HAMLIB_CACHE_FUNC or HAMLIB_CACHE_PARM
+ * \param setting   A single setting, or 0 for the default of the class
+ *
+ * \return the timeout in ms that applies to \a setting, otherwise
+ * a negative value if an error occurred.
+ *
+ * \sa rig_set_setting_cache_timeout_ms()
+ */
+int HAMLIB_API rig_get_setting_cache_timeout_ms(RIG *rig,
+        hamlib_cache_t selection, setting_t setting)
+{
+    const struct rig_setting_cache *sc;
+    int cls = setting_class(selection);
+    int idx = setting_index(setting);
+
+    if (!rig || cls < 0 || (setting != 0 && idx < 0))
+    {
+        return -RIG_EINVAL;
+    }
+
+    sc = setting_cache(rig);
+
+    if (sc == NULL) { return 0; }
+
+    if (setting != 0 && sc->setting_timeout_ms[cls][idx] != HAMLIB_CACHE_INHERIT)
+    {
+        return sc->setting_timeout_ms[cls][idx];
+    }
+
+    return sc->timeout_ms[cls];
+}
+
+/*
+ * Look up a level, func or parm.  Returns RIG_OK and the value on a cache
+ * hit, -RIG_ENAVAIL when the caller has to ask the rig.
+ */
+int rig_get_cache_setting(RIG *rig, hamlib_cache_t selection, vfo_t vfo,
+                          setting_t setting, value_t *val)
+{
+    struct rig_setting_cache *sc = setting_cache(rig);
+    struct rig_setting_cache_entry *entry;
+    struct rig_setting_cache_entry copy;
+    int cls, idx, timeout;
+    unsigned int seq;
+
+    if (sc == NULL) { return -RIG_ENAVAIL; }
+
+    cls = setting_class(selection);
+    idx = setting_index(setting);
+
+    if (cls < 0 || idx < 0) { return -RIG_ENAVAIL; }
+
+    timeout = sc->setting_timeout_ms[cls][idx];
+
+    if (timeout == HAMLIB_CACHE_INHERIT) { timeout = sc->timeout_ms[cls]; }
+
+    if (timeout == 0) { return -RIG_ENAVAIL; }
+
+    entry = setting_entry(rig, sc, cls, vfo, idx);
+
+    if (entry == NULL) { return -RIG_ENAVAIL; }
+
+    do
+    {
+        seq = rig_cache_read_begin(rig);
+        copy = *entry;
+    }
+    while (rig_cache_read_retry(rig, seq));
+
+    if (copy.time.tv_sec == 0 && copy.time.tv_nsec == 0) { return -RIG_ENAVAIL; }
+
+    if (timeout != HAMLIB_CACHE_ALWAYS
+            && elapsed_ms(&copy.time, HAMLIB_ELAPSED_GET) >= timeout)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    *val = copy.val;
+    return RIG_OK;
+}
+
+/*
+ * Store a level, func or parm value just read from the rig or reported by
+ * a transceive event.  Does nothing while caching is off.
+ */
+int rig_set_cache_setting(RIG *rig, hamlib_cache_t selection, vfo_t vfo,
+                          setting_t setting, value_t val)
+{
+    struct rig_setting_cache *sc = setting_cache(rig);
+    struct rig_setting_cache_entry *entry;
+    int cls, idx;
+
+    if (sc == NULL) { return RIG_OK; }
+
+    cls = setting_class(selection);
+    idx = setting_index(setting);
+
+    if (cls < 0 || idx < 0) { return -RIG_EINVAL; }
+
+    entry = setting_entry(rig, sc, cls, vfo, idx);
+
+    if (entry == NULL) { return RIG_OK; }
+
+    rig_cache_write_begin(rig);
+    entry->val = val;
+    elapsed_ms(&entry->time, HAMLIB_ELAPSED_SET);
+    rig_cache_write_end(rig);
+
+    return RIG_OK;
+}
+
+/*
+ * Forget a level, func or parm on every VFO, e.g. after it was set --
+ * the rig may round the value so we read it back next time.
+ */
+void rig_invalidate_cache_setting(RIG *rig, hamlib_cache_t selection,
+                                  setting_t setting)
+{
+    struct rig_setting_cache *sc = setting_cache(rig);
+    struct rig_setting_cache_entry *entry;
+    int cls, idx, slot;
+
+    if (sc == NULL) { return; }
+
+    cls = setting_class(selection);
+    idx = setting_index(setting);
+
+    if (cls < 0 || idx < 0) { return; }
+
+    rig_cache_write_begin(rig);
+
+    for (slot = 0; slot < HAMLIB_CACHE_VFO_SLOTS; slot++)
+    {
+        if (cls == 2) { entry = &sc->parm[idx]; }
+        else if (cls == 0) { entry = &sc->level[slot][idx]; }
+        else { entry = &sc->func[slot][idx]; }
+
+        entry->time.tv_sec = entry->time.tv_nsec = 0;
+    }
+
+    rig_cache_write_end(rig);
+}
+
 void rig_cache_show(RIG *rig, const char *func, int line)
 {
+    const struct rig_cache_slot *slot = rig->state.cache_slot;
+
     rig_debug(RIG_DEBUG_CACHE,
               "%s(%d): freqMainA=%.0f, modeMainA=%s, widthMainA=%d\n", func, line,
-              rig->state.cache.freqMainA, rig_strrmode(rig->state.cache.modeMainA),
-              (int)rig->state.cache.widthMainA);
+              slot[CACHE_SLOT_MAIN_A].freq, rig_strrmode(slot[CACHE_SLOT_MAIN_A].mode),
+              (int)slot[CACHE_SLOT_MAIN_A].width);
     rig_debug(RIG_DEBUG_CACHE,
               "%s(%d): freqMainB=%.0f, modeMainB=%s, widthMainB=%d\n", func, line,
-              rig->state.cache.freqMainB, rig_strrmode(rig->state.cache.modeMainB),
-              (int)rig->state.cache.widthMainB);
+              slot[CACHE_SLOT_MAIN_B].freq, rig_strrmode(slot[CACHE_SLOT_MAIN_B].mode),
+              (int)slot[CACHE_SLOT_MAIN_B].width);
 
     if (rig->state.vfo_list & RIG_VFO_SUB_A)
     {
         rig_debug(RIG_DEBUG_CACHE,
                   "%s(%d): freqSubA=%.0f, modeSubA=%s, widthSubA=%d\n", func, line,
-                  rig->state.cache.freqSubA, rig_strrmode(rig->state.cache.modeSubA),
-                  (int)rig->state.cache.widthSubA);
+                  slot[CACHE_SLOT_SUB_A].freq, rig_strrmode(slot[CACHE_SLOT_SUB_A].mode),
+                  (int)slot[CACHE_SLOT_SUB_A].width);
         rig_debug(RIG_DEBUG_CACHE,
                   "%s(%d): freqSubB=%.0f, modeSubB=%s, widthSubB=%d\n", func, line,
-                  rig->state.cache.freqSubB, rig_strrmode(rig->state.cache.modeSubB),
-                  (int)rig->state.cache.widthSubB);
+                  slot[CACHE_SLOT_SUB_B].freq, rig_strrmode(slot[CACHE_SLOT_SUB_B].mode),
+                  (int)slot[CACHE_SLOT_SUB_B].width);
     }
 }
 
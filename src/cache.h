@@ -25,8 +25,159 @@
 
 #include <hamlib/rig.h>
 
+/*
+ * rig->state.cache is guarded by a sequence lock so the poll thread, the
+ * async reader and client threads can share it without a mutex.  Writers
+ * make rig->state.cache_seq odd while they update the cache and even again
+ * when done; writers only ever wait on other writers.  Readers copy what they
+ * need between rig_cache_read_begin() and rig_cache_read_retry() and simply
+ * try again if a writer got in between, so they never see a torn
+ * freq/mode/width/split combination.
+ *
+ * Keep write sections short -- no rig I/O and no rig_debug() inside them.
+ */
+#if defined(__GNUC__)
+#define CACHE_SEQ_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CACHE_SEQ_CAS(p, o, n)  __atomic_compare_exchange_n((p), (o), (n), 0, \
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+#define CACHE_SEQ_STORE(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define CACHE_SEQ_FENCE()       __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define CACHE_SEQ_WFENCE()      __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define CACHE_SEQ_LOAD(p)       (*(p))
+#define CACHE_SEQ_CAS(p, o, n)  (*(p) == *(o) ? (*(p) = (n), 1) : (*(o) = *(p), 0))
+#define CACHE_SEQ_STORE(p, v)   (*(p) = (v))
+#define CACHE_SEQ_FENCE()
+#define CACHE_SEQ_WFENCE()
+#endif
+
+static inline void rig_cache_write_begin(RIG *rig)
+{
+    unsigned int seq = CACHE_SEQ_LOAD(&rig->state.cache_seq);
+
+    for (;;)
+    {
+        if (!(seq & 1) && CACHE_SEQ_CAS(&rig->state.cache_seq, &seq, seq + 1))
+        {
+            break;
+        }
+
+        seq = CACHE_SEQ_LOAD(&rig->state.cache_seq);
+    }
+
+    CACHE_SEQ_WFENCE();
+}
+
+static inline void rig_cache_write_end(RIG *rig)
+{
+    CACHE_SEQ_STORE(&rig->state.cache_seq, rig->state.cache_seq + 1);
+}
+
+static inline unsigned int rig_cache_read_begin(const RIG *rig)
+{
+    unsigned int seq;
+
+    while ((seq = CACHE_SEQ_LOAD(&rig->state.cache_seq)) & 1)
+    {
+        /* a writer is in the middle of an update */
+    }
+
+    return seq;
+}
+
+static inline int rig_cache_read_retry(const RIG *rig, unsigned int seq)
+{
+    CACHE_SEQ_FENCE();
+    return CACHE_SEQ_LOAD(&rig->state.cache_seq) != seq;
+}
+
+/* index of each VFO's entry in rig->state.cache_slot */
+enum rig_cache_slot_e
+{
+    CACHE_SLOT_CURR,
+    CACHE_SLOT_OTHER,
+    CACHE_SLOT_MAIN_A,  /* VFO_A, VFO_MAIN, VFO_VFO and VFO_MAIN_A */
+    CACHE_SLOT_MAIN_B,  /* VFO_B, VFO_SUB and VFO_MAIN_B */
+    CACHE_SLOT_MAIN_C,  /* VFO_C and VFO_MAIN_C */
+    CACHE_SLOT_SUB_A,
+    CACHE_SLOT_SUB_B,
+    CACHE_SLOT_SUB_C,
+    CACHE_SLOT_MEM      /* last MEM channel */
+};
+
+/*
+ * Map a single VFO to its cache slot, -1 if it has none.  vfo_t values are
+ * single bits so this is just a table lookup on the bit number.
+ */
+static inline int rig_cache_slot_index(vfo_t vfo)
+{
+    static const signed char bit_slot[32] =
+    {
+        CACHE_SLOT_MAIN_A,  /* RIG_VFO_A */
+        CACHE_SLOT_MAIN_B,  /* RIG_VFO_B */
+        CACHE_SLOT_MAIN_C,  /* RIG_VFO_C */
+        CACHE_SLOT_SUB_C,   /* RIG_VFO_SUB_C */
+        CACHE_SLOT_MAIN_C,  /* RIG_VFO_MAIN_C */
+        CACHE_SLOT_OTHER,   /* RIG_VFO_OTHER */
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        CACHE_SLOT_SUB_A,   /* RIG_VFO_SUB_A */
+        CACHE_SLOT_SUB_B,   /* RIG_VFO_SUB_B */
+        CACHE_SLOT_MAIN_A,  /* RIG_VFO_MAIN_A */
+        CACHE_SLOT_MAIN_B,  /* RIG_VFO_MAIN_B */
+        CACHE_SLOT_MAIN_B,  /* RIG_VFO_SUB */
+        CACHE_SLOT_MAIN_A,  /* RIG_VFO_MAIN */
+        CACHE_SLOT_MAIN_A,  /* RIG_VFO_VFO */
+        CACHE_SLOT_MEM,     /* RIG_VFO_MEM */
+        CACHE_SLOT_CURR,    /* RIG_VFO_CURR */
+        -1,                 /* RIG_VFO_TX_FLAG */
+        -1,                 /* RIG_VFO_ALL */
+    };
+    int bit;
+
+    if (vfo == 0 || (vfo & (vfo - 1)) != 0) { return -1; }
+
+#if defined(__GNUC__)
+    bit = __builtin_ctz(vfo);
+#else
+
+    for (bit = 0; !(vfo & 1); vfo >>= 1) { bit++; }
+
+#endif
+    return bit_slot[bit];
+}
+
+/* expire everything in the cache so the next get goes to the rig */
+#define CACHE_RESET rig_set_cache_freq(rig, RIG_VFO_ALL, (freq_t)0)
+
+/* consistent copy of what the cache knows about one VFO */
+struct rig_cache_snapshot
+{
+    vfo_t vfo;          /* VFO the request resolved to */
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    int cache_ms_freq;
+    int cache_ms_mode;
+    int cache_ms_width;
+    split_t split;
+    vfo_t split_vfo;
+    ptt_t ptt;
+    int satmode;
+    vfo_t curr_vfo;     /* cached current VFO, the rest does not depend on vfo */
+    int cache_ms_vfo;
+    int cache_ms_split;
+    int cache_ms_ptt;
+};
+
+int rig_get_cache_snapshot(RIG *rig, vfo_t vfo, struct rig_cache_snapshot *snap);
 int rig_set_cache_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width);
 int rig_set_cache_freq(RIG *rig, vfo_t vfo, freq_t freq);
+int rig_get_cache_setting(RIG *rig, hamlib_cache_t selection, vfo_t vfo,
+                          setting_t setting, value_t *val);
+int rig_set_cache_setting(RIG *rig, hamlib_cache_t selection, vfo_t vfo,
+                          setting_t setting, value_t val);
+void rig_invalidate_cache_setting(RIG *rig, hamlib_cache_t selection,
+                                  setting_t setting);
 void rig_cache_show(RIG *rig, const char *func, int line);
 
 #endif
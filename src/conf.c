@@ -91,6 +91,11 @@ static const struct confparams frontend_cfg_params[] =
         "Polling interval in milliseconds for transceive emulation, value of 0 disables polling",
         "0", RIG_CONF_NUMERIC, { .n = { 0, 1000000, 1 } }
     },
+    {
+        TOK_POLL_BUDGET, "poll_budget", "Rig state polls per second",
+        "Most CAT reads per second the poll routine may spend, value of 0 sets no limit",
+        "0", RIG_CONF_NUMERIC, { .n = { 0, 1000, 1 } }
+    },
     {
         TOK_PTT_TYPE, "ptt_type", "PTT type",
         "Push-To-Talk interface type override",
@@ -126,6 +131,21 @@ static const struct confparams frontend_cfg_params[] =
         "Cache timeout, value of 0 disables caching",
         "500", RIG_CONF_NUMERIC, { .n = {0, 5000, 1}}
     },
+    {
+        TOK_SETTING_CACHE_TIMEOUT, "setting_cache_timeout", "Level/func/parm cache timeout in ms",
+        "Cache timeout for levels, funcs and parms, value of 0 disables caching",
+        "0", RIG_CONF_NUMERIC, { .n = {0, 60000, 1}}
+    },
+    {
+        TOK_MULTICAST_FORMAT, "multicast_format", "Multicast packet format",
+        "JSON text or compact binary snapshots, see rig_snapshot_decode()",
+        "JSON", RIG_CONF_COMBO, { .c = {{ "JSON", "BINARY", NULL }} }
+    },
+    {
+        TOK_MULTICAST_KEYFRAME_INTERVAL, "multicast_keyframe_interval", "Multicast keyframe interval in ms",
+        "Binary multicast sends the full state this often and only changes in between, 0 sends the full state every packet",
+        "1000", RIG_CONF_NUMERIC, { .n = {0, 60000, 1}}
+    },
     {
         TOK_AUTO_POWER_ON, "auto_power_on", "Auto power on",
         "True enables compatible rigs to be powered up on open",
@@ -627,6 +647,15 @@ static int frontend_set_conf(RIG *rig, token_t token, const char *val)
         rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_ALL, atol(val));
         break;
 
+    case TOK_POLL_BUDGET:
+        if (1 != sscanf(val, "%d", &val_i) || val_i < 0)
+        {
+            return -RIG_EINVAL; //value format error
+        }
+
+        rs->poll_budget = val_i;
+        break;
+
     case TOK_LO_FREQ:
         rs->lo_freq = atof(val);
         break;
@@ -635,6 +664,37 @@ static int frontend_set_conf(RIG *rig, token_t token, const char *val)
         rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_ALL, atol(val));
         break;
 
+    case TOK_SETTING_CACHE_TIMEOUT:
+        rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_LEVEL, atol(val));
+        rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_FUNC, atol(val));
+        rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_PARM, atol(val));
+        break;
+
+    case TOK_MULTICAST_FORMAT:
+        if (!strcmp(val, "JSON"))
+        {
+            rs->multicast_format = RIG_MULTICAST_FORMAT_JSON;
+        }
+        else if (!strcmp(val, "BINARY"))
+        {
+            rs->multicast_format = RIG_MULTICAST_FORMAT_BINARY;
+        }
+        else
+        {
+            return -RIG_EINVAL;
+        }
+
+        break;
+
+    case TOK_MULTICAST_KEYFRAME_INTERVAL:
+        if (1 != sscanf(val, "%d", &val_i) || val_i < 0)
+        {
+            return -RIG_EINVAL; //value format error
+        }
+
+        rs->multicast_keyframe_interval_ms = val_i;
+        break;
+
     case TOK_AUTO_POWER_ON:
         if (1 != sscanf(val, "%d", &val_i))
         {
@@ -916,6 +976,10 @@ static int frontend_get_conf2(RIG *rig, token_t token, char *val, int val_len)
         SNPRINTF(val, val_len, "%d", rs->poll_interval);
         break;
 
+    case TOK_POLL_BUDGET:
+        SNPRINTF(val, val_len, "%d", rs->poll_budget);
+        break;
+
     case TOK_PTT_TYPE:
         switch (rs->pttport.type.ptt)
         {
@@ -1028,6 +1092,19 @@ static int frontend_get_conf2(RIG *rig, token_t token, char *val, int val_len)
         SNPRINTF(val, val_len, "%d", rig_get_cache_timeout_ms(rig, HAMLIB_CACHE_ALL));
         break;
 
+    case TOK_SETTING_CACHE_TIMEOUT:
+        SNPRINTF(val, val_len, "%d", rig_get_cache_timeout_ms(rig, HAMLIB_CACHE_LEVEL));
+        break;
+
+    case TOK_MULTICAST_FORMAT:
+        SNPRINTF(val, val_len, "%s",
+                 rs->multicast_format == RIG_MULTICAST_FORMAT_BINARY ? "BINARY" : "JSON");
+        break;
+
+    case TOK_MULTICAST_KEYFRAME_INTERVAL:
+        SNPRINTF(val, val_len, "%d", rs->multicast_keyframe_interval_ms);
+        break;
+
     case TOK_AUTO_POWER_ON:
         SNPRINTF(val, val_len, "%d", rs->auto_power_on);
         break;
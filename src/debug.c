@@ -50,6 +50,7 @@
 #include <hamlib/rig.h>
 #include <hamlib/rig_dll.h>
 #include "misc.h"
+#include "trace_ring.h"
 
 /*! @} */
 
@@ -65,13 +66,47 @@
 
 
 static int rig_debug_level = RIG_DEBUG_TRACE;
+static int rig_debug_trace_level = RIG_DEBUG_NONE;
 static int rig_debug_time_stamp = 0;
+int rig_debug_gate_level = RIG_DEBUG_TRACE;
 FILE *rig_debug_stream;
 static vprintf_cb_t rig_vprintf_cb;
 static rig_ptr_t rig_vprintf_arg;
 
 extern HAMLIB_EXPORT(void) dump_hex(const unsigned char ptr[], size_t size);
 
+
+/*
+ * Errors are always let through, to keep them for rigerror() even when
+ * nothing is printed.
+ */
+static void rig_debug_gate_update(void)
+{
+    int level = rig_debug_level;
+
+    if (rig_debug_trace_level > level)
+    {
+        level = rig_debug_trace_level;
+    }
+
+    if (level < RIG_DEBUG_ERR)
+    {
+        level = RIG_DEBUG_ERR;
+    }
+
+    rig_debug_gate_level = level;
+}
+
+
+static void rig_debug_save_copy(char *dst, const char *src)
+{
+    size_t len = strnlen(src, DEBUGMSGSAVE_SIZE - 1);
+
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+
 /**
  * \brief Do a hex dump of the unsigned char array.
  *
@@ -152,6 +187,7 @@ void dump_hex(const unsigned char ptr[], size_t size)
 void HAMLIB_API rig_set_debug(enum rig_debug_level_e debug_level)
 {
     rig_debug_level = debug_level;
+    rig_debug_gate_update();
 }
 
 
@@ -201,12 +237,31 @@ void HAMLIB_API rig_debug(enum rig_debug_level_e debug_level,
                           const char *fmt, ...)
 {
     va_list ap;
+    int print = rig_need_debug(debug_level);
+
+    if (debug_level <= rig_debug_trace_level)
+    {
+        va_start(ap, fmt);
+        rig_trace_ring_record(debug_level, fmt, ap);
+        va_end(ap);
+    }
 
-    if (!rig_need_debug(debug_level))
+    if (!print && debug_level > RIG_DEBUG_ERR)
     {
         return;
     }
 
+    /* the last three messages, for rigerror() */
+    rig_debug_save_copy(debugmsgsave3, debugmsgsave2);
+    rig_debug_save_copy(debugmsgsave2, debugmsgsave);
+    va_start(ap, fmt);
+    vsnprintf(debugmsgsave, sizeof(debugmsgsave), fmt, ap);
+    va_end(ap);
+
+    if (!print)
+    {
+        return;
+    }
 
     va_start(ap, fmt);
 
@@ -271,6 +326,65 @@ void HAMLIB_API rig_debug(enum rig_debug_level_e debug_level,
 }
 
 
+/**
+ * \brief Record debugging messages in memory, to be formatted later.
+ *
+ * \param debug_level Messages up to this level are recorded,
+ * RIG_DEBUG_NONE to stop.
+ * \param entries How many messages each thread keeps, the older ones are
+ * dropped.
+ *
+ * Recording a message copies its arguments and takes no lock, so the
+ * trace can stay on without changing the timing of the rig.  It is
+ * independent of the level set by rig_set_debug(): e.g. record everything
+ * while printing only the warnings.  The messages are formatted by
+ * rig_debug_trace_dump().
+ *
+ * \return RIG_OK, or a negative RIG_E* error code.
+ *
+ * \sa rig_debug_trace_dump()
+ */
+int HAMLIB_API rig_set_debug_trace(enum rig_debug_level_e debug_level,
+                                   int entries)
+{
+    int retval = rig_trace_ring_resize(entries);
+
+    if (retval != RIG_OK)
+    {
+        return retval;
+    }
+
+    rig_debug_trace_level = entries > 0 ? debug_level : RIG_DEBUG_NONE;
+    rig_debug_gate_update();
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Format the recorded debugging messages.
+ *
+ * \param stream Where to print them.
+ *
+ * Prints the messages recorded since rig_set_debug_trace() by all threads,
+ * oldest first, each with its time and the number of its thread.  They
+ * stay recorded until the rings wrap.
+ *
+ * \return the number of messages printed, or a negative RIG_E* error code.
+ *
+ * \sa rig_set_debug_trace()
+ */
+int HAMLIB_API rig_debug_trace_dump(FILE *stream)
+{
+    if (!stream)
+    {
+        return -RIG_EINVAL;
+    }
+
+    return rig_trace_ring_dump(stream);
+}
+
+
 /**
  * \brief Set callback to handle debugging messages.
  *
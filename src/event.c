@@ -49,6 +49,8 @@
 #include "misc.h"
 #include "cache.h"
 #include "network.h"
+#include "spectrum_ring.h"
+#include "poll_schedule.h"
 
 #define CHECK_RIG_ARG(r) (!(r) || !(r)->caps || !(r)->state.comm_state)
 
@@ -66,164 +68,277 @@ typedef struct rig_poll_routine_priv_data_s
 
 // TODO: Where to start/stop rig poll routine?
 
-void *rig_poll_routine(void *arg)
+/* last values seen by the poll routine */
+struct rig_poll_values
+{
+    ptt_t ptt;
+    vfo_t vfo;
+    freq_t freq_main, freq_sub;
+    rmode_t mode_main, mode_sub;
+    pbwidth_t width_main, width_sub;
+    split_t split;
+};
+
+/* make the next read of item go to the rig, the cache keeps idle items */
+static void rig_poll_expire(RIG *rig, int item)
 {
-    rig_poll_routine_args *args = (rig_poll_routine_args *)arg;
-    RIG *rig = args->rig;
     struct rig_state *rs = &rig->state;
-    int result;
-    int update_occurred;
+    struct rig_cache_slot *slot = NULL;
 
-    vfo_t vfo = RIG_VFO_NONE, vfo_prev = RIG_VFO_NONE;
-    freq_t freq_main = 0, freq_sub = 0, freq_main_prev = 0, freq_sub_prev = 0;
-    rmode_t mode_main = RIG_MODE_NONE, mode_sub = RIG_MODE_NONE,
-            mode_main_prev = RIG_MODE_NONE, mode_sub_prev = RIG_MODE_NONE;
-    pbwidth_t width_main = 0, width_sub = 0, width_main_prev = 0,
-              width_sub_prev = 0;
-    split_t split, split_prev = -1;
+    rig_cache_write_begin(rig);
 
-    rig_debug(RIG_DEBUG_VERBOSE, "%s(%d): Starting rig poll routine thread\n",
-              __FILE__, __LINE__);
+    switch (item)
+    {
+    case RIG_POLL_PTT:
+        elapsed_ms(&rs->cache.time_ptt, HAMLIB_ELAPSED_INVALIDATE);
+        break;
+
+    case RIG_POLL_VFO:
+        elapsed_ms(&rs->cache.time_vfo, HAMLIB_ELAPSED_INVALIDATE);
+        break;
+
+    case RIG_POLL_FREQ_MAIN:
+    case RIG_POLL_MODE_MAIN:
+        slot = &rs->cache_slot[rig_cache_slot_index(RIG_VFO_A)];
+        break;
+
+    case RIG_POLL_FREQ_SUB:
+    case RIG_POLL_MODE_SUB:
+        slot = &rs->cache_slot[rig_cache_slot_index(RIG_VFO_B)];
+        break;
+
+    case RIG_POLL_SPLIT:
+        elapsed_ms(&rs->cache.time_split, HAMLIB_ELAPSED_INVALIDATE);
+        break;
+    }
 
-    // Rig cache time should be equal to rig poll interval (should be set automatically by rigctld at least)
-    rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_ALL, rs->poll_interval);
+    if (slot && (item == RIG_POLL_FREQ_MAIN || item == RIG_POLL_FREQ_SUB))
+    {
+        elapsed_ms(&slot->time_freq, HAMLIB_ELAPSED_INVALIDATE);
+    }
+    else if (slot)
+    {
+        elapsed_ms(&slot->time_mode, HAMLIB_ELAPSED_INVALIDATE);
+        elapsed_ms(&slot->time_width, HAMLIB_ELAPSED_INVALIDATE);
+    }
 
-    update_occurred = 0;
+    rig_cache_write_end(rig);
+}
 
-    while (rs->poll_routine_thread_run)
+/* poll item, fire its event and return 1 if it changed */
+static int rig_poll_item(RIG *rig, int item, struct rig_poll_values *prev)
+{
+    struct rig_state *rs = &rig->state;
+    int result;
+    ptt_t ptt;
+    vfo_t vfo, tx_vfo;
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    split_t split;
+    vfo_t poll_vfo = RIG_VFO_A;
+    freq_t *freq_prev = &prev->freq_main;
+    rmode_t *mode_prev = &prev->mode_main;
+    pbwidth_t *width_prev = &prev->width_main;
+
+    switch (item)
     {
-        if (rig->caps->get_vfo)
-        {
-            result = rig_get_vfo(rig, &vfo);
+    case RIG_POLL_PTT:
+        /* transceive reports keep it up to date */
+        if (rs->use_cached_ptt) { return 0; }
 
-            if (result != RIG_OK)
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_vfo error %s\n", __FILE__, __LINE__,
-                          rigerror(result));
-            }
+        rig_poll_expire(rig, item);
+        result = rig_get_ptt(rig, RIG_VFO_CURR, &ptt);
 
-            if (vfo != vfo_prev)
-            {
-                rig_fire_vfo_event(rig, vfo);
-            }
+        if (result != RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_ptt error %s\n", __FILE__, __LINE__,
+                      rigerror(result));
+            return 0;
+        }
 
-            if (vfo != vfo_prev)
-            {
-                rig_debug(RIG_DEBUG_CACHE,
-                          "%s(%d) vfo=%s was %s\n", __FILE__, __LINE__,
-                          rig_strvfo(vfo), rig_strvfo(vfo_prev));
-                update_occurred = 1;
-                vfo_prev = vfo;
-            }
+        if (ptt == prev->ptt)
+        {
+            return 0;
         }
 
-        if (rig->caps->get_freq)
+        rig_debug(RIG_DEBUG_CACHE, "%s(%d) ptt=%d was %d\n", __FILE__, __LINE__,
+                  ptt, prev->ptt);
+        prev->ptt = ptt;
+        rig_fire_ptt_event(rig, RIG_VFO_CURR, ptt);
+        return 1;
+
+    case RIG_POLL_VFO:
+        rig_poll_expire(rig, item);
+        result = rig_get_vfo(rig, &vfo);
+
+        if (result != RIG_OK)
         {
-            result = rig_get_freq(rig, RIG_VFO_A, &freq_main);
+            rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_vfo error %s\n", __FILE__, __LINE__,
+                      rigerror(result));
+            return 0;
+        }
 
-            if (result != RIG_OK)
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_freqA error %s\n", __FILE__, __LINE__,
-                          rigerror(result));
-            }
+        if (vfo == prev->vfo)
+        {
+            return 0;
+        }
 
-            result = rig_get_freq(rig, RIG_VFO_B, &freq_sub);
+        rig_debug(RIG_DEBUG_CACHE, "%s(%d) vfo=%s was %s\n", __FILE__, __LINE__,
+                  rig_strvfo(vfo), rig_strvfo(prev->vfo));
+        prev->vfo = vfo;
+        rig_fire_vfo_event(rig, vfo);
+        return 1;
 
-            if (result != RIG_OK)
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_freqB error %s\n", __FILE__, __LINE__,
-                          rigerror(result));
-            }
+    case RIG_POLL_FREQ_SUB:
+        poll_vfo = RIG_VFO_B;
+        freq_prev = &prev->freq_sub;
 
-            if (freq_main != freq_main_prev)
-            {
-                rig_fire_freq_event(rig, RIG_VFO_A, freq_main);
-            }
+    /* fall through */
+    case RIG_POLL_FREQ_MAIN:
+        if (rs->use_cached_freq) { return 0; }
 
-            if (freq_sub != freq_sub_prev)
-            {
-                rig_fire_freq_event(rig, RIG_VFO_B, freq_sub);
-            }
+        rig_poll_expire(rig, item);
+        result = rig_get_freq(rig, poll_vfo, &freq);
 
-            if (freq_main != freq_main_prev || freq_sub != freq_sub_prev)
-            {
-                rig_debug(RIG_DEBUG_CACHE,
-                          "%s(%d) freq_main=%.0f was %.0f, freq_sub=%.0f was %.0f\n", __FILE__, __LINE__,
-                          freq_main, freq_main_prev, freq_sub, freq_sub_prev);
-                update_occurred = 1;
-                freq_main_prev = freq_main;
-                freq_sub_prev = freq_sub;
-            }
+        if (result != RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_freq%s error %s\n", __FILE__,
+                      __LINE__, poll_vfo == RIG_VFO_A ? "A" : "B", rigerror(result));
+            return 0;
         }
 
-        if (rig->caps->get_mode)
+        if (freq == *freq_prev)
         {
-            result = rig_get_mode(rig, RIG_VFO_A, &mode_main, &width_main);
+            return 0;
+        }
 
-            if (result != RIG_OK)
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_modeA error %s\n", __FILE__, __LINE__,
-                          rigerror(result));
-            }
+        rig_debug(RIG_DEBUG_CACHE, "%s(%d) freq%s=%.0f was %.0f\n", __FILE__, __LINE__,
+                  poll_vfo == RIG_VFO_A ? "_main" : "_sub", freq, *freq_prev);
+        *freq_prev = freq;
+        rig_fire_freq_event(rig, poll_vfo, freq);
+        return 1;
 
-            result = rig_get_mode(rig, RIG_VFO_B, &mode_sub, &width_sub);
+    case RIG_POLL_MODE_SUB:
+        poll_vfo = RIG_VFO_B;
+        mode_prev = &prev->mode_sub;
+        width_prev = &prev->width_sub;
 
-            if (result != RIG_OK)
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_modeB error %s\n", __FILE__, __LINE__,
-                          rigerror(result));
-            }
+    /* fall through */
+    case RIG_POLL_MODE_MAIN:
+        if (rs->use_cached_mode) { return 0; }
 
-            if (mode_main != mode_main_prev || width_main != width_main_prev)
-            {
-                rig_fire_mode_event(rig, RIG_VFO_A, mode_main, width_main);
-            }
+        rig_poll_expire(rig, item);
+        result = rig_get_mode(rig, poll_vfo, &mode, &width);
 
-            if (mode_sub != mode_sub_prev || width_sub != width_sub_prev)
-            {
-                rig_fire_mode_event(rig, RIG_VFO_B, mode_sub, width_sub);
-            }
+        if (result != RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_mode%s error %s\n", __FILE__,
+                      __LINE__, poll_vfo == RIG_VFO_A ? "A" : "B", rigerror(result));
+            return 0;
+        }
 
-            if (mode_main != mode_main_prev || mode_sub != mode_sub_prev)
-            {
-                rig_debug(RIG_DEBUG_CACHE, "%s(%d) mode_main=%s was %s, mode_sub=%s was %s\n",
-                          __FILE__, __LINE__, rig_strrmode(mode_main), rig_strrmode(mode_main_prev),
-                          rig_strrmode(mode_sub), rig_strrmode(mode_sub_prev));
-                update_occurred = 1;
-                mode_main_prev = mode_main;
-                mode_sub_prev = mode_sub;
-            }
+        if (mode == *mode_prev && width == *width_prev)
+        {
+            return 0;
+        }
 
-            if (width_main != width_main_prev || width_sub != width_sub_prev)
-            {
-                rig_debug(RIG_DEBUG_CACHE,
-                          "%s(%d) width_main=%ld was %ld, width_sub=%ld was %ld\n", __FILE__, __LINE__,
-                          width_main, width_main_prev, width_sub, width_sub_prev);
-                update_occurred = 1;
-                width_main_prev = width_main;
-                width_sub_prev = width_sub;
-            }
+        rig_debug(RIG_DEBUG_CACHE, "%s(%d) mode%s=%s/%ld was %s/%ld\n", __FILE__,
+                  __LINE__, poll_vfo == RIG_VFO_A ? "_main" : "_sub", rig_strrmode(mode),
+                  width, rig_strrmode(*mode_prev), *width_prev);
+        *mode_prev = mode;
+        *width_prev = width;
+        rig_fire_mode_event(rig, poll_vfo, mode, width);
+        return 1;
+
+    case RIG_POLL_SPLIT:
+        rig_poll_expire(rig, item);
+        result = rig_get_split_vfo(rig, RIG_VFO_A, &split, &tx_vfo);
+
+        if (result != RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_split_vfo error %s\n", __FILE__,
+                      __LINE__, rigerror(result));
+            return 0;
         }
 
-        if (rig->caps->get_split_vfo)
+        if (split == prev->split)
         {
-            vfo_t tx_vfo;
-            result = rig_get_split_vfo(rig, RIG_VFO_A, &split, &tx_vfo);
+            return 0;
+        }
 
-            if (result != RIG_OK)
-            {
-                rig_debug(RIG_DEBUG_ERR, "%s(%d): rig_get_modeA error %s\n", __FILE__, __LINE__,
-                          rigerror(result));
-            }
+        rig_debug(RIG_DEBUG_CACHE, "%s(%d) split=%d was %d\n", __FILE__, __LINE__,
+                  split, prev->split);
+        prev->split = split;
+        return 1;
+    }
 
-            if (split != split_prev)
-            {
-                rig_debug(RIG_DEBUG_CACHE, "%s(%d) split=%d was %d\n", __FILE__, __LINE__,
-                          split,
-                          split_prev);
-                update_occurred = 1;
-                split_prev = split;
-            }
+    return 0;
+}
+
+void *rig_poll_routine(void *arg)
+{
+    rig_poll_routine_args *args = (rig_poll_routine_args *)arg;
+    RIG *rig = args->rig;
+    struct rig_state *rs = &rig->state;
+    struct rig_poll_schedule sched;
+    struct rig_poll_values prev;
+    struct timespec start;
+    unsigned int enabled = 0;
+    int update_occurred;
+    double now;
+    int item;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s(%d): Starting rig poll routine thread\n",
+              __FILE__, __LINE__);
+
+    /* clients and PTT go first */
+    rig_set_priority(RIG_PRIO_BACKGROUND);
+
+    if (rig->caps->get_ptt) { enabled |= RIG_POLL_BIT(RIG_POLL_PTT); }
+
+    if (rig->caps->get_vfo) { enabled |= RIG_POLL_BIT(RIG_POLL_VFO); }
+
+    if (rig->caps->get_freq)
+    {
+        enabled |= RIG_POLL_BIT(RIG_POLL_FREQ_MAIN) | RIG_POLL_BIT(RIG_POLL_FREQ_SUB);
+    }
+
+    if (rig->caps->get_mode)
+    {
+        enabled |= RIG_POLL_BIT(RIG_POLL_MODE_MAIN) | RIG_POLL_BIT(RIG_POLL_MODE_SUB);
+    }
+
+    if (rig->caps->get_split_vfo) { enabled |= RIG_POLL_BIT(RIG_POLL_SPLIT); }
+
+    rig_poll_schedule_init(&sched, rs->poll_interval, rs->poll_budget, enabled);
+
+    // The poll routine refreshes what it polls itself, even items it has
+    // backed off from, so the cache can serve clients until the next poll
+    rig_set_cache_timeout_ms(rig, HAMLIB_CACHE_ALL, sched.slow_ms);
+
+    prev.ptt = -1;
+    prev.vfo = RIG_VFO_NONE;
+    prev.freq_main = prev.freq_sub = 0;
+    prev.mode_main = prev.mode_sub = RIG_MODE_NONE;
+    prev.width_main = prev.width_sub = 0;
+    prev.split = -1;
+
+    elapsed_ms(&start, HAMLIB_ELAPSED_SET);
+
+    while (rs->poll_routine_thread_run)
+    {
+        update_occurred = 0;
+        now = elapsed_ms(&start, HAMLIB_ELAPSED_GET);
+
+        while (rs->poll_routine_thread_run
+                && (item = rig_poll_schedule_next(&sched, now)) >= 0)
+        {
+            int changed = rig_poll_item(rig, item, &prev);
+
+            update_occurred |= changed;
+            now = elapsed_ms(&start, HAMLIB_ELAPSED_GET);
+            rig_poll_schedule_done(&sched, item, now, changed);
         }
 
         if (update_occurred)
@@ -231,7 +346,7 @@ void *rig_poll_routine(void *arg)
             network_publish_rig_poll_data(rig);
         }
 
-        hl_usleep(rs->poll_interval * 1000);
+        hl_usleep((rig_poll_schedule_wait(&sched, now) + 1) * 1000);
     }
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s(%d): Stopping rig poll routine thread\n",
@@ -635,8 +750,10 @@ int rig_fire_vfo_event(RIG *rig, vfo_t vfo)
 
     rig_debug(RIG_DEBUG_TRACE, "Event: vfo changed to %s\n", rig_strvfo(vfo));
 
+    rig_cache_write_begin(rig);
     rig->state.cache.vfo = vfo;
     elapsed_ms(&rig->state.cache.time_vfo, HAMLIB_ELAPSED_SET);
+    rig_cache_write_end(rig);
 
     network_publish_rig_transceive_data(rig);
 
@@ -656,8 +773,10 @@ int rig_fire_ptt_event(RIG *rig, vfo_t vfo, ptt_t ptt)
     rig_debug(RIG_DEBUG_TRACE, "Event: PTT changed to %i on %s\n", ptt,
               rig_strvfo(vfo));
 
+    rig_cache_write_begin(rig);
     rig->state.cache.ptt = ptt;
     elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+    rig_cache_write_end(rig);
 
     network_publish_rig_transceive_data(rig);
 
@@ -768,6 +887,8 @@ static int print_spectrum_line(char *str, size_t length,
 
 int rig_fire_spectrum_event(RIG *rig, struct rig_spectrum_line *line)
 {
+    uint64_t seq;
+
     ENTERFUNC;
 
     if (rig_need_debug(RIG_DEBUG_TRACE))
@@ -778,7 +899,15 @@ int rig_fire_spectrum_event(RIG *rig, struct rig_spectrum_line *line)
                   spectrum_debug);
     }
 
-    network_publish_rig_spectrum_data(rig, line);
+    /* the multicast publisher picks the line up from the ring */
+    if (rig_spectrum_ring_publish(rig, line, &seq) == RIG_OK)
+    {
+        network_publish_rig_spectrum_ref(rig, seq);
+    }
+    else
+    {
+        network_publish_rig_spectrum_data(rig, line);
+    }
 
     if (rig->callbacks.spectrum_event)
     {
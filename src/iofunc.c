@@ -42,6 +42,11 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include <hamlib/rig.h>
 #include "iofunc.h"
@@ -54,6 +59,8 @@
 #include "cm108.h"
 #include "gpio.h"
 #include "asyncpipe.h"
+#include "transaction.h"
+#include "stats.h"
 
 #if defined(WIN32) && defined(HAVE_WINDOWS_H)
 #include <windows.h>
@@ -221,6 +228,23 @@ static int create_sync_data_pipe(hamlib_port_t *p)
 
 #endif
 
+/**
+ * \brief The state hamlib keeps for a port
+ * \param p rig port descriptor
+ * \return the state, NULL unless p is the rig port of a rig
+ */
+struct port_private *port_private(const hamlib_port_t *p)
+{
+    const RIG *rig = p->rig;
+
+    if (rig == NULL || p != &rig->state.rigport)
+    {
+        return NULL;
+    }
+
+    return rig->state.rigport_private;
+}
+
 /**
  * \brief Open a hamlib_port based on its rig port type
  * \param p rig port descriptor
@@ -232,6 +256,7 @@ int HAMLIB_API port_open(hamlib_port_t *p)
     int want_state_delay = 0;
 
     p->fd = -1;
+    port_rx_discard(p);
     init_sync_data_pipe(p);
 
     if (p->asyncio)
@@ -380,6 +405,9 @@ int HAMLIB_API port_close(hamlib_port_t *p, rig_port_t port_type)
 {
     int ret = RIG_OK;
 
+    port_transaction_stop(p);
+    port_tx_stop(p);
+
     if (p->fd != -1)
     {
         switch (port_type)
@@ -412,6 +440,7 @@ int HAMLIB_API port_close(hamlib_port_t *p, rig_port_t port_type)
         p->fd = -1;
     }
 
+    port_rx_discard(p);
     close_sync_data_pipe(p);
 
     return (ret);
@@ -958,6 +987,299 @@ int HAMLIB_API write_block_sync_error(hamlib_port_t *p,
 
 #endif
 
+/*
+ * Write pacing.  write_delay and post_write_delay are deadlines rather
+ * than sleeps after the fact: the next byte, or the next write, may not
+ * go out before the deadline left by the previous one, and nobody waits
+ * when nothing is due.
+ *
+ * With a write_delay, write_block() hands a copy of the data to a writer
+ * thread owned by the port, which sends it one byte per deadline while the
+ * caller carries on.  Set commands of Yaesu style rigs, which get no
+ * reply, and long CW messages or memory uploads no longer block the
+ * calling thread for count * write_delay.  Reads first wait for the queue
+ * to drain, so response timeouts still start after the last byte was
+ * sent.  A write error of the writer is returned by the next write_block().
+ */
+
+static void port_time_now(struct timespec *ts)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+static void port_time_add_ms(struct timespec *ts, int ms)
+{
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000L;
+
+    if (ts->tv_nsec >= 1000000000L)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void port_sleep_until(const struct timespec *deadline)
+{
+    struct timespec now;
+    long long usec;
+
+    port_time_now(&now);
+
+    usec = (long long)(deadline->tv_sec - now.tv_sec) * 1000000LL
+           + (deadline->tv_nsec - now.tv_nsec) / 1000;
+
+    if (usec > 0)
+    {
+        hl_usleep(usec);
+    }
+}
+
+/* send count bytes one at a time, no earlier than *deadline and each
+ * write_delay after the previous one, and leave the deadline of the next
+ * write in *deadline */
+static int port_write_paced(hamlib_port_t *p, struct timespec *deadline,
+                            const unsigned char *txbuffer, size_t count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        ssize_t ret;
+
+        port_sleep_until(deadline);
+
+        ret = port_write(p, txbuffer + i, 1);
+
+        if (ret != 1)
+        {
+            rig_debug(RIG_DEBUG_ERR,
+                      "%s():%d failed %d - %s\n",
+                      __func__,
+                      __LINE__,
+                      (int) ret,
+                      strerror(errno));
+
+            return -RIG_EIO;
+        }
+
+        port_time_now(deadline);
+        port_time_add_ms(deadline, p->write_delay);
+    }
+
+    port_time_add_ms(deadline, p->post_write_delay);
+
+    return RIG_OK;
+}
+
+#ifdef HAVE_PTHREAD
+//! @cond Doxygen_Suppress
+#define PORT_TX_JOBS 16
+
+struct port_tx_job
+{
+    unsigned char *data;
+    size_t count;
+};
+
+struct port_tx_queue
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* signaled when a job is queued or done */
+    struct port_tx_job jobs[PORT_TX_JOBS];
+    int head;                   /* next job to send */
+    int count;                  /* jobs queued, including the one being sent */
+    int error;                  /* first error since the last write_block() */
+    int stop;
+    struct timespec deadline;   /* writer thread only */
+};
+//! @endcond
+
+static void *port_tx_thread(void *arg)
+{
+    hamlib_port_t *p = arg;
+    struct port_tx_queue *q = port_private(p)->tx_queue;
+
+    pthread_mutex_lock(&q->mutex);
+
+    for (;;)
+    {
+        struct port_tx_job job;
+        int ret;
+
+        while (q->count == 0 && !q->stop)
+        {
+            pthread_cond_wait(&q->cond, &q->mutex);
+        }
+
+        if (q->count == 0)
+        {
+            break;
+        }
+
+        job = q->jobs[q->head];
+        pthread_mutex_unlock(&q->mutex);
+
+        ret = port_write_paced(p, &q->deadline, job.data, job.count);
+        free(job.data);
+
+        pthread_mutex_lock(&q->mutex);
+
+        if (ret != RIG_OK && q->error == RIG_OK)
+        {
+            q->error = ret;
+        }
+
+        q->head = (q->head + 1) % PORT_TX_JOBS;
+        q->count--;
+        pthread_cond_broadcast(&q->cond);
+    }
+
+    pthread_mutex_unlock(&q->mutex);
+
+    return NULL;
+}
+
+static int port_tx_start(hamlib_port_t *p)
+{
+    struct port_private *pp = port_private(p);
+    struct port_tx_queue *q;
+
+    q = calloc(1, sizeof(*q));
+
+    if (q == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    q->error = RIG_OK;
+    port_time_now(&q->deadline);
+    pp->tx_queue = q;
+
+    if (pthread_create(&q->thread, NULL, port_tx_thread, p) != 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: cannot start writer thread: %s\n", __func__,
+                  strerror(errno));
+        pp->tx_queue = NULL;
+        pthread_cond_destroy(&q->cond);
+        pthread_mutex_destroy(&q->mutex);
+        free(q);
+        return -RIG_EINTERNAL;
+    }
+
+    return RIG_OK;
+}
+
+static int port_tx_enqueue(hamlib_port_t *p, const unsigned char *txbuffer,
+                           size_t count)
+{
+    struct port_tx_queue *q = port_private(p)->tx_queue;
+    unsigned char *data;
+    int ret;
+
+    data = malloc(count > 0 ? count : 1);
+
+    if (data == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    memcpy(data, txbuffer, count);
+
+    pthread_mutex_lock(&q->mutex);
+
+    while (q->count == PORT_TX_JOBS)
+    {
+        pthread_cond_wait(&q->cond, &q->mutex);
+    }
+
+    q->jobs[(q->head + q->count) % PORT_TX_JOBS].data = data;
+    q->jobs[(q->head + q->count) % PORT_TX_JOBS].count = count;
+    q->count++;
+
+    ret = q->error;
+    q->error = RIG_OK;
+
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+
+    return ret;
+}
+#endif
+
+/**
+ * \brief Wait until all bytes queued by write_block() have been sent
+ * \param p rig port descriptor
+ *
+ * To be called before anything else touches the device, e.g. a read, a
+ * flush or a change of the modem control lines.
+ */
+void port_tx_drain(hamlib_port_t *p)
+{
+#ifdef HAVE_PTHREAD
+    const struct port_private *pp = port_private(p);
+    struct port_tx_queue *q;
+
+    /* a PTT or DCD port may be the device of the rig port */
+    if (pp == NULL && p->rig != NULL && p->fd >= 0
+            && p->fd == p->rig->state.rigport.fd)
+    {
+        pp = port_private(&p->rig->state.rigport);
+    }
+
+    q = pp ? pp->tx_queue : NULL;
+
+    if (q == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&q->mutex);
+
+    while (q->count > 0)
+    {
+        pthread_cond_wait(&q->cond, &q->mutex);
+    }
+
+    pthread_mutex_unlock(&q->mutex);
+#endif
+}
+
+/**
+ * \brief Send what is queued and stop the writer thread of a port
+ * \param p rig port descriptor
+ *
+ * To be called before the port is closed.
+ */
+void port_tx_stop(hamlib_port_t *p)
+{
+#ifdef HAVE_PTHREAD
+    const struct port_private *pp = port_private(p);
+    struct port_tx_queue *q = pp ? pp->tx_queue : NULL;
+
+    if (q == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&q->mutex);
+    q->stop = 1;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+
+    pthread_join(q->thread, NULL);
+
+    port_private(p)->tx_queue = NULL;
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->mutex);
+    free(q);
+#endif
+}
+
+
 /**
  * \brief Write a block of characters to an fd.
  * \param p rig port descriptor
@@ -974,6 +1296,10 @@ int HAMLIB_API write_block_sync_error(hamlib_port_t *p,
  * Also, post_write_delay is for some Yaesu rigs (eg: FT747) that
  * get confused with sequential fast writes between cmd sequences.
  *
+ * With a write_delay, the bytes are queued and sent by the writer thread
+ * of the port, and the function returns without waiting for them.  A
+ * post_write_delay only delays the next write.
+ *
  * input:
  *
  * fd - file descriptor to write to
@@ -981,7 +1307,7 @@ int HAMLIB_API write_block_sync_error(hamlib_port_t *p,
  * count - count of byte to send from the txbuffer
  * write_delay - write delay in ms between 2 chars
  * post_write_delay - minimum delay between two writes
- * post_write_date - timeval of last write
+ * post_write_date - earliest time of the next write
  *
  * Actually, this function has nothing specific to serial comm,
  * it could work very well also with any file handle, like a socket.
@@ -990,6 +1316,7 @@ int HAMLIB_API write_block_sync_error(hamlib_port_t *p,
 int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
                            size_t count)
 {
+    struct timespec deadline;
     int ret;
     int method = 0;
 
@@ -999,59 +1326,54 @@ int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
         return (-RIG_EIO);
     }
 
-#ifdef WANT_NON_ACTIVE_POST_WRITE_DELAY
-
-    if (p->post_write_date.tv_sec != 0)
+    if (p->write_delay > 0)
     {
-        signed int date_delay;    /* in us */
-        struct timeval tv;
-
-        /* FIXME in Y2038 ... */
-        gettimeofday(&tv, NULL);
-        date_delay = p->post_write_delay * 1000 -
-                     ((tv.tv_sec - p->post_write_date.tv_sec) * 1000000 +
-                      (tv.tv_usec - p->post_write_date.tv_usec));
+#ifdef HAVE_PTHREAD
+        const struct port_private *pp = port_private(p);
 
-        if (date_delay > 0)
+        if (pp != NULL && pp->tx_queue == NULL)
         {
-            /*
-             * optional delay after last write
-             */
-            hl_sleep(date_delay);
+            port_tx_start(p);
         }
 
-        p->post_write_date.tv_sec = 0;
-    }
+        if (pp != NULL && pp->tx_queue != NULL)
+        {
+            method = 3;
+            ret = port_tx_enqueue(p, txbuffer, count);
 
-#endif
+            rig_debug(RIG_DEBUG_TRACE, "%s(): TX %d bytes, method=%d\n", __func__,
+                      (int)count, method);
+            dump_hex((unsigned char *) txbuffer, count);
 
-    if (p->write_delay > 0)
-    {
-        int i;
+            return ret;
+        }
+
+#endif
         method = 1;
+    }
 
-        for (i = 0; i < count; i++)
-        {
-            ret = port_write(p, txbuffer + i, 1);
+    /* the writer thread may still be busy if write_delay was just reset */
+    port_tx_drain(p);
 
-            if (ret != 1)
-            {
-                rig_debug(RIG_DEBUG_ERR,
-                          "%s():%d failed %d - %s\n",
-                          __func__,
-                          __LINE__,
-                          ret,
-                          strerror(errno));
+    deadline.tv_sec = p->post_write_date.tv_sec;
+    deadline.tv_nsec = p->post_write_date.tv_usec * 1000L;
 
-                return -RIG_EIO;
-            }
+    if (method == 1)
+    {
+        ret = port_write_paced(p, &deadline, txbuffer, count);
 
-            if (p->write_delay > 0) { hl_usleep(p->write_delay * 1000); }
+        if (ret != RIG_OK)
+        {
+            return ret;
         }
     }
     else
     {
         method = 2;
+
+        /* optional delay after last write */
+        port_sleep_until(&deadline);
+
         ret = port_write(p, txbuffer, count);
 
         if (ret != count)
@@ -1065,39 +1387,162 @@ int HAMLIB_API write_block(hamlib_port_t *p, const unsigned char *txbuffer,
 
             return -RIG_EIO;
         }
+
+        /* otherwise some yaesu rigs get confused */
+        /* with sequential fast writes*/
+        port_time_now(&deadline);
+        port_time_add_ms(&deadline, p->post_write_delay);
     }
 
+    p->post_write_date.tv_sec = deadline.tv_sec;
+    p->post_write_date.tv_usec = deadline.tv_nsec / 1000;
+
+    if (p->post_write_delay > 0) { method |= 4; }
+
     rig_debug(RIG_DEBUG_TRACE, "%s(): TX %d bytes, method=%d\n", __func__,
               (int)count, method);
     dump_hex((unsigned char *) txbuffer, count);
 
-    if (p->post_write_delay > 0)
+    return RIG_OK;
+}
+
+/*
+ * Receive buffer of direct reads.  Whatever the device has available is
+ * read in one go into the rx_buffer of the port, and bytes beyond the end of the current
+ * response are kept there for the next read_string() or read_block(), so a
+ * response costs one select() and one read() instead of one of each per
+ * byte.  The buffer is only refilled once it is empty.  Reads from the sync
+ * data pipe are not buffered, the pipe is read by another thread than the
+ * device.
+ */
+
+/**
+ * \brief Drop the bytes read ahead from a port
+ * \param p rig port descriptor
+ *
+ * To be called whenever pending input is discarded, e.g. on flush, open
+ * and close.
+ */
+void port_rx_discard(hamlib_port_t *p)
+{
+    struct port_private *pp = port_private(p);
+
+    if (pp == NULL)
+    {
+        return;
+    }
+
+    if (pp->rx_count > 0)
     {
-        method |= 4;
-#ifdef WANT_NON_ACTIVE_POST_WRITE_DELAY
-#define POST_WRITE_DELAY_TRSHLD 10
+        rig_debug(RIG_DEBUG_TRACE, "%s: discarding %d buffered bytes\n", __func__,
+                  (int) pp->rx_count);
+    }
+
+    pp->rx_pos = 0;
+    pp->rx_count = 0;
+}
 
-        if (p->post_write_delay > POST_WRITE_DELAY_TRSHLD)
+/* read as much as the device has, up to count bytes, retrying while busy */
+static ssize_t port_read_available(hamlib_port_t *p, unsigned char *buf,
+                                   size_t count, int direct)
+{
+    ssize_t rd_count;
+    int i = 0;
+
+    do
+    {
+        rd_count = port_read_generic(p, buf, count, direct);
+
+        if (rd_count >= 0)
         {
-            struct timeval tv;
-            gettimeofday(&tv, NULL);
-            p->post_write_date.tv_sec = tv.tv_sec;
-            p->post_write_date.tv_usec = tv.tv_usec;
+            break;
         }
-        else
-#endif
-            hl_usleep(p->post_write_delay * 1000); /* optional delay after last write */
 
-        /* otherwise some yaesu rigs get confused */
-        /* with sequential fast writes*/
+        if (errno == EAGAIN)
+        {
+            rig_stats_port_retry(p);
+            hl_usleep(5 * 1000);
+            rig_debug(RIG_DEBUG_WARN, "%s: port_read is busy? direct=%d\n", __func__,
+                      direct);
+        }
     }
+    while (++i < 10 && (errno == EBUSY || errno == EAGAIN));   // 50ms should be enough
 
-    return RIG_OK;
+    return rd_count;
 }
 
-static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
-                              size_t count, int direct)
+/* refill the empty receive buffer pp of p */
+static int port_rx_fill(hamlib_port_t *p, struct port_private *pp)
+{
+    ssize_t rd_count;
+
+    rd_count = port_read_available(p, pp->rx_buffer, sizeof(pp->rx_buffer), 1);
+
+    if (rd_count <= 0)
+    {
+        return rd_count < 0 ? -RIG_EIO : 0;
+    }
+
+    pp->rx_pos = 0;
+    pp->rx_count = rd_count;
+
+    return (int) rd_count;
+}
+
+/* move up to count buffered bytes to dst */
+static size_t port_rx_take(struct port_private *pp, unsigned char *dst,
+                           size_t count)
+{
+    if (count > pp->rx_count)
+    {
+        count = pp->rx_count;
+    }
+
+    memcpy(dst, pp->rx_buffer + pp->rx_pos, count);
+    pp->rx_pos += count;
+    pp->rx_count -= count;
+
+    return count;
+}
+
+/* length of buf up to and including the first byte in stopset, 0 if none */
+static size_t stopset_span(const unsigned char *buf, size_t len,
+                           const char *stopset, int stopset_len)
+{
+    const unsigned char *stop;
+    unsigned char isstop[256];
+    size_t i;
+
+    if (!stopset || stopset_len <= 0)
+    {
+        return 0;
+    }
+
+    if (stopset_len == 1)
+    {
+        stop = memchr(buf, stopset[0], len);
+        return stop ? (size_t)(stop - buf) + 1 : 0;
+    }
+
+    memset(isstop, 0, sizeof(isstop));
+
+    for (i = 0; i < (size_t) stopset_len; i++)
+    {
+        isstop[(unsigned char) stopset[i]] = 1;
+    }
+
+    for (i = 0; i < len; i++)
+    {
+        if (isstop[buf[i]]) { return i + 1; }
+    }
+
+    return 0;
+}
+
+static int read_block_loop(hamlib_port_t *p, unsigned char *rxbuffer,
+                           size_t count, int direct)
 {
+    struct port_private *pp = direct ? port_private(p) : NULL;
     struct timeval start_time, end_time, elapsed_time;
     int total_count = 0;
 
@@ -1108,6 +1553,8 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
         return -RIG_EINTERNAL;
     }
 
+    port_tx_drain(p);
+
     /* Store the time of the read loop start */
     gettimeofday(&start_time, NULL);
 
@@ -1116,6 +1563,14 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
         int result;
         int rd_count;
 
+        if (pp && pp->rx_count > 0)
+        {
+            rd_count = (int) port_rx_take(pp, rxbuffer + total_count, count);
+            total_count += rd_count;
+            count -= rd_count;
+            continue;
+        }
+
         result = port_wait_for_data(p, direct);
 
         if (result == -RIG_ETIMEOUT)
@@ -1155,8 +1610,20 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
         /*
          * grab bytes from the rig
          * The file descriptor must have been set up non blocking.
+         * Small reads go through the receive buffer so that whatever
+         * follows the block is kept for the next read.
          */
-        rd_count = (int) port_read_generic(p, rxbuffer + total_count, count, direct);
+        if (pp && count < sizeof(pp->rx_buffer))
+        {
+            rd_count = port_rx_fill(p, pp);
+        }
+        else
+        {
+            rd_count = (int) port_read_available(p, rxbuffer + total_count, count,
+                                                 direct);
+            total_count += rd_count > 0 ? rd_count : 0;
+            count -= rd_count > 0 ? rd_count : 0;
+        }
 
         if (rd_count < 0)
         {
@@ -1164,9 +1631,6 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
                       direct, strerror(errno));
             return -RIG_EIO;
         }
-
-        total_count += rd_count;
-        count -= rd_count;
     }
 
     if (direct)
@@ -1179,6 +1643,19 @@ static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
     return total_count;           /* return bytes count read */
 }
 
+static int read_block_generic(hamlib_port_t *p, unsigned char *rxbuffer,
+                              size_t count, int direct)
+{
+    struct timespec start;
+    int retval;
+
+    elapsed_ms(&start, HAMLIB_ELAPSED_SET);
+    retval = read_block_loop(p, rxbuffer, count, direct);
+    rig_stats_port_read(p, elapsed_ms(&start, HAMLIB_ELAPSED_GET), retval);
+
+    return retval;
+}
+
 
 /**
  * \brief Read bytes from the device directly or from the synchronous data pipe, depending on the device caps
@@ -1228,19 +1705,25 @@ int HAMLIB_API read_block_direct(hamlib_port_t *p, unsigned char *rxbuffer,
     return read_block_generic(p, rxbuffer, count, 1);
 }
 
-static int read_string_generic(hamlib_port_t *p,
-                               unsigned char *rxbuffer,
-                               size_t rxmax,
-                               const char *stopset,
-                               int stopset_len,
-                               int flush_flag,
-                               int expected_len,
-                               int direct)
+static int read_string_loop(hamlib_port_t *p,
+                            unsigned char *rxbuffer,
+                            size_t rxmax,
+                            const char *stopset,
+                            int stopset_len,
+                            int flush_flag,
+                            int expected_len,
+                            int direct)
 {
+    struct port_private *pp;
     struct timeval start_time, end_time, elapsed_time;
     int total_count = 0;
-    int i = 0;
-    static int minlen = 1; // dynamic minimum length of rig response data
+
+    /*
+     * Kept for the read_string() API.  The receive buffer reads whatever the
+     * port has, and without one a byte at a time so nothing past the stop
+     * set is consumed, so there is no read size left to tune with it.
+     */
+    (void) expected_len;
 
     if (!p->asyncio && !direct)
     {
@@ -1257,6 +1740,9 @@ static int read_string_generic(hamlib_port_t *p,
         return -RIG_EINVAL;
     }
 
+    port_tx_drain(p);
+    pp = direct ? port_private(p) : NULL;
+
     if (rxmax < 1)
     {
         rig_debug(RIG_DEBUG_ERR, "%s: error rxmax=%ld\n", __func__, (long)rxmax);
@@ -1266,24 +1752,28 @@ static int read_string_generic(hamlib_port_t *p,
     /* Store the time of the read loop start */
     gettimeofday(&start_time, NULL);
 
-    memset(rxbuffer, 0, rxmax);
+    rxbuffer[0] = '\000';
 
     while (total_count < rxmax - 1) // allow 1 byte for end-of-string
     {
+        unsigned char *chunk = &rxbuffer[total_count];
+        size_t room = rxmax - 1 - total_count;
+        size_t len, span;
         ssize_t rd_count = 0;
         int result;
 
-        result = port_wait_for_data(p, direct);
-
-        if (result == -RIG_ETIMEOUT)
+        if (!pp || pp->rx_count == 0)
         {
-            // a timeout is a timeout no matter how many bytes
-            //if (0 == total_count)
+            result = port_wait_for_data(p, direct);
+
+            if (result == -RIG_ETIMEOUT)
             {
                 /* Record timeout time and calculate elapsed time */
                 gettimeofday(&end_time, NULL);
                 timersub(&end_time, &start_time, &elapsed_time);
 
+                rxbuffer[total_count] = '\000';
+
                 if (direct)
                 {
                     dump_hex((unsigned char *) rxbuffer, total_count);
@@ -1303,69 +1793,74 @@ static int read_string_generic(hamlib_port_t *p,
                 return -RIG_ETIMEOUT;
             }
 
-            break; /* return what we have read */
-        }
-
-        if (result < 0)
-        {
-            if (direct)
+            if (result < 0)
             {
-                dump_hex(rxbuffer, total_count);
-            }
+                rxbuffer[total_count] = '\000';
 
-            rig_debug(RIG_DEBUG_ERR, "%s(): I/O error after %d chars, direct=%d: %d\n",
-                      __func__, total_count, direct, result);
-            return result;
-        }
+                if (direct)
+                {
+                    dump_hex(rxbuffer, total_count);
+                }
 
-        /*
-         * read 1 character from the rig, (check if in stop set)
-         * The file descriptor must have been set up non blocking.
-         */
-        do
-        {
-            rd_count = port_read_generic(p, &rxbuffer[total_count],
-                                         expected_len == 1 ? 1 : minlen, direct);
-            minlen -= rd_count;
+                rig_debug(RIG_DEBUG_ERR, "%s(): I/O error after %d chars, direct=%d: %d\n",
+                          __func__, total_count, direct, result);
+                return result;
+            }
 
-            if (errno == EAGAIN)
+            /*
+             * The file descriptor must have been set up non blocking.
+             * Without a receive buffer, read 1 character at a time so
+             * that nothing past the stop set is consumed.
+             */
+            if (pp)
             {
-                hl_usleep(5 * 1000);
-                rig_debug(RIG_DEBUG_WARN, "%s: port_read is busy? direct=%d\n", __func__,
-                          direct);
+                rd_count = port_rx_fill(p, pp);
             }
-        }
-        while (++i < 10 && errno == EBUSY);   // 50ms should be enough
-
-        /* if we get 0 bytes or an error something is wrong */
-        if (rd_count <= 0)
-        {
-            if (direct)
+            else
             {
-                dump_hex((unsigned char *) rxbuffer, total_count);
+                rd_count = port_read_available(p, chunk, 1, direct);
             }
 
-            rig_debug(RIG_DEBUG_ERR, "%s(): read failed, direct=%d - %s\n", __func__,
-                      direct, strerror(errno));
+            /* if we get 0 bytes or an error something is wrong */
+            if (rd_count <= 0)
+            {
+                rxbuffer[total_count] = '\000';
 
-            return -RIG_EIO;
-        }
+                if (direct)
+                {
+                    dump_hex((unsigned char *) rxbuffer, total_count);
+                }
 
-        // check to see if our string startis with \...if so we need more chars
-        if (total_count == 0 && rxbuffer[total_count] == '\\') { rxmax = (rxmax - 1) * 5; }
+                rig_debug(RIG_DEBUG_ERR, "%s(): read failed, direct=%d - %s\n", __func__,
+                          direct, strerror(errno));
 
-        total_count += (int) rd_count;
+                return -RIG_EIO;
+            }
+        }
 
-        if (stopset && memchr(stopset, rxbuffer[total_count - 1], stopset_len))
+        if (pp)
         {
-            if (minlen == 1) { minlen = total_count; }
-
-            if (minlen < total_count)
+            // check to see if our string starts with \...if so we need more chars
+            if (total_count == 0 && pp->rx_buffer[pp->rx_pos] == '\\')
             {
-                minlen = total_count;
-                rig_debug(RIG_DEBUG_VERBOSE, "%s: minlen now %d\n", __func__, minlen);
+                rxmax = (rxmax - 1) * 5;
+                room = rxmax - 1;
             }
 
+            len = pp->rx_count < room ? pp->rx_count : room;
+            span = stopset_span(pp->rx_buffer + pp->rx_pos, len, stopset, stopset_len);
+            total_count += (int) port_rx_take(pp, chunk, span ? span : len);
+        }
+        else
+        {
+            if (total_count == 0 && chunk[0] == '\\') { rxmax = (rxmax - 1) * 5; }
+
+            span = stopset_span(chunk, 1, stopset, stopset_len);
+            total_count += (int) rd_count;
+        }
+
+        if (span)
+        {
             break;
         }
     }
@@ -1389,6 +1884,31 @@ static int read_string_generic(hamlib_port_t *p,
     return total_count;           /* return bytes count read */
 }
 
+static int read_string_generic(hamlib_port_t *p,
+                               unsigned char *rxbuffer,
+                               size_t rxmax,
+                               const char *stopset,
+                               int stopset_len,
+                               int flush_flag,
+                               int expected_len,
+                               int direct)
+{
+    struct timespec start;
+    int retval;
+
+    elapsed_ms(&start, HAMLIB_ELAPSED_SET);
+    retval = read_string_loop(p, rxbuffer, rxmax, stopset, stopset_len, flush_flag,
+                              expected_len, direct);
+
+    /* a flush times out when there is nothing left, as it should */
+    if (!flush_flag)
+    {
+        rig_stats_port_read(p, elapsed_ms(&start, HAMLIB_ELAPSED_GET), retval);
+    }
+
+    return retval;
+}
+
 /**
  * \brief Read a string from the device directly or from the synchronous data pipe, depending on the device caps
  * \param p Hamlib port descriptor
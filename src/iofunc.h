@@ -25,9 +25,35 @@
 #include <sys/types.h>
 #include <hamlib/rig.h>
 
+#define PORT_RX_BUFFER_SIZE 1024 /* bytes read ahead by read_string/read_block */
+
+struct port_tx_queue;
+struct port_transaction_queue;
+
+/*
+ * State of the rig port kept by hamlib itself, out of hamlib_port_t so
+ * that the layout of the port stays that of the ABI.  rig_init() allocates
+ * it for rigport, port_private() finds it.  Other ports have none, they
+ * are read and written unbuffered.
+ */
+struct port_private
+{
+    size_t rx_pos;          /* offset of the first unread byte in rx_buffer */
+    size_t rx_count;        /* number of unread bytes in rx_buffer */
+    unsigned char rx_buffer[PORT_RX_BUFFER_SIZE]; /* read from the device but not consumed yet */
+    struct port_tx_queue *tx_queue; /* writer pacing bytes out at write_delay, NULL until needed */
+    struct port_transaction_queue *transaction_queue; /* see port_transaction_submit(), NULL until needed */
+};
+
+struct port_private *port_private(const hamlib_port_t *p);
+
 extern HAMLIB_EXPORT(int) port_open(hamlib_port_t *p);
 extern HAMLIB_EXPORT(int) port_close(hamlib_port_t *p, rig_port_t port_type);
 
+void port_rx_discard(hamlib_port_t *p);
+void port_tx_drain(hamlib_port_t *p);
+void port_tx_stop(hamlib_port_t *p);
+
 
 extern HAMLIB_EXPORT(int) read_block(hamlib_port_t *p,
                                      unsigned char *rxbuffer,
@@ -1798,10 +1798,10 @@ double HAMLIB_API elapsed_ms(struct timespec *start, int option)
     switch (option)
     {
     case HAMLIB_ELAPSED_GET:
-        if (start->tv_nsec == 0)   // if we haven't done SET yet
+        // not SET yet, or invalidated; leave it so, GET never writes
+        if (start->tv_sec == 0 && start->tv_nsec == 0)
         {
-            clock_gettime(CLOCK_REALTIME, start);
-            return 1000 * 1000;
+            return ELAPSED_INVALID_MS;
         }
 
         clock_gettime(CLOCK_REALTIME, &stop);
@@ -1815,10 +1815,9 @@ double HAMLIB_API elapsed_ms(struct timespec *start, int option)
         break;
 
     case HAMLIB_ELAPSED_INVALIDATE:
-        clock_gettime(CLOCK_REALTIME, start);
-        stop = *start;
-        start->tv_sec -= 10; // ten seconds should be more than enough
-        break;
+        // as if never set, so a GET can tell it from an old time
+        start->tv_sec = start->tv_nsec = 0;
+        return ELAPSED_INVALID_MS;
     }
 
     elapsed_msec = ((stop.tv_sec - start->tv_sec) + (stop.tv_nsec / 1e9 -
@@ -1826,7 +1825,7 @@ double HAMLIB_API elapsed_ms(struct timespec *start, int option)
 
     //rig_debug(RIG_DEBUG_TRACE, "%s: elapsed_msecs=%.0f\n", __func__, elapsed_msec);
 
-    if (elapsed_msec < 0 || option == HAMLIB_ELAPSED_INVALIDATE) { return 1000000; }
+    if (elapsed_msec < 0) { return ELAPSED_INVALID_MS; }
 
     return elapsed_msec;
 }
@@ -1834,7 +1833,17 @@ double HAMLIB_API elapsed_ms(struct timespec *start, int option)
 int HAMLIB_API rig_get_cache_timeout_ms(RIG *rig, hamlib_cache_t selection)
 {
     rig_debug(RIG_DEBUG_TRACE, "%s: called selection=%d\n", __func__, selection);
-    return rig->state.cache.timeout_ms;
+
+    switch (selection)
+    {
+    case HAMLIB_CACHE_LEVEL:
+    case HAMLIB_CACHE_FUNC:
+    case HAMLIB_CACHE_PARM:
+        return rig_get_setting_cache_timeout_ms(rig, selection, 0);
+
+    default:
+        return rig->state.cache.timeout_ms;
+    }
 }
 
 int HAMLIB_API rig_set_cache_timeout_ms(RIG *rig, hamlib_cache_t selection,
@@ -1842,8 +1851,18 @@ int HAMLIB_API rig_set_cache_timeout_ms(RIG *rig, hamlib_cache_t selection,
 {
     rig_debug(RIG_DEBUG_TRACE, "%s: called selection=%d, ms=%d\n", __func__,
               selection, ms);
-    rig->state.cache.timeout_ms = ms;
-    return RIG_OK;
+
+    switch (selection)
+    {
+    case HAMLIB_CACHE_LEVEL:
+    case HAMLIB_CACHE_FUNC:
+    case HAMLIB_CACHE_PARM:
+        return rig_set_setting_cache_timeout_ms(rig, selection, 0, ms);
+
+    default:
+        rig->state.cache.timeout_ms = ms;
+        return RIG_OK;
+    }
 }
 
 static char *funcname = "Unknown";
@@ -29,8 +29,11 @@
  */
 #ifdef HAVE_PTHREAD
 #include <pthread.h>
-#define set_transaction_active(rig) {pthread_mutex_lock(&rig->state.mutex_set_transaction);(rig)->state.transaction_active = 1;}
-#define set_transaction_inactive(rig) {(rig)->state.transaction_active = 0;pthread_mutex_unlock(&rig->state.mutex_set_transaction);}
+/* the port goes to the waiting thread of highest priority, see prio_lock.c */
+void rig_transaction_lock(RIG *rig);
+void rig_transaction_unlock(RIG *rig);
+#define set_transaction_active(rig) {rig_transaction_lock(rig);(rig)->state.transaction_active = 1;}
+#define set_transaction_inactive(rig) {(rig)->state.transaction_active = 0;rig_transaction_unlock(rig);}
 #else
 #define set_transaction_active(rig) {(rig)->state.transaction_active = 1;}
 #define set_transaction_inactive(rig) {(rig)->state.transaction_active = 0;}
@@ -115,6 +118,27 @@ extern HAMLIB_EXPORT(int) hl_usleep(rig_useconds_t usec);
 
 extern HAMLIB_EXPORT(double) elapsed_ms(struct timespec *start, int start_flag);
 
+// what elapsed_ms() gets for a time never set or invalidated, older than any cache timeout
+#define ELAPSED_INVALID_MS (1000 * 1000)
+
+// what ELAPSED1 declares, rig_elapsed_end() records it when it goes out of scope
+struct rig_elapsed
+{
+    struct timespec start;
+    RIG *rig;
+    const char *func;
+};
+extern HAMLIB_EXPORT(void) rig_elapsed_end(struct rig_elapsed *elapsed);
+
+#if defined(__GNUC__) && !defined(__cplusplus)
+// inside Hamlib the time is also added to the call stats of rig on every
+// return, see rig_get_call_stats(); <hamlib/rig.h> keeps the plain timer
+#undef ELAPSED1
+#undef ELAPSED2
+#define ELAPSED1 struct rig_elapsed __begin __attribute__((cleanup(rig_elapsed_end))) = { .rig = rig, .func = __func__ }; elapsed_ms(&__begin.start, HAMLIB_ELAPSED_SET);
+#define ELAPSED2 rig_debug(RIG_DEBUG_TRACE, "%.*s%d:%s: elapsed=%.0lfms\n", rig->state.depth, spaces(), rig->state.depth, __func__, elapsed_ms(&__begin.start, HAMLIB_ELAPSED_GET));
+#endif
+
 extern HAMLIB_EXPORT(vfo_t) vfo_fixup(RIG *rig, vfo_t vfo, split_t split);
 extern HAMLIB_EXPORT(vfo_t) vfo_fixup2a(RIG *rig, vfo_t vfo, split_t split, const char *func, const int line);
 #define vfo_fixup(r,v,s) vfo_fixup2a(r,v,s,__func__,__LINE__)
@@ -175,28 +199,6 @@ void errmsg(int err, char *s, const char *func, const char *file, int line);
                         return (rctmp); \
                        } while(0);}
 
-#define CACHE_RESET {\
-    elapsed_ms(&rig->state.cache.time_freqMainA, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_freqMainB, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_freqSubA, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_freqSubB, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_vfo, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_modeMainA, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_modeMainB, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_modeMainC, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_modeSubA, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_modeSubB, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_modeSubC, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_widthMainA, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_widthMainB, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_widthMainC, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_widthSubA, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_widthSubB, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_widthSubC, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_INVALIDATE);\
-    elapsed_ms(&rig->state.cache.time_split, HAMLIB_ELAPSED_INVALIDATE);\
-     }
-
 __END_DECLS
 
 #endif /* _MISC_H */
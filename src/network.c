@@ -77,8 +77,11 @@
 #include <hamlib/rig.h>
 #include "network.h"
 #include "misc.h"
+#include "iofunc.h"
+#include "transaction.h"
 #include "asyncpipe.h"
 #include "snapshot_data.h"
+#include "spectrum_ring.h"
 
 #ifdef HAVE_WINDOWS_H
 #include "io.h"
@@ -95,6 +98,7 @@ static int wsstarted;
 #define MULTICAST_PUBLISHER_DATA_PACKET_TYPE_POLL       0x01
 #define MULTICAST_PUBLISHER_DATA_PACKET_TYPE_TRANSCEIVE 0x02
 #define MULTICAST_PUBLISHER_DATA_PACKET_TYPE_SPECTRUM   0x03
+#define MULTICAST_PUBLISHER_DATA_PACKET_TYPE_SPECTRUM_REF 0x04
 
 #pragma pack(push,1)
 typedef struct multicast_publisher_data_packet_s
@@ -111,6 +115,7 @@ typedef struct multicast_publisher_args_s
     int socket_fd;
     const char *multicast_addr;
     int multicast_port;
+    struct snapshot_binary_state binary_state;
 
 #if defined(WIN32) && defined(HAVE_WINDOWS_H)
     hamlib_async_pipe_t *data_pipe;
@@ -338,6 +343,7 @@ int network_open(hamlib_port_t *rp, int default_port)
     }
 
     rp->fd = fd;
+    port_rx_discard(rp);
 
     socklen_t clientLen = sizeof(client);
     getsockname(rp->fd, (struct sockaddr *)&client, &clientLen);
@@ -365,6 +371,9 @@ void network_flush(hamlib_port_t *rp)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
+    port_tx_drain(rp);
+    port_rx_discard(rp);
+
     for (;;)
     {
         int ret;
@@ -416,6 +425,9 @@ int network_close(hamlib_port_t *rp)
 {
     int ret = 0;
 
+    port_transaction_stop(rp);
+    port_tx_stop(rp);
+
     if (rp->fd > 0)
     {
 #ifdef __MINGW32__
@@ -812,13 +824,56 @@ int network_publish_rig_spectrum_data(RIG *rig, struct rig_spectrum_line *line)
     RETURNFUNC2(RIG_OK);
 }
 
+int network_publish_rig_spectrum_ref(RIG *rig, uint64_t seq)
+{
+    int result;
+    struct rig_state *rs = &rig->state;
+    multicast_publisher_priv_data *mcast_publisher_priv;
+    multicast_publisher_data_packet packet =
+    {
+        .type = MULTICAST_PUBLISHER_DATA_PACKET_TYPE_SPECTRUM_REF,
+        .padding = 0,
+        .data_length = sizeof(seq),
+    };
+
+    if (rs->multicast_publisher_priv_data == NULL)
+    {
+        // Silently ignore call if multicast publisher is not enabled
+        return RIG_OK;
+    }
+
+    result = multicast_publisher_write_packet_header(rig, &packet);
+
+    if (result != RIG_OK)
+    {
+        RETURNFUNC2(result);
+    }
+
+    mcast_publisher_priv = (multicast_publisher_priv_data *)
+                           rs->multicast_publisher_priv_data;
+
+    // only the line number goes through the pipe, the data stays in the ring
+    result = multicast_publisher_write_data(&mcast_publisher_priv->args,
+                                            sizeof(seq), (unsigned char *) &seq);
+
+    if (result != RIG_OK)
+    {
+        RETURNFUNC2(result);
+    }
+
+    RETURNFUNC2(RIG_OK);
+}
+
 static int multicast_publisher_read_packet(multicast_publisher_args
         *mcast_publisher_args,
         uint8_t *type, struct rig_spectrum_line *spectrum_line,
-        unsigned char *spectrum_data)
+        unsigned char *spectrum_data, struct rig_spectrum_ref *spectrum_ref)
 {
     int result;
     multicast_publisher_data_packet packet;
+    uint64_t seq;
+
+    spectrum_ref->line = NULL;
 
     result = multicast_publisher_read_data(mcast_publisher_args, sizeof(packet),
                                            (unsigned char *) &packet);
@@ -866,6 +921,28 @@ static int multicast_publisher_read_packet(multicast_publisher_args
 
         break;
 
+    case MULTICAST_PUBLISHER_DATA_PACKET_TYPE_SPECTRUM_REF:
+        result = multicast_publisher_read_data(mcast_publisher_args, sizeof(seq),
+                                               (unsigned char *) &seq);
+
+        if (result < 0)
+        {
+            return (result);
+        }
+
+        if (rig_spectrum_ring_borrow(mcast_publisher_args->rig, seq,
+                                     spectrum_ref) != RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: spectrum line %lu already overwritten\n",
+                      __func__, (unsigned long) seq);
+            return (-RIG_ETIMEOUT);
+        }
+
+        // the data itself is not copied, only the line parameters
+        *spectrum_line = *spectrum_ref->line;
+        packet.type = MULTICAST_PUBLISHER_DATA_PACKET_TYPE_SPECTRUM;
+        break;
+
     default:
         rig_debug(RIG_DEBUG_ERR,
                   "%s: unexpected multicast publisher data packet type: %d\n", __func__,
@@ -882,12 +959,14 @@ void *multicast_publisher(void *arg)
 {
     unsigned char spectrum_data[HAMLIB_MAX_SPECTRUM_DATA];
     char snapshot_buffer[HAMLIB_MAX_SNAPSHOT_PACKET_SIZE];
+    size_t snapshot_length = 0;
 
     struct multicast_publisher_args_s *args = (struct multicast_publisher_args_s *)
             arg;
     RIG *rig = args->rig;
     struct rig_state *rs = &rig->state;
     struct rig_spectrum_line spectrum_line;
+    struct rig_spectrum_ref spectrum_ref;
     uint8_t packet_type;
 
     struct sockaddr_in dest_addr;
@@ -906,7 +985,7 @@ void *multicast_publisher(void *arg)
     while (rs->multicast_publisher_run)
     {
         result = multicast_publisher_read_packet(args, &packet_type, &spectrum_line,
-                 spectrum_data);
+                 spectrum_data, &spectrum_ref);
 
         if (result != RIG_OK)
         {
@@ -921,9 +1000,21 @@ void *multicast_publisher(void *arg)
             continue;
         }
 
-        result = snapshot_serialize(sizeof(snapshot_buffer), snapshot_buffer, rig,
-                                    packet_type == MULTICAST_PUBLISHER_DATA_PACKET_TYPE_SPECTRUM ? &spectrum_line :
-                                    NULL);
+        if (rs->multicast_format == RIG_MULTICAST_FORMAT_BINARY)
+        {
+            args->binary_state.keyframe_interval_ms = rs->multicast_keyframe_interval_ms;
+            result = snapshot_serialize_binary(sizeof(snapshot_buffer),
+                                               (unsigned char *) snapshot_buffer, &snapshot_length, rig,
+                                               packet_type == MULTICAST_PUBLISHER_DATA_PACKET_TYPE_SPECTRUM ? &spectrum_line :
+                                               NULL, &args->binary_state);
+        }
+        else
+        {
+            result = snapshot_serialize(sizeof(snapshot_buffer), snapshot_buffer, rig,
+                                        packet_type == MULTICAST_PUBLISHER_DATA_PACKET_TYPE_SPECTRUM ? &spectrum_line :
+                                        NULL);
+            snapshot_length = strlen(snapshot_buffer);
+        }
 
         if (result != RIG_OK)
         {
@@ -932,13 +1023,37 @@ void *multicast_publisher(void *arg)
             continue;
         }
 
-        rig_debug(RIG_DEBUG_TRACE, "%s: sending rig snapshot data: %s\n", __func__,
-                  snapshot_buffer);
+        if (snapshot_length == 0)
+        {
+            // nothing changed since the last delta
+            continue;
+        }
+
+        if (spectrum_ref.line && !rig_spectrum_ref_valid(rig, &spectrum_ref))
+        {
+            rig_debug(RIG_DEBUG_WARN,
+                      "%s: spectrum line %lu overwritten while serializing, dropped\n", __func__,
+                      (unsigned long) spectrum_ref.seq);
+            // what this packet had is now missing at the receivers
+            args->binary_state.valid = 0;
+            continue;
+        }
+
+        if (rs->multicast_format == RIG_MULTICAST_FORMAT_BINARY)
+        {
+            rig_debug(RIG_DEBUG_TRACE, "%s: sending %d bytes of binary rig snapshot data\n",
+                      __func__, (int) snapshot_length);
+        }
+        else
+        {
+            rig_debug(RIG_DEBUG_TRACE, "%s: sending rig snapshot data: %s\n", __func__,
+                      snapshot_buffer);
+        }
 
         send_result = sendto(
                           socket_fd,
                           snapshot_buffer,
-                          strlen(snapshot_buffer),
+                          snapshot_length,
                           0,
                           (struct sockaddr *) &dest_addr,
                           sizeof(dest_addr)
@@ -0,0 +1,224 @@
+/*
+ *  Hamlib Interface - adaptive rig state poll schedule
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig_internal
+ * @{
+ */
+
+/**
+ * \file poll_schedule.c
+ * \brief When rig_poll_routine() polls each piece of rig state
+ *
+ * Each polled item has its own interval.  An item whose value just changed,
+ * e.g. the frequency while the VFO knob turns, is polled every
+ * poll_interval; each poll that finds it unchanged doubles its interval,
+ * up to RIG_POLL_BACKOFF_MAX times poll_interval.  PTT is always polled
+ * every poll_interval and first when several items are due, and a VFO
+ * change makes the frequency and mode due at once.
+ *
+ * The polls of a rig can be limited to poll_budget per second.  Items due
+ * while the budget is spent are polled, most overdue first, as soon as it
+ * allows, but PTT gets no more than half of the budget.
+ */
+
+#include <hamlib/config.h>
+
+#include <string.h>
+
+#include "poll_schedule.h"
+
+//! @cond Doxygen_Suppress
+static void rig_poll_schedule_refill(struct rig_poll_schedule *s,
+                                     double now_ms)
+{
+    /* no more than a second worth of polls at once */
+    double max = s->budget > 1 ? s->budget : 1;
+
+    if (s->budget <= 0 || now_ms <= s->refill_ms)
+    {
+        return;
+    }
+
+    s->tokens += (now_ms - s->refill_ms) * s->budget / 1000.0;
+
+    if (s->tokens > max)
+    {
+        s->tokens = max;
+    }
+
+    s->refill_ms = now_ms;
+}
+
+
+void rig_poll_schedule_init(struct rig_poll_schedule *s, int fast_ms,
+                            int budget, unsigned int enabled)
+{
+    int i;
+
+    memset(s, 0, sizeof(*s));
+
+    if (fast_ms < 1)
+    {
+        fast_ms = 1;
+    }
+
+    s->fast_ms = fast_ms;
+    s->slow_ms = fast_ms * RIG_POLL_BACKOFF_MAX;
+    s->budget = budget > 0 ? budget : 0;
+    s->tokens = s->budget > 1 ? s->budget : 1;
+    s->enabled = enabled;
+
+    for (i = 0; i < RIG_POLL_ITEMS; i++)
+    {
+        s->interval_ms[i] = fast_ms;
+    }
+}
+
+
+int rig_poll_schedule_next(struct rig_poll_schedule *s, double now_ms)
+{
+    int item = -1;
+    int i;
+
+    rig_poll_schedule_refill(s, now_ms);
+
+    if (s->budget > 0 && s->tokens < 1)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < RIG_POLL_ITEMS; i++)
+    {
+        if (!(s->enabled & RIG_POLL_BIT(i)) || s->due_ms[i] > now_ms)
+        {
+            continue;
+        }
+
+        if (i == RIG_POLL_PTT)
+        {
+            item = i;
+            break;
+        }
+
+        if (item < 0 || s->due_ms[i] < s->due_ms[item])
+        {
+            item = i;
+        }
+    }
+
+    if (item >= 0 && s->budget > 0)
+    {
+        s->tokens -= 1;
+    }
+
+    return item;
+}
+
+
+void rig_poll_schedule_done(struct rig_poll_schedule *s, int item,
+                            double now_ms, int changed)
+{
+    int i;
+
+    if (item < 0 || item >= RIG_POLL_ITEMS)
+    {
+        return;
+    }
+
+    if (item == RIG_POLL_PTT)
+    {
+        /* at most half of the budget, the other items would starve */
+        s->interval_ms[item] = s->fast_ms;
+
+        if (s->budget > 0 && s->interval_ms[item] < 2000 / s->budget)
+        {
+            s->interval_ms[item] = 2000 / s->budget;
+        }
+    }
+    else if (changed)
+    {
+        s->interval_ms[item] = s->fast_ms;
+    }
+    else
+    {
+        s->interval_ms[item] *= 2;
+
+        if (s->interval_ms[item] > s->slow_ms)
+        {
+            s->interval_ms[item] = s->slow_ms;
+        }
+    }
+
+    s->due_ms[item] = now_ms + s->interval_ms[item];
+
+    /* another VFO probably has another frequency and mode */
+    if (changed && item == RIG_POLL_VFO)
+    {
+        for (i = RIG_POLL_FREQ_MAIN; i <= RIG_POLL_MODE_SUB; i++)
+        {
+            s->interval_ms[i] = s->fast_ms;
+            s->due_ms[i] = now_ms;
+        }
+    }
+}
+
+
+double rig_poll_schedule_wait(const struct rig_poll_schedule *s,
+                              double now_ms)
+{
+    double wait = s->fast_ms;
+    int i;
+
+    for (i = 0; i < RIG_POLL_ITEMS; i++)
+    {
+        if ((s->enabled & RIG_POLL_BIT(i)) && s->due_ms[i] - now_ms < wait)
+        {
+            wait = s->due_ms[i] - now_ms;
+        }
+    }
+
+    if (wait < 0)
+    {
+        wait = 0;
+    }
+
+    if (s->budget > 0)
+    {
+        /* tokens as they will be once refilled up to now */
+        double tokens = s->tokens;
+
+        if (now_ms > s->refill_ms)
+        {
+            tokens += (now_ms - s->refill_ms) * s->budget / 1000.0;
+        }
+
+        /* whole ms, so that the token is there once waited for */
+        if (tokens < 1 && (1 - tokens) * 1000.0 / s->budget > wait)
+        {
+            wait = (int)((1 - tokens) * 1000.0 / s->budget) + 1;
+        }
+    }
+
+    return wait;
+}
+//! @endcond
+
+/** @} */
@@ -0,0 +1,69 @@
+/*
+ *  Hamlib Interface - adaptive rig state poll schedule
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _POLL_SCHEDULE_H
+#define _POLL_SCHEDULE_H
+
+/* items polled by rig_poll_routine(), highest priority first */
+enum rig_poll_item_e
+{
+    RIG_POLL_PTT = 0,
+    RIG_POLL_VFO,
+    RIG_POLL_FREQ_MAIN,
+    RIG_POLL_FREQ_SUB,
+    RIG_POLL_MODE_MAIN,
+    RIG_POLL_MODE_SUB,
+    RIG_POLL_SPLIT,
+    RIG_POLL_ITEMS
+};
+
+#define RIG_POLL_BIT(item) (1U << (item))
+
+/* an idle item is polled down to this many times less often */
+#define RIG_POLL_BACKOFF_MAX 8
+
+struct rig_poll_schedule
+{
+    int fast_ms;                /* interval of an item that just changed */
+    int slow_ms;                /* interval of an item idle for long */
+    int budget;                 /* polls per second, 0 for no limit */
+    double tokens;              /* polls that may be spent right now */
+    double refill_ms;           /* when tokens were last added */
+    unsigned int enabled;       /* RIG_POLL_BIT() of the items to poll */
+    int interval_ms[RIG_POLL_ITEMS];
+    double due_ms[RIG_POLL_ITEMS];
+};
+
+/* times are in ms from any fixed origin; all items are due at time 0 */
+void rig_poll_schedule_init(struct rig_poll_schedule *s, int fast_ms,
+                            int budget, unsigned int enabled);
+
+/* the item to poll now, or -1 if none is due or the budget is spent */
+int rig_poll_schedule_next(struct rig_poll_schedule *s, double now_ms);
+
+/* item was polled, changed tells whether its value changed */
+void rig_poll_schedule_done(struct rig_poll_schedule *s, int item,
+                            double now_ms, int changed);
+
+/* ms until rig_poll_schedule_next() has something to poll */
+double rig_poll_schedule_wait(const struct rig_poll_schedule *s,
+                              double now_ms);
+
+#endif /* _POLL_SCHEDULE_H */
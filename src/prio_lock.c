@@ -0,0 +1,284 @@
+/*
+ *  Hamlib Interface - priority lock of the rig transactions
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file prio_lock.c
+ * \brief Rig port granted to transactions by priority
+ *
+ * Backends hold the transaction lock of a rig from sending a command to
+ * getting its reply, see set_transaction_active().  When it is released,
+ * it goes to the waiting thread of highest priority instead of whichever
+ * the scheduler wakes first: a PTT change waits at most for the
+ * transaction in progress, however many polls are queued behind it.
+ *
+ * The priority belongs to the calling thread.  rig_set_ptt(),
+ * rig_send_morse(), rig_stop_morse(), rig_set_split_vfo() and
+ * rig_set_split_freq() raise it to RIG_PRIO_URGENT while they run, and the
+ * poll routine runs at RIG_PRIO_BACKGROUND.  How long each priority waited
+ * is kept per rig, see rig_get_transaction_stats().
+ */
+
+#include <hamlib/config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "prio_lock.h"
+
+#ifdef HAVE_PTHREAD
+//! @cond Doxygen_Suppress
+static pthread_key_t rig_priority_key;
+static pthread_once_t rig_priority_once = PTHREAD_ONCE_INIT;
+
+
+static void rig_priority_key_create(void)
+{
+    pthread_key_create(&rig_priority_key, NULL);
+}
+
+
+void rig_prio_lock_init(struct rig_prio_lock *lock)
+{
+    memset(lock, 0, sizeof(*lock));
+    pthread_mutex_init(&lock->mutex, NULL);
+    pthread_cond_init(&lock->cond, NULL);
+}
+
+
+void rig_prio_lock_destroy(struct rig_prio_lock *lock)
+{
+    pthread_cond_destroy(&lock->cond);
+    pthread_mutex_destroy(&lock->mutex);
+}
+
+
+void rig_prio_lock_acquire(struct rig_prio_lock *lock)
+{
+    struct rig_transaction_stats *stats;
+    struct timespec start;
+    int priority = rig_get_priority();
+    double wait;
+    int i;
+
+    elapsed_ms(&start, HAMLIB_ELAPSED_SET);
+
+    pthread_mutex_lock(&lock->mutex);
+    lock->waiting[priority]++;
+
+    for (;;)
+    {
+        int ahead = lock->held;
+
+        for (i = 0; i < priority && !ahead; i++)
+        {
+            ahead = lock->waiting[i] > 0;
+        }
+
+        if (!ahead)
+        {
+            break;
+        }
+
+        pthread_cond_wait(&lock->cond, &lock->mutex);
+    }
+
+    lock->waiting[priority]--;
+    lock->held = 1;
+
+    wait = elapsed_ms(&start, HAMLIB_ELAPSED_GET);
+    stats = &lock->stats[priority];
+    stats->count++;
+    stats->wait_total_ms += wait;
+
+    if (wait > stats->wait_max_ms)
+    {
+        stats->wait_max_ms = wait;
+    }
+
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+
+void rig_prio_lock_release(struct rig_prio_lock *lock)
+{
+    pthread_mutex_lock(&lock->mutex);
+    lock->held = 0;
+    pthread_cond_broadcast(&lock->cond);
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+
+void rig_prio_lock_stats(struct rig_prio_lock *lock, int priority,
+                         struct rig_transaction_stats *stats)
+{
+    pthread_mutex_lock(&lock->mutex);
+    *stats = lock->stats[priority];
+    pthread_mutex_unlock(&lock->mutex);
+}
+
+
+void rig_transaction_lock(RIG *rig)
+{
+    if (rig->state.transaction_lock)
+    {
+        rig_prio_lock_acquire(rig->state.transaction_lock);
+    }
+}
+
+
+void rig_transaction_unlock(RIG *rig)
+{
+    if (rig->state.transaction_lock)
+    {
+        rig_prio_lock_release(rig->state.transaction_lock);
+    }
+}
+#endif
+
+
+int rig_transaction_lock_init(RIG *rig)
+{
+#ifdef HAVE_PTHREAD
+    rig->state.transaction_lock = malloc(sizeof(struct rig_prio_lock));
+
+    if (rig->state.transaction_lock == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    rig_prio_lock_init(rig->state.transaction_lock);
+#endif
+
+    return RIG_OK;
+}
+
+
+void rig_transaction_lock_cleanup(RIG *rig)
+{
+#ifdef HAVE_PTHREAD
+
+    if (rig->state.transaction_lock)
+    {
+        rig_prio_lock_destroy(rig->state.transaction_lock);
+        free(rig->state.transaction_lock);
+        rig->state.transaction_lock = NULL;
+    }
+
+#endif
+}
+//! @endcond
+
+
+/**
+ * \brief Set the priority of the rig transactions of the calling thread
+ * \param priority One of enum rig_priority_e
+ *
+ * Applies to all rigs used by the thread from now on.  Threads start at
+ * RIG_PRIO_USER.
+ *
+ * \return the previous priority of the thread, or -RIG_EINVAL.
+ */
+int HAMLIB_API rig_set_priority(int priority)
+{
+    int previous;
+
+    if (priority < 0 || priority >= RIG_PRIO_N)
+    {
+        return -RIG_EINVAL;
+    }
+
+    previous = rig_get_priority();
+
+#ifdef HAVE_PTHREAD
+    pthread_once(&rig_priority_once, rig_priority_key_create);
+    /* stored + 1, so that a thread that never set it reads NULL */
+    pthread_setspecific(rig_priority_key, (void *)(intptr_t)(priority + 1));
+#endif
+
+    return previous;
+}
+
+
+/**
+ * \brief Get the priority of the rig transactions of the calling thread
+ *
+ * \return one of enum rig_priority_e.
+ */
+int HAMLIB_API rig_get_priority(void)
+{
+#ifdef HAVE_PTHREAD
+    intptr_t value;
+
+    pthread_once(&rig_priority_once, rig_priority_key_create);
+    value = (intptr_t) pthread_getspecific(rig_priority_key);
+
+    if (value > 0)
+    {
+        return (int) value - 1;
+    }
+
+#endif
+
+    return RIG_PRIO_USER;
+}
+
+
+/**
+ * \brief Get how long the transactions of a priority waited for the port
+ * \param rig The rig handle
+ * \param priority One of enum rig_priority_e
+ * \param stats Where to store the counters, since rig_init()
+ *
+ * Only backends that lock their transactions, e.g. Icom, count them.
+ *
+ * \return RIG_OK, or a negative RIG_E* error code.
+ */
+int HAMLIB_API rig_get_transaction_stats(RIG *rig, int priority,
+        struct rig_transaction_stats *stats)
+{
+    if (!rig || !stats || priority < 0 || priority >= RIG_PRIO_N)
+    {
+        return -RIG_EINVAL;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+#ifdef HAVE_PTHREAD
+
+    if (rig->state.transaction_lock)
+    {
+        rig_prio_lock_stats(rig->state.transaction_lock, priority, stats);
+    }
+
+    return RIG_OK;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+/** @} */
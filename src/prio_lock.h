@@ -0,0 +1,54 @@
+/*
+ *  Hamlib Interface - priority lock of the rig transactions
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _PRIO_LOCK_H
+#define _PRIO_LOCK_H
+
+#include <hamlib/rig.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+
+/* a mutex granted to the waiter of highest rig_get_priority() first */
+struct rig_prio_lock
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int held;
+    int waiting[RIG_PRIO_N];
+    struct rig_transaction_stats stats[RIG_PRIO_N];
+};
+
+#define RIG_PRIO_LOCK_INITIALIZER \
+    { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, { 0 }, { { 0 } } }
+
+void rig_prio_lock_init(struct rig_prio_lock *lock);
+void rig_prio_lock_destroy(struct rig_prio_lock *lock);
+void rig_prio_lock_acquire(struct rig_prio_lock *lock);
+void rig_prio_lock_release(struct rig_prio_lock *lock);
+void rig_prio_lock_stats(struct rig_prio_lock *lock, int priority,
+                         struct rig_transaction_stats *stats);
+#endif
+
+/* allocated by rig_init(), used by set_transaction_active() */
+int rig_transaction_lock_init(RIG *rig);
+void rig_transaction_lock_cleanup(RIG *rig);
+
+#endif /* _PRIO_LOCK_H */
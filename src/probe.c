@@ -0,0 +1,467 @@
+/*
+ *  Hamlib Interface - rig auto-probe
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file probe.c
+ * \brief Where rig_probe() looks first
+ *
+ * The backend probes each step through their own baud rates, so trying
+ * them one after the other on a silent port takes a long time.
+ * rig_probe_first() starts with the likeliest one instead:
+ *
+ * - the model and rate last found on the same port, kept in
+ *   $HOME/.hamlib_probe, or the file named by $HAMLIB_PROBE_CACHE (empty
+ *   for none);
+ * - otherwise the protocol that answered a shared listen window: the
+ *   Kenwood "ID;" and the CI-V read ID broadcast are sent together, as
+ *   neither protocol takes the other's frame for a command, and a single
+ *   read per rate tells which one is there and at what rate.  Binary
+ *   protocols, e.g. the old Yaesu 5 byte commands, could take these bytes
+ *   for a command and are not part of it.
+ *
+ * The backend probes try the rate of the port first, then the most
+ * common backends are probed before the others.  Several ports are
+ * probed in parallel with rig_probe_ports().
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "serial.h"
+#include "iofunc.h"
+#include "misc.h"
+#include "probe.h"
+
+//! @cond Doxygen_Suppress
+#define PROBE_CACHE_LINES 64
+#define PROBE_CACHE_LINELEN 512
+
+/* every rate used by the Kenwood and Icom probes, fastest first */
+static const int probe_listen_rates[] =
+{
+    115200, 57600, 38400, 19200, 9600, 4800, 1200, 0
+};
+
+/* Kenwood/Elecraft ID, then CI-V read transceiver ID to all addresses */
+static const unsigned char probe_listen_frame[] =
+{
+    'I', 'D', ';', 0xfe, 0xfe, 0x00, 0xe0, 0x19, 0x00, 0xfd
+};
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t probe_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+void rig_probe_rate_first(const hamlib_port_t *port, int rates[])
+{
+    int rate = port->parm.serial.rate;
+    int i;
+
+    for (i = 0; rates[i]; i++)
+    {
+        if (rates[i] == rate)
+        {
+            for (; i > 0; i--)
+            {
+                rates[i] = rates[i - 1];
+            }
+
+            rates[0] = rate;
+            return;
+        }
+    }
+}
+
+
+static const char *rig_probe_cache_path(char *buf, int len)
+{
+    const char *path = getenv("HAMLIB_PROBE_CACHE");
+    const char *home;
+
+    if (path)
+    {
+        return path[0] ? path : NULL;
+    }
+
+    home = getenv("HOME");
+
+    if (!home)
+    {
+        return NULL;
+    }
+
+    SNPRINTF(buf, len, "%s/.hamlib_probe", home);
+
+    return buf;
+}
+
+
+int rig_probe_cache_lookup(const char *pathname, rig_model_t *model, int *rate)
+{
+    char buf[PROBE_CACHE_LINELEN];
+    char line[PROBE_CACHE_LINELEN];
+    char name[PROBE_CACHE_LINELEN];
+    const char *path = rig_probe_cache_path(buf, sizeof(buf));
+    int retval = -RIG_ENAVAIL;
+    unsigned int m;
+    int r;
+    FILE *fp;
+
+    if (!path || !pathname[0])
+    {
+        return -RIG_ENAVAIL;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&probe_cache_mutex);
+#endif
+
+    fp = fopen(path, "r");
+
+    while (fp && fgets(line, sizeof(line), fp))
+    {
+        if (sscanf(line, "%511s %u %d", name, &m, &r) == 3 && strcmp(name,
+                pathname) == 0)
+        {
+            *model = m;
+            *rate = r;
+            retval = RIG_OK;
+            break;
+        }
+    }
+
+    if (fp)
+    {
+        fclose(fp);
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&probe_cache_mutex);
+#endif
+
+    return retval;
+}
+
+
+int rig_probe_cache_store(const char *pathname, rig_model_t model, int rate)
+{
+    char buf[PROBE_CACHE_LINELEN];
+    char tmp[PROBE_CACHE_LINELEN + 4];
+    char name[PROBE_CACHE_LINELEN];
+    char (*lines)[PROBE_CACHE_LINELEN];
+    const char *path = rig_probe_cache_path(buf, sizeof(buf));
+    int nlines = 0;
+    int retval = RIG_OK;
+    int i;
+    FILE *fp;
+
+    if (!path || !pathname[0] || strchr(pathname, ' '))
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    lines = calloc(PROBE_CACHE_LINES, PROBE_CACHE_LINELEN);
+
+    if (!lines)
+    {
+        return -RIG_ENOMEM;
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&probe_cache_mutex);
+#endif
+
+    /* keep the other ports, the newest first */
+    SNPRINTF(lines[nlines++], PROBE_CACHE_LINELEN, "%s %u %d\n", pathname,
+             model, rate);
+
+    fp = fopen(path, "r");
+
+    while (fp && nlines < PROBE_CACHE_LINES
+            && fgets(lines[nlines], PROBE_CACHE_LINELEN, fp))
+    {
+        if (sscanf(lines[nlines], "%511s", name) == 1 && strcmp(name, pathname) != 0)
+        {
+            nlines++;
+        }
+    }
+
+    if (fp)
+    {
+        fclose(fp);
+    }
+
+    SNPRINTF(tmp, sizeof(tmp), "%s.tmp", path);
+    fp = fopen(tmp, "w");
+
+    if (!fp)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: cannot write %s\n", __func__, tmp);
+        retval = -RIG_EIO;
+    }
+    else
+    {
+        for (i = 0; i < nlines; i++)
+        {
+            fputs(lines[i], fp);
+        }
+
+        fclose(fp);
+#ifdef _WIN32
+        remove(path);
+#endif
+
+        if (rename(tmp, path) != 0)
+        {
+            remove(tmp);
+            retval = -RIG_EIO;
+        }
+    }
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&probe_cache_mutex);
+#endif
+
+    free(lines);
+
+    return retval;
+}
+
+
+int rig_probe_classify(const unsigned char *buf, int len)
+{
+    int i, j;
+
+    for (i = 0; i + 3 < len; i++)
+    {
+        /* IDnnn; -- but not the echo of ID; */
+        if (buf[i] == 'I' && buf[i + 1] == 'D' && buf[i + 2] != ';')
+        {
+            for (j = i + 2; j < len && buf[j] >= '0' && buf[j] <= '9'; j++);
+
+            if (j > i + 2 && j < len && buf[j] == ';')
+            {
+                return RIG_KENWOOD;
+            }
+        }
+
+        /* FE FE E0 <rig address> ... FD -- a reply to us, not our echo */
+        if (buf[i] == 0xfe && buf[i + 1] == 0xfe && buf[i + 2] == 0xe0
+                && buf[i + 3] != 0xe0 && buf[i + 3] != 0x00)
+        {
+            for (j = i + 4; j < len && buf[j] != 0xfd; j++);
+
+            if (j < len)
+            {
+                return RIG_ICOM;
+            }
+        }
+    }
+
+    return -1;
+}
+
+
+int rig_probe_listen(hamlib_port_t *port)
+{
+    unsigned char buf[64];
+    int rate = port->parm.serial.rate;
+    int timeout = port->timeout;
+    int retry = port->retry;
+    int write_delay = port->write_delay;
+    int post_write_delay = port->post_write_delay;
+    int be_num = -1;
+    int i;
+
+    if (port->type.rig != RIG_PORT_SERIAL)
+    {
+        return -1;
+    }
+
+    port->write_delay = port->post_write_delay = 0;
+    port->retry = 0;
+
+    for (i = 0; probe_listen_rates[i] && be_num < 0; i++)
+    {
+        int len = 0;
+
+        port->parm.serial.rate = probe_listen_rates[i];
+        port->timeout = 2 * 1000 / probe_listen_rates[i] + 50;
+
+        if (serial_open(port) != RIG_OK)
+        {
+            break;
+        }
+
+        if (write_block(port, probe_listen_frame, sizeof(probe_listen_frame)) == RIG_OK)
+        {
+            /* echoes and replies, each up to its ';' or 0xfd */
+            while (len < (int) sizeof(buf) - 1)
+            {
+                int n = read_string(port, buf + len, sizeof(buf) - len, ";\xfd", 2, 1, 1);
+
+                if (n <= 0)
+                {
+                    break;
+                }
+
+                len += n;
+                be_num = rig_probe_classify(buf, len);
+
+                if (be_num >= 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        close(port->fd);
+    }
+
+    port->timeout = timeout;
+    port->retry = retry;
+    port->write_delay = write_delay;
+    port->post_write_delay = post_write_delay;
+
+    if (be_num >= 0)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: backend %d answered at %d bps\n", __func__,
+                  be_num, probe_listen_rates[i - 1]);
+        port->parm.serial.rate = probe_listen_rates[i - 1];
+    }
+    else
+    {
+        port->parm.serial.rate = rate;
+    }
+
+    return be_num;
+}
+
+
+#ifdef HAVE_PTHREAD
+struct rig_probe_job
+{
+    hamlib_port_t *port;
+    rig_model_t model;
+};
+
+
+static void *rig_probe_thread(void *arg)
+{
+    struct rig_probe_job *job = arg;
+
+    job->model = rig_probe_first(job->port);
+
+    return NULL;
+}
+#endif
+//! @endcond
+
+
+/**
+ * \brief try to guess the rigs on several ports at once
+ * \param ports     The ports to probe
+ * \param nports    How many there are
+ * \param models    Where to store the model found on each port,
+ * RIG_MODEL_NONE if none
+ *
+ *  Like rig_probe(), but the ports are probed in parallel, so the time
+ *  taken is the one of the slowest port rather than the sum.
+ *
+ * \return RIG_OK, or a negative RIG_E* error code.
+ */
+int HAMLIB_API rig_probe_ports(hamlib_port_t *ports[], int nports,
+                               rig_model_t models[])
+{
+    int i;
+
+    if (!ports || !models || nports < 0)
+    {
+        return -RIG_EINVAL;
+    }
+
+#ifdef HAVE_PTHREAD
+    {
+        struct rig_probe_job *jobs;
+        pthread_t *threads;
+
+        jobs = calloc(nports, sizeof(*jobs));
+        threads = calloc(nports, sizeof(*threads));
+
+        if (nports > 0 && (!jobs || !threads))
+        {
+            free(jobs);
+            free(threads);
+            return -RIG_ENOMEM;
+        }
+
+        for (i = 0; i < nports; i++)
+        {
+            jobs[i].port = ports[i];
+
+            if (pthread_create(&threads[i], NULL, rig_probe_thread, &jobs[i]) != 0)
+            {
+                /* probe it here then */
+                jobs[i].model = rig_probe_first(ports[i]);
+                jobs[i].port = NULL;
+            }
+        }
+
+        for (i = 0; i < nports; i++)
+        {
+            if (jobs[i].port)
+            {
+                pthread_join(threads[i], NULL);
+            }
+
+            models[i] = jobs[i].model;
+        }
+
+        free(jobs);
+        free(threads);
+    }
+#else
+
+    for (i = 0; i < nports; i++)
+    {
+        models[i] = rig_probe_first(ports[i]);
+    }
+
+#endif
+
+    return RIG_OK;
+}
+
+/** @} */
@@ -0,0 +1,40 @@
+/*
+ *  Hamlib Interface - rig auto-probe
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _PROBE_H
+#define _PROBE_H
+
+#include <hamlib/rig.h>
+
+/* moves the rate of the port, if listed, to the front of a 0 terminated list */
+void rig_probe_rate_first(const hamlib_port_t *port, int rates[]);
+
+/* last model found on each port, see rig_probe_first() */
+int rig_probe_cache_lookup(const char *pathname, rig_model_t *model,
+                           int *rate);
+int rig_probe_cache_store(const char *pathname, rig_model_t model, int rate);
+
+/* backend number of the protocol that answered a shared probe, or -1 */
+int rig_probe_classify(const unsigned char *buf, int len);
+int rig_probe_listen(hamlib_port_t *port);
+
+rig_model_t rig_probe_first(hamlib_port_t *port);
+
+#endif /* _PROBE_H */
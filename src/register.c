@@ -35,10 +35,15 @@
 #include <stdio.h>
 #include <sys/types.h>
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #include <register.h>
 
 #include <hamlib/rig.h>
 #include "misc.h"
+#include "probe.h"
 
 //! @cond Doxygen_Suppress
 #ifndef PATH_MAX
@@ -151,46 +156,86 @@ static struct
     { 0, NULL }, /* end */
 };
 
-
 /*
- * This struct to keep track of known rig models.
- * It is chained, and used in a hash table, see below.
+ * Backends are initialized on demand, by rig_init() through
+ * rig_check_backend(), and only once: an application that opens one
+ * model registers the rig_caps of its backend only.
  */
 //! @cond Doxygen_Suppress
-struct rig_list
-{
-    const struct rig_caps *caps;
-    struct rig_list *next;
-};
+static char rig_backend_loaded[RIG_BACKEND_MAX];
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t rig_backend_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define RIG_BACKEND_LOCK() pthread_mutex_lock(&rig_backend_mutex)
+#define RIG_BACKEND_UNLOCK() pthread_mutex_unlock(&rig_backend_mutex)
+#else
+#define RIG_BACKEND_LOCK()
+#define RIG_BACKEND_UNLOCK()
+#endif
 //! @endcond
 
 
-// This size has to be > than the max# of rigs for any manufacturer
-// A fatal error will occur when running rigctl if this value is too small
+/*
+ * The registered rigs, sorted by model: a lookup is a binary search and
+ * rig_list_foreach() walks the models registered only.
+ */
 //! @cond Doxygen_Suppress
-#define RIGLSTHASHSZ 65535
-#define HASH_FUNC(a) ((a)%RIGLSTHASHSZ)
+static const struct rig_caps **rig_caps_list;
+static int rig_caps_count;
+static int rig_caps_size;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t rig_caps_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define RIG_CAPS_LOCK() pthread_mutex_lock(&rig_caps_mutex)
+#define RIG_CAPS_UNLOCK() pthread_mutex_unlock(&rig_caps_mutex)
+#else
+#define RIG_CAPS_LOCK()
+#define RIG_CAPS_UNLOCK()
+#endif
 //! @endcond
 
 
+static int rig_lookup_backend(rig_model_t rig_model);
+static int rig_init_backend(int be_idx);
+
+
 /*
- * The rig_hash_table is a hash table pointing to a list of next==NULL
- *  terminated caps.
+ * index of rig_model in rig_caps_list, or where to insert it
  */
-static struct rig_list *rig_hash_table[RIGLSTHASHSZ] = { NULL, };
+//! @cond Doxygen_Suppress
+static int rig_caps_search(rig_model_t rig_model, int *found)
+{
+    int lo = 0;
+    int hi = rig_caps_count;
 
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
 
-static int rig_lookup_backend(rig_model_t rig_model);
+        if (rig_caps_list[mid]->rig_model < rig_model)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    *found = lo < rig_caps_count && rig_caps_list[lo]->rig_model == rig_model;
+
+    return lo;
+}
+//! @endcond
 
 
 /*
- * Basically, this is a hash insert function that doesn't check for dup!
+ * Sorted insert, a model registered twice is an error
  */
 //! @cond Doxygen_Suppress
 int HAMLIB_API rig_register(const struct rig_caps *caps)
 {
-    int hval;
-    struct rig_list *p;
+    int i, found;
 
     //rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
@@ -199,57 +244,84 @@ int HAMLIB_API rig_register(const struct rig_caps *caps)
         return -RIG_EINVAL;
     }
 
-#if 0
-    rig_debug(RIG_DEBUG_VERBOSE,
-              "%s: rig_register (%u)\n",
-              __func__,
-              caps->rig_model);
-#endif
+    RIG_CAPS_LOCK();
 
-    p = (struct rig_list *)malloc(sizeof(struct rig_list));
+    i = rig_caps_search(caps->rig_model, &found);
 
-    if (!p)
+    if (found)
     {
-        return -RIG_ENOMEM;
+        RIG_CAPS_UNLOCK();
+        rig_debug(RIG_DEBUG_ERR, "%s: rig model %u registered twice\n", __func__,
+                  caps->rig_model);
+        return -RIG_EINVAL;
     }
 
-    hval = HASH_FUNC(caps->rig_model);
-
-    if (rig_hash_table[hval])
+    if (rig_caps_count == rig_caps_size)
     {
-        printf("Hash collision!!! Fatal error!!\n");
-        exit(1);
+        int size = rig_caps_size ? rig_caps_size * 2 : 256;
+        const struct rig_caps **list = realloc(rig_caps_list, size * sizeof(*list));
+
+        if (!list)
+        {
+            RIG_CAPS_UNLOCK();
+            return -RIG_ENOMEM;
+        }
+
+        rig_caps_list = list;
+        rig_caps_size = size;
     }
 
-    p->caps = caps;
-    // p->handle = NULL;
-    p->next = rig_hash_table[hval];
-    rig_hash_table[hval] = p;
+    memmove(&rig_caps_list[i + 1], &rig_caps_list[i],
+            (rig_caps_count - i) * sizeof(*rig_caps_list));
+    rig_caps_list[i] = caps;
+    rig_caps_count++;
+
+    RIG_CAPS_UNLOCK();
 
-    //RETURNFUNC(RIG_OK);
     return RIG_OK;
 }
 //! @endcond
 
 /*
  * Get rig capabilities.
- * ie. rig_hash_table lookup
+ * ie. rig_caps_list lookup
  */
 
 //! @cond Doxygen_Suppress
 const struct rig_caps *HAMLIB_API rig_get_caps(rig_model_t rig_model)
 {
-    struct rig_list *p;
+    const struct rig_caps *caps = NULL;
+    int i, found;
+
+    RIG_CAPS_LOCK();
 
-    for (p = rig_hash_table[HASH_FUNC(rig_model)]; p; p = p->next)
+    i = rig_caps_search(rig_model, &found);
+
+    if (found)
     {
-        if (p->caps->rig_model == rig_model)
-        {
-            return p->caps;
-        }
+        caps = rig_caps_list[i];
     }
 
-    return NULL;    /* sorry, caps not registered! */
+    RIG_CAPS_UNLOCK();
+
+    return caps;    /* NULL: sorry, caps not registered! */
+}
+//! @endcond
+
+
+/*
+ * the i-th registered rig, NULL past the last one
+ */
+//! @cond Doxygen_Suppress
+static const struct rig_caps *rig_caps_at(int i)
+{
+    const struct rig_caps *caps;
+
+    RIG_CAPS_LOCK();
+    caps = i < rig_caps_count ? rig_caps_list[i] : NULL;
+    RIG_CAPS_UNLOCK();
+
+    return caps;
 }
 //! @endcond
 
@@ -289,7 +361,6 @@ int HAMLIB_API rig_check_backend(rig_model_t rig_model)
     const struct rig_caps *caps;
     int be_idx;
     int retval;
-    int i, n;
 
     /* already loaded ? */
     caps = rig_get_caps(rig_model);
@@ -299,19 +370,6 @@ int HAMLIB_API rig_check_backend(rig_model_t rig_model)
         return RIG_OK;
     }
 
-    // hmmm...no caps so did we already load the rigs?
-    for (n = 0, i = 0; i < RIGLSTHASHSZ; i++)
-    {
-        if (rig_hash_table[i]) { ++n; }
-    }
-
-    if (n > 1)
-    {
-        rig_debug(RIG_DEBUG_ERR, "%s: rig model %u not found and rig count=%d\n",
-                  __func__, rig_model, n);
-        return -RIG_ENAVAIL;
-    }
-
     be_idx = rig_lookup_backend(rig_model);
 
     /*
@@ -326,20 +384,24 @@ int HAMLIB_API rig_check_backend(rig_model_t rig_model)
         return -RIG_ENAVAIL;
     }
 
-    // do we need to load the backend?
-//    if (rig_backend_list[be_idx].be_init_all == 0)
+    RIG_BACKEND_LOCK();
+    retval = rig_init_backend(be_idx);
+    RIG_BACKEND_UNLOCK();
+
+    if (retval != RIG_OK)
     {
-        retval = rig_load_backend(rig_backend_list[be_idx].be_name);
+        return retval;
     }
-#if 0
-    else
+
+    // its backend is loaded, by us or another thread, and does not have it
+    if (!rig_get_caps(rig_model))
     {
-        retval = RIG_OK;
+        rig_debug(RIG_DEBUG_ERR, "%s: rig model %u not found in backend %s\n",
+                  __func__, rig_model, rig_backend_list[be_idx].be_name);
+        return -RIG_ENAVAIL;
     }
 
-#endif
-
-    return retval;
+    return RIG_OK;
 }
 //! @endcond
 
@@ -348,46 +410,35 @@ int HAMLIB_API rig_check_backend(rig_model_t rig_model)
 //! @cond Doxygen_Suppress
 int HAMLIB_API rig_unregister(rig_model_t rig_model)
 {
-    int hval;
-    struct rig_list *p, *q;
-
-    hval = HASH_FUNC(rig_model);
-    q = NULL;
+    int i, found;
 
-    for (p = rig_hash_table[hval]; p; p = p->next)
-    {
-        if (p->caps->rig_model == rig_model)
-        {
-            if (q == NULL)
-            {
-                rig_hash_table[hval] = p->next;
-            }
-            else
-            {
-                q->next = p->next;
-            }
+    RIG_CAPS_LOCK();
 
-            free(p);
-            return RIG_OK;
-        }
+    i = rig_caps_search(rig_model, &found);
 
-        q = p;
+    if (found)
+    {
+        rig_caps_count--;
+        memmove(&rig_caps_list[i], &rig_caps_list[i + 1],
+                (rig_caps_count - i) * sizeof(*rig_caps_list));
     }
 
-    return -RIG_EINVAL; /* sorry, caps not registered! */
+    RIG_CAPS_UNLOCK();
+
+    return found ? RIG_OK : -RIG_EINVAL; /* sorry, caps not registered! */
 }
 //! @endcond
 
 /*
  * rig_list_foreach
- * executes cfunc on all the elements stored in the rig hash list
+ * executes cfunc on all the registered rigs, by model
  */
 //! @cond Doxygen_Suppress
 int HAMLIB_API rig_list_foreach(int (*cfunc)(const struct rig_caps *,
                                 rig_ptr_t),
                                 rig_ptr_t data)
 {
-    struct rig_list *p;
+    const struct rig_caps *caps;
     int i;
 
     if (!cfunc)
@@ -395,18 +446,17 @@ int HAMLIB_API rig_list_foreach(int (*cfunc)(const struct rig_caps *,
         return -RIG_EINVAL;
     }
 
-    for (i = 0; i < RIGLSTHASHSZ; i++)
+    for (i = 0; (caps = rig_caps_at(i)) != NULL; i++)
     {
-        struct rig_list *next = NULL;
-
-        for (p = rig_hash_table[i]; p; p = next)
+        if ((*cfunc)(caps, data) == 0)
         {
-            next = p->next;       /* read before call in case it is unregistered */
+            return RIG_OK;
+        }
 
-            if ((*cfunc)(p->caps, data) == 0)
-            {
-                return RIG_OK;
-            }
+        /* the next one moved down if cfunc unregistered this one */
+        if (rig_caps_at(i) != caps)
+        {
+            i--;
         }
     }
 
@@ -416,14 +466,14 @@ int HAMLIB_API rig_list_foreach(int (*cfunc)(const struct rig_caps *,
 
 /*
  * rig_list_foreach_model
- * executes cfunc on all the elements stored in the rig hash list
+ * executes cfunc on all the registered rig models, in order
  */
 //! @cond Doxygen_Suppress
 int HAMLIB_API rig_list_foreach_model(int (*cfunc)(const rig_model_t rig_model,
                                       rig_ptr_t),
                                       rig_ptr_t data)
 {
-    struct rig_list *p;
+    const struct rig_caps *caps;
     int i;
 
     if (!cfunc)
@@ -431,18 +481,17 @@ int HAMLIB_API rig_list_foreach_model(int (*cfunc)(const rig_model_t rig_model,
         return -RIG_EINVAL;
     }
 
-    for (i = 0; i < RIGLSTHASHSZ; i++)
+    for (i = 0; (caps = rig_caps_at(i)) != NULL; i++)
     {
-        struct rig_list *next = NULL;
-
-        for (p = rig_hash_table[i]; p; p = next)
+        if ((*cfunc)(caps->rig_model, data) == 0)
         {
-            next = p->next;       /* read before call in case it is unregistered */
+            return RIG_OK;
+        }
 
-            if ((*cfunc)(p->caps->rig_model, data) == 0)
-            {
-                return RIG_OK;
-            }
+        /* the next one moved down if cfunc unregistered this one */
+        if (rig_caps_at(i) != caps)
+        {
+            i--;
         }
     }
 
@@ -462,6 +511,14 @@ static int dummy_rig_probe(const hamlib_port_t *p,
 //! @endcond
 
 
+/*
+ * most common protocols first, the others in rig_backend_list order
+ */
+//! @cond Doxygen_Suppress
+static const int rig_probe_popular[] = { RIG_KENWOOD, RIG_ICOM, RIG_YAESU, -1 };
+//! @endcond
+
+
 /*
  * rig_probe_first
  * called straight by rig_probe
@@ -469,21 +526,67 @@ static int dummy_rig_probe(const hamlib_port_t *p,
 //! @cond Doxygen_Suppress
 rig_model_t rig_probe_first(hamlib_port_t *p)
 {
-    int i;
+    int order[RIG_BACKEND_MAX + 4];
+    int norder = 0;
+    int first = -1;
+    int i, j;
     rig_model_t model;
+    int rate;
+
+    if (p->type.rig == RIG_PORT_SERIAL)
+    {
+        if (rig_probe_cache_lookup(p->pathname, &model, &rate) == RIG_OK)
+        {
+            rig_debug(RIG_DEBUG_VERBOSE, "%s: %s had model %u at %d bps\n", __func__,
+                      p->pathname, model, rate);
+            first = RIG_BACKEND_NUM(model);
+            p->parm.serial.rate = rate;
+        }
+        else
+        {
+            first = rig_probe_listen(p);
+        }
+    }
+
+    if (first >= 0)
+    {
+        order[norder++] = first;
+    }
+
+    for (i = 0; rig_probe_popular[i] >= 0; i++)
+    {
+        order[norder++] = rig_probe_popular[i];
+    }
 
     for (i = 0; i < RIG_BACKEND_MAX && rig_backend_list[i].be_name; i++)
     {
-        if (rig_backend_list[i].be_probe_all)
+        order[norder++] = rig_backend_list[i].be_num;
+    }
+
+    for (i = 0; i < norder; i++)
+    {
+        int be_idx = rig_lookup_backend(RIG_MAKE_MODEL(order[i], 1));
+
+        /* each backend once */
+        for (j = 0; j < i && order[j] != order[i]; j++);
+
+        if (j < i || be_idx < 0 || !rig_backend_list[be_idx].be_probe_all)
         {
-            model = (*rig_backend_list[i].be_probe_all)(p, dummy_rig_probe,
-                    (rig_ptr_t)NULL);
+            continue;
+        }
 
-            /* stop at first one found */
-            if (model != RIG_MODEL_NONE)
+        model = (*rig_backend_list[be_idx].be_probe_all)(p, dummy_rig_probe,
+                (rig_ptr_t)NULL);
+
+        /* stop at first one found */
+        if (model != RIG_MODEL_NONE)
+        {
+            if (p->type.rig == RIG_PORT_SERIAL)
             {
-                return model;
+                rig_probe_cache_store(p->pathname, model, p->parm.serial.rate);
             }
+
+            return model;
         }
     }
 
@@ -521,8 +624,7 @@ int rig_load_all_backends()
 {
     int i;
 
-    memset(rig_hash_table, 0, sizeof(rig_hash_table));
-
+    /* those already loaded are skipped */
     for (i = 0; i < RIG_BACKEND_MAX && rig_backend_list[i].be_name; i++)
     {
         rig_load_backend(rig_backend_list[i].be_name);
@@ -538,6 +640,41 @@ typedef int (*backend_init_t)(rig_ptr_t);
 //! @endcond
 
 
+/*
+ * rig_init_backend
+ * registers the rigs of the backend unless done already; must be called
+ * with rig_backend_mutex held.  The backend only counts as loaded once its
+ * rigs are registered, so rig_check_backend() never takes a backend being
+ * initialized by another thread for one lacking the model.
+ */
+//! @cond Doxygen_Suppress
+static int rig_init_backend(int be_idx)
+{
+    backend_init_t be_init = rig_backend_list[be_idx].be_init_all;
+    int retval;
+
+    if (!be_init)
+    {
+        return -RIG_EINVAL;
+    }
+
+    /*
+     * registering its rigs again would fail, rig_register() refuses a
+     * duplicate model with -RIG_EINVAL
+     */
+    if (rig_backend_loaded[be_idx])
+    {
+        return RIG_OK;
+    }
+
+    retval = (*be_init)(NULL);
+    rig_backend_loaded[be_idx] = 1;
+
+    return retval;
+}
+//! @endcond
+
+
 /*
  * rig_load_backend
  */
@@ -545,22 +682,17 @@ typedef int (*backend_init_t)(rig_ptr_t);
 int HAMLIB_API rig_load_backend(const char *be_name)
 {
     int i;
-    backend_init_t be_init;
+    int retval;
 
     for (i = 0; i < RIG_BACKEND_MAX && rig_backend_list[i].be_name; i++)
     {
         if (!strcmp(be_name, rig_backend_list[i].be_name))
         {
-            be_init = rig_backend_list[i].be_init_all ;
+            RIG_BACKEND_LOCK();
+            retval = rig_init_backend(i);
+            RIG_BACKEND_UNLOCK();
 
-            if (be_init)
-            {
-                return (*be_init)(NULL);
-            }
-            else
-            {
-                return -RIG_EINVAL;
-            }
+            return retval;
         }
     }
 
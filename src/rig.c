@@ -77,6 +77,10 @@
 #include "sprintflst.h"
 #include "hamlibdatetime.h"
 #include "cache.h"
+#include "spectrum_ring.h"
+#include "prio_lock.h"
+#include "stats.h"
+#include "iofunc.h"
 
 /**
  * \brief Hamlib release number
@@ -453,6 +457,7 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
 #endif
 
     rs->async_data_enabled = 0;
+    rs->multicast_keyframe_interval_ms = 1000;
     rs->rigport.fd = -1;
     rs->pttport.fd = -1;
     rs->comm_state = 0;
@@ -655,6 +660,34 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
     rs->announces = caps->announces;
 
     rs->rigport.fd = rs->pttport.fd = rs->dcdport.fd = -1;
+    rs->rigport.rig = rs->pttport.rig = rs->dcdport.rig = rig;
+
+    /* without it the port is read and written unbuffered */
+    rs->rigport_private = calloc(1, sizeof(struct port_private));
+
+    if (rs->rigport_private == NULL)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: no memory for the port buffers\n", __func__);
+    }
+
+    if (rig_spectrum_ring_init(rig) != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: no memory for the spectrum ring\n", __func__);
+    }
+
+    if (rig_transaction_lock_init(rig) != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: no memory for the transaction lock\n", __func__);
+        rig_spectrum_ring_cleanup(rig);
+        free(rs->rigport_private);
+        free(rig);
+        return (NULL);
+    }
+
+    if (rig_stats_init(rig) != RIG_OK)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: no memory for the call stats\n", __func__);
+    }
 
     /*
      * let the backend a chance to setup his private data
@@ -671,6 +704,10 @@ RIG *HAMLIB_API rig_init(rig_model_t rig_model)
                       "%s: backend_init failed!\n",
                       __func__);
             /* cleanup and exit */
+            rig_spectrum_ring_cleanup(rig);
+            rig_transaction_lock_cleanup(rig);
+            rig_stats_cleanup(rig);
+            free(rs->rigport_private);
             free(rig);
             return (NULL);
         }
@@ -1361,6 +1398,11 @@ int HAMLIB_API rig_cleanup(RIG *rig)
         rig->caps->rig_cleanup(rig);
     }
 
+    free(rig->state.setting_cache);
+    rig_spectrum_ring_cleanup(rig);
+    rig_transaction_lock_cleanup(rig);
+    rig_stats_cleanup(rig);
+    free(rig->state.rigport_private);
     free(rig);
 
     return (RIG_OK);
@@ -1786,6 +1828,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
         int cache_ms_freq, cache_ms_mode, cache_ms_width;
         rig_get_cache(rig, vfo, freq, &cache_ms_freq, &mode, &cache_ms_mode, &width,
                       &cache_ms_width);
+        rig_stats_cache(rig, __func__, 1);
         ELAPSED2;
         return (RIG_OK);
     }
@@ -1814,7 +1857,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
             rig_debug(RIG_DEBUG_TRACE,
                       "%s: split is on so returning VFOA last known freq\n",
                       __func__);
-            *freq = rig->state.cache.freqMainA;
+            *freq = rig->state.cache_slot[CACHE_SLOT_MAIN_A].freq;
             return (RIG_OK);
         }
     }
@@ -1830,6 +1873,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
                        || (rig->state.cache.timeout_ms == HAMLIB_CACHE_ALWAYS
                            || rig->state.use_cached_freq)))
     {
+        rig_stats_cache(rig, __func__, 1);
         rig_debug(RIG_DEBUG_TRACE, "%s: %s cache hit age=%dms, freq=%.0f\n", __func__,
                   rig_strvfo(vfo), cache_ms_freq, *freq);
         ELAPSED2;
@@ -1837,6 +1881,7 @@ int HAMLIB_API rig_get_freq(RIG *rig, vfo_t vfo, freq_t *freq)
     }
     else
     {
+        rig_stats_cache(rig, __func__, 0);
         rig_debug(RIG_DEBUG_TRACE,
                   "%s: cache miss age=%dms, cached_vfo=%s, asked_vfo=%s\n", __func__,
                   cache_ms_freq,
@@ -2042,7 +2087,7 @@ int HAMLIB_API rig_set_mode(RIG *rig, vfo_t vfo, rmode_t mode, pbwidth_t width)
         vfo_t curr_vfo;
 
         // if not a targetable rig we will only set mode on VFOB if it is changing
-        if (rig->state.cache.modeMainB == mode)
+        if (rig->state.cache_slot[CACHE_SLOT_MAIN_B].mode == mode)
         {
             rig_debug(RIG_DEBUG_TRACE, "%s: VFOB mode not changing so ignoring\n",
                       __func__);
@@ -2147,9 +2192,12 @@ int HAMLIB_API rig_get_mode(RIG *rig,
 
     rig_cache_show(rig, __func__, __LINE__);
 
+    // the AI reports keep the cache, once they have filled it
     if (rig->state.cache.timeout_ms == HAMLIB_CACHE_ALWAYS
-            || rig->state.use_cached_mode)
+            || (rig->state.use_cached_mode && *mode != RIG_MODE_NONE
+                && cache_ms_mode < ELAPSED_INVALID_MS))
     {
+        rig_stats_cache(rig, __func__, 1);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age mode=%dms, width=%dms\n",
                   __func__, cache_ms_mode, cache_ms_width);
 
@@ -2160,6 +2208,7 @@ int HAMLIB_API rig_get_mode(RIG *rig,
     if ((*mode != RIG_MODE_NONE && cache_ms_mode < rig->state.cache.timeout_ms)
             && cache_ms_width < rig->state.cache.timeout_ms)
     {
+        rig_stats_cache(rig, __func__, 1);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age mode=%dms, width=%dms\n",
                   __func__, cache_ms_mode, cache_ms_width);
 
@@ -2168,6 +2217,7 @@ int HAMLIB_API rig_get_mode(RIG *rig,
     }
     else
     {
+        rig_stats_cache(rig, __func__, 0);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache miss age mode=%dms, width=%dms\n",
                   __func__, cache_ms_mode, cache_ms_width);
     }
@@ -2500,8 +2550,10 @@ int HAMLIB_API rig_set_vfo(RIG *rig, vfo_t vfo)
     if (retcode == RIG_OK)
     {
         vfo = rig->state.current_vfo; // vfo may change in the rig backend
+        rig_cache_write_begin(rig);
         rig->state.cache.vfo = vfo;
         elapsed_ms(&rig->state.cache.time_vfo, HAMLIB_ELAPSED_SET);
+        rig_cache_write_end(rig);
         rig_debug(RIG_DEBUG_TRACE, "%s: rig->state.current_vfo=%s\n", __func__,
                   rig_strvfo(vfo));
     }
@@ -2529,17 +2581,6 @@ int HAMLIB_API rig_set_vfo(RIG *rig, vfo_t vfo)
         rig_set_cache_freq(rig, RIG_VFO_ALL, (freq_t)0);
     }
 
-#if 0 // with new cache should not have to expire here anymore
-    // expire several cached items when we switch VFOs
-    elapsed_ms(&rig->state.cache.time_vfo, HAMLIB_ELAPSED_INVALIDATE);
-    elapsed_ms(&rig->state.cache.time_modeMainA, HAMLIB_ELAPSED_INVALIDATE);
-    elapsed_ms(&rig->state.cache.time_modeMainB, HAMLIB_ELAPSED_INVALIDATE);
-    elapsed_ms(&rig->state.cache.time_modeMainC, HAMLIB_ELAPSED_INVALIDATE);
-    elapsed_ms(&rig->state.cache.time_widthMainA, HAMLIB_ELAPSED_INVALIDATE);
-    elapsed_ms(&rig->state.cache.time_widthMainB, HAMLIB_ELAPSED_INVALIDATE);
-    elapsed_ms(&rig->state.cache.time_widthMainC, HAMLIB_ELAPSED_INVALIDATE);
-#endif
-
     rig_debug(RIG_DEBUG_TRACE, "%s: return %d, vfo=%s, curr_vfo=%s\n", __func__,
               retcode,
               rig_strvfo(vfo), rig_strvfo(rig->state.current_vfo));
@@ -2566,6 +2607,7 @@ int HAMLIB_API rig_set_vfo(RIG *rig, vfo_t vfo)
 int HAMLIB_API rig_get_vfo(RIG *rig, vfo_t *vfo)
 {
     const struct rig_caps *caps;
+    struct rig_cache_snapshot snap;
     int retcode;
     int cache_ms;
 
@@ -2592,18 +2634,21 @@ int HAMLIB_API rig_get_vfo(RIG *rig, vfo_t *vfo)
         RETURNFUNC(-RIG_ENAVAIL);
     }
 
-    cache_ms = elapsed_ms(&rig->state.cache.time_vfo, HAMLIB_ELAPSED_GET);
+    rig_get_cache_snapshot(rig, RIG_VFO_A, &snap);  // only the rig-wide entries are used
+    cache_ms = snap.cache_ms_vfo;
     rig_debug(RIG_DEBUG_TRACE, "%s: cache check age=%dms\n", __func__, cache_ms);
 
     if (cache_ms < rig->state.cache.timeout_ms)
     {
+        rig_stats_cache(rig, __func__, 1);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age=%dms\n", __func__, cache_ms);
-        *vfo = rig->state.cache.vfo;
+        *vfo = snap.curr_vfo;
         ELAPSED2;
         RETURNFUNC(RIG_OK);
     }
     else
     {
+        rig_stats_cache(rig, __func__, 0);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache miss age=%dms\n", __func__, cache_ms);
     }
 
@@ -2613,8 +2658,10 @@ int HAMLIB_API rig_get_vfo(RIG *rig, vfo_t *vfo)
     if (retcode == RIG_OK)
     {
         rig->state.current_vfo = *vfo;
+        rig_cache_write_begin(rig);
         rig->state.cache.vfo = *vfo;
         cache_ms = elapsed_ms(&rig->state.cache.time_vfo, HAMLIB_ELAPSED_SET);
+        rig_cache_write_end(rig);
     }
     else
     {
@@ -2632,27 +2679,12 @@ int HAMLIB_API rig_get_vfo(RIG *rig, vfo_t *vfo)
 }
 
 
-/**
- * \brief set PTT on/off
- * \param rig   The rig handle
- * \param vfo   The target VFO
- * \param ptt   The PTT status to set to
- *
- *  Sets "Push-To-Talk" on/off.
- *
- * \return RIG_OK if the operation has been successful, otherwise
- * a negative value if an error occurred (in which case, cause is
- * set appropriately).
- *
- * \sa rig_get_ptt()
- */
-int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
+static int rig_set_ptt_urgent(RIG *rig, vfo_t vfo, ptt_t ptt)
 {
     const struct rig_caps *caps;
     struct rig_state *rs = &rig->state;
     int retcode = RIG_OK;
 
-    ELAPSED1;
     ENTERFUNC;
 
     if (CHECK_RIG_ARG(rig))
@@ -2913,19 +2945,53 @@ int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
     // is requested on a rig that can't change freq on a transmitting VFO
     if (ptt != RIG_PTT_ON) { hl_usleep(50 * 1000); }
 
+    rig_cache_write_begin(rig);
     rig->state.cache.ptt = ptt;
     elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+    rig_cache_write_end(rig);
 
     if (retcode != RIG_OK) { rig_debug(RIG_DEBUG_ERR, "%s: return code=%d\n", __func__, retcode); }
 
     memcpy(&rig->state.pttport_deprecated, &rig->state.pttport,
            sizeof(rig->state.pttport_deprecated));
-    ELAPSED2;
 
     RETURNFUNC(retcode);
 }
 
 
+/**
+ * \brief set PTT on/off
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param ptt   The PTT status to set to
+ *
+ *  Sets "Push-To-Talk" on/off.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ * \sa rig_get_ptt()
+ */
+int HAMLIB_API rig_set_ptt(RIG *rig, vfo_t vfo, ptt_t ptt)
+{
+    int priority = rig_set_priority(RIG_PRIO_URGENT);
+    int retcode;
+
+    ELAPSED1;
+    retcode = rig_set_ptt_urgent(rig, vfo, ptt);
+
+    /* apps start the audio on return, a paced PTT command must be out by then */
+    if (retcode == RIG_OK)
+    {
+        port_tx_drain(&rig->state.rigport);
+    }
+
+    rig_set_priority(priority);
+    return retcode;
+}
+
+
 /**
  * \brief get the status of the PTT
  * \param rig   The rig handle
@@ -2947,6 +3013,7 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
     int retcode = RIG_OK;
     int status;
     vfo_t curr_vfo;
+    struct rig_cache_snapshot snap;
     int cache_ms;
     int targetable_ptt = 0;
     int backend_num;
@@ -2964,18 +3031,21 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
         RETURNFUNC(-RIG_EINVAL);
     }
 
-    cache_ms = elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_GET);
+    rig_get_cache_snapshot(rig, RIG_VFO_A, &snap);  // only the rig-wide entries are used
+    cache_ms = snap.cache_ms_ptt;
     rig_debug(RIG_DEBUG_TRACE, "%s: cache check age=%dms\n", __func__, cache_ms);
 
-    if (cache_ms < rig->state.cache.timeout_ms)
+    if (cache_ms < rig->state.cache.timeout_ms || rig->state.use_cached_ptt)
     {
+        rig_stats_cache(rig, __func__, 1);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age=%dms\n", __func__, cache_ms);
-        *ptt = rig->state.cache.ptt;
+        *ptt = snap.ptt;
         ELAPSED2;
         RETURNFUNC(RIG_OK);
     }
     else
     {
+        rig_stats_cache(rig, __func__, 0);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache miss age=%dms\n", __func__, cache_ms);
     }
 
@@ -3001,8 +3071,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
+                rig_cache_write_begin(rig);
                 rig->state.cache.ptt = *ptt;
                 elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+                rig_cache_write_end(rig);
             }
 
             ELAPSED2;
@@ -3050,8 +3122,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
             {
                 /* return the first error code */
                 retcode = rc2;
+                rig_cache_write_begin(rig);
                 rig->state.cache.ptt = *ptt;
                 elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+                rig_cache_write_end(rig);
             }
         }
 
@@ -3066,8 +3140,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
+                rig_cache_write_begin(rig);
                 elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
                 rig->state.cache.ptt = *ptt;
+                rig_cache_write_end(rig);
             }
 
             RETURNFUNC(retcode);
@@ -3086,8 +3162,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
             *ptt = status ? RIG_PTT_ON : RIG_PTT_OFF;
         }
 
+        rig_cache_write_begin(rig);
         rig->state.cache.ptt = *ptt;
         elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+        rig_cache_write_end(rig);
         ELAPSED2;
         RETURNFUNC(retcode);
 
@@ -3099,8 +3177,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
+                rig_cache_write_begin(rig);
                 elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
                 rig->state.cache.ptt = *ptt;
+                rig_cache_write_end(rig);
             }
 
             RETURNFUNC(retcode);
@@ -3119,8 +3199,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
             *ptt = status ? RIG_PTT_ON : RIG_PTT_OFF;
         }
 
+        rig_cache_write_begin(rig);
         rig->state.cache.ptt = *ptt;
         elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
+        rig_cache_write_end(rig);
         ELAPSED2;
         RETURNFUNC(retcode);
 
@@ -3132,8 +3214,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
+                rig_cache_write_begin(rig);
                 elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
                 rig->state.cache.ptt = *ptt;
+                rig_cache_write_end(rig);
             }
 
             RETURNFUNC(retcode);
@@ -3143,8 +3227,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
         if (retcode == RIG_OK)
         {
+            rig_cache_write_begin(rig);
             elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
             rig->state.cache.ptt = *ptt;
+            rig_cache_write_end(rig);
         }
 
         ELAPSED2;
@@ -3158,8 +3244,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
+                rig_cache_write_begin(rig);
                 elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
                 rig->state.cache.ptt = *ptt;
+                rig_cache_write_end(rig);
             }
 
             RETURNFUNC(retcode);
@@ -3169,8 +3257,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
         if (retcode == RIG_OK)
         {
+            rig_cache_write_begin(rig);
             elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
             rig->state.cache.ptt = *ptt;
+            rig_cache_write_end(rig);
         }
 
         ELAPSED2;
@@ -3185,8 +3275,10 @@ int HAMLIB_API rig_get_ptt(RIG *rig, vfo_t vfo, ptt_t *ptt)
 
             if (retcode == RIG_OK)
             {
+                rig_cache_write_begin(rig);
                 elapsed_ms(&rig->state.cache.time_ptt, HAMLIB_ELAPSED_SET);
                 rig->state.cache.ptt = *ptt;
+                rig_cache_write_end(rig);
             }
 
             RETURNFUNC(retcode);
@@ -3236,6 +3328,8 @@ int HAMLIB_API rig_get_dcd(RIG *rig, vfo_t vfo, dcd_t *dcd)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     if (!dcd)
     {
         RETURNFUNC(-RIG_EINVAL);
@@ -3626,29 +3720,13 @@ int HAMLIB_API rig_get_rptr_offs(RIG *rig, vfo_t vfo, shortfreq_t *rptr_offs)
 }
 
 
-/**
- * \brief set the split frequencies
- * \param rig   The rig handle
- * \param vfo   The target VFO
- * \param tx_freq   The transmit split frequency to set to
- *
- *  Sets the split(TX) frequency.
- *
- * \return RIG_OK if the operation has been successful, otherwise
- * a negative value if an error occurred (in which case, cause is
- * set appropriately).
- *
- * \sa rig_get_split_freq(), rig_set_split_vfo()
- */
-int HAMLIB_API rig_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
+static int rig_set_split_freq_urgent(RIG *rig, vfo_t vfo, freq_t tx_freq)
 {
     const struct rig_caps *caps;
     int retcode, rc2;
     vfo_t curr_vfo, tx_vfo;
     freq_t tfreq = 0;
 
-    ELAPSED1;
-
     if (CHECK_RIG_ARG(rig))
     {
         RETURNFUNC2(-RIG_EINVAL);
@@ -3687,7 +3765,6 @@ int HAMLIB_API rig_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
     {
         TRACE;
         retcode = caps->set_split_freq(rig, vfo, tx_freq);
-        ELAPSED2;
         RETURNFUNC2(retcode);
     }
 
@@ -3717,7 +3794,6 @@ int HAMLIB_API rig_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
         }
         while (tfreq != tx_freq && retry-- > 0 && retcode == RIG_OK);
 
-        ELAPSED2;
         RETURNFUNC2(retcode);
     }
 
@@ -3786,11 +3862,37 @@ int HAMLIB_API rig_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
         retcode = rc2;
     }
 
-    ELAPSED2;
     RETURNFUNC2(retcode);
 }
 
 
+/**
+ * \brief set the split frequencies
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param tx_freq   The transmit split frequency to set to
+ *
+ *  Sets the split(TX) frequency.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ * \sa rig_get_split_freq(), rig_set_split_vfo()
+ */
+int HAMLIB_API rig_set_split_freq(RIG *rig, vfo_t vfo, freq_t tx_freq)
+{
+    int priority = rig_set_priority(RIG_PRIO_URGENT);
+    int retcode;
+
+    ELAPSED1;
+    retcode = rig_set_split_freq_urgent(rig, vfo, tx_freq);
+
+    rig_set_priority(priority);
+    return retcode;
+}
+
+
 /**
  * \brief get the current split frequencies
  * \param rig   The rig handle
@@ -4038,7 +4140,7 @@ int HAMLIB_API rig_set_split_mode(RIG *rig,
 
     // we will reuse cached mode instead of trying to set mode again
     if ((tx_vfo & (RIG_VFO_A | RIG_VFO_MAIN | RIG_VFO_MAIN_A | RIG_VFO_SUB_A))
-            && (tx_mode == rig->state.cache.modeMainA))
+            && (tx_mode == rig->state.cache_slot[CACHE_SLOT_MAIN_A].mode))
     {
         rig_debug(RIG_DEBUG_VERBOSE, "%s(%d): VFOA mode=%s already set...ignoring\n",
                   __func__, __LINE__, rig_strrmode(tx_mode));
@@ -4046,7 +4148,7 @@ int HAMLIB_API rig_set_split_mode(RIG *rig,
         RETURNFUNC(RIG_OK);
     }
     else if ((tx_vfo & (RIG_VFO_B | RIG_VFO_SUB | RIG_VFO_MAIN_B | RIG_VFO_SUB_B))
-             && (tx_mode == rig->state.cache.modeMainB))
+             && (tx_mode == rig->state.cache_slot[CACHE_SLOT_MAIN_B].mode))
     {
         rig_debug(RIG_DEBUG_VERBOSE, "%s(%d): VFOB mode=%s already set...ignoring\n",
                   __func__, __LINE__, rig_strrmode(tx_mode));
@@ -4447,31 +4549,15 @@ int HAMLIB_API rig_get_split_freq_mode(RIG *rig,
 }
 
 
-/**
- * \brief set the split mode
- * \param rig   The rig handle
- * \param vfo   The target VFO
- * \param split The split mode to set to
- * \param tx_vfo    The transmit VFO
- *
- *  Sets the current split mode.
- *
- * \return RIG_OK if the operation has been successful, otherwise
- * a negative value if an error occurred (in which case, cause is
- * set appropriately).
- *
- * \sa rig_get_split_vfo()
- */
-int HAMLIB_API rig_set_split_vfo(RIG *rig,
-                                 vfo_t rx_vfo,
-                                 split_t split,
-                                 vfo_t tx_vfo)
+static int rig_set_split_vfo_urgent(RIG *rig,
+                                    vfo_t rx_vfo,
+                                    split_t split,
+                                    vfo_t tx_vfo)
 {
     const struct rig_caps *caps;
     int retcode, rc2;
     vfo_t curr_vfo;
 
-    ELAPSED1;
     ENTERFUNC;
     rig_debug(RIG_DEBUG_VERBOSE, "%s: rx_vfo=%s, split=%d, tx_vfo=%s\n", __func__,
               rig_strvfo(rx_vfo), split, rig_strvfo(tx_vfo));
@@ -4491,7 +4577,6 @@ int HAMLIB_API rig_set_split_vfo(RIG *rig,
     if (rig->state.cache.ptt)
     {
         rig_debug(RIG_DEBUG_WARN, "%s: cannot execute when PTT is on\n", __func__);
-        ELAPSED2;
         return RIG_OK;
     }
 
@@ -4550,10 +4635,11 @@ int HAMLIB_API rig_set_split_vfo(RIG *rig,
             rig->state.tx_vfo = tx_vfo;
         }
 
+        rig_cache_write_begin(rig);
         rig->state.cache.split = split;
         rig->state.cache.split_vfo = tx_vfo;
         elapsed_ms(&rig->state.cache.time_split, HAMLIB_ELAPSED_SET);
-        ELAPSED2;
+        rig_cache_write_end(rig);
         RETURNFUNC(retcode);
     }
 
@@ -4595,14 +4681,46 @@ int HAMLIB_API rig_set_split_vfo(RIG *rig,
         rig->state.tx_vfo = tx_vfo;
     }
 
+    rig_cache_write_begin(rig);
     rig->state.cache.split = split;
     rig->state.cache.split_vfo = tx_vfo;
     elapsed_ms(&rig->state.cache.time_split, HAMLIB_ELAPSED_SET);
-    ELAPSED2;
+    rig_cache_write_end(rig);
     RETURNFUNC(retcode);
 }
 
 
+/**
+ * \brief set the split mode
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ * \param split The split mode to set to
+ * \param tx_vfo    The transmit VFO
+ *
+ *  Sets the current split mode.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ * \sa rig_get_split_vfo()
+ */
+int HAMLIB_API rig_set_split_vfo(RIG *rig,
+                                 vfo_t rx_vfo,
+                                 split_t split,
+                                 vfo_t tx_vfo)
+{
+    int priority = rig_set_priority(RIG_PRIO_URGENT);
+    int retcode;
+
+    ELAPSED1;
+    retcode = rig_set_split_vfo_urgent(rig, rx_vfo, split, tx_vfo);
+
+    rig_set_priority(priority);
+    return retcode;
+}
+
+
 /**
  * \brief get the current split mode
  * \param rig   The rig handle
@@ -4632,6 +4750,7 @@ int HAMLIB_API rig_get_split_vfo(RIG *rig,
 #if 0
     vfo_t curr_vfo;
 #endif
+    struct rig_cache_snapshot snap;
     int cache_ms;
 
     ELAPSED1;
@@ -4650,12 +4769,13 @@ int HAMLIB_API rig_get_split_vfo(RIG *rig,
     }
 
     caps = rig->caps;
+    rig_get_cache_snapshot(rig, RIG_VFO_A, &snap);  // only the rig-wide entries are used
 
     if (caps->get_split_vfo == NULL)
     {
         // if we can't get the vfo we will return whatever we have cached
-        *split = rig->state.cache.split;
-        *tx_vfo = rig->state.cache.split_vfo;
+        *split = snap.split;
+        *tx_vfo = snap.split_vfo;
         rig_debug(RIG_DEBUG_VERBOSE,
                   "%s: no get_split_vfo so returning split=%d, tx_vfo=%s\n", __func__, *split,
                   rig_strvfo(*tx_vfo));
@@ -4663,13 +4783,14 @@ int HAMLIB_API rig_get_split_vfo(RIG *rig,
         RETURNFUNC(RIG_OK);
     }
 
-    cache_ms = elapsed_ms(&rig->state.cache.time_split, HAMLIB_ELAPSED_GET);
+    cache_ms = snap.cache_ms_split;
     rig_debug(RIG_DEBUG_TRACE, "%s: cache check age=%dms\n", __func__, cache_ms);
 
     if (cache_ms < rig->state.cache.timeout_ms)
     {
-        *split = rig->state.cache.split;
-        *tx_vfo = rig->state.cache.split_vfo;
+        *split = snap.split;
+        *tx_vfo = snap.split_vfo;
+        rig_stats_cache(rig, __func__, 1);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache hit age=%dms, split=%d, tx_vfo=%s\n",
                   __func__, cache_ms, *split, rig_strvfo(*tx_vfo));
         ELAPSED2;
@@ -4677,6 +4798,7 @@ int HAMLIB_API rig_get_split_vfo(RIG *rig,
     }
     else
     {
+        rig_stats_cache(rig, __func__, 0);
         rig_debug(RIG_DEBUG_TRACE, "%s: cache miss age=%dms\n", __func__, cache_ms);
     }
 
@@ -4692,9 +4814,11 @@ int HAMLIB_API rig_get_split_vfo(RIG *rig,
         {
             // rigctld doesn't like nested calls
             retcode = caps->get_split_vfo(rig, vfo, split, tx_vfo);
+            rig_cache_write_begin(rig);
             rig->state.cache.split = *split;
             rig->state.cache.split_vfo = *tx_vfo;
             elapsed_ms(&rig->state.cache.time_split, HAMLIB_ELAPSED_SET);
+            rig_cache_write_end(rig);
         }
         ELAPSED2;
         RETURNFUNC(retcode);
@@ -4732,9 +4856,11 @@ int HAMLIB_API rig_get_split_vfo(RIG *rig,
 
     if (retcode == RIG_OK)  // only update cache on success
     {
+        rig_cache_write_begin(rig);
         rig->state.cache.split = *split;
         rig->state.cache.split_vfo = *tx_vfo;
         elapsed_ms(&rig->state.cache.time_split, HAMLIB_ELAPSED_SET);
+        rig_cache_write_end(rig);
     }
 
     ELAPSED2;
@@ -4769,6 +4895,8 @@ int HAMLIB_API rig_set_rit(RIG *rig, vfo_t vfo, shortfreq_t rit)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     caps = rig->caps;
 
     if (caps->set_rit == NULL)
@@ -4840,6 +4968,8 @@ int HAMLIB_API rig_get_rit(RIG *rig, vfo_t vfo, shortfreq_t *rit)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     if (!rit)
     {
         RETURNFUNC(-RIG_EINVAL);
@@ -4917,6 +5047,8 @@ int HAMLIB_API rig_set_xit(RIG *rig, vfo_t vfo, shortfreq_t xit)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     caps = rig->caps;
 
     if (caps->set_xit == NULL)
@@ -4988,6 +5120,8 @@ int HAMLIB_API rig_get_xit(RIG *rig, vfo_t vfo, shortfreq_t *xit)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     if (!xit)
     {
         RETURNFUNC(-RIG_EINVAL);
@@ -5065,6 +5199,8 @@ int HAMLIB_API rig_set_ts(RIG *rig, vfo_t vfo, shortfreq_t ts)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     caps = rig->caps;
 
     if (caps->set_ts == NULL)
@@ -5136,6 +5272,8 @@ int HAMLIB_API rig_get_ts(RIG *rig, vfo_t vfo, shortfreq_t *ts)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     if (!ts)
     {
         RETURNFUNC(-RIG_EINVAL);
@@ -5539,6 +5677,8 @@ int HAMLIB_API rig_set_powerstat(RIG *rig, powerstat_t status)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     if (rig->caps->set_powerstat == NULL)
     {
         rig_debug(RIG_DEBUG_WARN, "%s set_powerstat not implemented\n", __func__);
@@ -5576,6 +5716,8 @@ int HAMLIB_API rig_get_powerstat(RIG *rig, powerstat_t *status)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     if (!status)
     {
         RETURNFUNC(-RIG_EINVAL);
@@ -5751,6 +5893,8 @@ int HAMLIB_API rig_vfo_op(RIG *rig, vfo_t vfo, vfo_op_t op)
         RETURNFUNC(-RIG_EINVAL);
     }
 
+    ELAPSED1;
+
     caps = rig->caps;
 
     if (caps->vfo_op == NULL || !rig_has_vfo_op(rig, op))
@@ -6050,21 +6194,7 @@ int HAMLIB_API rig_recv_dtmf(RIG *rig, vfo_t vfo, char *digits, int *length)
 }
 
 
-/**
- * \brief send morse code
- * \param rig   The rig handle
- * \param vfo   The target VFO
- * \param msg   Message to be sent
- *
- *  Sends morse message.
- *  See keyer change speed, etc. (TODO).
- *
- * \return RIG_OK if the operation has been successful, otherwise
- * a negative value if an error occurred (in which case, cause is
- * set appropriately).
- *
- */
-int HAMLIB_API rig_send_morse(RIG *rig, vfo_t vfo, const char *msg)
+static int rig_send_morse_urgent(RIG *rig, vfo_t vfo, const char *msg)
 {
     const struct rig_caps *caps;
     int retcode, rc2;
@@ -6124,19 +6254,34 @@ int HAMLIB_API rig_send_morse(RIG *rig, vfo_t vfo, const char *msg)
     RETURNFUNC(retcode);
 }
 
+
 /**
- * \brief stop morse code
+ * \brief send morse code
  * \param rig   The rig handle
  * \param vfo   The target VFO
+ * \param msg   Message to be sent
  *
- *  Stops the send morse message.
+ *  Sends morse message.
+ *  See keyer change speed, etc. (TODO).
  *
  * \return RIG_OK if the operation has been successful, otherwise
  * a negative value if an error occurred (in which case, cause is
  * set appropriately).
  *
  */
-int HAMLIB_API rig_stop_morse(RIG *rig, vfo_t vfo)
+int HAMLIB_API rig_send_morse(RIG *rig, vfo_t vfo, const char *msg)
+{
+    int priority = rig_set_priority(RIG_PRIO_URGENT);
+    int retcode;
+
+    ELAPSED1;
+    retcode = rig_send_morse_urgent(rig, vfo, msg);
+
+    rig_set_priority(priority);
+    return retcode;
+}
+
+static int rig_stop_morse_urgent(RIG *rig, vfo_t vfo)
 {
     const struct rig_caps *caps;
     int retcode, rc2;
@@ -6190,6 +6335,31 @@ int HAMLIB_API rig_stop_morse(RIG *rig, vfo_t vfo)
     RETURNFUNC(retcode);
 }
 
+
+/**
+ * \brief stop morse code
+ * \param rig   The rig handle
+ * \param vfo   The target VFO
+ *
+ *  Stops the send morse message.
+ *
+ * \return RIG_OK if the operation has been successful, otherwise
+ * a negative value if an error occurred (in which case, cause is
+ * set appropriately).
+ *
+ */
+int HAMLIB_API rig_stop_morse(RIG *rig, vfo_t vfo)
+{
+    int priority = rig_set_priority(RIG_PRIO_URGENT);
+    int retcode;
+
+    ELAPSED1;
+    retcode = rig_stop_morse_urgent(rig, vfo);
+
+    rig_set_priority(priority);
+    return retcode;
+}
+
 /*
  * wait_morse_ptt
  * generic routine to wait for ptt=0
@@ -6620,6 +6790,40 @@ int HAMLIB_API rig_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq,
     //if (vfo == RIG_VFO_CURR) { vfo = rig->state.current_vfo; }
 
     vfo = vfo_fixup(rig, vfo, rig->state.cache.split);
+
+    // backends that can batch commands read everything in one round trip,
+    // unless the cache would answer anyway
+    if (rig->caps->rig_get_vfo_info && rig->state.cache.timeout_ms != HAMLIB_CACHE_ALWAYS
+            && !rig->state.use_cached_freq)
+    {
+        struct rig_cache_snapshot snap;
+
+        retval = rig_get_cache_snapshot(rig, vfo, &snap);
+
+        if (retval != RIG_OK || snap.freq == 0
+                || snap.cache_ms_freq >= rig->state.cache.timeout_ms
+                || snap.cache_ms_mode >= rig->state.cache.timeout_ms)
+        {
+            TRACE;
+            retval = rig->caps->rig_get_vfo_info(rig, vfo, freq, mode, width, split);
+
+            if (retval == RIG_OK)
+            {
+                rig_set_cache_freq(rig, vfo, *freq);
+                rig_set_cache_mode(rig, vfo, *mode, *width);
+                // the split cache is left alone, the batch does not read the tx vfo
+                *satmode = rig->state.cache.satmode;
+                ELAPSED2;
+                RETURNFUNC(RIG_OK);
+            }
+
+            if (retval != -RIG_ENAVAIL && retval != -RIG_ENIMPL) { RETURNFUNC(retval); }
+
+            rig_debug(RIG_DEBUG_TRACE, "%s: no batch for vfo=%s, one get at a time\n",
+                      __func__, rig_strvfo(vfo));
+        }
+    }
+
     // we can't use the cached values as some clients may only call this function
     // like Log4OM which mostly does polling
     TRACE;
@@ -6633,7 +6837,7 @@ int HAMLIB_API rig_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq,
     int allTheTimeB = (vfo & (RIG_VFO_B | RIG_VFO_SUB))
                       && (rig->caps->targetable_vfo & RIG_TARGETABLE_MODE);
     int justOnceB = (vfo & (RIG_VFO_B | RIG_VFO_SUB))
-                    && (rig->state.cache.modeMainB == RIG_MODE_NONE);
+                    && (rig->state.cache_slot[CACHE_SLOT_MAIN_B].mode == RIG_MODE_NONE);
 
     if (allTheTimeA || allTheTimeB || justOnceB)
     {
@@ -6644,8 +6848,14 @@ int HAMLIB_API rig_get_vfo_info(RIG *rig, vfo_t vfo, freq_t *freq,
     }
     else // we'll just us VFOA so we don't swap vfos -- freq is what's important
     {
-        *mode = rig->state.cache.modeMainA;
-        *width = rig->state.cache.widthMainA;
+        struct rig_cache_snapshot snap;
+
+        retval = rig_get_cache_snapshot(rig, RIG_VFO_A, &snap);
+
+        if (retval != RIG_OK) { RETURNFUNC(retval); }
+
+        *mode = snap.mode;
+        *width = snap.width;
     }
 
     *satmode = rig->state.cache.satmode;
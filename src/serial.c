@@ -79,6 +79,8 @@
 #include <hamlib/rig.h>
 #include "serial.h"
 #include "misc.h"
+#include "iofunc.h"
+#include "transaction.h"
 
 #ifdef HAVE_SYS_IOCCOM_H
 #  include <sys/ioccom.h>
@@ -147,6 +149,8 @@ int HAMLIB_API serial_open(hamlib_port_t *rp)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s: %s\n", __func__, rp->pathname);
 
+    port_rx_discard(rp);
+
     if (!strncmp(rp->pathname, "uh-rig", 6))
     {
         /*
@@ -647,6 +651,9 @@ int HAMLIB_API serial_flush(hamlib_port_t *p)
     int timeout_save;
     unsigned char buf[4096];
 
+    /* what the writer thread still has to send is not flushed */
+    port_tx_drain(p);
+
     if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd || p->flushx)
     {
         /*
@@ -658,6 +665,8 @@ int HAMLIB_API serial_flush(hamlib_port_t *p)
 
         rig_debug(RIG_DEBUG_TRACE, "%s: flushing\n", __func__);
 
+        port_rx_discard(p);
+
         while ((n = read(p->fd, buf, sizeof(buf))) > 0)
         {
             nbytes += n;
@@ -791,6 +800,9 @@ int ser_close(hamlib_port_t *p)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
+    port_transaction_stop(p);
+    port_tx_stop(p);
+
     /*
      * For microHam devices, do not close the
      * socket via close but call a service routine
@@ -901,6 +913,9 @@ int HAMLIB_API ser_set_rts(hamlib_port_t *p, int state)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s: RTS=%d\n", __func__, state);
 
+    /* the line changes after the bytes written before */
+    port_tx_drain(p);
+
     // ignore this for microHam ports
     if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd)
     {
@@ -977,6 +992,8 @@ int HAMLIB_API ser_set_dtr(hamlib_port_t *p, int state)
 
     rig_debug(RIG_DEBUG_VERBOSE, "%s: DTR=%d\n", __func__, state);
 
+    port_tx_drain(p);
+
     // silently ignore on microHam RADIO channel,
     // but (un)set ptt on microHam PTT channel.
     if (p->fd == uh_radio_fd)
@@ -1061,6 +1078,8 @@ int HAMLIB_API ser_get_dtr(hamlib_port_t *p, int *state)
  */
 int HAMLIB_API ser_set_brk(hamlib_port_t *p, int state)
 {
+    port_tx_drain(p);
+
     // ignore this for microHam ports
     if (p->fd == uh_ptt_fd || p->fd == uh_radio_fd)
     {
@@ -40,6 +40,9 @@
 
 #include <hamlib/rig.h>
 #include "cal.h"
+#include "cache.h"
+#include "misc.h"
+#include "stats.h"
 
 
 #ifndef DOC_HIDDEN
@@ -79,6 +82,8 @@ int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
         return -RIG_EINVAL;
     }
 
+    ELAPSED1;
+
     caps = rig->caps;
 
     if (caps->set_level == NULL || !rig_has_set_level(rig, level))
@@ -90,7 +95,14 @@ int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
-        return caps->set_level(rig, vfo, level, val);
+        retcode = caps->set_level(rig, vfo, level, val);
+
+        if (retcode == RIG_OK)
+        {
+            rig_invalidate_cache_setting(rig, HAMLIB_CACHE_LEVEL, level);
+        }
+
+        return retcode;
     }
 
     if (!caps->set_vfo)
@@ -108,6 +120,12 @@ int HAMLIB_API rig_set_level(RIG *rig, vfo_t vfo, setting_t level, value_t val)
 
     retcode = caps->set_level(rig, vfo, level, val);
     caps->set_vfo(rig, curr_vfo);
+
+    if (retcode == RIG_OK)
+    {
+        rig_invalidate_cache_setting(rig, HAMLIB_CACHE_LEVEL, level);
+    }
+
     return retcode;
 }
 
@@ -150,6 +168,8 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
         return -RIG_EINVAL;
     }
 
+    ELAPSED1;
+
     caps = rig->caps;
 
     if (caps->get_level == NULL || !rig_has_get_level(rig, level))
@@ -157,6 +177,14 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
         return -RIG_ENAVAIL;
     }
 
+    if (rig_get_cache_setting(rig, HAMLIB_CACHE_LEVEL, vfo, level, val) == RIG_OK)
+    {
+        rig_stats_cache(rig, __func__, 1);
+        return RIG_OK;
+    }
+
+    rig_stats_cache(rig, __func__, 0);
+
     /*
      * Special case(frontend emulation): calibrated S-meter reading
      */
@@ -185,7 +213,14 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
             || vfo == rig->state.current_vfo)
     {
 
-        return caps->get_level(rig, vfo, level, val);
+        retcode = caps->get_level(rig, vfo, level, val);
+
+        if (retcode == RIG_OK)
+        {
+            rig_set_cache_setting(rig, HAMLIB_CACHE_LEVEL, vfo, level, *val);
+        }
+
+        return retcode;
     }
 
     if (!caps->set_vfo)
@@ -203,6 +238,12 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
 
     retcode = caps->get_level(rig, vfo, level, val);
     caps->set_vfo(rig, curr_vfo);
+
+    if (retcode == RIG_OK)
+    {
+        rig_set_cache_setting(rig, HAMLIB_CACHE_LEVEL, vfo, level, *val);
+    }
+
     return retcode;
 }
 
@@ -225,6 +266,8 @@ int HAMLIB_API rig_get_level(RIG *rig, vfo_t vfo, setting_t level, value_t *val)
  */
 int HAMLIB_API rig_set_parm(RIG *rig, setting_t parm, value_t val)
 {
+    int retcode;
+
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_RIG_ARG(rig))
@@ -232,12 +275,21 @@ int HAMLIB_API rig_set_parm(RIG *rig, setting_t parm, value_t val)
         return -RIG_EINVAL;
     }
 
+    ELAPSED1;
+
     if (rig->caps->set_parm == NULL || !rig_has_set_parm(rig, parm))
     {
         return -RIG_ENAVAIL;
     }
 
-    return rig->caps->set_parm(rig, parm, val);
+    retcode = rig->caps->set_parm(rig, parm, val);
+
+    if (retcode == RIG_OK)
+    {
+        rig_invalidate_cache_setting(rig, HAMLIB_CACHE_PARM, parm);
+    }
+
+    return retcode;
 }
 
 
@@ -259,6 +311,8 @@ int HAMLIB_API rig_set_parm(RIG *rig, setting_t parm, value_t val)
  */
 int HAMLIB_API rig_get_parm(RIG *rig, setting_t parm, value_t *val)
 {
+    int retcode;
+
     rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
 
     if (CHECK_RIG_ARG(rig) || !val)
@@ -266,12 +320,30 @@ int HAMLIB_API rig_get_parm(RIG *rig, setting_t parm, value_t *val)
         return -RIG_EINVAL;
     }
 
+    ELAPSED1;
+
     if (rig->caps->get_parm == NULL || !rig_has_get_parm(rig, parm))
     {
         return -RIG_ENAVAIL;
     }
 
-    return rig->caps->get_parm(rig, parm, val);
+    if (rig_get_cache_setting(rig, HAMLIB_CACHE_PARM, RIG_VFO_NONE, parm,
+                              val) == RIG_OK)
+    {
+        rig_stats_cache(rig, __func__, 1);
+        return RIG_OK;
+    }
+
+    rig_stats_cache(rig, __func__, 0);
+
+    retcode = rig->caps->get_parm(rig, parm, val);
+
+    if (retcode == RIG_OK)
+    {
+        rig_set_cache_setting(rig, HAMLIB_CACHE_PARM, RIG_VFO_NONE, parm, *val);
+    }
+
+    return retcode;
 }
 
 
@@ -483,6 +555,8 @@ int HAMLIB_API rig_set_func(RIG *rig, vfo_t vfo, setting_t func, int status)
         return -RIG_EINVAL;
     }
 
+    ELAPSED1;
+
     caps = rig->caps;
 
     if (caps->set_func == NULL || !rig_has_set_func(rig, func))
@@ -495,7 +569,14 @@ int HAMLIB_API rig_set_func(RIG *rig, vfo_t vfo, setting_t func, int status)
             || vfo == rig->state.current_vfo)
     {
 
-        return caps->set_func(rig, vfo, func, status);
+        retcode = caps->set_func(rig, vfo, func, status);
+
+        if (retcode == RIG_OK)
+        {
+            rig_invalidate_cache_setting(rig, HAMLIB_CACHE_FUNC, func);
+        }
+
+        return retcode;
     }
     else
     {
@@ -520,6 +601,11 @@ int HAMLIB_API rig_set_func(RIG *rig, vfo_t vfo, setting_t func, int status)
     retcode = caps->set_func(rig, vfo, func, status);
     caps->set_vfo(rig, curr_vfo);
 
+    if (retcode == RIG_OK)
+    {
+        rig_invalidate_cache_setting(rig, HAMLIB_CACHE_FUNC, func);
+    }
+
     return retcode;
 }
 
@@ -548,6 +634,7 @@ int HAMLIB_API rig_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status)
     const struct rig_caps *caps;
     int retcode;
     vfo_t curr_vfo;
+    value_t cached;
 
     // too verbose
     //rig_debug(RIG_DEBUG_VERBOSE, "%s called\n", __func__);
@@ -557,6 +644,8 @@ int HAMLIB_API rig_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status)
         return -RIG_EINVAL;
     }
 
+    ELAPSED1;
+
     caps = rig->caps;
 
     if (caps->get_func == NULL || !rig_has_get_func(rig, func))
@@ -564,12 +653,30 @@ int HAMLIB_API rig_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status)
         return -RIG_ENAVAIL;
     }
 
+    if (rig_get_cache_setting(rig, HAMLIB_CACHE_FUNC, vfo, func,
+                              &cached) == RIG_OK)
+    {
+        *status = cached.i;
+        rig_stats_cache(rig, __func__, 1);
+        return RIG_OK;
+    }
+
+    rig_stats_cache(rig, __func__, 0);
+
     if ((caps->targetable_vfo & RIG_TARGETABLE_FUNC)
             || vfo == RIG_VFO_CURR
             || vfo == rig->state.current_vfo)
     {
 
-        return caps->get_func(rig, vfo, func, status);
+        retcode = caps->get_func(rig, vfo, func, status);
+
+        if (retcode == RIG_OK)
+        {
+            cached.i = *status;
+            rig_set_cache_setting(rig, HAMLIB_CACHE_FUNC, vfo, func, cached);
+        }
+
+        return retcode;
     }
 
     if (!caps->set_vfo)
@@ -588,6 +695,12 @@ int HAMLIB_API rig_get_func(RIG *rig, vfo_t vfo, setting_t func, int *status)
     retcode = caps->get_func(rig, vfo, func, status);
     caps->set_vfo(rig, curr_vfo);
 
+    if (retcode == RIG_OK)
+    {
+        cached.i = *status;
+        rig_set_cache_setting(rig, HAMLIB_CACHE_FUNC, vfo, func, cached);
+    }
+
     return retcode;
 }
 
@@ -1,7 +1,11 @@
 #include <hamlib/config.h>
 
+#include <stdint.h>
+#include <string.h>
+
 #include <hamlib/rig.h>
 #include "misc.h"
+#include "cache.h"
 #include "snapshot_data.h"
 #include "hamlibdatetime.h"
 
@@ -12,9 +16,70 @@
 #define SPECTRUM_MODE_FIXED "FIXED"
 #define SPECTRUM_MODE_CENTER "CENTER"
 
+/*
+ * Binary snapshot format, all values little endian:
+ *
+ *   header  'H' 'L' version flags  seq(u32)  payload length(u16)  0(u16)
+ *   payload TLV fields: type(u8) length(u16) value
+ *
+ * Fields of a VFO follow its SNAPSHOT_TLV_VFO field.  Decoders skip
+ * unknown field types, so fields may be added without a version bump.
+ * A keyframe carries every field, a delta only those that changed since
+ * the previous packet.
+ */
+#define SNAPSHOT_MAGIC0 'H'
+#define SNAPSHOT_MAGIC1 'L'
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_SIZE 12
+#define SNAPSHOT_TLV_HEADER_SIZE 3
+
+#define SNAPSHOT_FLAG_SPECTRUM 0x01
+#define SNAPSHOT_FLAG_KEYFRAME 0x02     /* full state, otherwise changes only */
+
+#define SNAPSHOT_TLV_MODEL          0x01    /* u32 rig model */
+#define SNAPSHOT_TLV_NAME           0x02    /* model name, not terminated */
+#define SNAPSHOT_TLV_STATUS         0x03    /* u8 port open */
+#define SNAPSHOT_TLV_SPLIT          0x04    /* u8 split */
+#define SNAPSHOT_TLV_SPLIT_VFO      0x05    /* u32 split vfo */
+#define SNAPSHOT_TLV_SATMODE        0x06    /* u8 satmode */
+#define SNAPSHOT_TLV_VFO            0x10    /* u32 vfo, u8 SNAPSHOT_VFO_* flags */
+#define SNAPSHOT_TLV_VFO_FREQ       0x11    /* f64 freq */
+#define SNAPSHOT_TLV_VFO_MODE       0x12    /* u64 mode */
+#define SNAPSHOT_TLV_VFO_WIDTH      0x13    /* i32 width */
+#define SNAPSHOT_TLV_SPECTRUM       0x20    /* spectrum line parameters */
+#define SNAPSHOT_TLV_SPECTRUM_DATA  0x21    /* raw spectrum bytes */
+
+#define SNAPSHOT_VFO_CACHED 0x01
+#define SNAPSHOT_VFO_PTT    0x02
+#define SNAPSHOT_VFO_RX     0x04
+#define SNAPSHOT_VFO_TX     0x08
+
+#define SNAPSHOT_SPECTRUM_SIZE (4 + 1 + 4 + 4 + 6 * 8)
+
+struct snapshot_writer
+{
+    unsigned char *buffer;
+    size_t size;
+    size_t length;
+    int overflow;
+};
+
 static int snapshot_serialize_rig(cJSON *rig_node, RIG *rig)
 {
     cJSON *node;
+    split_t split;
+    vfo_t split_vfo;
+    int satmode;
+    unsigned int seq;
+
+    do
+    {
+        seq = rig_cache_read_begin(rig);
+        split = rig->state.cache.split;
+        split_vfo = rig->state.cache.split_vfo;
+        satmode = rig->state.cache.satmode;
+    }
+    while (rig_cache_read_retry(rig, seq));
 
     // TODO: need to assign rig an ID, e.g. from command line
     node = cJSON_AddStringToObject(rig_node, "id", "rig_id");
@@ -49,7 +114,7 @@ static int snapshot_serialize_rig(cJSON *rig_node, RIG *rig)
     }
 
     node = cJSON_AddBoolToObject(rig_node, "split",
-                                 rig->state.cache.split == RIG_SPLIT_ON ? 1 : 0);
+                                 split == RIG_SPLIT_ON ? 1 : 0);
 
     if (node == NULL)
     {
@@ -57,7 +122,7 @@ static int snapshot_serialize_rig(cJSON *rig_node, RIG *rig)
     }
 
     node = cJSON_AddStringToObject(rig_node, "splitVfo",
-                                   rig_strvfo(rig->state.cache.split_vfo));
+                                   rig_strvfo(split_vfo));
 
     if (node == NULL)
     {
@@ -65,7 +130,7 @@ static int snapshot_serialize_rig(cJSON *rig_node, RIG *rig)
     }
 
     node = cJSON_AddBoolToObject(rig_node, "satMode",
-                                 rig->state.cache.satmode ? 1 : 0);
+                                 satmode ? 1 : 0);
 
     if (node == NULL)
     {
@@ -80,13 +145,7 @@ error:
 
 static int snapshot_serialize_vfo(cJSON *vfo_node, RIG *rig, vfo_t vfo)
 {
-    freq_t freq;
-    int freq_ms, mode_ms, width_ms;
-    rmode_t mode;
-    pbwidth_t width;
-    ptt_t ptt;
-    split_t split;
-    vfo_t split_vfo;
+    struct rig_cache_snapshot snap;
     int result;
     int is_rx, is_tx;
     cJSON *node;
@@ -100,26 +159,26 @@ static int snapshot_serialize_vfo(cJSON *vfo_node, RIG *rig, vfo_t vfo)
         goto error;
     }
 
-    result = rig_get_cache(rig, vfo, &freq, &freq_ms, &mode, &mode_ms, &width,
-                           &width_ms);
+    // one consistent read so freq, mode, width and split always match
+    result = rig_get_cache_snapshot(rig, vfo, &snap);
 
     if (result == RIG_OK)
     {
-        node = cJSON_AddNumberToObject(vfo_node, "freq", freq);
+        node = cJSON_AddNumberToObject(vfo_node, "freq", snap.freq);
 
         if (node == NULL)
         {
             goto error;
         }
 
-        node = cJSON_AddStringToObject(vfo_node, "mode", rig_strrmode(mode));
+        node = cJSON_AddStringToObject(vfo_node, "mode", rig_strrmode(snap.mode));
 
         if (node == NULL)
         {
             goto error;
         }
 
-        node = cJSON_AddNumberToObject(vfo_node, "width", (double) width);
+        node = cJSON_AddNumberToObject(vfo_node, "width", (double) snap.width);
 
         if (node == NULL)
         {
@@ -127,19 +186,22 @@ static int snapshot_serialize_vfo(cJSON *vfo_node, RIG *rig, vfo_t vfo)
         }
     }
 
-    ptt = rig->state.cache.ptt;
-    node = cJSON_AddBoolToObject(vfo_node, "ptt", ptt == RIG_PTT_OFF ? 0 : 1);
+    else
+    {
+        snap.ptt = rig->state.cache.ptt;
+        snap.split = rig->state.cache.split;
+        snap.split_vfo = rig->state.cache.split_vfo;
+    }
+
+    node = cJSON_AddBoolToObject(vfo_node, "ptt", snap.ptt == RIG_PTT_OFF ? 0 : 1);
 
     if (node == NULL)
     {
         goto error;
     }
 
-    split = rig->state.cache.split;
-    split_vfo = rig->state.cache.split_vfo;
-
-    is_rx = (split == RIG_SPLIT_OFF && vfo == rig->state.current_vfo)
-            || (split == RIG_SPLIT_ON && vfo != split_vfo);
+    is_rx = (snap.split == RIG_SPLIT_OFF && vfo == rig->state.current_vfo)
+            || (snap.split == RIG_SPLIT_ON && vfo != snap.split_vfo);
     node = cJSON_AddBoolToObject(vfo_node, "rx", is_rx);
 
     if (node == NULL)
@@ -147,8 +209,8 @@ static int snapshot_serialize_vfo(cJSON *vfo_node, RIG *rig, vfo_t vfo)
         goto error;
     }
 
-    is_tx = (split == RIG_SPLIT_OFF && vfo == rig->state.current_vfo)
-            || (split == RIG_SPLIT_ON && vfo == split_vfo);
+    is_tx = (snap.split == RIG_SPLIT_OFF && vfo == rig->state.current_vfo)
+            || (snap.split == RIG_SPLIT_ON && vfo == snap.split_vfo);
     node = cJSON_AddBoolToObject(vfo_node, "tx", is_tx);
 
     if (node == NULL)
@@ -424,3 +486,568 @@ error:
     cJSON_Delete(root_node);
     RETURNFUNC2(-RIG_EINTERNAL);
 }
+
+
+static unsigned char *snapshot_put(struct snapshot_writer *w, size_t n)
+{
+    unsigned char *p;
+
+    if (w->overflow || w->size - w->length < n)
+    {
+        w->overflow = 1;
+        return NULL;
+    }
+
+    p = w->buffer + w->length;
+    w->length += n;
+
+    return p;
+}
+
+static void snapshot_put_u8(struct snapshot_writer *w, uint8_t v)
+{
+    unsigned char *p = snapshot_put(w, 1);
+
+    if (p) { p[0] = v; }
+}
+
+static void snapshot_put_u16(struct snapshot_writer *w, uint16_t v)
+{
+    unsigned char *p = snapshot_put(w, 2);
+
+    if (p)
+    {
+        p[0] = v & 0xff;
+        p[1] = v >> 8;
+    }
+}
+
+static void snapshot_put_u32(struct snapshot_writer *w, uint32_t v)
+{
+    unsigned char *p = snapshot_put(w, 4);
+    int i;
+
+    for (i = 0; p && i < 4; i++, v >>= 8)
+    {
+        p[i] = v & 0xff;
+    }
+}
+
+static void snapshot_put_u64(struct snapshot_writer *w, uint64_t v)
+{
+    unsigned char *p = snapshot_put(w, 8);
+    int i;
+
+    for (i = 0; p && i < 8; i++, v >>= 8)
+    {
+        p[i] = v & 0xff;
+    }
+}
+
+static void snapshot_put_double(struct snapshot_writer *w, double d)
+{
+    uint64_t v;
+
+    memcpy(&v, &d, sizeof(v));
+    snapshot_put_u64(w, v);
+}
+
+static void snapshot_put_tlv(struct snapshot_writer *w, uint8_t type,
+                             uint16_t length)
+{
+    snapshot_put_u8(w, type);
+    snapshot_put_u16(w, length);
+}
+
+static void snapshot_put_bytes(struct snapshot_writer *w, uint8_t type,
+                               const void *data, size_t length)
+{
+    unsigned char *p;
+
+    if (length > 0xffff)
+    {
+        w->overflow = 1;
+        return;
+    }
+
+    snapshot_put_tlv(w, type, length);
+    p = snapshot_put(w, length);
+
+    if (p) { memcpy(p, data, length); }
+}
+
+static void snapshot_write_rig(struct snapshot_writer *w, RIG *rig,
+                               struct snapshot_binary_state *state, int keyframe)
+{
+    const char *name = rig->caps->model_name;
+    int status = rig->state.comm_state ? 1 : 0;
+    split_t split;
+    vfo_t split_vfo;
+    int satmode;
+    unsigned int seq;
+
+    do
+    {
+        seq = rig_cache_read_begin(rig);
+        split = rig->state.cache.split;
+        split_vfo = rig->state.cache.split_vfo;
+        satmode = rig->state.cache.satmode ? 1 : 0;
+    }
+    while (rig_cache_read_retry(rig, seq));
+
+    split = split == RIG_SPLIT_ON ? RIG_SPLIT_ON : RIG_SPLIT_OFF;
+
+    if (keyframe)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_MODEL, 4);
+        snapshot_put_u32(w, rig->caps->rig_model);
+        snapshot_put_bytes(w, SNAPSHOT_TLV_NAME, name, strlen(name));
+    }
+
+    if (keyframe || status != state->status)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_STATUS, 1);
+        snapshot_put_u8(w, status);
+    }
+
+    if (keyframe || split != state->split)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_SPLIT, 1);
+        snapshot_put_u8(w, split == RIG_SPLIT_ON ? 1 : 0);
+    }
+
+    if (keyframe || split_vfo != state->split_vfo)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_SPLIT_VFO, 4);
+        snapshot_put_u32(w, split_vfo);
+    }
+
+    if (keyframe || satmode != state->satmode)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_SATMODE, 1);
+        snapshot_put_u8(w, satmode);
+    }
+
+    state->status = status;
+    state->split = split;
+    state->split_vfo = split_vfo;
+    state->satmode = satmode;
+}
+
+static void snapshot_write_vfo(struct snapshot_writer *w, RIG *rig, vfo_t vfo,
+                               struct snapshot_binary_vfo *last, int keyframe)
+{
+    struct rig_cache_snapshot snap;
+    uint8_t flags = 0;
+    int cached;
+    int freq_changed, mode_changed, width_changed;
+
+    cached = rig_get_cache_snapshot(rig, vfo, &snap) == RIG_OK;
+
+    if (!cached)
+    {
+        snap.ptt = rig->state.cache.ptt;
+        snap.split = rig->state.cache.split;
+        snap.split_vfo = rig->state.cache.split_vfo;
+    }
+
+    if (cached) { flags |= SNAPSHOT_VFO_CACHED; }
+
+    if (snap.ptt != RIG_PTT_OFF) { flags |= SNAPSHOT_VFO_PTT; }
+
+    if ((snap.split == RIG_SPLIT_OFF && vfo == rig->state.current_vfo)
+            || (snap.split == RIG_SPLIT_ON && vfo != snap.split_vfo))
+    {
+        flags |= SNAPSHOT_VFO_RX;
+    }
+
+    if ((snap.split == RIG_SPLIT_OFF && vfo == rig->state.current_vfo)
+            || (snap.split == RIG_SPLIT_ON && vfo == snap.split_vfo))
+    {
+        flags |= SNAPSHOT_VFO_TX;
+    }
+
+    freq_changed = cached && (keyframe || snap.freq != last->freq);
+    mode_changed = cached && (keyframe || snap.mode != last->mode);
+    width_changed = cached && (keyframe || snap.width != last->width);
+
+    /* a delta leaves out VFOs that did not change at all */
+    if (keyframe || flags != last->flags
+            || freq_changed || mode_changed || width_changed)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_VFO, 5);
+        snapshot_put_u32(w, vfo);
+        snapshot_put_u8(w, flags);
+    }
+
+    if (freq_changed)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_VFO_FREQ, 8);
+        snapshot_put_double(w, snap.freq);
+        last->freq = snap.freq;
+    }
+
+    if (mode_changed)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_VFO_MODE, 8);
+        snapshot_put_u64(w, snap.mode);
+        last->mode = snap.mode;
+    }
+
+    if (width_changed)
+    {
+        snapshot_put_tlv(w, SNAPSHOT_TLV_VFO_WIDTH, 4);
+        snapshot_put_u32(w, (uint32_t)(int32_t) snap.width);
+        last->width = snap.width;
+    }
+
+    last->flags = flags;
+}
+
+static void snapshot_write_spectrum(struct snapshot_writer *w,
+                                    const struct rig_spectrum_line *line)
+{
+    snapshot_put_tlv(w, SNAPSHOT_TLV_SPECTRUM, SNAPSHOT_SPECTRUM_SIZE);
+    snapshot_put_u32(w, (uint32_t) line->id);
+    snapshot_put_u8(w, line->spectrum_mode);
+    snapshot_put_u32(w, (uint32_t) line->data_level_min);
+    snapshot_put_u32(w, (uint32_t) line->data_level_max);
+    snapshot_put_double(w, line->signal_strength_min);
+    snapshot_put_double(w, line->signal_strength_max);
+    snapshot_put_double(w, line->center_freq);
+    snapshot_put_double(w, line->span_freq);
+    snapshot_put_double(w, line->low_edge_freq);
+    snapshot_put_double(w, line->high_edge_freq);
+    snapshot_put_bytes(w, SNAPSHOT_TLV_SPECTRUM_DATA, line->spectrum_data,
+                       line->spectrum_data_length);
+}
+
+/*
+ * Binary counterpart of snapshot_serialize(): writes the snapshot straight
+ * into buffer without allocating any memory and returns the packet size in
+ * *length.  See rig_snapshot_decode() for the receiving side.
+ *
+ * With a state, only what changed since the previous packet is sent, and
+ * a full keyframe goes out every state->keyframe_interval_ms (or every
+ * packet if that is 0).  A delta without any change and without spectrum
+ * data is not worth a packet: *length is then 0 and the sequence number
+ * is not used up.
+ */
+int snapshot_serialize_binary(size_t buffer_length, unsigned char *buffer,
+                              size_t *length, RIG *rig,
+                              struct rig_spectrum_line *spectrum_line,
+                              struct snapshot_binary_state *state)
+{
+    struct snapshot_binary_state scratch;
+    struct snapshot_writer w;
+    size_t payload_length;
+    int keyframe = 1;
+    uint8_t flags = 0;
+
+    if (state == NULL)
+    {
+        memset(&scratch, 0, sizeof(scratch));
+        state = &scratch;
+    }
+    else if (state->valid && state->keyframe_interval_ms > 0
+             && elapsed_ms(&state->keyframe_time, HAMLIB_ELAPSED_GET)
+             < state->keyframe_interval_ms)
+    {
+        keyframe = 0;
+    }
+
+    if (keyframe) { flags |= SNAPSHOT_FLAG_KEYFRAME; }
+
+    if (spectrum_line) { flags |= SNAPSHOT_FLAG_SPECTRUM; }
+
+    w.buffer = buffer;
+    w.size = buffer_length;
+    w.length = 0;
+    w.overflow = 0;
+
+    snapshot_put_u8(&w, SNAPSHOT_MAGIC0);
+    snapshot_put_u8(&w, SNAPSHOT_MAGIC1);
+    snapshot_put_u8(&w, SNAPSHOT_VERSION);
+    snapshot_put_u8(&w, flags);
+    snapshot_put_u32(&w, rig->state.snapshot_packet_sequence_number);
+    snapshot_put_u16(&w, 0);    /* payload length, filled in below */
+    snapshot_put_u16(&w, 0);
+
+    snapshot_write_rig(&w, rig, state, keyframe);
+    snapshot_write_vfo(&w, rig, RIG_VFO_A, &state->vfos[0], keyframe);
+    snapshot_write_vfo(&w, rig, RIG_VFO_B, &state->vfos[1], keyframe);
+
+    if (spectrum_line != NULL)
+    {
+        snapshot_write_spectrum(&w, spectrum_line);
+    }
+
+    payload_length = w.length - SNAPSHOT_HEADER_SIZE;
+
+    if (w.overflow || payload_length > 0xffff)
+    {
+        /* the receivers must not miss what was not sent */
+        state->valid = 0;
+        RETURNFUNC2(-RIG_EINVAL);
+    }
+
+    if (keyframe)
+    {
+        state->valid = 1;
+        elapsed_ms(&state->keyframe_time, HAMLIB_ELAPSED_SET);
+    }
+    else if (payload_length == 0)
+    {
+        *length = 0;
+        return RIG_OK;
+    }
+
+    buffer[8] = payload_length & 0xff;
+    buffer[9] = payload_length >> 8;
+    *length = w.length;
+
+    rig->state.snapshot_packet_sequence_number++;
+
+    RETURNFUNC2(RIG_OK);
+}
+
+static uint16_t snapshot_get_u16(const unsigned char *p)
+{
+    return p[0] | (uint16_t) p[1] << 8;
+}
+
+static uint32_t snapshot_get_u32(const unsigned char *p)
+{
+    return p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16
+           | (uint32_t) p[3] << 24;
+}
+
+static uint64_t snapshot_get_u64(const unsigned char *p)
+{
+    return snapshot_get_u32(p) | (uint64_t) snapshot_get_u32(p + 4) << 32;
+}
+
+static double snapshot_get_double(const unsigned char *p)
+{
+    uint64_t v = snapshot_get_u64(p);
+    double d;
+
+    memcpy(&d, &v, sizeof(d));
+
+    return d;
+}
+
+/* find the entry of vfo, or add one */
+static struct rig_snapshot_vfo *snapshot_find_vfo(struct rig_snapshot *snapshot,
+        vfo_t vfo)
+{
+    int i;
+
+    for (i = 0; i < snapshot->vfo_count; i++)
+    {
+        if (snapshot->vfos[i].vfo == vfo)
+        {
+            return &snapshot->vfos[i];
+        }
+    }
+
+    if (snapshot->vfo_count == HAMLIB_SNAPSHOT_MAX_VFOS)
+    {
+        return NULL;
+    }
+
+    snapshot->vfos[snapshot->vfo_count].vfo = vfo;
+
+    return &snapshot->vfos[snapshot->vfo_count++];
+}
+
+/**
+ * \brief Decode a binary multicast snapshot packet
+ * \param buffer The received packet
+ * \param length The packet size in bytes
+ * \param snapshot The decoded snapshot
+ *
+ * Decodes a packet sent by the multicast publisher with the
+ * multicast_format=BINARY configuration, without allocating any memory.
+ * Unknown fields are skipped.  A spectrum line is not copied,
+ * snapshot->spectrum.spectrum_data points into buffer.
+ *
+ * A keyframe replaces the whole snapshot, a delta packet only updates the
+ * fields it carries, so the same snapshot, zeroed before the first packet,
+ * must be passed for every packet of a publisher.  Gaps in the sequence
+ * numbers are added to snapshot->lost and clear snapshot->synced until the
+ * next keyframe.
+ *
+ * \return RIG_OK if the packet was decoded, -RIG_EPROTO if it is not a
+ * valid binary snapshot.
+ */
+int HAMLIB_API rig_snapshot_decode(const unsigned char *buffer, size_t length,
+                                   struct rig_snapshot *snapshot)
+{
+    const unsigned char *p, *end;
+    struct rig_snapshot_vfo *vfo = NULL;
+    unsigned int seq, gap;
+
+    if (!buffer || !snapshot || length < SNAPSHOT_HEADER_SIZE
+            || buffer[0] != SNAPSHOT_MAGIC0 || buffer[1] != SNAPSHOT_MAGIC1
+            || buffer[2] != SNAPSHOT_VERSION)
+    {
+        return -RIG_EPROTO;
+    }
+
+    if (SNAPSHOT_HEADER_SIZE + (size_t) snapshot_get_u16(buffer + 8) > length)
+    {
+        return -RIG_EPROTO;
+    }
+
+    p = buffer + SNAPSHOT_HEADER_SIZE;
+    end = p + snapshot_get_u16(buffer + 8);
+
+    /* check the TLV chain first, a delta must be applied entirely or not */
+    while (p < end)
+    {
+        if (end - p < SNAPSHOT_TLV_HEADER_SIZE
+                || end - p - SNAPSHOT_TLV_HEADER_SIZE < snapshot_get_u16(p + 1))
+        {
+            return -RIG_EPROTO;
+        }
+
+        p += SNAPSHOT_TLV_HEADER_SIZE + snapshot_get_u16(p + 1);
+    }
+
+    seq = snapshot_get_u32(buffer + 4);
+    gap = seq - snapshot->seq - 1;
+
+    if (snapshot->packets > 0 && gap != 0)
+    {
+        /* a huge gap is a late or repeated packet rather than a loss */
+        if (gap < 0x80000000U) { snapshot->lost += gap; }
+
+        snapshot->synced = 0;
+    }
+
+    if (buffer[3] & SNAPSHOT_FLAG_KEYFRAME)
+    {
+        unsigned int packets = snapshot->packets;
+        unsigned int lost = snapshot->lost;
+
+        memset(snapshot, 0, sizeof(*snapshot));
+        snapshot->packets = packets;
+        snapshot->lost = lost;
+        snapshot->synced = 1;
+    }
+
+    snapshot->seq = seq;
+    snapshot->packets++;
+    snapshot->keyframe = (buffer[3] & SNAPSHOT_FLAG_KEYFRAME) ? 1 : 0;
+    snapshot->has_spectrum = 0;
+    memset(&snapshot->spectrum, 0, sizeof(snapshot->spectrum));
+
+    p = buffer + SNAPSHOT_HEADER_SIZE;
+
+    while (p < end)
+    {
+        uint8_t type;
+        uint16_t len;
+
+        type = p[0];
+        len = snapshot_get_u16(p + 1);
+        p += SNAPSHOT_TLV_HEADER_SIZE;
+
+        switch (type)
+        {
+        case SNAPSHOT_TLV_MODEL:
+            if (len >= 4) { snapshot->model = snapshot_get_u32(p); }
+
+            break;
+
+        case SNAPSHOT_TLV_NAME:
+        {
+            size_t n = len < sizeof(snapshot->name) ? len : sizeof(snapshot->name) - 1;
+            memcpy(snapshot->name, p, n);
+            snapshot->name[n] = '\0';
+            break;
+        }
+
+        case SNAPSHOT_TLV_STATUS:
+            if (len >= 1) { snapshot->status = p[0]; }
+
+            break;
+
+        case SNAPSHOT_TLV_SPLIT:
+            if (len >= 1) { snapshot->split = p[0] ? RIG_SPLIT_ON : RIG_SPLIT_OFF; }
+
+            break;
+
+        case SNAPSHOT_TLV_SPLIT_VFO:
+            if (len >= 4) { snapshot->split_vfo = snapshot_get_u32(p); }
+
+            break;
+
+        case SNAPSHOT_TLV_SATMODE:
+            if (len >= 1) { snapshot->satmode = p[0]; }
+
+            break;
+
+        case SNAPSHOT_TLV_VFO:
+            vfo = len >= 5 ? snapshot_find_vfo(snapshot, snapshot_get_u32(p)) : NULL;
+
+            if (vfo)
+            {
+                vfo->cached = (p[4] & SNAPSHOT_VFO_CACHED) ? 1 : 0;
+                vfo->ptt = (p[4] & SNAPSHOT_VFO_PTT) ? 1 : 0;
+                vfo->rx = (p[4] & SNAPSHOT_VFO_RX) ? 1 : 0;
+                vfo->tx = (p[4] & SNAPSHOT_VFO_TX) ? 1 : 0;
+            }
+
+            break;
+
+        case SNAPSHOT_TLV_VFO_FREQ:
+            if (vfo && len >= 8) { vfo->freq = snapshot_get_double(p); }
+
+            break;
+
+        case SNAPSHOT_TLV_VFO_MODE:
+            if (vfo && len >= 8) { vfo->mode = snapshot_get_u64(p); }
+
+            break;
+
+        case SNAPSHOT_TLV_VFO_WIDTH:
+            if (vfo && len >= 4) { vfo->width = (int32_t) snapshot_get_u32(p); }
+
+            break;
+
+        case SNAPSHOT_TLV_SPECTRUM:
+            if (len >= SNAPSHOT_SPECTRUM_SIZE)
+            {
+                struct rig_spectrum_line *line = &snapshot->spectrum;
+
+                line->id = (int32_t) snapshot_get_u32(p);
+                line->spectrum_mode = p[4];
+                line->data_level_min = (int32_t) snapshot_get_u32(p + 5);
+                line->data_level_max = (int32_t) snapshot_get_u32(p + 9);
+                line->signal_strength_min = snapshot_get_double(p + 13);
+                line->signal_strength_max = snapshot_get_double(p + 21);
+                line->center_freq = snapshot_get_double(p + 29);
+                line->span_freq = snapshot_get_double(p + 37);
+                line->low_edge_freq = snapshot_get_double(p + 45);
+                line->high_edge_freq = snapshot_get_double(p + 53);
+                snapshot->has_spectrum = 1;
+            }
+
+            break;
+
+        case SNAPSHOT_TLV_SPECTRUM_DATA:
+            snapshot->spectrum.spectrum_data = (unsigned char *) p;
+            snapshot->spectrum.spectrum_data_length = len;
+            break;
+
+        default:
+            break;
+        }
+
+        p += len;
+    }
+
+    return RIG_OK;
+}
@@ -1,6 +1,31 @@
 #ifndef _SNAPSHOT_DATA_H
 #define _SNAPSHOT_DATA_H
 
+#include <stdint.h>
+#include <time.h>
+
+struct snapshot_binary_vfo
+{
+    uint8_t flags;
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+};
+
+/* what the publisher sent last, for binary delta snapshots */
+struct snapshot_binary_state
+{
+    int keyframe_interval_ms;   /* 0 sends a keyframe every packet */
+    int valid;                  /* a keyframe was sent */
+    struct timespec keyframe_time;
+    int status;
+    split_t split;
+    vfo_t split_vfo;
+    int satmode;
+    struct snapshot_binary_vfo vfos[2];
+};
+
 int snapshot_serialize(size_t buffer_length, char *buffer, RIG *rig, struct rig_spectrum_line *spectrum_line);
+int snapshot_serialize_binary(size_t buffer_length, unsigned char *buffer, size_t *length, RIG *rig, struct rig_spectrum_line *spectrum_line, struct snapshot_binary_state *state);
 
 #endif
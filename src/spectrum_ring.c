@@ -0,0 +1,256 @@
+/*
+ *  Hamlib Interface - spectrum line ring buffer
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file spectrum_ring.c
+ * \brief Ring buffer of the most recent spectrum scope lines
+ *
+ * Every spectrum line fired by a backend is copied once into a ring of
+ * HAMLIB_SPECTRUM_RING_SIZE slots owned by the rig state.  Consumers, e.g.
+ * waterfall displays or the multicast publisher, borrow lines by reference
+ * instead of getting a copy per line through a callback.
+ *
+ * There is a single producer, the thread firing spectrum events, and any
+ * number of lock-free consumers.  Each slot carries a stamp derived from
+ * the number of the line it holds, odd while the producer rewrites it.  A
+ * borrowed line stays usable until the producer wraps around to its slot,
+ * which consumers detect with rig_spectrum_ref_valid() after using it, in
+ * the same way as the rig cache sequence lock.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hamlib/rig.h>
+#include "cache.h"
+#include "spectrum_ring.h"
+
+//! @cond Doxygen_Suppress
+struct rig_spectrum_slot
+{
+    volatile uint64_t stamp;    /* (line number + 1) * 2, +1 while written */
+    struct rig_spectrum_line line;
+    unsigned char data[HAMLIB_MAX_SPECTRUM_DATA];
+};
+
+struct rig_spectrum_ring
+{
+    volatile uint64_t head;     /* number of lines published */
+    struct rig_spectrum_slot slots[HAMLIB_SPECTRUM_RING_SIZE];
+};
+
+#define SPECTRUM_STAMP(seq) (((seq) + 1) << 1)
+
+
+int rig_spectrum_ring_init(RIG *rig)
+{
+    if (rig->caps->spectrum_scopes[0].name == NULL)
+    {
+        return RIG_OK;
+    }
+
+    rig->state.spectrum_ring = calloc(1, sizeof(struct rig_spectrum_ring));
+
+    if (rig->state.spectrum_ring == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    return RIG_OK;
+}
+
+
+void rig_spectrum_ring_cleanup(RIG *rig)
+{
+    free(rig->state.spectrum_ring);
+    rig->state.spectrum_ring = NULL;
+}
+
+
+/*
+ * Copy line into the next slot and return its number in *seq.  Only one
+ * thread may publish lines of a rig.
+ */
+int rig_spectrum_ring_publish(RIG *rig, const struct rig_spectrum_line *line,
+                              uint64_t *seq)
+{
+    struct rig_spectrum_ring *ring = rig->state.spectrum_ring;
+    struct rig_spectrum_slot *slot;
+    size_t length = line->spectrum_data_length;
+    uint64_t k;
+
+    if (ring == NULL)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    if (length > HAMLIB_MAX_SPECTRUM_DATA)
+    {
+        length = HAMLIB_MAX_SPECTRUM_DATA;
+    }
+
+    k = ring->head;
+    slot = &ring->slots[k % HAMLIB_SPECTRUM_RING_SIZE];
+
+    CACHE_SEQ_STORE(&slot->stamp, SPECTRUM_STAMP(k) | 1);
+    CACHE_SEQ_WFENCE();
+
+    slot->line = *line;
+    slot->line.spectrum_data = slot->data;
+    slot->line.spectrum_data_length = length;
+    memcpy(slot->data, line->spectrum_data, length);
+
+    CACHE_SEQ_STORE(&slot->stamp, SPECTRUM_STAMP(k));
+    CACHE_SEQ_STORE(&ring->head, k + 1);
+
+    if (seq) { *seq = k; }
+
+    return RIG_OK;
+}
+
+
+int rig_spectrum_ring_borrow(RIG *rig, uint64_t seq,
+                             struct rig_spectrum_ref *ref)
+{
+    struct rig_spectrum_ring *ring = rig->state.spectrum_ring;
+    struct rig_spectrum_slot *slot;
+
+    if (ring == NULL)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    slot = &ring->slots[seq % HAMLIB_SPECTRUM_RING_SIZE];
+
+    if (CACHE_SEQ_LOAD(&slot->stamp) != SPECTRUM_STAMP(seq))
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    ref->line = &slot->line;
+    ref->seq = seq;
+
+    return RIG_OK;
+}
+//! @endcond
+
+
+/**
+ * \brief Borrow the most recent spectrum lines
+ * \param rig The rig handle
+ * \param cursor Line number to continue from, or NULL for the latest lines
+ * \param refs Where to store the borrowed lines, oldest first
+ * \param max Size of refs
+ *
+ * Without a cursor, borrows the latest \a max lines still in the ring.
+ * With a cursor, borrows up to \a max lines starting at *cursor, or at the
+ * oldest line still in the ring if the caller fell behind, and advances
+ * *cursor past them; start with *cursor = 0.  Gaps in refs[].seq are lines
+ * that were overwritten before they could be borrowed.
+ *
+ * Nothing is copied: refs[].line points into the ring.  The producer may
+ * overwrite a line while it is being used, so check
+ * rig_spectrum_ref_valid() once done with it and discard the result if it
+ * returns 0.
+ *
+ * \return the number of lines stored in refs.
+ */
+int HAMLIB_API rig_get_spectrum_lines(RIG *rig, uint64_t *cursor,
+                                      struct rig_spectrum_ref *refs, int max)
+{
+    struct rig_spectrum_ring *ring;
+    uint64_t head, oldest, first, k;
+    int n = 0;
+
+    if (!rig || !refs || max <= 0 || !(ring = rig->state.spectrum_ring))
+    {
+        return 0;
+    }
+
+    head = CACHE_SEQ_LOAD(&ring->head);
+
+    /* the slot after head may be being rewritten right now */
+    oldest = head >= HAMLIB_SPECTRUM_RING_SIZE ?
+             head - (HAMLIB_SPECTRUM_RING_SIZE - 1) : 0;
+
+    if (cursor)
+    {
+        first = *cursor;
+    }
+    else
+    {
+        first = head >= (uint64_t) max ? head - max : 0;
+    }
+
+    if (first < oldest)
+    {
+        first = oldest;
+    }
+
+    for (k = first; k < head && n < max; k++)
+    {
+        if (rig_spectrum_ring_borrow(rig, k, &refs[n]) == RIG_OK)
+        {
+            n++;
+        }
+    }
+
+    if (cursor && k > *cursor)
+    {
+        *cursor = k;
+    }
+
+    return n;
+}
+
+
+/**
+ * \brief Check that a borrowed spectrum line was not overwritten
+ * \param rig The rig handle
+ * \param ref A line borrowed with rig_get_spectrum_lines()
+ *
+ * \return 1 if everything read from ref->line since it was borrowed is
+ * consistent, 0 if the line has been overwritten meanwhile.
+ */
+int HAMLIB_API rig_spectrum_ref_valid(RIG *rig,
+                                      const struct rig_spectrum_ref *ref)
+{
+    struct rig_spectrum_ring *ring;
+
+    if (!rig || !ref || !(ring = rig->state.spectrum_ring))
+    {
+        return 0;
+    }
+
+    CACHE_SEQ_FENCE();
+
+    return CACHE_SEQ_LOAD(&ring->slots[ref->seq % HAMLIB_SPECTRUM_RING_SIZE].stamp)
+           == SPECTRUM_STAMP(ref->seq);
+}
+
+/** @} */
@@ -0,0 +1,38 @@
+/*
+ *  Hamlib Interface - spectrum line ring buffer
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _SPECTRUM_RING_H
+#define _SPECTRUM_RING_H
+
+#include <hamlib/rig.h>
+
+/* allocated by rig_init() for rigs with spectrum scopes, NULL otherwise */
+int rig_spectrum_ring_init(RIG *rig);
+void rig_spectrum_ring_cleanup(RIG *rig);
+
+/* single producer: the thread that fires spectrum events */
+int rig_spectrum_ring_publish(RIG *rig, const struct rig_spectrum_line *line,
+                              uint64_t *seq);
+
+/* borrow line seq, if it is still in the ring */
+int rig_spectrum_ring_borrow(RIG *rig, uint64_t seq,
+                             struct rig_spectrum_ref *ref);
+
+#endif /* _SPECTRUM_RING_H */
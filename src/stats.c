@@ -0,0 +1,537 @@
+/*
+ *  Hamlib Interface - latency statistics of the rig calls and port reads
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig
+ * @{
+ */
+
+/**
+ * \file stats.c
+ * \brief Where the time of a rig goes
+ *
+ * Each rig keeps a latency histogram per function timed with ELAPSED1:
+ * the frontend calls like rig_get_freq() or rig_set_ptt(), and the
+ * transactions of the backends, e.g. kenwood_transaction().  The ones
+ * that may answer from the cache also count how often they did.  The
+ * reads of the rig port are timed too, with their timeouts, busy retries
+ * and errors.
+ *
+ * The counters are added to atomically, so recording takes no lock.  See
+ * rig_get_call_stats(), rig_get_port_stats(), and rig_stats_prometheus()
+ * for all of them in the Prometheus text format, as sent by the
+ * \\dump_stats command of rigctld.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "stats.h"
+
+//! @cond Doxygen_Suppress
+#if defined(__GNUC__)
+#define STATS_ADD(p, v)         __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#define STATS_LOAD(p)           __atomic_load_n((p), __ATOMIC_RELAXED)
+#define STATS_NAME_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STATS_NAME_CAS(p, o, n) __atomic_compare_exchange_n((p), (o), (n), 0, \
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+#define STATS_ADD(p, v)         (*(p) += (v))
+#define STATS_LOAD(p)           (*(p))
+#define STATS_NAME_LOAD(p)      (*(p))
+#define STATS_NAME_CAS(p, o, n) (*(p) == *(o) ? (*(p) = (n), 1) : (*(o) = *(p), 0))
+#endif
+
+
+int rig_stats_init(RIG *rig)
+{
+    rig->state.stats = calloc(1, sizeof(struct rig_stats));
+
+    if (rig->state.stats == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    return RIG_OK;
+}
+
+
+void rig_stats_cleanup(RIG *rig)
+{
+    free(rig->state.stats);
+    rig->state.stats = NULL;
+}
+
+
+static void stats_hist_add(struct rig_latency_hist *hist, double ms)
+{
+    uint64_t us = ms > 0 ? (uint64_t)(ms * 1000) : 0;
+    int k;
+
+    for (k = 0; k < RIG_STATS_BUCKETS && us > RIG_STATS_BUCKET_US(k); k++);
+
+    STATS_ADD(&hist->count, 1);
+    STATS_ADD(&hist->sum_us, us);
+
+    if (k < RIG_STATS_BUCKETS)
+    {
+        STATS_ADD(&hist->bucket[k], 1);
+    }
+}
+
+
+static void stats_hist_copy(struct rig_latency_hist *dst,
+                            const struct rig_latency_hist *src)
+{
+    int k;
+
+    dst->count = STATS_LOAD(&src->count);
+    dst->sum_us = STATS_LOAD(&src->sum_us);
+
+    for (k = 0; k < RIG_STATS_BUCKETS; k++)
+    {
+        dst->bucket[k] = STATS_LOAD(&src->bucket[k]);
+    }
+}
+
+
+/*
+ * The entry of func, made on its first call.  Names are kept by address,
+ * so func must be a string that lives as long as the rig, e.g. __func__.
+ */
+static struct rig_call_stats *stats_call(RIG *rig, const char *func)
+{
+    struct rig_stats *stats = rig->state.stats;
+    uintptr_t hash = (uintptr_t) func;
+    int i;
+
+    if (stats == NULL || func == NULL)
+    {
+        return NULL;
+    }
+
+    hash ^= hash >> 7;
+
+    for (i = 0; i < RIG_STATS_CALLS; i++)
+    {
+        struct rig_call_stats *call = &stats->calls[(hash + i) % RIG_STATS_CALLS];
+        const char *name = STATS_NAME_LOAD(&call->name);
+
+        if (name == NULL)
+        {
+            if (STATS_NAME_CAS(&call->name, &name, func))
+            {
+                return call;
+            }
+        }
+
+        if (name == func)
+        {
+            return call;
+        }
+    }
+
+    return NULL;
+}
+
+
+void rig_elapsed_end(struct rig_elapsed *elapsed)
+{
+    struct rig_call_stats *call;
+
+    if (elapsed->rig == NULL)
+    {
+        return;
+    }
+
+    call = stats_call(elapsed->rig, elapsed->func);
+
+    if (call)
+    {
+        stats_hist_add(&call->latency, elapsed_ms(&elapsed->start,
+                       HAMLIB_ELAPSED_GET));
+    }
+}
+
+
+void rig_stats_cache(RIG *rig, const char *func, int hit)
+{
+    struct rig_call_stats *call = stats_call(rig, func);
+
+    if (call)
+    {
+        STATS_ADD(hit ? &call->cache_hits : &call->cache_misses, 1);
+    }
+}
+
+
+static struct rig_port_stats *stats_port(hamlib_port_t *p)
+{
+    RIG *rig = p->rig;
+
+    /* only compared, rig is not used unless p is its port */
+    if (rig == NULL || p != &rig->state.rigport || rig->state.stats == NULL)
+    {
+        return NULL;
+    }
+
+    return &rig->state.stats->port;
+}
+
+
+void rig_stats_port_read(hamlib_port_t *p, double ms, int retval)
+{
+    struct rig_port_stats *port = stats_port(p);
+
+    if (port == NULL)
+    {
+        return;
+    }
+
+    stats_hist_add(&port->latency, ms);
+
+    if (retval == -RIG_ETIMEOUT)
+    {
+        STATS_ADD(&port->timeouts, 1);
+    }
+    else if (retval < 0)
+    {
+        STATS_ADD(&port->errors, 1);
+    }
+}
+
+
+void rig_stats_port_retry(hamlib_port_t *p)
+{
+    struct rig_port_stats *port = stats_port(p);
+
+    if (port)
+    {
+        STATS_ADD(&port->retries, 1);
+    }
+}
+
+
+static int stats_call_cmp(const void *a, const void *b)
+{
+    const struct rig_call_stats *ca = a;
+    const struct rig_call_stats *cb = b;
+
+    return strcmp(ca->name, cb->name);
+}
+
+
+/* copy the entries in use into calls[], by name */
+static int stats_calls_copy(RIG *rig, struct rig_call_stats *calls)
+{
+    struct rig_stats *stats = rig->state.stats;
+    int n = 0;
+    int i;
+
+    for (i = 0; i < RIG_STATS_CALLS; i++)
+    {
+        const struct rig_call_stats *call = &stats->calls[i];
+        const char *name = STATS_NAME_LOAD(&call->name);
+
+        if (name == NULL)
+        {
+            continue;
+        }
+
+        calls[n].name = name;
+        stats_hist_copy(&calls[n].latency, &call->latency);
+        calls[n].cache_hits = STATS_LOAD(&call->cache_hits);
+        calls[n].cache_misses = STATS_LOAD(&call->cache_misses);
+        n++;
+    }
+
+    qsort(calls, n, sizeof(*calls), stats_call_cmp);
+
+    return n;
+}
+
+
+static void stats_port_copy(RIG *rig, struct rig_port_stats *port)
+{
+    const struct rig_port_stats *src = &rig->state.stats->port;
+
+    stats_hist_copy(&port->latency, &src->latency);
+    port->timeouts = STATS_LOAD(&src->timeouts);
+    port->retries = STATS_LOAD(&src->retries);
+    port->errors = STATS_LOAD(&src->errors);
+}
+
+
+/* s as a label value, with \, " and new lines escaped */
+static void stats_label_value(char *buf, int len, const char *s)
+{
+    int n = 0;
+
+    for (; *s && n < len - 3; s++)
+    {
+        if (*s == '\\' || *s == '"')
+        {
+            buf[n++] = '\\';
+            buf[n++] = *s;
+        }
+        else if (*s == '\n')
+        {
+            buf[n++] = '\\';
+            buf[n++] = 'n';
+        }
+        else
+        {
+            buf[n++] = *s;
+        }
+    }
+
+    buf[n] = '\0';
+}
+
+
+static void stats_hist_print(FILE *stream, const char *metric,
+                             const char *labels,
+                             const struct rig_latency_hist *hist)
+{
+    uint64_t total = 0;
+    int k;
+
+    for (k = 0; k < RIG_STATS_BUCKETS; k++)
+    {
+        total += hist->bucket[k];
+        fprintf(stream, "%s_bucket{%s,le=\"%g\"} %" PRIu64 "\n", metric, labels,
+                RIG_STATS_BUCKET_US(k) / 1e6, total);
+    }
+
+    /* a call may be counted but not put in its bucket yet */
+    if (hist->count > total)
+    {
+        total = hist->count;
+    }
+
+    fprintf(stream, "%s_bucket{%s,le=\"+Inf\"} %" PRIu64 "\n", metric, labels,
+            total);
+    fprintf(stream, "%s_sum{%s} %.6f\n", metric, labels, hist->sum_us / 1e6);
+    fprintf(stream, "%s_count{%s} %" PRIu64 "\n", metric, labels, total);
+}
+//! @endcond
+
+
+/**
+ * \brief Get the latency of a function of a rig
+ * \param rig   The rig handle
+ * \param n     Which function, from 0
+ * \param stats Where to store its counters, since rig_init()
+ *
+ * The functions timed are the ones called at least once, in the order of
+ * their names.  They are the frontend calls and backend transactions that
+ * use ELAPSED1, and only with gcc or clang builds.
+ *
+ * \return RIG_OK, -RIG_EINVAL once \a n is past the last one, or another
+ * negative RIG_E* error code.
+ */
+int HAMLIB_API rig_get_call_stats(RIG *rig, int n, struct rig_call_stats *stats)
+{
+    struct rig_call_stats *calls;
+    int ncalls;
+
+    if (!rig || !stats || n < 0)
+    {
+        return -RIG_EINVAL;
+    }
+
+    if (rig->state.stats == NULL)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    calls = malloc(RIG_STATS_CALLS * sizeof(*calls));
+
+    if (calls == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    ncalls = stats_calls_copy(rig, calls);
+
+    if (n < ncalls)
+    {
+        *stats = calls[n];
+    }
+
+    free(calls);
+
+    return n < ncalls ? RIG_OK : -RIG_EINVAL;
+}
+
+
+/**
+ * \brief Get the latency of the reads of the port of a rig
+ * \param rig   The rig handle
+ * \param stats Where to store the counters, since rig_init()
+ *
+ * Every read_string() and read_block() of the rig port is counted, except
+ * the ones that flush it.
+ *
+ * \return RIG_OK, or a negative RIG_E* error code.
+ */
+int HAMLIB_API rig_get_port_stats(RIG *rig, struct rig_port_stats *stats)
+{
+    if (!rig || !stats)
+    {
+        return -RIG_EINVAL;
+    }
+
+    if (rig->state.stats == NULL)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    stats_port_copy(rig, stats);
+
+    return RIG_OK;
+}
+
+
+/**
+ * \brief Print the latency statistics of a rig in the Prometheus format
+ * \param rig    The rig handle
+ * \param stream Where to print them
+ *
+ * Prints the histograms hamlib_call_duration_seconds, per function, and
+ * hamlib_port_read_duration_seconds, and the counters
+ * hamlib_cache_hits_total, hamlib_cache_misses_total,
+ * hamlib_port_timeouts_total, hamlib_port_retries_total and
+ * hamlib_port_errors_total, all labelled with the model and the port of
+ * the rig.
+ *
+ * \return RIG_OK, or a negative RIG_E* error code.
+ */
+int HAMLIB_API rig_stats_prometheus(RIG *rig, FILE *stream)
+{
+    static const struct
+    {
+        const char *metric;
+        const char *help;
+    } port_counters[] =
+    {
+        { "hamlib_port_timeouts_total", "Reads of the rig port that timed out" },
+        { "hamlib_port_retries_total", "Reads of the rig port tried again as the port was busy" },
+        { "hamlib_port_errors_total", "Reads of the rig port that failed" },
+    };
+    struct rig_call_stats *calls;
+    struct rig_port_stats port;
+    char model[128], pathname[2 * HAMLIB_FILPATHLEN], name[128];
+    char labels[2 * HAMLIB_FILPATHLEN + 512];
+    uint64_t port_counts[3];
+    int ncalls;
+    int i, j;
+
+    if (!rig || !stream)
+    {
+        return -RIG_EINVAL;
+    }
+
+    if (rig->state.stats == NULL)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    calls = malloc(RIG_STATS_CALLS * sizeof(*calls));
+
+    if (calls == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    ncalls = stats_calls_copy(rig, calls);
+    stats_port_copy(rig, &port);
+
+    stats_label_value(model, sizeof(model), rig->caps->model_name);
+    stats_label_value(pathname, sizeof(pathname), rig->state.rigport.pathname);
+
+    fprintf(stream, "# HELP hamlib_call_duration_seconds Time taken by the rig "
+            "calls and backend transactions\n");
+    fprintf(stream, "# TYPE hamlib_call_duration_seconds histogram\n");
+
+    for (i = 0; i < ncalls; i++)
+    {
+        stats_label_value(name, sizeof(name), calls[i].name);
+        SNPRINTF(labels, sizeof(labels), "model=\"%s\",port=\"%s\",call=\"%s\"",
+                 model, pathname, name);
+        stats_hist_print(stream, "hamlib_call_duration_seconds", labels,
+                         &calls[i].latency);
+    }
+
+    for (j = 0; j < 2; j++)
+    {
+        const char *metric = j ? "hamlib_cache_misses_total" :
+                             "hamlib_cache_hits_total";
+
+        fprintf(stream, "# HELP %s Rig calls %s\n", metric,
+                j ? "asked to the rig" : "answered from the cache");
+        fprintf(stream, "# TYPE %s counter\n", metric);
+
+        for (i = 0; i < ncalls; i++)
+        {
+            if (calls[i].cache_hits + calls[i].cache_misses == 0)
+            {
+                continue;
+            }
+
+            stats_label_value(name, sizeof(name), calls[i].name);
+            fprintf(stream, "%s{model=\"%s\",port=\"%s\",call=\"%s\"} %" PRIu64 "\n",
+                    metric, model, pathname, name,
+                    j ? calls[i].cache_misses : calls[i].cache_hits);
+        }
+    }
+
+    SNPRINTF(labels, sizeof(labels), "model=\"%s\",port=\"%s\"", model, pathname);
+    fprintf(stream, "# HELP hamlib_port_read_duration_seconds Time from a read "
+            "of the rig port to the reply\n");
+    fprintf(stream, "# TYPE hamlib_port_read_duration_seconds histogram\n");
+    stats_hist_print(stream, "hamlib_port_read_duration_seconds", labels,
+                     &port.latency);
+
+    port_counts[0] = port.timeouts;
+    port_counts[1] = port.retries;
+    port_counts[2] = port.errors;
+
+    for (i = 0; i < 3; i++)
+    {
+        fprintf(stream, "# HELP %s %s\n", port_counters[i].metric,
+                port_counters[i].help);
+        fprintf(stream, "# TYPE %s counter\n", port_counters[i].metric);
+        fprintf(stream, "%s{%s} %" PRIu64 "\n", port_counters[i].metric, labels,
+                port_counts[i]);
+    }
+
+    free(calls);
+
+    return RIG_OK;
+}
+
+/** @} */
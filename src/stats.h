@@ -0,0 +1,46 @@
+/*
+ *  Hamlib Interface - latency statistics of the rig calls and port reads
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <hamlib/rig.h>
+
+/* most functions timed per rig, the others are not counted */
+#define RIG_STATS_CALLS 64
+
+struct rig_stats
+{
+    struct rig_call_stats calls[RIG_STATS_CALLS];   /* by name, NULL if free */
+    struct rig_port_stats port;                     /* of rig->state.rigport */
+};
+
+/* allocated by rig_init() */
+int rig_stats_init(RIG *rig);
+void rig_stats_cleanup(RIG *rig);
+
+/* func answered from the cache, or not */
+void rig_stats_cache(RIG *rig, const char *func, int hit);
+
+/* a read of p that took ms and returned retval, counted if p is a rig port */
+void rig_stats_port_read(hamlib_port_t *p, double ms, int retval);
+void rig_stats_port_retry(hamlib_port_t *p);
+
+#endif /* _STATS_H */
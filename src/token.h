@@ -123,6 +123,14 @@
 #define TOK_TWIDDLE_TIMEOUT  TOKEN_FRONTEND(128)
 /** \brief rig: Supporess get_freq on VFOB for satellite RIT tuning */
 #define TOK_TWIDDLE_RIT  TOKEN_FRONTEND(129)
+/** \brief rig: Cache timeout for levels, funcs and parms */
+#define TOK_SETTING_CACHE_TIMEOUT  TOKEN_FRONTEND(130)
+/** \brief rig: Multicast packet format */
+#define TOK_MULTICAST_FORMAT  TOKEN_FRONTEND(131)
+/** \brief rig: Interval of full binary multicast snapshots */
+#define TOK_MULTICAST_KEYFRAME_INTERVAL  TOKEN_FRONTEND(132)
+/** \brief rig: Most polls per second of the poll routine */
+#define TOK_POLL_BUDGET  TOKEN_FRONTEND(133)
 /*
  * rotator specific tokens
  * (strictly, should be documented as rotator_internal)
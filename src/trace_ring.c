@@ -0,0 +1,717 @@
+/*
+ *  Hamlib Interface - binary trace of the debug messages
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig_internal
+ * @{
+ */
+
+/**
+ * \file trace_ring.c
+ * \brief Debug messages recorded now, formatted later
+ *
+ * Printing a debug message formats it and flushes the stream, which takes
+ * long enough to change the timing of the CAT exchange being debugged.
+ * rig_set_debug_trace() records the messages instead: the time, the format
+ * string, which also tells where the message comes from, and the raw
+ * arguments are copied into a ring owned by the calling thread, so no lock
+ * is taken and nothing is formatted.  Strings are copied, up to
+ * RIG_TRACE_STRLEN bytes per message in all.  rig_debug_trace_dump()
+ * formats what the rings of all threads hold, oldest message first.
+ *
+ * The format string is kept by address, so rig_debug() must be given one
+ * that lives as long as the program, e.g. a string literal.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "cache.h"
+#include "trace_ring.h"
+
+//! @cond Doxygen_Suppress
+#define RIG_TRACE_ARGS 12
+#define RIG_TRACE_STRLEN 64
+#define RIG_TRACE_SPECLEN 32
+
+union rig_trace_arg
+{
+    long long i;        /* integers, star widths, string offsets */
+    double d;
+    const void *p;
+};
+
+struct rig_trace_record
+{
+    volatile uint64_t stamp;    /* odd while written, 0 if never */
+    struct timeval tv;
+    const char *fmt;
+    int level;
+    int thread;
+    int nargs;
+    union rig_trace_arg args[RIG_TRACE_ARGS];
+    char str[RIG_TRACE_STRLEN];
+};
+
+struct rig_trace_ring
+{
+    struct rig_trace_ring *next;
+    int size;
+    int thread;                 /* number of the owner in the dump */
+    int orphan;                 /* its thread is gone, under the mutex */
+    volatile uint64_t head;     /* records written, by the owner only */
+    struct rig_trace_record *records;
+};
+
+/* one conversion of a format string */
+struct rig_trace_conv
+{
+    char flags[8];              /* room left for a star '-' */
+    int width;                  /* -1 if none, -2 if '*' */
+    int prec;
+    char length[3];
+    char conv;
+};
+
+#define TRACE_STAMP(k) (((k) + 1) << 1)
+
+static int trace_ring_entries;
+static int trace_ring_threads;
+static struct rig_trace_ring *trace_rings;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t trace_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t trace_ring_key;
+static pthread_once_t trace_ring_once = PTHREAD_ONCE_INIT;
+#define TRACE_LOCK()   pthread_mutex_lock(&trace_ring_mutex)
+#define TRACE_UNLOCK() pthread_mutex_unlock(&trace_ring_mutex)
+#else
+static struct rig_trace_ring *trace_ring_single;
+#define TRACE_LOCK()
+#define TRACE_UNLOCK()
+#endif
+
+
+/* left to the next thread that wants one of the same size */
+static void trace_ring_release(void *arg)
+{
+    struct rig_trace_ring *ring = arg;
+
+    TRACE_LOCK();
+    ring->orphan = 1;
+    TRACE_UNLOCK();
+}
+
+
+#ifdef HAVE_PTHREAD
+static void trace_ring_key_create(void)
+{
+    pthread_key_create(&trace_ring_key, trace_ring_release);
+}
+#endif
+
+
+/* called with the mutex held */
+static struct rig_trace_ring *trace_ring_get(int size)
+{
+    struct rig_trace_ring *ring;
+
+    for (ring = trace_rings; ring; ring = ring->next)
+    {
+        if (ring->orphan && ring->size == size)
+        {
+            ring->orphan = 0;
+            return ring;
+        }
+    }
+
+    ring = calloc(1, sizeof(*ring));
+
+    if (ring)
+    {
+        ring->records = calloc(size, sizeof(*ring->records));
+
+        if (!ring->records)
+        {
+            free(ring);
+            return NULL;
+        }
+
+        ring->size = size;
+        ring->next = trace_rings;
+        trace_rings = ring;
+    }
+
+    return ring;
+}
+
+
+/* the ring of the calling thread, of the current size */
+static struct rig_trace_ring *trace_ring_self(void)
+{
+    struct rig_trace_ring *ring;
+    int size = trace_ring_entries;
+
+#ifdef HAVE_PTHREAD
+    pthread_once(&trace_ring_once, trace_ring_key_create);
+    ring = pthread_getspecific(trace_ring_key);
+#else
+    ring = trace_ring_single;
+#endif
+
+    if (ring && ring->size == size)
+    {
+        return ring;
+    }
+
+    if (size <= 0)
+    {
+        return NULL;
+    }
+
+    TRACE_LOCK();
+
+    if (ring)
+    {
+        ring->orphan = 1;
+    }
+
+    ring = trace_ring_get(size);
+
+    if (ring)
+    {
+        ring->thread = ++trace_ring_threads;
+    }
+
+    TRACE_UNLOCK();
+
+#ifdef HAVE_PTHREAD
+    pthread_setspecific(trace_ring_key, ring);
+#else
+    trace_ring_single = ring;
+#endif
+
+    return ring;
+}
+
+
+/* parse the conversion after a '%', return where it ends */
+static const char *trace_parse(const char *p, struct rig_trace_conv *c)
+{
+    int n = 0;
+
+    while (*p && strchr("-+ #0'", *p) && n < (int) sizeof(c->flags) - 2)
+    {
+        c->flags[n++] = *p++;
+    }
+
+    c->flags[n] = '\0';
+    c->width = c->prec = -1;
+
+    if (*p == '*')
+    {
+        c->width = -2;
+        p++;
+    }
+    else if (*p >= '0' && *p <= '9')
+    {
+        c->width = (int) strtol(p, (char **) &p, 10);
+    }
+
+    if (*p == '.')
+    {
+        p++;
+
+        if (*p == '*')
+        {
+            c->prec = -2;
+            p++;
+        }
+        else
+        {
+            c->prec = (int) strtol(p, (char **) &p, 10);
+        }
+    }
+
+    n = 0;
+
+    while (*p && strchr("hljztLq", *p) && n < (int) sizeof(c->length) - 1)
+    {
+        c->length[n++] = *p++;
+    }
+
+    c->length[n] = '\0';
+    c->conv = *p;
+
+    return *p ? p + 1 : p;
+}
+
+
+/* how many argument slots the conversion takes, -1 if not supported */
+static int trace_slots(const struct rig_trace_conv *c)
+{
+    int n = (c->width == -2) + (c->prec == -2);
+
+    if (c->conv == 'n')
+    {
+        return n;
+    }
+
+    if (c->conv == '\0' || !strchr("diouxXceEfFgGaAsp", c->conv)
+            || ((c->conv == 's' || c->conv == 'c') && c->length[0]))
+    {
+        return -1;
+    }
+
+    return n + 1;
+}
+
+
+static long long trace_va_signed(const char *length, va_list *ap)
+{
+    if (!strcmp(length, "hh")) { return (signed char) va_arg(*ap, int); }
+
+    if (!strcmp(length, "h")) { return (short) va_arg(*ap, int); }
+
+    if (!strcmp(length, "l")) { return va_arg(*ap, long); }
+
+    if (!strcmp(length, "ll") || !strcmp(length, "q")) { return va_arg(*ap, long long); }
+
+    if (!strcmp(length, "j")) { return va_arg(*ap, intmax_t); }
+
+    if (!strcmp(length, "z")) { return va_arg(*ap, ssize_t); }
+
+    if (!strcmp(length, "t")) { return va_arg(*ap, ptrdiff_t); }
+
+    return va_arg(*ap, int);
+}
+
+
+static long long trace_va_unsigned(const char *length, va_list *ap)
+{
+    if (!strcmp(length, "hh")) { return (unsigned char) va_arg(*ap, unsigned int); }
+
+    if (!strcmp(length, "h")) { return (unsigned short) va_arg(*ap, unsigned int); }
+
+    if (!strcmp(length, "l")) { return va_arg(*ap, unsigned long); }
+
+    if (!strcmp(length, "ll") || !strcmp(length, "q")) { return va_arg(*ap, unsigned long long); }
+
+    if (!strcmp(length, "j")) { return va_arg(*ap, uintmax_t); }
+
+    if (!strcmp(length, "z")) { return va_arg(*ap, size_t); }
+
+    if (!strcmp(length, "t")) { return va_arg(*ap, ptrdiff_t); }
+
+    return va_arg(*ap, unsigned int);
+}
+
+
+/* copy the raw arguments, as far as they fit */
+static void trace_capture(struct rig_trace_record *rec, const char *fmt,
+                          va_list ap)
+{
+    struct rig_trace_conv c;
+    va_list aq;
+    int nstr = 0;
+    int n = 0;
+
+    va_copy(aq, ap);
+    rec->str[RIG_TRACE_STRLEN - 1] = '\0';
+
+    while ((fmt = strchr(fmt, '%')))
+    {
+        int slots;
+
+        if (fmt[1] == '%')
+        {
+            fmt += 2;
+            continue;
+        }
+
+        fmt = trace_parse(fmt + 1, &c);
+        slots = trace_slots(&c);
+
+        if (slots < 0 || n + slots > RIG_TRACE_ARGS)
+        {
+            break;
+        }
+
+        if (c.width == -2)
+        {
+            rec->args[n++].i = va_arg(aq, int);
+        }
+
+        if (c.prec == -2)
+        {
+            rec->args[n].i = va_arg(aq, int);
+            c.prec = (int) rec->args[n++].i;
+        }
+
+        switch (c.conv)
+        {
+        case 'd':
+        case 'i':
+            rec->args[n++].i = trace_va_signed(c.length, &aq);
+            break;
+
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            rec->args[n++].i = trace_va_unsigned(c.length, &aq);
+            break;
+
+        case 'c':
+            rec->args[n++].i = va_arg(aq, int);
+            break;
+
+        case 's':
+        {
+            const char *s = va_arg(aq, const char *);
+            int room = RIG_TRACE_STRLEN - 1 - nstr;
+            int len;
+
+            if (!s)
+            {
+                rec->args[n++].i = -1;
+                break;
+            }
+
+            for (len = 0; len < room && (c.prec < 0 || len < c.prec) && s[len]; len++);
+
+            memcpy(rec->str + nstr, s, len);
+            rec->args[n++].i = nstr;
+            nstr += len;
+            rec->str[nstr] = '\0';
+
+            if (nstr < RIG_TRACE_STRLEN - 1)
+            {
+                nstr++;
+            }
+
+            break;
+        }
+
+        case 'p':
+            rec->args[n++].p = va_arg(aq, void *);
+            break;
+
+        case 'n':
+            (void) va_arg(aq, void *);
+            break;
+
+        default:
+            if (c.length[0] == 'L')
+            {
+                rec->args[n++].d = (double) va_arg(aq, long double);
+            }
+            else
+            {
+                rec->args[n++].d = va_arg(aq, double);
+            }
+
+            break;
+        }
+    }
+
+    va_end(aq);
+    rec->nargs = n;
+}
+
+
+void rig_trace_ring_record(enum rig_debug_level_e level, const char *fmt,
+                           va_list ap)
+{
+    struct rig_trace_ring *ring;
+    struct rig_trace_record *rec;
+    uint64_t k;
+
+    ring = trace_ring_self();
+
+    if (!ring)
+    {
+        return;
+    }
+
+    k = ring->head;
+    rec = &ring->records[k % ring->size];
+
+    CACHE_SEQ_STORE(&rec->stamp, TRACE_STAMP(k) | 1);
+    CACHE_SEQ_WFENCE();
+
+    gettimeofday(&rec->tv, NULL);
+    rec->fmt = fmt;
+    rec->level = level;
+    rec->thread = ring->thread;
+    trace_capture(rec, fmt, ap);
+
+    CACHE_SEQ_STORE(&rec->stamp, TRACE_STAMP(k));
+    CACHE_SEQ_STORE(&ring->head, k + 1);
+}
+
+
+int rig_trace_ring_resize(int entries)
+{
+    struct rig_trace_ring **pring;
+
+    if (entries < 0)
+    {
+        return -RIG_EINVAL;
+    }
+
+    TRACE_LOCK();
+    trace_ring_entries = entries;
+
+    /* nobody writes to an orphan, and the dump holds the mutex */
+    for (pring = &trace_rings; *pring;)
+    {
+        struct rig_trace_ring *ring = *pring;
+
+        if (ring->orphan && ring->size != entries)
+        {
+            *pring = ring->next;
+            free(ring->records);
+            free(ring);
+        }
+        else
+        {
+            pring = &ring->next;
+        }
+    }
+
+    TRACE_UNLOCK();
+
+    return RIG_OK;
+}
+
+
+static int trace_record_cmp(const void *a, const void *b)
+{
+    const struct rig_trace_record *ra = a;
+    const struct rig_trace_record *rb = b;
+
+    if (ra->tv.tv_sec != rb->tv.tv_sec)
+    {
+        return ra->tv.tv_sec < rb->tv.tv_sec ? -1 : 1;
+    }
+
+    if (ra->tv.tv_usec != rb->tv.tv_usec)
+    {
+        return ra->tv.tv_usec < rb->tv.tv_usec ? -1 : 1;
+    }
+
+    return ra->stamp < rb->stamp ? -1 : ra->stamp > rb->stamp;
+}
+
+
+/* format one record the way rig_debug() would have printed it */
+static void trace_print(FILE *stream, const struct rig_trace_record *rec)
+{
+    const char *fmt = rec->fmt;
+    struct rig_trace_conv c;
+    char spec[RIG_TRACE_SPECLEN];
+    int n = 0;
+
+    while (*fmt)
+    {
+        const char *p = strchr(fmt, '%');
+        int slots;
+
+        if (!p)
+        {
+            fputs(fmt, stream);
+            break;
+        }
+
+        fwrite(fmt, 1, p - fmt, stream);
+
+        if (p[1] == '%')
+        {
+            fputc('%', stream);
+            fmt = p + 2;
+            continue;
+        }
+
+        fmt = trace_parse(p + 1, &c);
+        slots = trace_slots(&c);
+
+        if (slots < 0 || n + slots > rec->nargs)
+        {
+            /* not recorded */
+            fputs(p, stream);
+            break;
+        }
+
+        if (c.width == -2)
+        {
+            c.width = (int) rec->args[n++].i;
+
+            if (c.width < 0)
+            {
+                /* a negative star width is a '-' flag */
+                c.width = -c.width;
+                strcat(c.flags, "-");
+            }
+        }
+
+        if (c.prec == -2)
+        {
+            c.prec = (int) rec->args[n++].i;
+        }
+
+        /* the widths are known now, and the integers are all long long */
+        snprintf(spec, sizeof(spec), "%%%s", c.flags);
+
+        if (c.width >= 0)
+        {
+            snprintf(spec + strlen(spec), sizeof(spec) - strlen(spec), "%d", c.width);
+        }
+
+        if (c.prec >= 0)
+        {
+            snprintf(spec + strlen(spec), sizeof(spec) - strlen(spec), ".%d", c.prec);
+        }
+
+        switch (c.conv)
+        {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            snprintf(spec + strlen(spec), sizeof(spec) - strlen(spec), "ll%c", c.conv);
+            fprintf(stream, spec, rec->args[n++].i);
+            break;
+
+        case 'c':
+            strcat(spec, "c");
+            fprintf(stream, spec, (int) rec->args[n++].i);
+            break;
+
+        case 's':
+            strcat(spec, "s");
+            fprintf(stream, spec, rec->args[n].i < 0 ? "(null)" :
+                    rec->str + rec->args[n].i);
+            n++;
+            break;
+
+        case 'p':
+            strcat(spec, "p");
+            fprintf(stream, spec, rec->args[n++].p);
+            break;
+
+        case 'n':
+            break;
+
+        default:
+            snprintf(spec + strlen(spec), sizeof(spec) - strlen(spec), "%c", c.conv);
+            fprintf(stream, spec, rec->args[n++].d);
+            break;
+        }
+    }
+}
+
+
+int rig_trace_ring_dump(FILE *stream)
+{
+    struct rig_trace_record *recs;
+    struct rig_trace_ring *ring;
+    int total = 0;
+    int n = 0;
+    int i;
+
+    TRACE_LOCK();
+
+    for (ring = trace_rings; ring; ring = ring->next)
+    {
+        total += ring->size;
+    }
+
+    recs = malloc((total ? total : 1) * sizeof(*recs));
+
+    if (!recs)
+    {
+        TRACE_UNLOCK();
+        return -RIG_ENOMEM;
+    }
+
+    for (ring = trace_rings; ring; ring = ring->next)
+    {
+        for (i = 0; i < ring->size; i++)
+        {
+            struct rig_trace_record *rec = &ring->records[i];
+            uint64_t stamp = CACHE_SEQ_LOAD(&rec->stamp);
+
+            if (stamp == 0 || (stamp & 1))
+            {
+                continue;
+            }
+
+            memcpy(&recs[n], rec, sizeof(*rec));
+            CACHE_SEQ_FENCE();
+
+            /* skip it if it was written over while copied */
+            if (CACHE_SEQ_LOAD(&rec->stamp) == stamp)
+            {
+                n++;
+            }
+        }
+    }
+
+    TRACE_UNLOCK();
+
+    qsort(recs, n, sizeof(*recs), trace_record_cmp);
+
+    for (i = 0; i < n; i++)
+    {
+        char buf[64];
+        struct tm tm;
+        time_t t = recs[i].tv.tv_sec;
+
+        localtime_r(&t, &tm);
+        strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+        fprintf(stream, "%s.%06ld T%d: ", buf, (long) recs[i].tv.tv_usec,
+                recs[i].thread);
+        trace_print(stream, &recs[i]);
+    }
+
+    fflush(stream);
+    free(recs);
+
+    return n;
+}
+//! @endcond
+
+/** @} */
@@ -0,0 +1,39 @@
+/*
+ *  Hamlib Interface - binary trace of the debug messages
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _TRACE_RING_H
+#define _TRACE_RING_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <hamlib/rig.h>
+
+/* size of the ring of the threads that record from now on, 0 to stop */
+int rig_trace_ring_resize(int entries);
+
+/* record a message in the ring of the calling thread, without formatting */
+void rig_trace_ring_record(enum rig_debug_level_e level, const char *fmt,
+                           va_list ap);
+
+/* format the records of all threads, oldest first */
+int rig_trace_ring_dump(FILE *stream);
+
+#endif /* _TRACE_RING_H */
@@ -0,0 +1,455 @@
+/*
+ *  Hamlib Interface - asynchronous port transactions
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+/**
+ * \addtogroup rig_internal
+ * @{
+ */
+
+/**
+ * \file transaction.c
+ * \brief Asynchronous command/reply transactions on a port
+ *
+ * port_transaction_submit() queues a command together with the way to
+ * recognize its reply, and returns at once.  Each port with transactions
+ * pending has a thread that runs them in order with write_block() and
+ * read_string()/read_block(), and reports every reply through a completion
+ * callback.  An application driving many rigs submits to all of them and
+ * the I/O of the ports overlaps, without a thread of its own per rig.
+ *
+ * Transactions run on the rig port of a rig.  Each one holds the
+ * transaction lock of the rig like a transaction of the backend, so the
+ * rig_* API may still be used, its calls taking turns with the
+ * transactions, if the backend takes that lock around its own I/O (Icom,
+ * Kenwood, newcat, see set_transaction_active()).  The completion callback runs without the lock; it may
+ * call the rig_* API or submit more transactions, but not wait for them.
+ * port_transaction_wait() waits until all are done.  Closing the port
+ * completes the transactions not started yet with -RIG_EIO.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <hamlib/rig.h>
+#include "iofunc.h"
+#include "misc.h"
+#include "transaction.h"
+
+#ifdef HAVE_PTHREAD
+//! @cond Doxygen_Suppress
+struct port_transaction_item
+{
+    struct port_transaction_item *next;
+    struct port_transaction transaction;
+    unsigned char *reply;
+    /* followed by the copy of the command */
+};
+
+struct port_transaction_queue
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* signaled when an item is queued or done */
+    struct port_transaction_item *head, *tail;
+    int pending;                /* items queued, including the running one */
+    int stop;
+};
+//! @endcond
+
+static pthread_mutex_t port_transaction_start_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* read bytes until the matcher of t accepts them */
+static int port_transaction_read_match(hamlib_port_t *p,
+                                       const struct port_transaction *t,
+                                       unsigned char *reply)
+{
+    size_t len = 0;
+
+    while (len < t->reply_max - 1)
+    {
+        int ret = read_block(p, reply + len, 1);
+
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        len++;
+        ret = t->match(reply, len, t->match_arg);
+
+        if (ret != 0)
+        {
+            return ret < 0 ? ret : (int) len;
+        }
+    }
+
+    return -RIG_EPROTO;
+}
+
+
+static int port_transaction_run(hamlib_port_t *p,
+                                const struct port_transaction *t,
+                                unsigned char *reply)
+{
+    int timeout_save = p->timeout;
+    int ret = 0;
+
+    if (t->flush)
+    {
+        rig_flush(p);
+    }
+
+    if (t->cmd_len > 0)
+    {
+        ret = write_block(p, t->cmd, t->cmd_len);
+
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+
+    if (t->timeout > 0)
+    {
+        p->timeout = t->timeout;
+    }
+
+    if (t->stopset)
+    {
+        ret = read_string(p, reply, t->reply_max, t->stopset, t->stopset_len, 0, 0);
+    }
+    else if (t->reply_len > 0)
+    {
+        ret = read_block(p, reply, t->reply_len);
+    }
+    else if (t->match)
+    {
+        ret = port_transaction_read_match(p, t, reply);
+    }
+
+    p->timeout = timeout_save;
+
+    if (ret >= 0)
+    {
+        reply[ret] = '\0';
+    }
+
+    return ret;
+}
+
+
+static void *port_transaction_thread(void *arg)
+{
+    hamlib_port_t *p = arg;
+    struct port_transaction_queue *q = port_private(p)->transaction_queue;
+
+    pthread_mutex_lock(&q->mutex);
+
+    for (;;)
+    {
+        struct port_transaction_item *item;
+        int cancel;
+        int ret;
+
+        while (q->head == NULL && !q->stop)
+        {
+            pthread_cond_wait(&q->cond, &q->mutex);
+        }
+
+        item = q->head;
+
+        if (item == NULL)
+        {
+            break;
+        }
+
+        cancel = q->stop;
+        pthread_mutex_unlock(&q->mutex);
+
+        if (cancel)
+        {
+            ret = -RIG_EIO;
+            item->reply[0] = '\0';
+        }
+        else
+        {
+            set_transaction_active(p->rig);
+            ret = port_transaction_run(p, &item->transaction, item->reply);
+            set_transaction_inactive(p->rig);
+        }
+
+        if (ret < 0)
+        {
+            rig_debug(RIG_DEBUG_VERBOSE, "%s: transaction failed: %d\n", __func__,
+                      ret);
+        }
+
+        if (item->transaction.done)
+        {
+            item->transaction.done(p, ret, item->reply, item->transaction.done_arg);
+        }
+
+        pthread_mutex_lock(&q->mutex);
+
+        q->head = item->next;
+
+        if (q->head == NULL)
+        {
+            q->tail = NULL;
+        }
+
+        q->pending--;
+        free(item->reply);
+        free(item);
+        pthread_cond_broadcast(&q->cond);
+    }
+
+    pthread_mutex_unlock(&q->mutex);
+
+    return NULL;
+}
+
+
+static int port_transaction_start(hamlib_port_t *p)
+{
+    struct port_private *pp = port_private(p);
+    struct port_transaction_queue *q;
+
+    q = calloc(1, sizeof(*q));
+
+    if (q == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    pp->transaction_queue = q;
+
+    if (pthread_create(&q->thread, NULL, port_transaction_thread, p) != 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: cannot start transaction thread\n", __func__);
+        pp->transaction_queue = NULL;
+        pthread_cond_destroy(&q->cond);
+        pthread_mutex_destroy(&q->mutex);
+        free(q);
+        return -RIG_EINTERNAL;
+    }
+
+    return RIG_OK;
+}
+#endif
+
+
+/**
+ * \brief Queue a command/reply transaction on a port
+ * \param p An open port
+ * \param transaction The command, the reply matcher and the completion
+ * callback; copied, it can be reused as soon as this returns
+ *
+ * The transaction runs on the transaction thread of the port after the
+ * ones submitted before it.  Its completion callback gets the reply or the
+ * error code.
+ *
+ * Transactions run on the rig port of a rig only, RIG_ENAVAIL is returned
+ * for other ports.  They are serialized with the rig_* API only if the
+ * backend does its I/O under the transaction lock, see struct
+ * port_transaction.
+ *
+ * \return RIG_OK if the transaction was queued, a negative RIG_E* error
+ * code otherwise, in which case the callback is not called.
+ */
+int HAMLIB_API port_transaction_submit(hamlib_port_t *p,
+                                       const struct port_transaction *transaction)
+{
+#ifdef HAVE_PTHREAD
+    struct port_private *pp;
+    struct port_transaction_queue *q;
+    struct port_transaction_item *item;
+    struct port_transaction *t;
+
+    if (!p || !transaction || (transaction->cmd_len > 0 && !transaction->cmd))
+    {
+        return -RIG_EINVAL;
+    }
+
+    pp = port_private(p);
+
+    if (pp == NULL)
+    {
+        return -RIG_ENAVAIL;
+    }
+
+    if (p->fd < 0)
+    {
+        return -RIG_EIO;
+    }
+
+    item = calloc(1, sizeof(*item) + transaction->cmd_len);
+
+    if (item == NULL)
+    {
+        return -RIG_ENOMEM;
+    }
+
+    t = &item->transaction;
+    *t = *transaction;
+    t->cmd = (unsigned char *)(item + 1);
+    memcpy(item + 1, transaction->cmd, transaction->cmd_len);
+
+    if (t->reply_max == 0)
+    {
+        t->reply_max = PORT_RX_BUFFER_SIZE;
+    }
+
+    if (t->reply_len >= t->reply_max)
+    {
+        t->reply_max = t->reply_len + 1;
+    }
+
+    item->reply = malloc(t->reply_max);
+
+    if (item->reply == NULL)
+    {
+        free(item);
+        return -RIG_ENOMEM;
+    }
+
+    pthread_mutex_lock(&port_transaction_start_mutex);
+
+    if (pp->transaction_queue == NULL && port_transaction_start(p) != RIG_OK)
+    {
+        pthread_mutex_unlock(&port_transaction_start_mutex);
+        free(item->reply);
+        free(item);
+        return -RIG_EINTERNAL;
+    }
+
+    pthread_mutex_unlock(&port_transaction_start_mutex);
+
+    q = pp->transaction_queue;
+
+    pthread_mutex_lock(&q->mutex);
+
+    if (q->tail)
+    {
+        q->tail->next = item;
+    }
+    else
+    {
+        q->head = item;
+    }
+
+    q->tail = item;
+    q->pending++;
+
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+
+    return RIG_OK;
+#else
+    return -RIG_ENIMPL;
+#endif
+}
+
+
+/**
+ * \brief Wait until the transactions submitted on a port are done
+ * \param p The port
+ *
+ * \return RIG_OK once the completion callbacks of all transactions
+ * submitted so far have returned, or -RIG_EINVAL when called from one of
+ * them, which could never return.
+ */
+int HAMLIB_API port_transaction_wait(hamlib_port_t *p)
+{
+#ifdef HAVE_PTHREAD
+    const struct port_private *pp;
+    struct port_transaction_queue *q;
+
+    if (!p)
+    {
+        return -RIG_EINVAL;
+    }
+
+    pp = port_private(p);
+    q = pp ? pp->transaction_queue : NULL;
+
+    if (q == NULL)
+    {
+        return RIG_OK;
+    }
+
+    if (pthread_equal(pthread_self(), q->thread))
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: called from a completion callback\n",
+                  __func__);
+        return -RIG_EINVAL;
+    }
+
+    pthread_mutex_lock(&q->mutex);
+
+    while (q->pending > 0)
+    {
+        pthread_cond_wait(&q->cond, &q->mutex);
+    }
+
+    pthread_mutex_unlock(&q->mutex);
+#endif
+
+    return RIG_OK;
+}
+
+
+//! @cond Doxygen_Suppress
+void port_transaction_stop(hamlib_port_t *p)
+{
+#ifdef HAVE_PTHREAD
+    struct port_private *pp = port_private(p);
+    struct port_transaction_queue *q = pp ? pp->transaction_queue : NULL;
+
+    if (q == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&q->mutex);
+    q->stop = 1;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+
+    pthread_join(q->thread, NULL);
+
+    pp->transaction_queue = NULL;
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->mutex);
+    free(q);
+#endif
+}
+//! @endcond
+
+/** @} */
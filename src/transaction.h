@@ -0,0 +1,30 @@
+/*
+ *  Hamlib Interface - asynchronous port transactions
+ *
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _TRANSACTION_H
+#define _TRANSACTION_H
+
+#include <hamlib/rig.h>
+
+/* completes what was not started with -RIG_EIO and stops the thread,
+ * before the port is closed */
+void port_transaction_stop(hamlib_port_t *p);
+
+#endif /* _TRANSACTION_H */
@@ -148,6 +148,7 @@ int main(int argc, char *argv[])
     int interactive;    /* if no cmd on command line, switch to interactive */
     int prompt = 1;         /* Print prompt in rigctl */
     int vfo_opt = 0;       /* vfo_opt = 0 means target VFO is 'currVFO' */
+    int chk_vfo_done = 0;
     char send_cmd_term = '\r';  /* send_cmd termination char */
     int ext_resp = 0;
     char resp_sep = '\n';
@@ -647,7 +648,8 @@ int main(int argc, char *argv[])
         }
 
         retcode = rigctl_parse(my_rig, stdin, stdout, argv, argc, NULL,
-                               interactive, prompt, &vfo_opt, send_cmd_term,
+                               interactive, prompt, &vfo_opt, &chk_vfo_done,
+                               send_cmd_term,
                                &ext_resp, &resp_sep, 0);
 
         // if we get a hard error we try to reopen the rig again
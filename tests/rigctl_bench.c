@@ -0,0 +1,177 @@
+/*
+ * Hamlib rigctl_bench program
+ *
+ * Measures what rigctl_parse() costs per command, i.e. reading the command,
+ * looking it up in the command table, dispatching it and formatting the
+ * reply.  The dummy rig is used so the rig itself costs next to nothing.
+ * The lookup alone is timed too, with the indexes and with the linear scans
+ * of the command table they replaced.
+ *
+ * Usage: rigctl_bench [loops]
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <hamlib/rig.h>
+#include "rigctl_parse.h"
+
+#define LOOP_COUNT 20000
+#define LOOKUP_LOOPS 50    /* lookups per command per loop */
+
+/*
+ * A mix of one letter and long form commands, rigctld style.  They are all
+ * answered from the rig cache so the dummy rig's per command delay does not
+ * hide the parser.
+ */
+static const char *commands[] =
+{
+    "f\n",
+    "m\n",
+    "v\n",
+    "s\n",
+    "\\get_freq\n",
+    "\\get_mode\n",
+    "\\get_vfo\n",
+    "\\get_split_vfo\n",
+    "\\chk_vfo\n",
+    "\\get_cache\n",
+    NULL
+};
+
+
+/* ns per lookup of the commands above, by the indexes or linear scans */
+static double bench_lookup(int loops, int ncmds, int linear)
+{
+    char names[32][64];
+    struct timeval tv1, tv2;
+    volatile int found = 0;
+    int i, n;
+
+    for (n = 0; n < ncmds; n++)
+    {
+        snprintf(names[n], sizeof(names[n]), "%.*s",
+                 (int) strcspn(commands[n], "\n"), commands[n]);
+
+        if (!rigctl_lookup_cmd(names[n], linear))
+        {
+            fprintf(stderr, "%s: %s not found\n", __func__, names[n]);
+            exit(5);
+        }
+    }
+
+    gettimeofday(&tv1, NULL);
+
+    for (i = 0; i < loops * LOOKUP_LOOPS; i++)
+    {
+        for (n = 0; n < ncmds; n++)
+        {
+            found += rigctl_lookup_cmd(names[n], linear);
+        }
+    }
+
+    gettimeofday(&tv2, NULL);
+
+    return ((tv2.tv_sec - tv1.tv_sec) * 1e9 + (tv2.tv_usec - tv1.tv_usec) * 1e3)
+           / ((double) loops * LOOKUP_LOOPS * ncmds);
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *my_rig;
+    FILE *fin, *fout;
+    int retcode;
+    int loops = LOOP_COUNT;
+    int ncmds, i, n;
+    int vfo_opt = 0;
+    int chk_vfo_done = 0;
+    int ext_resp = 0;
+    char resp_sep = '\n';
+    struct timeval tv1, tv2;
+    double elapsed;
+
+    if (argc > 1)
+    {
+        loops = atoi(argv[1]);
+    }
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    my_rig = rig_init(RIG_MODEL_DUMMY);
+
+    if (!my_rig)
+    {
+        fprintf(stderr, "rig_init failed\n");
+        exit(1);
+    }
+
+    retcode = rig_open(my_rig);
+
+    if (retcode != RIG_OK)
+    {
+        fprintf(stderr, "rig_open: error = %s\n", rigerror(retcode));
+        exit(2);
+    }
+
+    rig_set_cache_timeout_ms(my_rig, HAMLIB_CACHE_ALL, 60 * 1000);
+
+    fin = tmpfile();
+    fout = tmpfile();
+
+    if (!fin || !fout)
+    {
+        perror("tmpfile");
+        exit(3);
+    }
+
+    for (ncmds = 0; commands[ncmds] != NULL; ncmds++)
+    {
+        fputs(commands[ncmds], fin);
+    }
+
+    gettimeofday(&tv1, NULL);
+
+    for (i = 0; i < loops; i++)
+    {
+        rewind(fin);
+        rewind(fout);
+
+        for (n = 0; n < ncmds; n++)
+        {
+            retcode = rigctl_parse(my_rig, fin, fout, NULL, 0, NULL, 1, 0,
+                                   &vfo_opt, &chk_vfo_done, 0, &ext_resp,
+                                   &resp_sep, 0);
+
+            if (retcode != RIG_OK)
+            {
+                fprintf(stderr, "rigctl_parse: %s returned %d\n", commands[n], retcode);
+                exit(4);
+            }
+        }
+    }
+
+    gettimeofday(&tv2, NULL);
+
+    elapsed = (tv2.tv_sec - tv1.tv_sec) * 1e6 + (tv2.tv_usec - tv1.tv_usec);
+
+    printf("%d commands in %.3f s\n", loops * ncmds, elapsed / 1e6);
+    printf("%.0f ns per command (parse + dispatch + reply)\n",
+           elapsed * 1e3 / ((double)loops * ncmds));
+
+    printf("%.1f ns per lookup with the linear scans\n",
+           bench_lookup(loops, ncmds, 1));
+    printf("%.1f ns per lookup with the indexes\n",
+           bench_lookup(loops, ncmds, 0));
+
+    fclose(fin);
+    fclose(fout);
+    rig_close(my_rig);
+    rig_cleanup(my_rig);
+
+    return 0;
+}
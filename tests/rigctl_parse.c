@@ -94,7 +94,6 @@ extern int read_history();
 #define ARG_IN  (ARG_IN1|ARG_IN2|ARG_IN3|ARG_IN4)
 #define ARG_OUT (ARG_OUT1|ARG_OUT2|ARG_OUT3|ARG_OUT4)
 
-static int chk_vfo_executed;
 char rigctld_password[64];
 int is_passwordOK;
 int is_rigctld;
@@ -126,6 +125,7 @@ struct test_table
                        int,
                        int,
                        int *,
+                       int *,
                        char,
                        int,
                        char,
@@ -152,6 +152,7 @@ struct test_table
                                                     int interactive,    \
                                                     int prompt,         \
                                                     int *vfo_opt,       \
+                                                    int *chk_vfo_done,  \
                                                     char send_cmd_term, \
                                                     int ext_resp,       \
                                                     char resp_sep,      \
@@ -223,6 +224,7 @@ declare_proto_rig(get_info);
 declare_proto_rig(dump_caps);
 declare_proto_rig(dump_conf);
 declare_proto_rig(dump_state);
+declare_proto_rig(dump_stats);
 declare_proto_rig(set_ant);
 declare_proto_rig(get_ant);
 declare_proto_rig(reset);
@@ -342,6 +344,7 @@ static struct test_table test_list[] =
     { '1',  "dump_caps",        ACTION(dump_caps),      ARG_NOVFO },
     { '3',  "dump_conf",        ACTION(dump_conf),      ARG_NOVFO },
     { 0x8f, "dump_state",       ACTION(dump_state),     ARG_OUT | ARG_NOVFO },
+    { 0x9a, "dump_stats",       ACTION(dump_stats),     ARG_NOVFO },
     { 0xf0, "chk_vfo",          ACTION(chk_vfo),        ARG_NOVFO, "ChkVFO" },   /* rigctld only--check for VFO mode */
     { 0xf2, "set_vfo_opt",      ACTION(set_vfo_opt),    ARG_NOVFO | ARG_IN, "Status" }, /* turn vfo option on/off */
     { 0xf3, "get_vfo_info",     ACTION(get_vfo_info),   ARG_NOVFO | ARG_IN1 | ARG_OUT4, "Freq", "Mode", "Width", "Split", "SatMode" }, /* get several vfo parameters at once */
@@ -360,24 +363,86 @@ static struct test_table test_list[] =
 };
 
 
-static struct test_table *find_cmd_entry(int cmd)
+/*
+ * Lookup tables over test_list[], built once on first use: a direct index
+ * on the one byte command and a copy sorted by long name for bsearch().
+ * Both keep the first entry when test_list[] holds a duplicate, just like
+ * the linear scans they replace.
+ */
+#define TEST_LIST_SIZE (sizeof(test_list) / sizeof(test_list[0]))
+
+static struct test_table *cmd_index[256];
+static struct test_table *name_index[TEST_LIST_SIZE];
+static int name_index_len;
+
+static int cmp_test_name(const void *a, const void *b)
 {
-    int i;
+    const struct test_table *ta = *(struct test_table * const *)a;
+    const struct test_table *tb = *(struct test_table * const *)b;
+    int ret = strncmp(ta->name, tb->name, MAXNAMSIZ);
+
+    if (ret == 0)
+    {
+        // same name: earlier entry first so duplicates can be dropped below
+        ret = ta < tb ? -1 : (ta > tb);
+    }
+
+    return ret;
+}
+
+static int cmp_test_key(const void *key, const void *elem)
+{
+    const struct test_table *t = *(struct test_table * const *)elem;
+
+    return strncmp((const char *)key, t->name, MAXNAMSIZ);
+}
+
+static void build_cmd_index(void)
+{
+    int i, n;
 
-    for (i = 0; test_list[i].cmd != 0x00; i++)
+    for (i = 0, n = 0; test_list[i].cmd != 0x00; i++)
     {
-        if (test_list[i].cmd == cmd)
+        if (cmd_index[test_list[i].cmd] == NULL)
         {
-            break;
+            cmd_index[test_list[i].cmd] = &test_list[i];
+        }
+
+        name_index[n++] = &test_list[i];
+    }
+
+    qsort(name_index, n, sizeof(name_index[0]), cmp_test_name);
+
+    for (i = 0, name_index_len = 0; i < n; i++)
+    {
+        if (name_index_len == 0
+                || strncmp(name_index[name_index_len - 1]->name, name_index[i]->name,
+                           MAXNAMSIZ) != 0)
+        {
+            name_index[name_index_len++] = name_index[i];
         }
     }
+}
+
+#ifdef HAVE_PTHREAD
+static pthread_once_t cmd_index_once = PTHREAD_ONCE_INIT;
+#define CMD_INDEX_INIT() pthread_once(&cmd_index_once, build_cmd_index)
+#else
+static int cmd_index_built;
+#define CMD_INDEX_INIT() do { if (!cmd_index_built) { build_cmd_index(); cmd_index_built = 1; } } while (0)
+#endif
+
 
-    if (test_list[i].cmd == 0x00)
+static struct test_table *find_cmd_entry(int cmd)
+{
+    if (cmd <= 0x00 || cmd > 0xff)
     {
         return NULL;
     }
 
-    return &test_list[i];
+    CMD_INDEX_INIT();
+
+    return cmd_index[cmd];
 }
 
 
@@ -492,13 +557,53 @@ static void rp_getline(const char *s)
  */
 static char parse_arg(const char *arg)
 {
+    struct test_table **entry;
+
+    CMD_INDEX_INIT();
+
+    entry = bsearch(arg, name_index, name_index_len, sizeof(name_index[0]),
+                    cmp_test_key);
+
+    return entry ? (*entry)->cmd : 0;
+}
+
+
+/*
+ * Look up a command as rigctl_parse() does, by its long name after a '\\'
+ * or else by its one byte command, and return the entry's one byte
+ * command, 0 if unknown.  With linear set, test_list[] is scanned the way
+ * it was before the indexes, for rigctl_bench to compare both.
+ */
+int rigctl_lookup_cmd(const char *cmd, int linear)
+{
+    const struct test_table *entry;
+    int c = (unsigned char) cmd[0];
     int i;
 
-    for (i = 0; test_list[i].cmd != 0x00; i++)
+    if (!linear)
+    {
+        entry = find_cmd_entry(c == '\\' ? (unsigned char) parse_arg(cmd + 1) : c);
+        return entry ? entry->cmd : 0;
+    }
+
+    if (c == '\\')
+    {
+        for (i = 0; test_list[i].cmd != 0x00; i++)
+        {
+            if (!strncmp(cmd + 1, test_list[i].name, MAXNAMSIZ))
+            {
+                break;
+            }
+        }
+
+        c = test_list[i].cmd;
+    }
+
+    for (i = 0; c != 0x00 && test_list[i].cmd != 0x00; i++)
     {
-        if (!strncmp(arg, test_list[i].name, MAXNAMSIZ))
+        if (test_list[i].cmd == c)
         {
-            return test_list[i].cmd;
+            return c;
         }
     }
 
@@ -506,6 +611,109 @@ static char parse_arg(const char *arg)
 }
 
 
+/*
+ * The command at the start of a rigctld command line, 0 if none.  Skips
+ * the extended response prefix and leaves *line at the command.
+ */
+static unsigned char rigctl_line_cmd(const char **line)
+{
+    const char *p = *line;
+    char cmd_name[MAXNAMSIZ];
+
+    /* skip extended response prefix, see rigctl_parse() */
+    if (*p == '+'
+            || (*p != '\\' && *p != '_' && *p != '#'
+                && *p != '(' && *p != ')' && *p != '['
+                && ispunct((int)*p)))
+    {
+        ++p;
+    }
+
+    *line = p;
+
+    if (*p == '\\')
+    {
+        size_t len = strcspn(p + 1, " \t");
+
+        if (len == 0 || len >= MAXNAMSIZ)
+        {
+            return 0;
+        }
+
+        memcpy(cmd_name, p + 1, len);
+        cmd_name[len] = '\0';
+        return parse_arg(cmd_name);
+    }
+
+    return *p;
+}
+
+
+/* PTT, CW and split changes go ahead of the other clients' commands */
+static int rigctl_cmd_urgent(unsigned char cmd)
+{
+    return cmd == 'T' || cmd == 'b' || cmd == 0xbb || cmd == 'S' || cmd == 'I';
+}
+
+
+/*
+ * Returns 1 when the rigctld command line starts with a command that
+ * rigctl_parse() runs at RIG_PRIO_URGENT, so rigctld can queue it ahead
+ * of the reads and other settings of its clients.
+ */
+int rigctl_cmd_is_urgent(const char *line)
+{
+    return rigctl_cmd_urgent(rigctl_line_cmd(&line));
+}
+
+
+/*
+ * Returns 1 when the rigctld command line holds exactly one get_* command,
+ * i.e. a read whose reply only depends on the rig state.  rigctld uses this
+ * to answer identical concurrent requests from a single rig round trip.
+ */
+int rigctl_cmd_is_read(const char *line, int vfo_opt)
+{
+    const struct test_table *cmd_entry;
+    unsigned char cmd;
+    int ntokens, nexpected;
+    const char *p;
+
+    cmd = rigctl_line_cmd(&line);
+    cmd_entry = find_cmd_entry(cmd);
+
+    if (!cmd_entry || strncmp(cmd_entry->name, "get_", 4) != 0
+            || (cmd_entry->flags & ARG_IN_LINE))
+    {
+        return 0;
+    }
+
+    /* anything beyond the expected arguments would be a second command */
+    nexpected = 1;
+
+    if (vfo_opt && !(cmd_entry->flags & ARG_NOVFO)) { nexpected++; }
+
+    if ((cmd_entry->flags & ARG_IN1) && cmd_entry->arg1) { nexpected++; }
+
+    if ((cmd_entry->flags & ARG_IN2) && cmd_entry->arg2) { nexpected++; }
+
+    if ((cmd_entry->flags & ARG_IN3) && cmd_entry->arg3) { nexpected++; }
+
+    for (ntokens = 0, p = line; *p;)
+    {
+        p += strspn(p, " \t");
+
+        if (*p)
+        {
+            ntokens++;
+            p += strcspn(p, " \t");
+        }
+    }
+
+    return ntokens == nexpected;
+}
+
+
 /*
  * This scanf works even in presence of signals (timer, SIGIO, ..)
  */
@@ -644,12 +852,50 @@ static int next_word(char *buffer, int argc, char *argv[], int newline)
     })
 
 
+/*
+ * Pipelined rigctld requests carry a client chosen tag in front of the
+ * command, e.g. "[12]\get_freq", which is repeated in front of every line
+ * of the reply.  Copies the tag into tag and returns the length of the
+ * "[tag]" prefix, or 0 when line is not tagged.
+ */
+int rigctl_parse_tag(const char *line, char *tag, size_t tagsize)
+{
+    size_t len = 0;
+
+    if (line[0] != '[')
+    {
+        return 0;
+    }
+
+    while (isalnum((int)line[len + 1]) || line[len + 1] == '_'
+            || line[len + 1] == '-' || line[len + 1] == '.')
+    {
+        if (++len >= tagsize)
+        {
+            return 0;
+        }
+    }
+
+    if (len == 0 || line[len + 1] != ']')
+    {
+        return 0;
+    }
+
+    memcpy(tag, line + 1, len);
+    tag[len] = '\0';
+
+    return len + 2;
+}
+
+
 int rigctl_parse(RIG *my_rig, FILE *fin, FILE *fout, char *argv[], int argc,
                  sync_cb_t sync_cb,
-                 int interactive, int prompt, int *vfo_opt, char send_cmd_term,
+                 int interactive, int prompt, int *vfo_opt, int *chk_vfo_done,
+                 char send_cmd_term,
                  int *ext_resp_ptr, char *resp_sep_ptr, int use_password)
 {
     int retcode;        /* generic return code from functions */
+    int priority = rig_get_priority();  /* restored on the way out */
     unsigned char cmd;
     struct test_table *cmd_entry = NULL;
 
@@ -713,6 +959,7 @@ int rigctl_parse(RIG *my_rig, FILE *fin, FILE *fout, char *argv[], int argc,
                         && cmd != '#'
                         && cmd != '('
                         && cmd != ')'
+                        && cmd != '['
                         && ispunct(cmd)
                         && !prompt)
                 {
@@ -1636,6 +1883,15 @@ readline_repeat:
 
 #endif // HAVE_LIBREADLINE
 
+    if (rigctl_cmd_urgent(cmd))
+    {
+        rig_set_priority(RIG_PRIO_URGENT);
+    }
+    else
+    {
+        rig_set_priority(priority);
+    }
+
     if (sync_cb) { sync_cb(1); }    /* lock if necessary */
 
     if (!prompt)
@@ -1699,7 +1955,8 @@ readline_repeat:
     if (use_password && !is_passwordOK && (cmd_entry->arg1 != NULL) && !preCmd)
     {
         rig_debug(RIG_DEBUG_ERR, "%s: need password=%s for cmd=%s\n", __func__, rigctld_password, cmd_entry->arg1);
-        return(-RIG_EPROTO);
+        retcode = -RIG_EPROTO;
+        goto done;
     }
     retcode = (*cmd_entry->rig_routine)(my_rig,
                                         fout,
@@ -1707,6 +1964,7 @@ readline_repeat:
                                         interactive,
                                         prompt,
                                         vfo_opt,
+                                        chk_vfo_done,
                                         send_cmd_term,
                                         *ext_resp_ptr,
                                         *resp_sep_ptr,
@@ -1720,10 +1978,7 @@ readline_repeat:
     if (retcode == -RIG_EIO)
     {
         rig_debug(RIG_DEBUG_ERR, "%s: RIG_EIO?\n", __func__);
-
-        if (sync_cb) { sync_cb(0); }    /* unlock if necessary */
-
-        return (retcode);
+        goto done;
     }
 
     if (retcode != RIG_OK)
@@ -1773,12 +2028,21 @@ readline_repeat:
 
 #ifdef HAVE_LIBREADLINE
 
-    if (input_line != NULL && (result = strtok(NULL, " "))) { goto readline_repeat; }
+    if (input_line != NULL && (result = strtok(NULL, " ")))
+    {
+        /* the next command parses at the caller's priority too */
+        rig_set_priority(priority);
+        goto readline_repeat;
+    }
 
 #endif
 
+done:
+
     if (sync_cb) { sync_cb(0); }    /* unlock if necessary */
 
+    rig_set_priority(priority);
+
     return (retcode);
 }
 
@@ -2322,7 +2586,7 @@ declare_proto_rig(get_vfo_info)
 /* '\get_vfo_list' */
 declare_proto_rig(get_vfo_list)
 {
-    static char prntbuf[256];
+    char prntbuf[256];
 
     ENTERFUNC;
 
@@ -2341,7 +2605,7 @@ declare_proto_rig(get_vfo_list)
 /* '\get_modes' */
 declare_proto_rig(get_modes)
 {
-    static char prntbuf[1024];
+    char prntbuf[1024];
     int i;
     char freqbuf[32];
 
@@ -4252,6 +4516,15 @@ declare_proto_rig(dump_caps)
 }
 
 
+/* 0x9a */
+declare_proto_rig(dump_stats)
+{
+    ENTERFUNC;
+
+    RETURNFUNC(rig_stats_prometheus(rig, fout));
+}
+
+
 /* For rigctld internal use */
 declare_proto_rig(dump_state)
 {
@@ -4358,7 +4631,7 @@ declare_proto_rig(dump_state)
     // protocol 1 allows fields can be listed/processed in any order
     // protocol 1 fields can be multi-line -- just write the thing to allow for it
     // backward compatible as new values will just generate warnings
-    if (chk_vfo_executed) // for 3.3 compatiblility
+    if (*chk_vfo_done) // for 3.3 compatiblility
     {
         fprintf(fout, "vfo_ops=0x%x\n", rig->caps->vfo_ops);
         fprintf(fout, "ptt_type=0x%x\n",
@@ -4891,7 +5164,7 @@ declare_proto_rig(chk_vfo)
 
     fprintf(fout, "%d\n", rig->state.vfo_opt);
 
-    chk_vfo_executed = 1; // this allows us to control dump_state version
+    *chk_vfo_done = 1; // this allows us to control dump_state version
 
     RETURNFUNC(RIG_OK);
 }
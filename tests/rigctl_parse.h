@@ -50,7 +50,16 @@ int set_conf(RIG *my_rig, char *conf_parms);
 
 typedef void (*sync_cb_t)(int);
 int rigctl_parse(RIG *my_rig, FILE *fin, FILE *fout, char *argv[], int argc, sync_cb_t sync_cb,
-                 int interactive, int prompt, int * vfo_mode, char send_cmd_term,
+                 int interactive, int prompt, int * vfo_mode, int * chk_vfo_done,
+                 char send_cmd_term,
                  int * ext_resp_ptr, char * resp_sep_ptr, int use_password);
 
+int rigctl_cmd_is_read(const char *line, int vfo_opt);
+int rigctl_cmd_is_urgent(const char *line);
+int rigctl_lookup_cmd(const char *cmd, int linear);
+
+/* longest request tag of the pipelined rigctld protocol, with the NUL */
+#define RIGCTL_TAG_MAX 16
+int rigctl_parse_tag(const char *line, char *tag, size_t tagsize);
+
 #endif  /* RIGCTL_PARSE_H */
@@ -75,8 +75,10 @@
 #include "serial.h"
 #include "sprintflst.h"
 #include "network.h"
+#include "prio_lock.h"
 
 #include "rigctl_parse.h"
+#include "rigctld_evloop.h"
 
 
 /*
@@ -84,7 +86,7 @@
  *      keep up to date SHORT_OPTIONS, usage()'s output and man page. thanks.
  * TODO: add an option to read from a file
  */
-#define SHORT_OPTIONS "m:r:p:d:P:D:s:c:T:t:C:W:w:x:z:lLuovhVZMA:n:"
+#define SHORT_OPTIONS "m:r:p:d:P:D:s:c:T:t:C:W:w:x:z:lLuovhVZMA:n:ER:"
 static struct option long_options[] =
 {
     {"model",           1, 0, 'm'},
@@ -112,6 +114,8 @@ static struct option long_options[] =
     {"multicast-addr",  1, 0, 'M'},
     {"multicast-port",  1, 0, 'n'},
     {"password",        1, 0, 'A'},
+    {"event-loop",      0, 0, 'E'},
+    {"add-rig",         1, 0, 'R'},
     {0, 0, 0, 0}
 };
 
@@ -123,6 +127,7 @@ struct handle_data
     struct sockaddr_storage cli_addr;
     socklen_t clilen;
     int vfo_mode;
+    int chk_vfo_done;   /* the client sent \chk_vfo, see dump_state */
     int use_password;
 };
 
@@ -153,21 +158,106 @@ extern char rigctld_password[64];
 
 #define MAXCONFLEN 1024
 
+#ifdef RIGCTLD_HAVE_EVLOOP
+static int evloop_stop_requested(void)
+{
+    return ctrl_c;
+}
+
+
+/*
+ * Set up and open a rig given by --add-rig=MODEL,RIG-FILE[,SPEED][,TOKEN=VALUE...]
+ * Returns NULL if the rig cannot be set up; failing to open it is not an
+ * error, the event loop will try again.
+ */
+static RIG *add_rig_open(const char *spec, volatile int *opened)
+{
+    char buf[MAXCONFLEN];
+    char conf_parms[MAXCONFLEN] = "";
+    char *model, *file, *tok, *saveptr = NULL;
+    RIG *rig;
+    int retcode;
+
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    model = strtok_r(buf, ",", &saveptr);
+    file = strtok_r(NULL, ",", &saveptr);
+
+    if (!model || !file)
+    {
+        fprintf(stderr, "Invalid --add-rig '%s', expected MODEL,RIG-FILE\n", spec);
+        return NULL;
+    }
+
+    rig = rig_init(atoi(model));
+
+    if (!rig)
+    {
+        fprintf(stderr, "Unknown rig num %s, or initialization error.\n", model);
+        return NULL;
+    }
+
+    strncpy(rig->state.rigport.pathname, file, HAMLIB_FILPATHLEN - 1);
+
+    while ((tok = strtok_r(NULL, ",", &saveptr)) != NULL)
+    {
+        if (!strchr(tok, '='))
+        {
+            rig->state.rigport.parm.serial.rate = atoi(tok);
+            rig->state.rigport_deprecated.parm.serial.rate = atoi(tok);
+            continue;
+        }
+
+        if (*conf_parms != '\0')
+        {
+            strcat(conf_parms, ",");
+        }
+
+        strncat(conf_parms, tok, MAXCONFLEN - strlen(conf_parms) - 1);
+    }
+
+    retcode = set_conf(rig, conf_parms);
+
+    if (retcode != RIG_OK)
+    {
+        fprintf(stderr, "Config parameter error in --add-rig '%s': %s\n", spec,
+                rigerror(retcode));
+        rig_cleanup(rig);
+        return NULL;
+    }
+
+    retcode = rig_open(rig);
+    *opened = retcode == RIG_OK ? 1 : 0;
+
+    if (retcode != RIG_OK)
+    {
+        fprintf(stderr, "rig_open: error = %s %s\n", rigerror(retcode), file);
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: added rig model %u, '%s' on %s\n", __func__,
+              rig->caps->rig_model, rig->caps->model_name, file);
+
+    return rig;
+}
+#endif
+
 
 void mutex_rigctld(int lock)
 {
 #ifdef HAVE_PTHREAD
-    static pthread_mutex_t client_lock = PTHREAD_MUTEX_INITIALIZER;
+    /* granted by priority, see rig_set_priority() in rigctl_parse() */
+    static struct rig_prio_lock client_lock = RIG_PRIO_LOCK_INITIALIZER;
 
     if (lock)
     {
-        pthread_mutex_lock(&client_lock);
+        rig_prio_lock_acquire(&client_lock);
         rig_debug(RIG_DEBUG_VERBOSE, "%s: client lock engaged\n", __func__);
     }
     else
     {
         rig_debug(RIG_DEBUG_VERBOSE, "%s: client lock disengaged\n", __func__);
-        pthread_mutex_unlock(&client_lock);
+        rig_prio_lock_release(&client_lock);
     }
 
 #endif
@@ -272,6 +362,11 @@ int main(int argc, char *argv[])
 #endif
     struct handle_data *arg;
     int vfo_mode = 0; /* vfo_mode=0 means target VFO is current VFO */
+#ifdef RIGCTLD_HAVE_EVLOOP
+    int event_loop = 0;
+    const char *add_rig[RIGCTLD_EVLOOP_MAX_RIGS];
+    int add_rigs = 0;
+#endif
     int i;
     extern int is_rigctld;
 
@@ -601,6 +696,32 @@ int main(int argc, char *argv[])
 
             break;
 
+        case 'E':
+#ifdef RIGCTLD_HAVE_EVLOOP
+            event_loop = 1;
+#else
+            fprintf(stderr,
+                    "Event loop not supported on this platform, using a thread per client\n");
+#endif
+            break;
+
+        case 'R':
+#ifdef RIGCTLD_HAVE_EVLOOP
+
+            if (add_rigs == RIGCTLD_EVLOOP_MAX_RIGS - 1)
+            {
+                fprintf(stderr, "Too many rigs, at most %d are supported\n",
+                        RIGCTLD_EVLOOP_MAX_RIGS);
+                exit(1);
+            }
+
+            add_rig[add_rigs++] = optarg;
+#else
+            fprintf(stderr, "--add-rig needs the event loop, not supported on this platform\n");
+            exit(1);
+#endif
+            break;
+
         default:
             usage();    /* unknown option? */
             exit(1);
@@ -949,108 +1070,159 @@ int main(int argc, char *argv[])
 #endif
 #endif
 
-    /*
-     * main loop accepting connections
-     */
-    do
+#ifdef RIGCTLD_HAVE_EVLOOP
+
+    if (event_loop)
     {
-        fd_set set;
-        struct timeval timeout;
+        static struct rigctld_evloop_conf evloop_conf;
+        static volatile int add_rig_opened[RIGCTLD_EVLOOP_MAX_RIGS];
+
+        memset(&evloop_conf, 0, sizeof(evloop_conf));
+        evloop_conf.nrigs = 1;
+        evloop_conf.rigs[0].rig = my_rig;
+        evloop_conf.rigs[0].sync_cb = mutex_rigctld;
+        evloop_conf.rigs[0].rig_opened = &rig_opened;
+        evloop_conf.vfo_mode = vfo_mode;
+        evloop_conf.use_password = rigctld_password[0] != 0;
+
+        /* the added rigs are only used by their I/O worker, no sync_cb */
+        for (i = 0; i < add_rigs; i++)
+        {
+            struct rigctld_evloop_rig *r = &evloop_conf.rigs[evloop_conf.nrigs];
 
-        arg = calloc(1, sizeof(struct handle_data));
+            r->rig_opened = &add_rig_opened[evloop_conf.nrigs];
+            r->rig = add_rig_open(add_rig[i], r->rig_opened);
 
-        if (!arg)
-        {
-            rig_debug(RIG_DEBUG_ERR, "calloc: %s\n", strerror(errno));
-            exit(1);
+            if (!r->rig)
+            {
+                exit(2);
+            }
+
+            evloop_conf.nrigs++;
         }
-        if (rigctld_password[0] != 0) arg->use_password = 1;
 
-        /* use select to allow for periodic checks for CTRL+C */
-        FD_ZERO(&set);
-        FD_SET(sock_listen, &set);
-        timeout.tv_sec = 5;
-        timeout.tv_usec = 0;
-        retcode = select(sock_listen + 1, &set, NULL, NULL, &timeout);
+        retcode = rigctld_evloop_run(sock_listen, &evloop_conf,
+                                     evloop_stop_requested);
 
-        if (retcode == -1)
+        if (retcode != RIG_OK)
         {
-            int errno_stored = errno;
-            rig_debug(RIG_DEBUG_ERR, "%s: select() failed: %s\n", __func__,
-                      strerror(errno_stored));
-
-            if (ctrl_c) 
-            {
-                rig_debug(RIG_DEBUG_VERBOSE, "%s: ctrl_c when retcode==-1\n", __func__);
-                break;
-            }
-            if (errno == EINTR)
-            {
-                rig_debug(RIG_DEBUG_VERBOSE, "%s: ignoring interrupted system call\n",
-                          __func__);
-                retcode = 0;
-            }
+            rig_debug(RIG_DEBUG_ERR, "%s: event loop failed: %s\n", __func__,
+                      rigerror(retcode));
         }
-        else if (retcode == 0)
+
+        for (i = 1; i < evloop_conf.nrigs; i++)
         {
-            if (ctrl_c)
-            {
-                rig_debug(RIG_DEBUG_VERBOSE, "%s: ctrl_c when retcode==0\n", __func__);
-                break;
-            }
+            rig_close(evloop_conf.rigs[i].rig);
+            rig_cleanup(evloop_conf.rigs[i].rig);
         }
-        else
+    }
+    else
+#endif
+    {
+        /*
+         * main loop accepting connections
+         */
+        do
         {
-            arg->rig = my_rig;
-            arg->clilen = sizeof(arg->cli_addr);
-            arg->vfo_mode = vfo_mode;
-            arg->sock = accept(sock_listen,
-                               (struct sockaddr *)&arg->cli_addr,
-                               &arg->clilen);
-
-            if (arg->sock < 0)
+            fd_set set;
+            struct timeval timeout;
+
+            arg = calloc(1, sizeof(struct handle_data));
+
+            if (!arg)
             {
-                handle_error(RIG_DEBUG_ERR, "accept");
-                break;
+                rig_debug(RIG_DEBUG_ERR, "calloc: %s\n", strerror(errno));
+                exit(1);
             }
+            if (rigctld_password[0] != 0) arg->use_password = 1;
 
-            if ((retcode = getnameinfo((struct sockaddr const *)&arg->cli_addr,
-                                       arg->clilen,
-                                       host,
-                                       sizeof(host),
-                                       serv,
-                                       sizeof(serv),
-                                       NI_NUMERICHOST | NI_NUMERICSERV))
-                    < 0)
+            /* use select to allow for periodic checks for CTRL+C */
+            FD_ZERO(&set);
+            FD_SET(sock_listen, &set);
+            timeout.tv_sec = 5;
+            timeout.tv_usec = 0;
+            retcode = select(sock_listen + 1, &set, NULL, NULL, &timeout);
+
+            if (retcode == -1)
             {
-                rig_debug(RIG_DEBUG_WARN,
-                          "Peer lookup error: %s",
-                          gai_strerror(retcode));
+                int errno_stored = errno;
+                rig_debug(RIG_DEBUG_ERR, "%s: select() failed: %s\n", __func__,
+                          strerror(errno_stored));
+
+                if (ctrl_c) 
+                {
+                    rig_debug(RIG_DEBUG_VERBOSE, "%s: ctrl_c when retcode==-1\n", __func__);
+                    break;
+                }
+                if (errno == EINTR)
+                {
+                    rig_debug(RIG_DEBUG_VERBOSE, "%s: ignoring interrupted system call\n",
+                              __func__);
+                    retcode = 0;
+                }
             }
+            else if (retcode == 0)
+            {
+                if (ctrl_c)
+                {
+                    rig_debug(RIG_DEBUG_VERBOSE, "%s: ctrl_c when retcode==0\n", __func__);
+                    break;
+                }
+            }
+            else
+            {
+                arg->rig = my_rig;
+                arg->clilen = sizeof(arg->cli_addr);
+                arg->vfo_mode = vfo_mode;
+                arg->chk_vfo_done = 0;
+                arg->sock = accept(sock_listen,
+                                   (struct sockaddr *)&arg->cli_addr,
+                                   &arg->clilen);
+
+                if (arg->sock < 0)
+                {
+                    handle_error(RIG_DEBUG_ERR, "accept");
+                    break;
+                }
 
-            rig_debug(RIG_DEBUG_VERBOSE,
-                      "Connection opened from %s:%s\n",
-                      host,
-                      serv);
+                if ((retcode = getnameinfo((struct sockaddr const *)&arg->cli_addr,
+                                           arg->clilen,
+                                           host,
+                                           sizeof(host),
+                                           serv,
+                                           sizeof(serv),
+                                           NI_NUMERICHOST | NI_NUMERICSERV))
+                        < 0)
+                {
+                    rig_debug(RIG_DEBUG_WARN,
+                              "Peer lookup error: %s",
+                              gai_strerror(retcode));
+                }
+
+                rig_debug(RIG_DEBUG_VERBOSE,
+                          "Connection opened from %s:%s\n",
+                          host,
+                          serv);
 
 #ifdef HAVE_PTHREAD
-            pthread_attr_init(&attr);
-            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+                pthread_attr_init(&attr);
+                pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 
-            retcode = pthread_create(&thread, &attr, handle_socket, arg);
+                retcode = pthread_create(&thread, &attr, handle_socket, arg);
 
-            if (retcode != 0)
-            {
-                rig_debug(RIG_DEBUG_ERR, "pthread_create: %s\n", strerror(retcode));
-                break;
-            }
+                if (retcode != 0)
+                {
+                    rig_debug(RIG_DEBUG_ERR, "pthread_create: %s\n", strerror(retcode));
+                    break;
+                }
 
 #else
-            handle_socket(arg);
+                handle_socket(arg);
 #endif
+            }
         }
+        while (retcode == 0 && !ctrl_c);
     }
-    while (retcode == 0 && !ctrl_c);
     rig_debug(RIG_DEBUG_VERBOSE, "%s: while loop done\n", __func__);
 
 #ifdef HAVE_PTHREAD
@@ -1194,7 +1366,8 @@ void *handle_socket(void *arg)
                       handle_data_arg->vfo_mode, handle_data_arg->use_password);
             retcode = rigctl_parse(handle_data_arg->rig, fsockin, fsockout, NULL, 0,
                                    mutex_rigctld,
-                                   1, 0, &handle_data_arg->vfo_mode, send_cmd_term, &ext_resp, &resp_sep, handle_data_arg->use_password);
+                                   1, 0, &handle_data_arg->vfo_mode, &handle_data_arg->chk_vfo_done,
+                                   send_cmd_term, &ext_resp, &resp_sep, handle_data_arg->use_password);
 
             if (retcode != 0) { rig_debug(RIG_DEBUG_VERBOSE, "%s: rigctl_parse retcode=%d\n", __func__, retcode); }
         }
@@ -1347,6 +1520,9 @@ void usage(void)
         "  -M, --multicast-addr=addr     set multicast UDP address, default 0.0.0.0 (off), recommend 224.0.1.1\n"
         "  -n, --multicast-port=port     set multicast UDP port, default 4532\n"
         "  -A, --password                set password for rigctld access\n"
+        "  -E, --event-loop              serve all clients from one event loop and a rig command queue\n"
+        "  -R, --add-rig=MODEL,RIG-FILE[,SPEED][,TOKEN=VALUE...]\n"
+        "                                also serve this rig, with -E; may be repeated\n"
         "  -h, --help                    display this help and exit\n"
         "  -V, --version                 output version information and exit\n\n",
         portno);
@@ -0,0 +1,1533 @@
+/*
+ * rigctld_evloop.c - (C) The Hamlib Group 2023
+ *
+ * Event driven client handling for rigctld.  A single epoll loop
+ * services the listening socket and all client sockets; complete command
+ * lines are queued on the FIFO of the rig they address and drained by
+ * the I/O worker of that rig.  Tagged ("[id]cmd") lines that arrive
+ * together are queued as one batch and executed back to back within a
+ * single rig transaction window.  PTT, CW and split changes skip ahead of
+ * the jobs of the other clients, see evloop_enqueue().
+ *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <hamlib/config.h>
+
+#include "rigctld_evloop.h"
+
+#ifdef RIGCTLD_HAVE_EVLOOP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netdb.h>
+
+#include <hamlib/rig.h>
+#include "misc.h"
+
+
+#define EVLOOP_MAX_EVENTS 64
+#define EVLOOP_RXBUFSZ 4096
+#define EVLOOP_TXBUF_MAX (1024 * 1024)  /* unsent replies before a client is dropped */
+
+
+struct evloop_client
+{
+    struct evloop *loop;
+    int sock;
+    int refs;               /* event loop + queued jobs, under queue lock */
+    int pending;            /* jobs queued for this client */
+    int paused;             /* not read until pending drains */
+    int closing;            /* drop remaining jobs, peer is gone */
+    int eof;                /* peer sent all its lines, close once answered */
+    int quit;               /* drop remaining jobs, close once the reply is sent */
+    int wake;               /* the event loop must look at the client again */
+    uint32_t events;        /* epoll events the socket is registered for */
+    char *txbuf;            /* replies the socket did not take yet */
+    size_t txlen;
+    size_t txsize;
+    int vfo_mode[RIGCTLD_EVLOOP_MAX_RIGS];  /* per rig, as their workers run together */
+    int chk_vfo_done[RIGCTLD_EVLOOP_MAX_RIGS]; /* sent \chk_vfo to the rig, see dump_state */
+    int ext_resp;
+    char resp_sep;
+    int use_password;
+    int rig;                /* index of the rig selected by \select_rig */
+    struct evloop_queue *pending_q; /* queue of the pending jobs, NULL if several */
+    int held;               /* parsing stopped until pending drains */
+    unsigned long scan;     /* last coalescing scan that saw a job of ours */
+    size_t rxlen;
+    char rxbuf[EVLOOP_RXBUFSZ];
+    char host[NI_MAXHOST];
+    char serv[NI_MAXSERV];
+    struct evloop_client *prev;     /* event loop's list of clients */
+    struct evloop_client *next;
+};
+
+struct evloop_job
+{
+    struct evloop_client *client;
+    struct timespec queued;
+    struct evloop_job *next;
+    int batch;              /* number of tagged commands, 0 if untagged */
+    int urgent;             /* queued ahead of the normal jobs */
+    char line[];
+};
+
+/* per-rig command FIFO */
+struct evloop_queue
+{
+    struct evloop *loop;
+    const struct rigctld_evloop_rig *rig;
+    int index;
+    pthread_cond_t cond;
+    struct evloop_job *head;
+    struct evloop_job *tail;
+    int depth;
+    pthread_t worker;
+    unsigned long scan;
+    /* statistics, reported when the loop ends */
+    unsigned long jobs;
+    unsigned long coalesced;
+    unsigned long batched;
+    int max_depth;
+    double max_wait_ms;
+};
+
+struct evloop
+{
+    const struct rigctld_evloop_conf *conf;
+    int epfd;
+    pthread_mutex_t lock;   /* all queues and the client state they touch */
+    int run;
+    struct evloop_queue queues[RIGCTLD_EVLOOP_MAX_RIGS];
+};
+
+
+static void evloop_client_free(struct evloop_client *client)
+{
+    rig_debug(RIG_DEBUG_VERBOSE, "Connection closed from %s:%s\n",
+              client->host, client->serv);
+    close(client->sock);
+    free(client->txbuf);
+    free(client);
+}
+
+
+/* must be called with loop->lock held */
+static void evloop_client_unref(struct evloop_client *client)
+{
+    if (--client->refs == 0)
+    {
+        evloop_client_free(client);
+    }
+}
+
+
+/*
+ * Register the socket of client for what the event loop waits for: lines
+ * unless paused or at end of file, and writability while replies are
+ * left to send or the client needs a wake up.
+ * Must be called with loop->lock held.
+ */
+static void evloop_client_update(struct evloop *loop,
+                                 struct evloop_client *client)
+{
+    struct epoll_event ev;
+    uint32_t events = 0;
+
+    if (client->closing)
+    {
+        return;
+    }
+
+    if (!client->paused && !client->eof)
+    {
+        events |= EPOLLIN;
+    }
+
+    if (client->txlen > 0 || client->wake)
+    {
+        events |= EPOLLOUT;
+    }
+
+    if (events == client->events)
+    {
+        return;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = client;
+
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, client->sock, &ev) < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: epoll_ctl: %s\n", __func__, strerror(errno));
+        return;
+    }
+
+    client->events = events;
+}
+
+
+/* must be called with loop->lock held */
+static void evloop_client_arm(struct evloop *loop,
+                              struct evloop_client *client, int arm)
+{
+    client->paused = !arm;
+    evloop_client_update(loop, client);
+}
+
+
+/*
+ * Have the event loop look at the client again, e.g. to resume parsing
+ * the lines a held client already sent: the socket is writable, so
+ * EPOLLOUT fires at once.
+ * Must be called with loop->lock held.
+ */
+static void evloop_client_wake(struct evloop *loop, struct evloop_client *client)
+{
+    client->wake = 1;
+    evloop_client_update(loop, client);
+}
+
+
+/* drop a client that went away, must be called with loop->lock held */
+static void evloop_client_close(struct evloop_client *client)
+{
+    client->closing = 1;
+    client->txlen = 0;
+    shutdown(client->sock, SHUT_RDWR);
+}
+
+
+/*
+ * Send what the socket takes of the replies waiting for client.
+ * Must be called with loop->lock held.
+ */
+static void evloop_flush(struct evloop_client *client)
+{
+    while (client->txlen > 0)
+    {
+        ssize_t n = send(client->sock, client->txbuf, client->txlen, MSG_NOSIGNAL);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return;
+            }
+
+            rig_debug(RIG_DEBUG_WARN, "%s: send to %s:%s failed: %s\n", __func__,
+                      client->host, client->serv, strerror(errno));
+            evloop_client_close(client);
+            return;
+        }
+
+        client->txlen -= n;
+        memmove(client->txbuf, client->txbuf + n, client->txlen);
+    }
+}
+
+
+/*
+ * Queue a reply to client and send what the socket takes right away, the
+ * event loop sends the rest once the client reads again.  The socket never
+ * blocks, so a client that stops reading does not hold up the rig.
+ */
+static void evloop_send(struct evloop_client *client, const char *buf,
+                        size_t len)
+{
+    struct evloop *loop = client->loop;
+
+    pthread_mutex_lock(&loop->lock);
+
+    if (client->closing)
+    {
+        pthread_mutex_unlock(&loop->lock);
+        return;
+    }
+
+    if (client->txlen + len > EVLOOP_TXBUF_MAX)
+    {
+        rig_debug(RIG_DEBUG_WARN, "%s: %s:%s does not read its replies, dropped\n",
+                  __func__, client->host, client->serv);
+        evloop_client_close(client);
+        pthread_mutex_unlock(&loop->lock);
+        return;
+    }
+
+    if (client->txlen + len > client->txsize)
+    {
+        size_t size = client->txsize ? client->txsize : EVLOOP_RXBUFSZ;
+        char *txbuf;
+
+        while (size < client->txlen + len)
+        {
+            size *= 2;
+        }
+
+        txbuf = realloc(client->txbuf, size);
+
+        if (!txbuf)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: realloc: %s\n", __func__, strerror(errno));
+            evloop_client_close(client);
+            pthread_mutex_unlock(&loop->lock);
+            return;
+        }
+
+        client->txbuf = txbuf;
+        client->txsize = size;
+    }
+
+    memcpy(client->txbuf + client->txlen, buf, len);
+    client->txlen += len;
+    evloop_flush(client);
+    evloop_client_update(loop, client);
+
+    pthread_mutex_unlock(&loop->lock);
+}
+
+
+static int evloop_is_blank(const char *s)
+{
+    while (*s && isspace((unsigned char)*s))
+    {
+        ++s;
+    }
+
+    return *s == '\0';
+}
+
+
+static void evloop_reopen(const struct rigctld_evloop_rig *conf)
+{
+    int retcode;
+
+    rig_debug(RIG_DEBUG_ERR, "%s: i/o error\n", __func__);
+
+    if (conf->sync_cb) { conf->sync_cb(1); }
+
+    retcode = rig_close(conf->rig);
+    *conf->rig_opened = 0;
+
+    if (conf->sync_cb) { conf->sync_cb(0); }
+
+    rig_debug(RIG_DEBUG_ERR, "%s: rig_close retcode=%d\n", __func__, retcode);
+
+    hl_usleep(1000 * 1000);
+
+    if (conf->sync_cb) { conf->sync_cb(1); }
+
+    retcode = rig_open(conf->rig);
+    *conf->rig_opened = retcode == RIG_OK ? 1 : 0;
+
+    if (conf->sync_cb) { conf->sync_cb(0); }
+
+    rig_debug(RIG_DEBUG_ERR, "%s: rig_open retcode=%d, opened=%d\n", __func__,
+              retcode, *conf->rig_opened);
+}
+
+
+/* try to reopen the rig if an earlier error closed it, returns 1 if open */
+static int evloop_rig_ready(const struct rigctld_evloop_rig *conf)
+{
+    int retcode;
+
+    if (*conf->rig_opened)
+    {
+        return 1;
+    }
+
+    if (conf->sync_cb) { conf->sync_cb(1); }
+
+    retcode = rig_open(conf->rig);
+    *conf->rig_opened = retcode == RIG_OK ? 1 : 0;
+
+    if (conf->sync_cb) { conf->sync_cb(0); }
+
+    rig_debug(RIG_DEBUG_ERR, "%s: rig_open reopened retcode=%d\n", __func__,
+              retcode);
+
+    return *conf->rig_opened;
+}
+
+
+/*
+ * Length of the "@N " prefix addressing rig N at the start of cmd, or 0
+ * if there is none.  *rig is set to N, or to -1 if N is not a rig of the
+ * event loop.
+ */
+static int evloop_rig_prefix(const struct evloop *loop, const char *cmd,
+                             int *rig)
+{
+    const char *p = cmd + 1;
+    long n;
+
+    if (cmd[0] != '@')
+    {
+        return 0;
+    }
+
+    n = 0;
+
+    while (isdigit((unsigned char)*p) && n < RIGCTLD_EVLOOP_MAX_RIGS)
+    {
+        n = n * 10 + (*p++ - '0');
+    }
+
+    *rig = p > cmd + 1 && n < loop->conf->nrigs ? (int)n : -1;
+
+    while (*p && !isspace((unsigned char)*p))
+    {
+        ++p;
+        *rig = -1;
+    }
+
+    while (*p && isspace((unsigned char)*p))
+    {
+        ++p;
+    }
+
+    return p - cmd;
+}
+
+
+/* the client sent \quit: answer nothing more, close once the reply is sent */
+static void evloop_quit(struct evloop_client *client)
+{
+    pthread_mutex_lock(&client->loop->lock);
+    client->quit = 1;
+    client->eof = 1;
+    evloop_client_wake(client->loop, client);
+    pthread_mutex_unlock(&client->loop->lock);
+}
+
+
+/*
+ * Run one queued command line through rigctl_parse() and send the
+ * collected reply to the client.  Only the worker thread calls this.
+ * Returns the reply, to be freed by the caller, or NULL if there was none.
+ */
+static char *evloop_execute(struct evloop_queue *q, struct evloop_job *job,
+                            size_t *outlen)
+{
+    const struct rigctld_evloop_rig *conf = q->rig;
+    struct evloop_client *client = job->client;
+    FILE *fin, *fout;
+    char *out = NULL;
+    int retcode = RIG_OK;
+
+    *outlen = 0;
+
+    if (!evloop_rig_ready(conf))
+    {
+        char reply[32];
+
+        SNPRINTF(reply, sizeof(reply), NETRIGCTL_RET "%d\n", -RIG_EIO);
+        evloop_send(client, reply, strlen(reply));
+        return NULL;
+    }
+
+    fin = fmemopen(job->line, strlen(job->line), "r");
+    fout = open_memstream(&out, outlen);
+
+    if (!fin || !fout)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: stream setup failed: %s\n", __func__,
+                  strerror(errno));
+
+        if (fin) { fclose(fin); }
+
+        if (fout) { fclose(fout); }
+
+        free(out);
+        return NULL;
+    }
+
+    /* a line may hold several commands, e.g. "f m" */
+    while (!evloop_is_blank(job->line + ftell(fin)))
+    {
+        retcode = rigctl_parse(conf->rig, fin, fout, NULL, 0, conf->sync_cb,
+                               1, 0, &client->vfo_mode[q->index],
+                               &client->chk_vfo_done[q->index], '\r',
+                               &client->ext_resp, &client->resp_sep,
+                               client->use_password);
+
+        if (retcode != RIG_OK
+                && !(retcode < 0 && RIG_IS_SOFT_ERRCODE(-retcode)))
+        {
+            break;
+        }
+    }
+
+    fclose(fin);
+    fclose(fout);
+
+    if (*outlen > 0)
+    {
+        evloop_send(client, out, *outlen);
+    }
+
+    if (retcode == RIGCTL_PARSE_END)
+    {
+        /* the event loop sees the hangup and releases the client */
+        evloop_quit(client);
+    }
+    else if (retcode < 0 && !RIG_IS_SOFT_ERRCODE(-retcode))
+    {
+        evloop_reopen(conf);
+    }
+
+    return out;
+}
+
+
+/*
+ * Run a tagged command through rigctl_parse() with the extended response
+ * protocol, so every reply ends in its own RPRT line, and append the reply
+ * to fout with each line prefixed by "[tag] ".
+ */
+static int evloop_execute_tagged(struct evloop_queue *q,
+                                 struct evloop_client *client,
+                                 const char *tag, const char *cmd, FILE *fout)
+{
+    const struct rigctld_evloop_rig *conf = q->rig;
+    FILE *fin, *fcmd;
+    char *out = NULL, *p, *eol;
+    size_t outlen = 0;
+    int retcode = RIG_OK;
+
+    fin = fmemopen((void *)cmd, strlen(cmd), "r");
+    fcmd = open_memstream(&out, &outlen);
+
+    if (!fin || !fcmd)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: stream setup failed: %s\n", __func__,
+                  strerror(errno));
+
+        if (fin) { fclose(fin); }
+
+        if (fcmd) { fclose(fcmd); }
+
+        free(out);
+        fprintf(fout, "[%s] " NETRIGCTL_RET "%d\n", tag, -RIG_EINTERNAL);
+        return -RIG_EINTERNAL;
+    }
+
+    while (!evloop_is_blank(cmd + ftell(fin)))
+    {
+        int ext_resp = 1;
+        char resp_sep = '\n';
+
+        /* the caller holds the rig, hence no sync_cb here */
+        retcode = rigctl_parse(conf->rig, fin, fcmd, NULL, 0, NULL,
+                               1, 0, &client->vfo_mode[q->index],
+                               &client->chk_vfo_done[q->index], '\r',
+                               &ext_resp, &resp_sep, client->use_password);
+
+        if (retcode != RIG_OK
+                && !(retcode < 0 && RIG_IS_SOFT_ERRCODE(-retcode)))
+        {
+            break;
+        }
+    }
+
+    fclose(fin);
+    fclose(fcmd);
+
+    for (p = out; p && p < out + outlen; p = eol + 1)
+    {
+        eol = memchr(p, '\n', out + outlen - p);
+
+        if (!eol)
+        {
+            eol = out + outlen;
+        }
+
+        fprintf(fout, "[%s] %.*s\n", tag, (int)(eol - p), p);
+    }
+
+    free(out);
+
+    return retcode;
+}
+
+
+/*
+ * Execute a batch of tagged commands back to back while holding the rig
+ * for the whole batch, then send all the tagged replies in one write.
+ * Once a command fails hard the rest of the batch is answered with its
+ * error instead of being sent to the rig.  Only the worker thread calls this.
+ */
+static void evloop_execute_batch(struct evloop_queue *q,
+                                 struct evloop_job *job)
+{
+    const struct rigctld_evloop_rig *conf = q->rig;
+    struct evloop_client *client = job->client;
+    FILE *fout;
+    char *out = NULL, *line, *saveptr = NULL;
+    size_t outlen = 0;
+    int retcode = RIG_OK;
+    int ready;
+
+    fout = open_memstream(&out, &outlen);
+
+    if (!fout)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: open_memstream: %s\n", __func__,
+                  strerror(errno));
+        return;
+    }
+
+    ready = evloop_rig_ready(conf);
+
+    if (!ready)
+    {
+        retcode = -RIG_EIO;
+    }
+    else if (conf->sync_cb)
+    {
+        conf->sync_cb(1);
+    }
+
+    for (line = strtok_r(job->line, "\r\n", &saveptr); line;
+            line = strtok_r(NULL, "\r\n", &saveptr))
+    {
+        char tag[RIGCTL_TAG_MAX];
+        int taglen = rigctl_parse_tag(line, tag, sizeof(tag));
+
+        if (taglen == 0)
+        {
+            continue;
+        }
+
+        if (retcode == RIG_OK || (retcode < 0 && RIG_IS_SOFT_ERRCODE(-retcode)))
+        {
+            int rig;
+
+            /* the prefix already routed the batch to this rig */
+            taglen += evloop_rig_prefix(q->loop, line + taglen, &rig);
+            retcode = evloop_execute_tagged(q, client, tag, line + taglen, fout);
+        }
+        else
+        {
+            fprintf(fout, "[%s] " NETRIGCTL_RET "%d\n", tag,
+                    retcode < 0 ? retcode : -RIG_EIO);
+        }
+    }
+
+    if (ready && conf->sync_cb)
+    {
+        conf->sync_cb(0);
+    }
+
+    fclose(fout);
+
+    if (outlen > 0)
+    {
+        evloop_send(client, out, outlen);
+    }
+
+    free(out);
+
+    if (retcode == RIGCTL_PARSE_END)
+    {
+        evloop_quit(client);
+    }
+    else if (ready && retcode < 0 && !RIG_IS_SOFT_ERRCODE(-retcode))
+    {
+        evloop_reopen(conf);
+    }
+}
+
+
+/*
+ * Unlink the queued jobs that may share the reply of the read that was
+ * just executed for job: same command line, same protocol state, and no
+ * earlier job of the same client still waiting (replies stay in order).
+ * Only the reads at the head of the queue are looked at, the reads queued
+ * after a command that may change the rig must see that change.
+ * Must be called with loop->lock held.
+ */
+static struct evloop_job *evloop_coalesce(struct evloop_queue *q,
+        const struct evloop_job *job, int vfo_mode, int ext_resp, char resp_sep)
+{
+    struct evloop_job *attached = NULL, **tail = &attached;
+    struct evloop_job **pp = &q->head, *prev = NULL;
+
+    q->scan++;
+
+    while (*pp)
+    {
+        struct evloop_job *j = *pp;
+        struct evloop_client *client = j->client;
+
+        if (j->batch || !rigctl_cmd_is_read(j->line, client->vfo_mode[q->index]))
+        {
+            break;
+        }
+
+        if (client != job->client
+                && client->scan != q->scan
+                && !client->closing
+                && !client->quit
+                && client->vfo_mode[q->index] == vfo_mode
+                && client->ext_resp == ext_resp
+                && client->resp_sep == resp_sep
+                && strcmp(j->line, job->line) == 0)
+        {
+            *pp = j->next;
+
+            if (q->tail == j)
+            {
+                q->tail = prev;
+            }
+
+            q->depth--;
+            j->next = NULL;
+            *tail = j;
+            tail = &j->next;
+            continue;
+        }
+
+        client->scan = q->scan;
+        prev = j;
+        pp = &j->next;
+    }
+
+    return attached;
+}
+
+
+/* must be called with loop->lock held */
+static void evloop_job_done(struct evloop_queue *q, struct evloop_job *job)
+{
+    job->client->pending--;
+
+    if (job->client->held || job->client->eof)
+    {
+        if (job->client->pending == 0)
+        {
+            evloop_client_wake(q->loop, job->client);
+        }
+    }
+    else if (job->client->pending < RIGCTLD_EVLOOP_MAX_PENDING)
+    {
+        evloop_client_arm(q->loop, job->client, 1);
+    }
+
+    evloop_client_unref(job->client);
+    free(job);
+}
+
+
+static void *evloop_worker(void *arg)
+{
+    struct evloop_queue *q = (struct evloop_queue *)arg;
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: rig #%d I/O worker started\n", __func__,
+              q->index);
+
+    pthread_mutex_lock(&q->loop->lock);
+
+    for (;;)
+    {
+        struct evloop_job *job, *attached = NULL;
+        struct evloop_client *client;
+        char *out = NULL;
+        size_t outlen = 0;
+        double wait_ms;
+        int skip;
+
+        while (q->loop->run && !q->head)
+        {
+            pthread_cond_wait(&q->cond, &q->loop->lock);
+        }
+
+        if (!q->head)
+        {
+            break;
+        }
+
+        job = q->head;
+        q->head = job->next;
+
+        if (!q->head)
+        {
+            q->tail = NULL;
+        }
+
+        q->depth--;
+        skip = job->client->closing || job->client->quit;
+        wait_ms = elapsed_ms(&job->queued, HAMLIB_ELAPSED_GET);
+
+        if (wait_ms > q->max_wait_ms)
+        {
+            q->max_wait_ms = wait_ms;
+        }
+
+        q->jobs++;
+
+        if (job->batch)
+        {
+            q->batched += job->batch;
+        }
+
+        pthread_mutex_unlock(&q->loop->lock);
+
+        rig_debug(RIG_DEBUG_TRACE, "%s: '%s' from %s:%s queued %.0fms, depth=%d\n",
+                  __func__, job->line, job->client->host, job->client->serv,
+                  wait_ms, q->depth);
+
+        client = job->client;
+
+        if (!skip && job->batch)
+        {
+            evloop_execute_batch(q, job);
+        }
+        else if (!skip)
+        {
+            int vfo_mode = client->vfo_mode[q->index];
+            int ext_resp = client->ext_resp;
+            char resp_sep = client->resp_sep;
+            int is_read = rigctl_cmd_is_read(job->line, vfo_mode);
+
+            out = evloop_execute(q, job, &outlen);
+
+            /* identical reads that queued up meanwhile get the same answer */
+            if (is_read && out && outlen > 0)
+            {
+                pthread_mutex_lock(&q->loop->lock);
+                attached = evloop_coalesce(q, job, vfo_mode, ext_resp, resp_sep);
+                pthread_mutex_unlock(&q->loop->lock);
+            }
+
+            if (attached)
+            {
+                struct evloop_job *j;
+                int n = 0;
+
+                for (j = attached; j; j = j->next, n++)
+                {
+                    evloop_send(j->client, out, outlen);
+                    j->client->ext_resp = client->ext_resp;
+                    j->client->resp_sep = client->resp_sep;
+                }
+
+                rig_debug(RIG_DEBUG_TRACE, "%s: '%s' answered %d more client(s)\n",
+                          __func__, job->line, n);
+            }
+
+            free(out);
+        }
+
+        pthread_mutex_lock(&q->loop->lock);
+
+        while (attached)
+        {
+            struct evloop_job *next = attached->next;
+            q->coalesced++;
+            evloop_job_done(q, attached);
+            attached = next;
+        }
+
+        evloop_job_done(q, job);
+    }
+
+    pthread_mutex_unlock(&q->loop->lock);
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: rig #%d I/O worker stopped\n", __func__,
+              q->index);
+
+    return NULL;
+}
+
+
+/*
+ * Queue a job on the FIFO of the rig.  An urgent command goes ahead of the
+ * normal jobs of the other clients, but behind the urgent jobs already
+ * queued and behind the jobs of its own client, whose replies stay in
+ * order.
+ */
+static void evloop_enqueue(struct evloop_queue *q, struct evloop_client *client,
+                           const char *line, size_t len, int batch)
+{
+    struct evloop_job *job = malloc(sizeof(*job) + len + 1);
+    struct evloop_job *prev, *j;
+
+    if (!job)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: malloc: %s\n", __func__, strerror(errno));
+        return;
+    }
+
+    job->client = client;
+    job->next = NULL;
+    job->batch = batch;
+    memcpy(job->line, line, len);
+    job->line[len] = '\0';
+    job->urgent = !batch && rigctl_cmd_is_urgent(job->line);
+    elapsed_ms(&job->queued, HAMLIB_ELAPSED_SET);
+
+    pthread_mutex_lock(&q->loop->lock);
+
+    if (client->quit)
+    {
+        pthread_mutex_unlock(&q->loop->lock);
+        free(job);
+        return;
+    }
+
+    prev = q->tail;
+
+    if (job->urgent)
+    {
+        for (prev = NULL, j = q->head; j; j = j->next)
+        {
+            if (j->urgent || j->client == client)
+            {
+                prev = j;
+            }
+        }
+    }
+
+    if (prev)
+    {
+        job->next = prev->next;
+        prev->next = job;
+    }
+    else
+    {
+        job->next = q->head;
+        q->head = job;
+    }
+
+    if (q->tail == prev)
+    {
+        q->tail = job;
+    }
+
+    if (++q->depth > q->max_depth)
+    {
+        q->max_depth = q->depth;
+    }
+
+    client->refs++;
+
+    if (client->pending == 0)
+    {
+        client->pending_q = q;
+    }
+    else if (client->pending_q != q)
+    {
+        client->pending_q = NULL;
+    }
+
+    /* stop reading from a client that is too far ahead of the rig */
+    if (++client->pending >= RIGCTLD_EVLOOP_MAX_PENDING)
+    {
+        evloop_client_arm(q->loop, client, 0);
+    }
+
+    pthread_cond_signal(&q->cond);
+    pthread_mutex_unlock(&q->loop->lock);
+}
+
+
+/*
+ * Commands handled by the event loop itself.  They answer right away, so
+ * they wait until the client has no command queued on any rig.
+ */
+static int evloop_is_loop_cmd(const char *cmd)
+{
+    return strncmp(cmd, "\\select_rig", 11) == 0
+           || strncmp(cmd, "\\list_rigs", 10) == 0;
+}
+
+
+static void evloop_loop_cmd(struct evloop *loop, struct evloop_client *client,
+                            const char *cmd)
+{
+    char reply[256];
+    int i;
+
+    if (strncmp(cmd, "\\list_rigs", 10) == 0)
+    {
+        for (i = 0; i < loop->conf->nrigs; i++)
+        {
+            const struct rig_caps *caps = loop->conf->rigs[i].rig->caps;
+
+            SNPRINTF(reply, sizeof(reply), "%d %u %s %s%s\n", i, caps->rig_model,
+                     caps->mfg_name, caps->model_name, i == client->rig ? " *" : "");
+            evloop_send(client, reply, strlen(reply));
+        }
+
+        return;
+    }
+
+    /* \select_rig N */
+    {
+        char *end;
+        long n = strtol(cmd + 11, &end, 10);
+
+        if (end == cmd + 11 || !evloop_is_blank(end) || n < 0
+                || n >= loop->conf->nrigs)
+        {
+            SNPRINTF(reply, sizeof(reply), NETRIGCTL_RET "%d\n", -RIG_EINVAL);
+        }
+        else
+        {
+            client->rig = (int)n;
+            SNPRINTF(reply, sizeof(reply), NETRIGCTL_RET "%d\n", RIG_OK);
+        }
+
+        evloop_send(client, reply, strlen(reply));
+    }
+}
+
+
+/*
+ * Queue the complete lines received from a client.  Each line goes to the
+ * rig selected by the client, or to rig N when prefixed with "@N ".
+ * Consecutive tagged lines for the same rig become one batch job, untagged
+ * lines are queued one by one.  Replies must stay in order, so an untagged
+ * line for another rig than the pending jobs of the client, or a command
+ * of the event loop, holds the client until those jobs are done; the
+ * worker finishing the last one wakes the loop up to resume parsing.
+ * Tagged replies carry their tag, so tagged lines never wait.
+ */
+static void evloop_parse(struct evloop *loop, struct evloop_client *client)
+{
+    struct evloop_queue *batch_q = NULL;
+    char *start, *end;
+    char *batch_start = NULL, *batch_end = NULL;
+    int batch = 0;
+
+    start = client->rxbuf;
+    end = client->rxbuf + client->rxlen;
+
+    for (;;)
+    {
+        char tag[RIGCTL_TAG_MAX];
+        char *eol = start, *cmd;
+        char eolc;
+        int taglen, rig, hold;
+        struct evloop_queue *q;
+
+        while (eol < end && *eol != '\n' && *eol != '\r')
+        {
+            ++eol;
+        }
+
+        if (eol == end)
+        {
+            break;
+        }
+
+        if (eol == start)
+        {
+            start = eol + 1;
+            continue;
+        }
+
+        eolc = *eol;
+        *eol = '\0';
+        taglen = rigctl_parse_tag(start, tag, sizeof(tag));
+        rig = client->rig;
+        cmd = start + taglen;
+        cmd += evloop_rig_prefix(loop, cmd, &rig);
+        q = rig >= 0 ? &loop->queues[rig] : NULL;
+
+        if (batch && (taglen == 0 || q != batch_q))
+        {
+            evloop_enqueue(batch_q, client, batch_start, batch_end - batch_start,
+                           batch);
+            batch = 0;
+        }
+
+        if (taglen > 0 && !q)
+        {
+            char reply[RIGCTL_TAG_MAX + 32];
+
+            SNPRINTF(reply, sizeof(reply), "[%s] " NETRIGCTL_RET "%d\n", tag,
+                     -RIG_EINVAL);
+            evloop_send(client, reply, strlen(reply));
+        }
+        else if (taglen > 0)
+        {
+            if (!batch)
+            {
+                batch_start = start;
+                batch_q = q;
+            }
+
+            batch_end = eol;
+            batch++;
+        }
+        else
+        {
+            pthread_mutex_lock(&loop->lock);
+            hold = client->pending > 0
+                   && (!q || client->pending_q != q || evloop_is_loop_cmd(cmd));
+
+            if (hold)
+            {
+                client->held = 1;
+                evloop_client_arm(loop, client, 0);
+            }
+
+            pthread_mutex_unlock(&loop->lock);
+
+            if (hold)
+            {
+                *eol = eolc;
+                break;
+            }
+
+            if (!q)
+            {
+                char reply[32];
+
+                SNPRINTF(reply, sizeof(reply), NETRIGCTL_RET "%d\n", -RIG_EINVAL);
+                evloop_send(client, reply, strlen(reply));
+            }
+            else if (evloop_is_loop_cmd(cmd))
+            {
+                evloop_loop_cmd(loop, client, cmd);
+            }
+            else
+            {
+                evloop_enqueue(q, client, cmd, eol - cmd, 0);
+            }
+        }
+
+        *eol = eolc;
+        start = eol + 1;
+    }
+
+    if (batch)
+    {
+        evloop_enqueue(batch_q, client, batch_start, batch_end - batch_start, batch);
+    }
+
+    client->rxlen = end - start;
+
+    if (client->rxlen == sizeof(client->rxbuf) && !client->held)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: line too long from %s:%s, discarded\n",
+                  __func__, client->host, client->serv);
+        client->rxlen = 0;
+    }
+    else if (client->rxlen > 0 && start != client->rxbuf)
+    {
+        memmove(client->rxbuf, start, client->rxlen);
+    }
+}
+
+
+/* returns -1 at end of file */
+static int evloop_read(struct evloop *loop, struct evloop_client *client)
+{
+    ssize_t n;
+
+    if (client->rxlen == sizeof(client->rxbuf))
+    {
+        return 0;
+    }
+
+    n = recv(client->sock, client->rxbuf + client->rxlen,
+             sizeof(client->rxbuf) - client->rxlen, 0);
+
+    if (n <= 0)
+    {
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0;
+        }
+
+        if (n < 0)
+        {
+            rig_debug(RIG_DEBUG_WARN, "%s: recv from %s:%s failed: %s\n", __func__,
+                      client->host, client->serv, strerror(errno));
+        }
+
+        return -1;
+    }
+
+    client->rxlen += n;
+    evloop_parse(loop, client);
+
+    return 0;
+}
+
+
+/*
+ * The socket is writable or a worker woke the client up: send the replies
+ * left over and, if the last job of a held client is done, go on with its
+ * lines.
+ */
+static void evloop_writable(struct evloop *loop, struct evloop_client *client)
+{
+    int resume;
+
+    pthread_mutex_lock(&loop->lock);
+    evloop_flush(client);
+    resume = client->wake && client->held && client->pending == 0;
+    client->wake = 0;
+
+    if (resume)
+    {
+        client->held = 0;
+        evloop_client_arm(loop, client, 1);
+    }
+    else
+    {
+        evloop_client_update(loop, client);
+    }
+
+    pthread_mutex_unlock(&loop->lock);
+
+    if (resume)
+    {
+        evloop_parse(loop, client);
+    }
+}
+
+
+/*
+ * The peer will send nothing more, e.g. "echo f | nc -N": its last line
+ * may lack its end of line, and what it sent is still answered before
+ * the client is closed.
+ */
+static void evloop_eof(struct evloop *loop, struct evloop_client *client)
+{
+    pthread_mutex_lock(&loop->lock);
+    client->eof = 1;
+    evloop_client_update(loop, client);
+    pthread_mutex_unlock(&loop->lock);
+
+    if (client->rxlen > 0 && client->rxlen < sizeof(client->rxbuf))
+    {
+        client->rxbuf[client->rxlen++] = '\n';
+
+        if (!client->held)
+        {
+            evloop_parse(loop, client);
+        }
+    }
+}
+
+
+/* true once the client can be closed */
+static int evloop_client_done(struct evloop *loop, struct evloop_client *client)
+{
+    int done;
+
+    pthread_mutex_lock(&loop->lock);
+    done = client->closing
+           || (client->eof && !client->held && client->pending == 0
+               && client->txlen == 0);
+    pthread_mutex_unlock(&loop->lock);
+
+    return done;
+}
+
+
+static struct evloop_client *evloop_accept(struct evloop *loop,
+        int sock_listen)
+{
+    const struct rigctld_evloop_conf *conf = loop->conf;
+    struct evloop_client *client;
+    struct sockaddr_storage cli_addr;
+    socklen_t clilen = sizeof(cli_addr);
+    struct epoll_event ev;
+    int retcode;
+    int sock;
+    int i;
+
+    sock = accept(sock_listen, (struct sockaddr *)&cli_addr, &clilen);
+
+    if (sock < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: accept: %s\n", __func__, strerror(errno));
+        return NULL;
+    }
+
+    client = calloc(1, sizeof(struct evloop_client));
+
+    if (!client)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: calloc: %s\n", __func__, strerror(errno));
+        close(sock);
+        return NULL;
+    }
+
+    if (fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK) < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: fcntl: %s\n", __func__, strerror(errno));
+        close(sock);
+        free(client);
+        return NULL;
+    }
+
+    client->loop = loop;
+    client->sock = sock;
+    client->refs = 1;
+
+    for (i = 0; i < RIGCTLD_EVLOOP_MAX_RIGS; i++)
+    {
+        client->vfo_mode[i] = conf->vfo_mode;
+    }
+
+    client->resp_sep = '\n';
+    client->use_password = conf->use_password;
+
+    if ((retcode = getnameinfo((struct sockaddr const *)&cli_addr, clilen,
+                               client->host, sizeof(client->host),
+                               client->serv, sizeof(client->serv),
+                               NI_NUMERICHOST | NI_NUMERICSERV)) != 0)
+    {
+        rig_debug(RIG_DEBUG_WARN, "Peer lookup error: %s", gai_strerror(retcode));
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = client->events = EPOLLIN;
+    ev.data.ptr = client;
+
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, sock, &ev) < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: epoll_ctl: %s\n", __func__, strerror(errno));
+        close(sock);
+        free(client);
+        return NULL;
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "Connection opened from %s:%s\n",
+              client->host, client->serv);
+
+    return client;
+}
+
+
+/* let the workers finish what is queued */
+static void evloop_stop_workers(struct evloop *loop, int nworkers)
+{
+    int i;
+
+    pthread_mutex_lock(&loop->lock);
+    loop->run = 0;
+
+    for (i = 0; i < nworkers; i++)
+    {
+        pthread_cond_signal(&loop->queues[i].cond);
+    }
+
+    pthread_mutex_unlock(&loop->lock);
+
+    for (i = 0; i < nworkers; i++)
+    {
+        pthread_join(loop->queues[i].worker, NULL);
+    }
+}
+
+
+int rigctld_evloop_run(int sock_listen,
+                       const struct rigctld_evloop_conf *conf,
+                       int (*stop_requested)(void))
+{
+    struct evloop loop;
+    struct evloop_client *clients = NULL;
+    struct epoll_event ev;
+    struct epoll_event events[EVLOOP_MAX_EVENTS];
+    int retcode;
+    int i;
+
+    if (conf->nrigs < 1 || conf->nrigs > RIGCTLD_EVLOOP_MAX_RIGS)
+    {
+        return -RIG_EINVAL;
+    }
+
+    memset(&loop, 0, sizeof(loop));
+    loop.conf = conf;
+    loop.run = 1;
+    pthread_mutex_init(&loop.lock, NULL);
+
+    for (i = 0; i < conf->nrigs; i++)
+    {
+        loop.queues[i].loop = &loop;
+        loop.queues[i].rig = &conf->rigs[i];
+        loop.queues[i].index = i;
+        pthread_cond_init(&loop.queues[i].cond, NULL);
+    }
+
+    loop.epfd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (loop.epfd < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: epoll_create1: %s\n", __func__,
+                  strerror(errno));
+        return -RIG_EINTERNAL;
+    }
+
+    /* a NULL data pointer marks the listening socket */
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+
+    if (epoll_ctl(loop.epfd, EPOLL_CTL_ADD, sock_listen, &ev) < 0)
+    {
+        rig_debug(RIG_DEBUG_ERR, "%s: epoll_ctl: %s\n", __func__, strerror(errno));
+        close(loop.epfd);
+        return -RIG_EINTERNAL;
+    }
+
+    for (i = 0; i < conf->nrigs; i++)
+    {
+        retcode = pthread_create(&loop.queues[i].worker, NULL, evloop_worker,
+                                 &loop.queues[i]);
+
+        if (retcode != 0)
+        {
+            rig_debug(RIG_DEBUG_ERR, "%s: pthread_create: %s\n", __func__,
+                      strerror(retcode));
+            evloop_stop_workers(&loop, i);
+            close(loop.epfd);
+            return -RIG_EINTERNAL;
+        }
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: event loop started for %d rig(s)\n",
+              __func__, conf->nrigs);
+
+    while (!stop_requested())
+    {
+        int n;
+
+        /* wake up every second to check for CTRL+C */
+        n = epoll_wait(loop.epfd, events, EVLOOP_MAX_EVENTS, 1000);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            rig_debug(RIG_DEBUG_ERR, "%s: epoll_wait: %s\n", __func__,
+                      strerror(errno));
+            break;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            struct evloop_client *client = events[i].data.ptr;
+
+            if (!client)
+            {
+                client = evloop_accept(&loop, sock_listen);
+
+                if (client)
+                {
+                    client->next = clients;
+
+                    if (clients) { clients->prev = client; }
+
+                    clients = client;
+                }
+
+                continue;
+            }
+
+            if (!(events[i].events & (EPOLLERR | EPOLLHUP)))
+            {
+                if (events[i].events & EPOLLOUT)
+                {
+                    evloop_writable(&loop, client);
+                }
+
+                if ((events[i].events & EPOLLIN) && evloop_read(&loop, client) < 0)
+                {
+                    evloop_eof(&loop, client);
+                }
+
+                if (!evloop_client_done(&loop, client))
+                {
+                    continue;
+                }
+            }
+
+            /* answered or gone: unlink and drop the event loop's reference */
+            if (client->prev) { client->prev->next = client->next; }
+            else { clients = client->next; }
+
+            if (client->next) { client->next->prev = client->prev; }
+
+            pthread_mutex_lock(&loop.lock);
+            client->closing = 1;
+            epoll_ctl(loop.epfd, EPOLL_CTL_DEL, client->sock, NULL);
+            evloop_client_unref(client);
+            pthread_mutex_unlock(&loop.lock);
+        }
+    }
+
+    rig_debug(RIG_DEBUG_VERBOSE, "%s: event loop stopping\n", __func__);
+
+    evloop_stop_workers(&loop, conf->nrigs);
+
+    while (clients)
+    {
+        struct evloop_client *next = clients->next;
+        evloop_client_free(clients);
+        clients = next;
+    }
+
+    close(loop.epfd);
+
+    for (i = 0; i < conf->nrigs; i++)
+    {
+        struct evloop_queue *q = &loop.queues[i];
+
+        pthread_cond_destroy(&q->cond);
+
+        rig_debug(RIG_DEBUG_VERBOSE,
+                  "%s: rig #%d: %lu commands executed, %lu answered by coalescing, %lu in batches, max queue depth=%d, max queue wait=%.0fms\n",
+                  __func__, i, q->jobs, q->coalesced, q->batched, q->max_depth,
+                  q->max_wait_ms);
+    }
+
+    pthread_mutex_destroy(&loop.lock);
+
+    return RIG_OK;
+}
+
+#endif  /* RIGCTLD_HAVE_EVLOOP */
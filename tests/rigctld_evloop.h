@@ -0,0 +1,70 @@
+/*
+ * rigctld_evloop.h - (C) The Hamlib Group 2023
+ *
+ * Event driven client handling for rigctld.
+ *
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License along
+ *   with this program; if not, write to the Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef RIGCTLD_EVLOOP_H
+#define RIGCTLD_EVLOOP_H
+
+#include <hamlib/rig.h>
+#include "rigctl_parse.h"
+
+/*
+ * The event loop needs epoll(7) for the client sockets and a pthread
+ * for the rig I/O worker, so it is only available on Linux.
+ */
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_PTHREAD)
+#define RIGCTLD_HAVE_EVLOOP 1
+#endif
+
+/* max commands a single client may have waiting in the rig queue */
+#define RIGCTLD_EVLOOP_MAX_PENDING 16
+
+/* max rigs served by one event loop */
+#define RIGCTLD_EVLOOP_MAX_RIGS 16
+
+struct rigctld_evloop_rig
+{
+    RIG *rig;                   /* rig served by its own I/O worker */
+    sync_cb_t sync_cb;          /* passed on to rigctl_parse, may be NULL */
+    volatile int *rig_opened;   /* shared with rigctld's reopen logic */
+};
+
+struct rigctld_evloop_conf
+{
+    int nrigs;
+    struct rigctld_evloop_rig rigs[RIGCTLD_EVLOOP_MAX_RIGS]; /* rigs[0] is selected by new clients */
+    int vfo_mode;               /* initial vfo_mode of every client */
+    int use_password;           /* clients must send \password first */
+};
+
+/*
+ * Serve all clients of sock_listen from a single epoll loop.  Every rig
+ * has its own FIFO and I/O worker thread, so only that thread ever waits
+ * on the rig port and slow rigs do not hold up the others.  A complete
+ * command line is appended to the FIFO of the rig selected by the client,
+ * with \select_rig or an "@N " prefix, and executed in arrival order.
+ * Returns when stop_requested() returns non-zero.
+ */
+int rigctld_evloop_run(int sock_listen,
+                       const struct rigctld_evloop_conf *conf,
+                       int (*stop_requested)(void));
+
+#endif  /* RIGCTLD_EVLOOP_H */
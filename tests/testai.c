@@ -0,0 +1,184 @@
+/*
+ * Check of the Kenwood and Yaesu transceive (AI) reports
+ *
+ * Feeds reports to the async hooks of a TS-2000, a TS-590SG and an FT-991
+ * as the async data handler would, and checks that they fire events and
+ * that rig_get_freq(), rig_get_mode() and rig_get_ptt() then answer from
+ * the cache.  Nothing answers on the port, so any CAT round trip fails.
+ * Also checks that the replies of a running transaction are not taken for
+ * reports, and that the mode of the TS-590SG waits for its DATA sub-mode.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hamlib/rig.h>
+#include "kenwood.h"
+#include "newcat.h"
+#include "testcheck.h"
+
+#define FRAME(s) strlen(s), (const unsigned char *)(s)
+
+static int freq_events;
+
+
+static int freq_event(RIG *rig, vfo_t vfo, freq_t freq, rig_ptr_t arg)
+{
+    freq_events++;
+    return RIG_OK;
+}
+
+
+static RIG *open_fake(rig_model_t model, int sv[2])
+{
+    RIG *rig = open_fake_rig(model, sv, 100);
+
+    if (rig)
+    {
+        rig->state.comm_state = 1;
+        rig_set_freq_callback(rig, freq_event, NULL);
+    }
+
+    return rig;
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    struct kenwood_priv_data *kpriv;
+    struct newcat_priv_data *npriv;
+    int sv[2];
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    ptt_t ptt;
+    int errors = 0;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig_load_all_backends();
+
+    /* TS-2000 */
+    rig = open_fake(RIG_MODEL_TS2000, sv);
+
+    if (!rig)
+    {
+        fprintf(stderr, "cannot set up the TS-2000\n");
+        return 1;
+    }
+
+    kpriv = rig->state.priv;
+
+    /* an empty cache still asks the rig */
+    rig->state.use_cached_mode = 1;
+    CHECK(rig_get_mode(rig, RIG_VFO_A, &mode, &width) != RIG_OK);
+    rig->state.use_cached_mode = 0;
+
+    /* outside a transaction every frame is a report */
+    CHECK(kenwood_is_async_frame(rig, FRAME("FA00014074000;")) == 1);
+
+    /* a transaction waiting for FA and MD keeps their replies */
+    strcpy(kpriv->async_wait, "FAMD");
+    CHECK(kenwood_is_async_frame(rig, FRAME("FA00014074000;")) == 0);
+    CHECK(kenwood_is_async_frame(rig, FRAME("MD2;")) == 0);
+    CHECK(kenwood_is_async_frame(rig, FRAME("?;")) == 0);
+    CHECK(kenwood_is_async_frame(rig, FRAME("TX0;")) == 1);
+    kpriv->async_wait[0] = '\0';
+
+    freq_events = 0;
+    CHECK(kenwood_process_async_frame(rig, FRAME("FA00014074000;")) == RIG_OK);
+    CHECK(kenwood_process_async_frame(rig, FRAME("MD2;")) == RIG_OK);
+    CHECK(kenwood_process_async_frame(rig, FRAME("TX0;")) == RIG_OK);
+    CHECK(freq_events == 1);
+
+    CHECK(rig_get_freq(rig, RIG_VFO_A, &freq) == RIG_OK && freq == 14074000);
+    CHECK(rig_get_mode(rig, RIG_VFO_A, &mode, &width) == RIG_OK
+          && mode == RIG_MODE_USB);
+    CHECK(rig_get_ptt(rig, RIG_VFO_A, &ptt) == RIG_OK && ptt == RIG_PTT_ON);
+
+    /* IF carries frequency, mode, PTT and split at once */
+    CHECK(kenwood_process_async_frame(rig,
+                                      FRAME("IF00007074000     +000000000010010000;")) == RIG_OK);
+    CHECK(freq_events == 2);
+    CHECK(rig_get_freq(rig, RIG_VFO_A, &freq) == RIG_OK && freq == 7074000);
+    CHECK(rig_get_mode(rig, RIG_VFO_A, &mode, &width) == RIG_OK
+          && mode == RIG_MODE_LSB);
+    CHECK(rig_get_ptt(rig, RIG_VFO_A, &ptt) == RIG_OK && ptt == RIG_PTT_OFF);
+    CHECK(kpriv->split == RIG_SPLIT_ON);
+
+    /* unknown reports are ignored */
+    CHECK(kenwood_process_async_frame(rig, FRAME("SM00005;")) == RIG_OK);
+
+    /* with AI off the cache stops answering */
+    kenwood_set_trn(rig, RIG_TRN_OFF);
+    CHECK(!rig->state.use_cached_freq && !rig->state.use_cached_mode
+          && !rig->state.use_cached_ptt);
+
+    close_fake_rig(rig, sv);
+
+    /* TS-590SG, DATA is not known until a DA report */
+    rig = open_fake(RIG_MODEL_TS590SG, sv);
+
+    if (!rig)
+    {
+        fprintf(stderr, "cannot set up the TS-590SG\n");
+        return 1;
+    }
+
+    CHECK(kenwood_process_async_frame(rig, FRAME("MD2;")) == RIG_OK);
+    CHECK(rig->state.use_cached_mode == 0);
+
+    CHECK(kenwood_process_async_frame(rig, FRAME("DA1;")) == RIG_OK);
+    CHECK(rig->state.use_cached_mode == 1);
+    CHECK(rig_get_mode(rig, RIG_VFO_A, &mode, &width) == RIG_OK
+          && mode == RIG_MODE_PKTUSB);
+
+    CHECK(kenwood_process_async_frame(rig, FRAME("MD1;")) == RIG_OK);
+    CHECK(rig_get_mode(rig, RIG_VFO_A, &mode, &width) == RIG_OK
+          && mode == RIG_MODE_PKTLSB);
+
+    CHECK(kenwood_process_async_frame(rig, FRAME("DA0;")) == RIG_OK);
+    CHECK(rig_get_mode(rig, RIG_VFO_A, &mode, &width) == RIG_OK
+          && mode == RIG_MODE_LSB);
+
+    close_fake_rig(rig, sv);
+
+    /* FT-991 */
+    rig = open_fake(RIG_MODEL_FT991, sv);
+
+    if (!rig)
+    {
+        fprintf(stderr, "cannot set up the FT-991\n");
+        return 1;
+    }
+
+    npriv = (struct newcat_priv_data *) rig->state.priv;
+
+    strcpy(npriv->async_wait, "FA");
+    CHECK(newcat_is_async_frame(rig, FRAME("FA014074000;")) == 0);
+    CHECK(newcat_is_async_frame(rig, FRAME("MD02;")) == 1);
+    npriv->async_wait[0] = '\0';
+
+    freq_events = 0;
+    CHECK(newcat_process_async_frame(rig, FRAME("FA014074000;")) == RIG_OK);
+    CHECK(newcat_process_async_frame(rig, FRAME("MD02;")) == RIG_OK);
+    CHECK(newcat_process_async_frame(rig, FRAME("TX1;")) == RIG_OK);
+    CHECK(freq_events == 1);
+
+    CHECK(rig_get_freq(rig, RIG_VFO_A, &freq) == RIG_OK && freq == 14074000);
+    CHECK(rig_get_mode(rig, RIG_VFO_A, &mode, &width) == RIG_OK
+          && mode == RIG_MODE_USB);
+    CHECK(rig_get_ptt(rig, RIG_VFO_A, &ptt) == RIG_OK && ptt == RIG_PTT_ON);
+
+    newcat_set_trn(rig, RIG_TRN_OFF);
+    CHECK(!rig->state.use_cached_freq && !rig->state.use_cached_mode
+          && !rig->state.use_cached_ptt);
+
+    close_fake_rig(rig, sv);
+
+    return check_result(errors);
+}
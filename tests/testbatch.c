@@ -0,0 +1,154 @@
+/*
+ * Check of Kenwood and Yaesu command batching
+ *
+ * A thread on the other end of a socket pair plays the rig: it reads each
+ * write as one request and answers all of its commands at once.  Checks
+ * that kenwood_get_vfo_info() sends FA, MD and IF in a single write and
+ * decodes the replies, and that a command refused in the middle of a
+ * batch only fails that command.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <hamlib/rig.h>
+#include "kenwood.h"
+#include "newcat.h"
+#include "testcheck.h"
+
+
+struct fake_rig
+{
+    int fd;
+    const char *reply;
+    char request[256];
+};
+
+
+static void *fake_rig_thread(void *arg)
+{
+    struct fake_rig *f = arg;
+    ssize_t n;
+
+    n = recv(f->fd, f->request, sizeof(f->request) - 1, 0);
+
+    if (n > 0)
+    {
+        f->request[n] = '\0';
+        send(f->fd, f->reply, strlen(f->reply), 0);
+    }
+
+    return NULL;
+}
+
+
+/* answer the next write on the port of rig with reply */
+static int fake_rig_start(struct fake_rig *f, pthread_t *thread, int fd,
+                          const char *reply)
+{
+    memset(f, 0, sizeof(*f));
+    f->fd = fd;
+    f->reply = reply;
+
+    return pthread_create(thread, NULL, fake_rig_thread, f);
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    struct fake_rig f;
+    pthread_t thread;
+    struct kenwood_batch_cmd kbatch[3];
+    struct newcat_batch_cmd nbatch[3];
+    int sv[2];
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    split_t split;
+    int errors = 0;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig_load_all_backends();
+
+    /* TS-2000: frequency, mode and split of VFO A in one round trip */
+    rig = open_fake_rig(RIG_MODEL_TS2000, sv, 500);
+
+    if (!rig)
+    {
+        fprintf(stderr, "cannot set up the TS-2000\n");
+        return 1;
+    }
+
+    rig->state.current_vfo = RIG_VFO_A;
+
+    fake_rig_start(&f, &thread, sv[1],
+                   "FA00014074000;MD2;"
+                   "IF00014074000     +000000000020010000;");
+    CHECK(kenwood_get_vfo_info(rig, RIG_VFO_A, &freq, &mode, &width,
+                               &split) == RIG_OK);
+    pthread_join(thread, NULL);
+
+    CHECK(strcmp(f.request, "FA;MD;IF;") == 0);
+    CHECK(freq == 14074000);
+    CHECK(mode == RIG_MODE_USB);
+    CHECK(width == rig_passband_normal(rig, RIG_MODE_USB));
+    CHECK(split == RIG_SPLIT_ON);
+
+    /* the VFO that is not current needs a VFO swap, left to the frontend */
+    CHECK(kenwood_get_vfo_info(rig, RIG_VFO_B, &freq, &mode, &width,
+                               &split) == -RIG_ENAVAIL);
+
+    /* a refused command does not fail the others */
+    kbatch[0].cmd = "FA";
+    kbatch[1].cmd = "XX";
+    kbatch[2].cmd = "FB";
+    fake_rig_start(&f, &thread, sv[1], "FA00007074000;?;FB00010136000;");
+    CHECK(kenwood_transaction_batch(rig, kbatch, 3) == RIG_OK);
+    pthread_join(thread, NULL);
+
+    CHECK(strcmp(f.request, "FA;XX;FB;") == 0);
+    CHECK(kbatch[0].retval == RIG_OK
+          && strcmp(kbatch[0].reply, "FA00007074000") == 0);
+    CHECK(kbatch[1].retval == -RIG_ERJCTED && kbatch[1].reply[0] == '\0');
+    CHECK(kbatch[2].retval == RIG_OK
+          && strcmp(kbatch[2].reply, "FB00010136000") == 0);
+
+    /* replies out of step with the commands */
+    fake_rig_start(&f, &thread, sv[1], "FB00010136000;FA00007074000;MD2;");
+    CHECK(kenwood_transaction_batch(rig, kbatch, 3) == -RIG_EPROTO);
+    pthread_join(thread, NULL);
+
+    close_fake_rig(rig, sv);
+
+    /* FT-991 */
+    rig = open_fake_rig(RIG_MODEL_FT991, sv, 500);
+
+    if (!rig)
+    {
+        fprintf(stderr, "cannot set up the FT-991\n");
+        return 1;
+    }
+
+    nbatch[0].cmd = "FA;";
+    nbatch[1].cmd = "MD0;";
+    nbatch[2].cmd = "FT;";
+    fake_rig_start(&f, &thread, sv[1], "FA014074000;MD02;FT1;");
+    CHECK(newcat_get_cmd_batch(rig, nbatch, 3) == RIG_OK);
+    pthread_join(thread, NULL);
+
+    CHECK(strcmp(f.request, "FA;MD0;FT;") == 0);
+    CHECK(nbatch[0].retval == RIG_OK
+          && strcmp(nbatch[0].reply, "FA014074000;") == 0);
+    CHECK(nbatch[1].retval == RIG_OK && strcmp(nbatch[1].reply, "MD02;") == 0);
+    CHECK(nbatch[2].retval == RIG_OK && strcmp(nbatch[2].reply, "FT1;") == 0);
+
+    close_fake_rig(rig, sv);
+
+    return check_result(errors);
+}
@@ -0,0 +1,96 @@
+/*
+ * Helpers shared by the unit checks
+ *
+ * A check counts its failures in the errors of the caller and returns
+ * check_result(errors) from main.  The fake rigs talk to the port of
+ * the rig over a socket pair: the rig side is sv[0], the test writes
+ * replies to and reads commands from sv[1].
+ */
+
+#ifndef _TESTCHECK_H
+#define _TESTCHECK_H 1
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <hamlib/rig.h>
+
+#define CHECK(cond) \
+    do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); errors++; } } while (0)
+
+
+static inline int check_result(int errors)
+{
+    if (errors)
+    {
+        fprintf(stderr, "%d check(s) failed\n", errors);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/* writes s to the fake rig side, nonzero when all of it went */
+static inline int feed(int fd, const char *s)
+{
+    return write(fd, s, strlen(s)) == (ssize_t) strlen(s);
+}
+
+
+/* a bare device port on sv[0] */
+static inline int open_port_pair(hamlib_port_t *port, int sv[2], int timeout)
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    {
+        return -1;
+    }
+
+    memset(port, 0, sizeof(*port));
+    port->type.rig = RIG_PORT_DEVICE;
+    port->fd = sv[0];
+    port->timeout = timeout;
+
+    return 0;
+}
+
+
+/* a rig of the model on sv[0], without retries or write delays */
+static inline RIG *open_fake_rig(rig_model_t model, int sv[2], int timeout)
+{
+    RIG *rig = rig_init(model);
+
+    if (!rig)
+    {
+        return NULL;
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    {
+        rig_cleanup(rig);
+        return NULL;
+    }
+
+    rig->state.rigport.type.rig = RIG_PORT_DEVICE;
+    rig->state.rigport.fd = sv[0];
+    rig->state.rigport.timeout = timeout;
+    rig->state.rigport.retry = 0;
+    rig->state.rigport.write_delay = 0;
+    rig->state.rigport.post_write_delay = 0;
+    rig->state.current_vfo = RIG_VFO_A;
+
+    return rig;
+}
+
+
+static inline void close_fake_rig(RIG *rig, int sv[2])
+{
+    rig->state.comm_state = 0;
+    close(sv[1]);
+    rig_cleanup(rig);
+    close(sv[0]);
+}
+
+#endif /* _TESTCHECK_H */
@@ -0,0 +1,221 @@
+/*
+ * Check of the pipelined Icom CI-V transactions
+ *
+ * A thread on the other end of a socket pair plays an IC-7300: it waits
+ * for the requests kept in flight by icom_get_vfo_info() and answers them
+ * in another order, with a transceive frame in between.  Checks that each
+ * reply goes to its request, and that a request left unanswered is sent
+ * again on its own.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <hamlib/rig.h>
+#include "icom.h"
+#include "icom_defs.h"
+#include "frame.h"
+#include "testcheck.h"
+
+#define IC7300_ADDR 0x94
+
+struct exchange
+{
+    int frames;                 /* request frames to wait for */
+    const unsigned char *reply;
+    int reply_len;
+};
+
+struct fake_rig
+{
+    int fd;
+    const struct exchange *exchanges;
+    int count;
+    unsigned char request[256];
+    int request_len;            /* of all exchanges */
+    int first_request_frames;   /* frames in the first write */
+};
+
+
+static void *fake_rig_thread(void *arg)
+{
+    struct fake_rig *f = arg;
+    int i;
+
+    for (i = 0; i < f->count; i++)
+    {
+        int frames = 0;
+
+        while (frames < f->exchanges[i].frames
+                && f->request_len < (int) sizeof(f->request))
+        {
+            ssize_t n = recv(f->fd, f->request + f->request_len,
+                             sizeof(f->request) - f->request_len, 0);
+            int k;
+
+            if (n <= 0)
+            {
+                return NULL;
+            }
+
+            for (k = 0; k < n; k++)
+            {
+                if (f->request[f->request_len + k] == FI) { frames++; }
+            }
+
+            if (i == 0 && f->first_request_frames == 0) { f->first_request_frames = frames; }
+
+            f->request_len += n;
+        }
+
+        send(f->fd, f->exchanges[i].reply, f->exchanges[i].reply_len, 0);
+    }
+
+    return NULL;
+}
+
+
+static RIG *open_fake(int sv[2])
+{
+    RIG *rig = open_fake_rig(RIG_MODEL_IC7300, sv, 300);
+    struct icom_priv_data *priv;
+    struct timeval tv = { 2, 0 };
+
+    if (!rig)
+    {
+        return NULL;
+    }
+
+    /* do not hang if a request never comes */
+    setsockopt(sv[1], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    priv = (struct icom_priv_data *) rig->state.priv;
+    priv->serial_USB_echo_off = 1;
+
+    return rig;
+}
+
+
+/* 14.074 MHz, PKTUSB with FIL1, 2700 Hz, split on */
+#define REPLY_FREQ  0xfe, 0xfe, 0xe0, IC7300_ADDR, 0x03, 0x00, 0x40, 0x07, 0x14, 0x00, 0xfd
+#define REPLY_MODE  0xfe, 0xfe, 0xe0, IC7300_ADDR, 0x26, 0x00, 0x01, 0x01, 0x01, 0xfd
+#define REPLY_WIDTH 0xfe, 0xfe, 0xe0, IC7300_ADDR, 0x1a, 0x03, 0x31, 0xfd
+#define REPLY_SPLIT 0xfe, 0xfe, 0xe0, IC7300_ADDR, 0x0f, 0x01, 0xfd
+/* transceive frequency change to 7.074 MHz */
+#define TRANSCEIVE  0xfe, 0xfe, 0x00, IC7300_ADDR, 0x00, 0x00, 0x40, 0x07, 0x07, 0x00, 0xfd
+
+static const unsigned char shuffled[] =
+{
+    REPLY_SPLIT, TRANSCEIVE, REPLY_WIDTH, REPLY_MODE, REPLY_FREQ
+};
+
+static const unsigned char no_freq[] =
+{
+    REPLY_MODE, REPLY_WIDTH, REPLY_SPLIT
+};
+
+static const unsigned char freq_only[] =
+{
+    REPLY_FREQ
+};
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    struct fake_rig f;
+    struct exchange ex[2];
+    pthread_t thread;
+    int sv[2];
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    split_t split;
+    int errors = 0;
+    static const unsigned char expected[] =
+    {
+        0xfe, 0xfe, IC7300_ADDR, 0xe0, 0x03, 0xfd,
+        0xfe, 0xfe, IC7300_ADDR, 0xe0, 0x26, 0x00, 0xfd,
+        0xfe, 0xfe, IC7300_ADDR, 0xe0, 0x1a, 0x03, 0xfd,
+        0xfe, 0xfe, IC7300_ADDR, 0xe0, 0x0f, 0xfd
+    };
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    rig = open_fake(sv);
+
+    if (!rig)
+    {
+        fprintf(stderr, "cannot set up the IC-7300\n");
+        return 1;
+    }
+
+    /* all four requests in one write, replies in any order */
+    memset(&f, 0, sizeof(f));
+    f.fd = sv[1];
+    ex[0].frames = 4;
+    ex[0].reply = shuffled;
+    ex[0].reply_len = sizeof(shuffled);
+    f.exchanges = ex;
+    f.count = 1;
+    pthread_create(&thread, NULL, fake_rig_thread, &f);
+
+    CHECK(icom_get_vfo_info(rig, RIG_VFO_CURR, &freq, &mode, &width,
+                            &split) == RIG_OK);
+    pthread_join(thread, NULL);
+
+    CHECK(f.first_request_frames == 4);
+    CHECK(f.request_len == sizeof(expected)
+          && memcmp(f.request, expected, sizeof(expected)) == 0);
+    CHECK(freq == 14074000);
+    CHECK(mode == RIG_MODE_PKTUSB);
+    CHECK(width == 2700);
+    CHECK(split == RIG_SPLIT_ON);
+    /* the transceive frame went to the async handler */
+    CHECK(rig->state.use_cached_freq == 1);
+
+    /* the lost frequency reply is asked for again, alone */
+    memset(&f, 0, sizeof(f));
+    f.fd = sv[1];
+    ex[0].frames = 4;
+    ex[0].reply = no_freq;
+    ex[0].reply_len = sizeof(no_freq);
+    ex[1].frames = 1;
+    ex[1].reply = freq_only;
+    ex[1].reply_len = sizeof(freq_only);
+    f.exchanges = ex;
+    f.count = 2;
+    pthread_create(&thread, NULL, fake_rig_thread, &f);
+
+    CHECK(icom_get_vfo_info(rig, RIG_VFO_CURR, &freq, &mode, &width,
+                            &split) == RIG_OK);
+    pthread_join(thread, NULL);
+
+    CHECK(f.request_len == sizeof(expected) + 6
+          && memcmp(f.request + sizeof(expected), expected, 6) == 0);
+    CHECK(freq == 14074000);
+    CHECK(mode == RIG_MODE_PKTUSB);
+
+    /* without pipelining the frontend takes the usual way */
+    CHECK(rig_set_conf(rig, rig_token_lookup(rig, "civ_pipeline"), "1")
+          == RIG_OK);
+    CHECK(icom_get_vfo_info(rig, RIG_VFO_CURR, &freq, &mode, &width,
+                            &split) == -RIG_ENAVAIL);
+
+    /* nor for the VFO that is not selected */
+    CHECK(rig_set_conf(rig, rig_token_lookup(rig, "civ_pipeline"), "0")
+          == RIG_OK);
+    CHECK(icom_get_vfo_info(rig, RIG_VFO_B, &freq, &mode, &width,
+                            &split) == -RIG_ENAVAIL);
+
+    close_fake_rig(rig, sv);
+
+    return check_result(errors);
+}
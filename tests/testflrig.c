@@ -0,0 +1,187 @@
+/*
+ * Check of the flrig XML-RPC transport
+ *
+ * Queues the HTTP replies flrig would send on one end of a socketpair and
+ * opens the flrig backend on the other.  Checks that each reply is read up
+ * to its Content-length only, so that replies queued back to back are not
+ * mixed up, that faults are told apart from values, and that
+ * rig_get_vfo_info reads everything in one system.multicall and stops
+ * trying once flrig refuses it.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hamlib/rig.h>
+#include "testcheck.h"
+
+#define FAULT "<fault><value><struct>" \
+    "<member><name>faultCode</name><value><i4>-1</i4></value></member>" \
+    "<member><name>faultString</name><value>%s</value></member>" \
+    "</struct></value></fault>"
+
+/* a multicall response: each result is an array of one value */
+#define RESULT(v) "<value><array><data><value>" v "</value></data></array></value>"
+
+
+static void reply_body(int fd, const char *body)
+{
+    char buf[8192];
+    int len;
+
+    len = snprintf(buf, sizeof(buf),
+                   "HTTP/1.1 200 OK\r\nServer: XMLRPC++ 0.8\r\n"
+                   "Content-Type: text/xml\r\nContent-length: %d\r\n\r\n%s",
+                   (int) strlen(body), body);
+
+    if (write(fd, buf, len) != len)
+    {
+        perror("write");
+    }
+}
+
+
+static void reply(int fd, const char *value)
+{
+    char body[4096];
+
+    snprintf(body, sizeof(body),
+             "<?xml version=\"1.0\"?>\r\n<methodResponse><params><param>\r\n"
+             "\t<value>%s</value>\r\n</param></params></methodResponse>\r\n", value);
+    reply_body(fd, body);
+}
+
+
+static void reply_fault(int fd, const char *text)
+{
+    char fault[1024];
+    char body[4096];
+
+    snprintf(fault, sizeof(fault), FAULT, text);
+    snprintf(body, sizeof(body),
+             "<?xml version=\"1.0\"?>\r\n<methodResponse>%s</methodResponse>\r\n",
+             fault);
+    reply_body(fd, body);
+}
+
+
+/* what the backend sent since the last call, "" if nothing */
+static const char *requests(int fd)
+{
+    static char buf[65536];
+    int len = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT);
+
+    buf[len > 0 ? len : 0] = '\0';
+
+    return buf;
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    int sv[2];
+    freq_t freq;
+    rmode_t mode;
+    pbwidth_t width;
+    split_t split;
+    vfo_t tx_vfo;
+    ptt_t ptt;
+    const char *sent;
+    int errors = 0;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig_load_all_backends();
+
+    rig = open_fake_rig(RIG_MODEL_FLRIG, sv, 100);
+
+    if (!rig)
+    {
+        fprintf(stderr, "cannot set up flrig\n");
+        return 1;
+    }
+
+    rig->state.comm_state = 1;
+
+    /* what flrig_open asks, all at once */
+    reply(sv[1], "1.4.5");
+    reply(sv[1], "IC-7300");
+    reply(sv[1], "<i4>100</i4>");
+    reply(sv[1], "USB");
+    reply(sv[1], "<double>14074000</double>");
+    reply(sv[1], "<array><data><value>200</value><value>3000</value></data></array>");
+    reply(sv[1], "A");
+    reply(sv[1],
+          "<array><data><value>LSB</value><value>USB</value><value>CW</value>"
+          "<value>RTTY</value></data></array>");
+
+    CHECK(rig->caps->rig_open(rig) == RIG_OK);
+    sent = requests(sv[1]);
+    CHECK(strstr(sent, "Connection: keep-alive") != NULL);
+    CHECK(strstr(sent, "rig.get_modes") != NULL);
+    CHECK(requests(sv[1])[0] == '\0');
+
+    /* two replies queued, each call takes its own */
+    reply(sv[1], "<double>7074000</double>");
+    reply(sv[1], "<i4>1</i4>");
+    CHECK(rig->caps->get_freq(rig, RIG_VFO_B, &freq) == RIG_OK && freq == 7074000);
+    CHECK(rig->caps->get_split_vfo(rig, RIG_VFO_A, &split, &tx_vfo) == RIG_OK
+          && split == RIG_SPLIT_ON && tx_vfo == RIG_VFO_B);
+    requests(sv[1]);
+
+    /* an unknown method is not available, other faults are errors */
+    reply_fault(sv[1], "rig.get_ptt: unknown method name");
+    CHECK(rig->caps->get_ptt(rig, RIG_VFO_A, &ptt) == RIG_ENAVAIL);
+    reply_fault(sv[1], "XMLRPC: bad params");
+    CHECK(rig->caps->get_ptt(rig, RIG_VFO_A, &ptt) == -RIG_EPROTO);
+    requests(sv[1]);
+
+    /* frequency, mode, width and split in one round trip */
+    reply(sv[1],
+          "<array><data>"
+          RESULT("<double>14074000</double>")
+          RESULT("USB")
+          RESULT("<array><data><value>200</value><value>2400</value></data></array>")
+          RESULT("<i4>0</i4>")
+          "</data></array>");
+    CHECK(rig->caps->rig_get_vfo_info(rig, RIG_VFO_A, &freq, &mode, &width,
+                                      &split) == RIG_OK);
+    CHECK(freq == 14074000);
+    CHECK(mode == RIG_MODE_USB);
+    CHECK(width == 2400);
+    CHECK(split == RIG_SPLIT_OFF);
+    sent = requests(sv[1]);
+    CHECK(strstr(sent, "system.multicall") != NULL);
+    CHECK(strstr(sent, "rig.get_bwA") != NULL);
+    CHECK(strstr(sent, "rig.get_split") != NULL);
+
+    /* a failed call of a multicall fails it */
+    reply(sv[1],
+          "<array><data>"
+          RESULT("<double>7074000</double>")
+          "<value><struct><member><name>faultCode</name><value><i4>-1</i4></value>"
+          "</member></struct></value>"
+          RESULT("<array><data><value>200</value><value>2400</value></data></array>")
+          RESULT("<i4>0</i4>")
+          "</data></array>");
+    CHECK(rig->caps->rig_get_vfo_info(rig, RIG_VFO_B, &freq, &mode, &width,
+                                      &split) == -RIG_ENAVAIL);
+    requests(sv[1]);
+
+    /* flrig without system.multicall is asked once only */
+    reply_fault(sv[1], "system.multicall: unknown method name");
+    CHECK(rig->caps->rig_get_vfo_info(rig, RIG_VFO_A, &freq, &mode, &width,
+                                      &split) == -RIG_ENAVAIL);
+    requests(sv[1]);
+    CHECK(rig->caps->rig_get_vfo_info(rig, RIG_VFO_A, &freq, &mode, &width,
+                                      &split) == -RIG_ENAVAIL);
+    CHECK(requests(sv[1])[0] == '\0');
+
+    close_fake_rig(rig, sv);
+
+    return check_result(errors);
+}
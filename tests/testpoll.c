@@ -0,0 +1,117 @@
+/*
+ * Check of the adaptive poll schedule
+ *
+ * Drives the schedule of rig_poll_routine() with a simulated clock and
+ * checks that idle items back off, that a changed item and PTT are polled
+ * every poll_interval, PTT first, and that poll_budget limits the polls.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "poll_schedule.h"
+#include "testcheck.h"
+
+#define ALL_ITEMS ((1U << RIG_POLL_ITEMS) - 1)
+
+/*
+ * Run the schedule from now to end, the value of item changing every
+ * change_ms (never if 0), and count the polls of each item.
+ */
+static double run(struct rig_poll_schedule *s, double now, double end,
+                  int change_item, double change_ms, int counts[RIG_POLL_ITEMS])
+{
+    double last_change = now;
+
+    while (now < end)
+    {
+        int item;
+
+        while ((item = rig_poll_schedule_next(s, now)) >= 0)
+        {
+            int changed = 0;
+
+            if (item == change_item && change_ms > 0 && now - last_change >= change_ms)
+            {
+                changed = 1;
+                last_change = now;
+            }
+
+            counts[item]++;
+            rig_poll_schedule_done(s, item, now, changed);
+        }
+
+        now += rig_poll_schedule_wait(s, now);
+    }
+
+    return now;
+}
+
+
+int main(int argc, char *argv[])
+{
+    struct rig_poll_schedule s;
+    int counts[RIG_POLL_ITEMS];
+    double now;
+    int i, total;
+    int errors = 0;
+
+    /* everything is due at first, PTT first */
+    rig_poll_schedule_init(&s, 100, 0, ALL_ITEMS);
+
+    for (i = 0; i < RIG_POLL_ITEMS; i++)
+    {
+        CHECK(rig_poll_schedule_next(&s, 0) == i);
+        rig_poll_schedule_done(&s, i, 0, 0);
+    }
+
+    CHECK(rig_poll_schedule_next(&s, 50) == -1);
+    CHECK(rig_poll_schedule_wait(&s, 50) == 50);
+    CHECK(rig_poll_schedule_next(&s, 100) == RIG_POLL_PTT);
+    rig_poll_schedule_done(&s, RIG_POLL_PTT, 100, 0);
+    CHECK(rig_poll_schedule_next(&s, 100) == -1);
+    CHECK(s.interval_ms[RIG_POLL_FREQ_MAIN] == 200);
+
+    /* idle items back off to 8 times poll_interval, PTT does not */
+    memset(counts, 0, sizeof(counts));
+    now = run(&s, 100, 10100, -1, 0, counts);
+    CHECK(s.interval_ms[RIG_POLL_FREQ_MAIN] == 800);
+    CHECK(s.interval_ms[RIG_POLL_PTT] == 100);
+    CHECK(counts[RIG_POLL_PTT] >= 99 && counts[RIG_POLL_PTT] <= 101);
+    CHECK(counts[RIG_POLL_FREQ_MAIN] <= 16);
+
+    /* a turning knob is polled every poll_interval */
+    memset(counts, 0, sizeof(counts));
+    now = run(&s, now, now + 10000, RIG_POLL_FREQ_MAIN, 1, counts);
+    CHECK(counts[RIG_POLL_FREQ_MAIN] >= 95);
+    CHECK(counts[RIG_POLL_FREQ_SUB] <= 14);
+
+    /* and backs off once it stops */
+    memset(counts, 0, sizeof(counts));
+    now = run(&s, now, now + 2000, -1, 0, counts);
+    CHECK(s.interval_ms[RIG_POLL_FREQ_MAIN] == 800);
+
+    /* a VFO change makes frequency and mode due at once */
+    rig_poll_schedule_done(&s, RIG_POLL_VFO, now, 1);
+    CHECK(s.due_ms[RIG_POLL_FREQ_MAIN] == now && s.due_ms[RIG_POLL_MODE_SUB] == now);
+    CHECK(s.interval_ms[RIG_POLL_MODE_SUB] == 100);
+
+    /* 20 polls per second: the budget holds, PTT still comes first */
+    rig_poll_schedule_init(&s, 10, 20, ALL_ITEMS);
+    memset(counts, 0, sizeof(counts));
+    run(&s, 0, 10000, RIG_POLL_FREQ_MAIN, 1, counts);
+
+    for (total = 0, i = 0; i < RIG_POLL_ITEMS; i++)
+    {
+        total += counts[i];
+    }
+
+    CHECK(total <= 20 * 10 + 20);
+    CHECK(counts[RIG_POLL_PTT] >= 95 && counts[RIG_POLL_PTT] <= 101);
+    CHECK(counts[RIG_POLL_FREQ_MAIN] >= 20);
+
+    return check_result(errors);
+}
@@ -0,0 +1,132 @@
+/*
+ * Check of the priority lock of the rig transactions
+ *
+ * While the main thread holds the lock, a background, a user and an
+ * urgent thread queue for it in that order.  Checks that they get it in
+ * the reverse order, and that the waits are counted per priority.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <hamlib/rig.h>
+#include "misc.h"
+#include "prio_lock.h"
+#include "testcheck.h"
+
+
+struct waiter
+{
+    RIG *rig;
+    int priority;
+};
+
+static pthread_mutex_t order_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int order[RIG_PRIO_N];
+static int order_len;
+
+
+static void *waiter_thread(void *arg)
+{
+    struct waiter *w = arg;
+
+    rig_set_priority(w->priority);
+    set_transaction_active(w->rig);
+
+    pthread_mutex_lock(&order_mutex);
+    order[order_len++] = w->priority;
+    pthread_mutex_unlock(&order_mutex);
+
+    set_transaction_inactive(w->rig);
+
+    return NULL;
+}
+
+
+/* wait until n threads of priority queue for the lock */
+static void wait_queued(RIG *rig, int priority, int n)
+{
+    struct rig_prio_lock *lock = rig->state.transaction_lock;
+    int queued;
+
+    do
+    {
+        hl_usleep(1000);
+        pthread_mutex_lock(&lock->mutex);
+        queued = lock->waiting[priority];
+        pthread_mutex_unlock(&lock->mutex);
+    }
+    while (queued < n);
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    struct waiter w[RIG_PRIO_N];
+    pthread_t threads[RIG_PRIO_N];
+    struct rig_transaction_stats stats;
+    static const int queue_order[RIG_PRIO_N] =
+    {
+        RIG_PRIO_BACKGROUND, RIG_PRIO_USER, RIG_PRIO_URGENT
+    };
+    int errors = 0;
+    int i;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    rig = rig_init(RIG_MODEL_DUMMY);
+
+    if (!rig)
+    {
+        fprintf(stderr, "rig_init failed\n");
+        return 1;
+    }
+
+    CHECK(rig_get_priority() == RIG_PRIO_USER);
+    CHECK(rig_set_priority(RIG_PRIO_BACKGROUND) == RIG_PRIO_USER);
+    CHECK(rig_set_priority(RIG_PRIO_USER) == RIG_PRIO_BACKGROUND);
+    CHECK(rig_set_priority(RIG_PRIO_N) == -RIG_EINVAL);
+
+    set_transaction_active(rig);
+
+    for (i = 0; i < RIG_PRIO_N; i++)
+    {
+        w[i].rig = rig;
+        w[i].priority = queue_order[i];
+        pthread_create(&threads[i], NULL, waiter_thread, &w[i]);
+        wait_queued(rig, queue_order[i], 1);
+    }
+
+    hl_usleep(20 * 1000);
+    set_transaction_inactive(rig);
+
+    for (i = 0; i < RIG_PRIO_N; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    CHECK(order_len == RIG_PRIO_N);
+    CHECK(order[0] == RIG_PRIO_URGENT);
+    CHECK(order[1] == RIG_PRIO_USER);
+    CHECK(order[2] == RIG_PRIO_BACKGROUND);
+
+    /* the main thread and the user thread */
+    CHECK(rig_get_transaction_stats(rig, RIG_PRIO_USER, &stats) == RIG_OK);
+    CHECK(stats.count == 2);
+    CHECK(stats.wait_max_ms >= 20);
+
+    CHECK(rig_get_transaction_stats(rig, RIG_PRIO_URGENT, &stats) == RIG_OK);
+    CHECK(stats.count == 1);
+    CHECK(stats.wait_total_ms <= stats.wait_max_ms);
+
+    CHECK(rig_get_transaction_stats(rig, RIG_PRIO_N, &stats) == -RIG_EINVAL);
+
+    rig_cleanup(rig);
+
+    return check_result(errors);
+}
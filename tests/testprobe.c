@@ -0,0 +1,212 @@
+/*
+ * Check of the rig auto-probe
+ *
+ * Checks the rate ordering, the classification of the replies to the
+ * shared listen window and the cache of the models found.  Then probes
+ * two fake TS-2000, each on its own pseudo terminal, in parallel and
+ * checks that both are found and remembered.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+
+#include <hamlib/rig.h>
+#include "probe.h"
+#include "testcheck.h"
+
+#define CACHE "testprobe.cache"
+#define NFAKES 2
+
+struct fake
+{
+    int master;
+    int slave;          /* held open, so the master never reads EIO */
+    char pathname[HAMLIB_FILPATHLEN];
+    volatile int stop;
+};
+
+
+/* answers ID; like a TS-2000, ignores everything else */
+static void *fake_ts2000(void *arg)
+{
+    struct fake *f = arg;
+    char buf[256];
+    int len = 0;
+
+    while (!f->stop)
+    {
+        struct pollfd pfd = { f->master, POLLIN, 0 };
+        int n;
+
+        if (poll(&pfd, 1, 20) <= 0)
+        {
+            continue;
+        }
+
+        n = read(f->master, buf + len, sizeof(buf) - 1 - len);
+
+        if (n <= 0)
+        {
+            usleep(1000);
+            continue;
+        }
+
+        len += n;
+        buf[len] = '\0';
+
+        if (memmem(buf, len, "ID;", 3))
+        {
+            if (write(f->master, "ID019;", 6) != 6)
+            {
+                perror("write");
+            }
+
+            len = 0;
+        }
+        else if (len > (int) sizeof(buf) / 2)
+        {
+            len = 0;
+        }
+    }
+
+    return NULL;
+}
+
+
+static int fake_open(struct fake *f)
+{
+    struct termios t;
+
+    f->master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (f->master < 0 || grantpt(f->master) != 0 || unlockpt(f->master) != 0)
+    {
+        return -1;
+    }
+
+    strncpy(f->pathname, ptsname(f->master), sizeof(f->pathname) - 1);
+    f->slave = open(f->pathname, O_RDWR | O_NOCTTY);
+
+    if (f->slave < 0 || tcgetattr(f->slave, &t) != 0)
+    {
+        return -1;
+    }
+
+    cfmakeraw(&t);
+    tcsetattr(f->slave, TCSANOW, &t);
+    f->stop = 0;
+
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const unsigned char echo[] =
+    {
+        'I', 'D', ';', 0xfe, 0xfe, 0x00, 0xe0, 0x19, 0x00, 0xfd
+    };
+    static const unsigned char civ_reply[] =
+    {
+        0xfe, 0xfe, 0x00, 0xe0, 0x19, 0x00, 0xfd,
+        0xfe, 0xfe, 0xe0, 0x94, 0x19, 0x00, 0x94, 0xfd
+    };
+    int rates[] = { 115200, 57600, 38400, 19200, 9600, 0 };
+    struct fake fakes[NFAKES];
+    pthread_t threads[NFAKES];
+    hamlib_port_t ports[NFAKES];
+    hamlib_port_t *pports[NFAKES];
+    rig_model_t models[NFAKES];
+    hamlib_port_t port;
+    rig_model_t model;
+    int rate;
+    int errors = 0;
+    int i;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    rig_load_all_backends();
+
+    /* the rate of the port first, the others in order */
+    memset(&port, 0, sizeof(port));
+    port.parm.serial.rate = 19200;
+    rig_probe_rate_first(&port, rates);
+    CHECK(rates[0] == 19200 && rates[1] == 115200 && rates[3] == 38400
+          && rates[4] == 9600);
+    port.parm.serial.rate = 4800;
+    rig_probe_rate_first(&port, rates);
+    CHECK(rates[0] == 19200 && rates[4] == 9600);
+
+    /* our own echoes are not an answer */
+    CHECK(rig_probe_classify(echo, sizeof(echo)) == -1);
+    CHECK(rig_probe_classify((const unsigned char *) "ID;ID019;", 9) == RIG_KENWOOD);
+    CHECK(rig_probe_classify((const unsigned char *) "ID;ID01", 7) == -1);
+    CHECK(rig_probe_classify(civ_reply, sizeof(civ_reply)) == RIG_ICOM);
+    CHECK(rig_probe_classify(civ_reply, sizeof(civ_reply) - 1) == -1);
+
+    /* one line per port, the latest model wins */
+    remove(CACHE);
+    setenv("HAMLIB_PROBE_CACHE", CACHE, 1);
+    CHECK(rig_probe_cache_lookup("/dev/ttyUSB0", &model, &rate) == -RIG_ENAVAIL);
+    CHECK(rig_probe_cache_store("/dev/ttyUSB0", RIG_MODEL_TS2000, 57600) == RIG_OK);
+    CHECK(rig_probe_cache_store("/dev/ttyUSB1", RIG_MODEL_IC7300, 19200) == RIG_OK);
+    CHECK(rig_probe_cache_store("/dev/ttyUSB0", RIG_MODEL_TS590S, 115200) == RIG_OK);
+    CHECK(rig_probe_cache_lookup("/dev/ttyUSB0", &model, &rate) == RIG_OK
+          && model == RIG_MODEL_TS590S && rate == 115200);
+    CHECK(rig_probe_cache_lookup("/dev/ttyUSB1", &model, &rate) == RIG_OK
+          && model == RIG_MODEL_IC7300 && rate == 19200);
+    remove(CACHE);
+
+    /* two rigs probed at once */
+    for (i = 0; i < NFAKES; i++)
+    {
+        if (fake_open(&fakes[i]) != 0)
+        {
+            fprintf(stderr, "no pseudo terminal, skipping the probe\n");
+            return errors ? 1 : 0;
+        }
+
+        pthread_create(&threads[i], NULL, fake_ts2000, &fakes[i]);
+
+        memset(&ports[i], 0, sizeof(ports[i]));
+        ports[i].type.rig = RIG_PORT_SERIAL;
+        strncpy(ports[i].pathname, fakes[i].pathname, HAMLIB_FILPATHLEN - 1);
+        ports[i].parm.serial.rate = 9600;
+        ports[i].parm.serial.data_bits = 8;
+        ports[i].parm.serial.stop_bits = 1;
+        ports[i].parm.serial.parity = RIG_PARITY_NONE;
+        ports[i].parm.serial.handshake = RIG_HANDSHAKE_NONE;
+        pports[i] = &ports[i];
+    }
+
+    CHECK(rig_probe_ports(pports, NFAKES, models) == RIG_OK);
+
+    for (i = 0; i < NFAKES; i++)
+    {
+        CHECK(models[i] == RIG_MODEL_TS2000);
+        CHECK(rig_probe_cache_lookup(fakes[i].pathname, &model, &rate) == RIG_OK
+              && model == RIG_MODEL_TS2000 && rate == 115200);
+    }
+
+    /* and found straight away the next time */
+    CHECK(rig_probe(&ports[0]) == RIG_MODEL_TS2000);
+
+    for (i = 0; i < NFAKES; i++)
+    {
+        fakes[i].stop = 1;
+        pthread_join(threads[i], NULL);
+        close(fakes[i].slave);
+        close(fakes[i].master);
+    }
+
+    remove(CACHE);
+
+    return check_result(errors);
+}
@@ -0,0 +1,118 @@
+/*
+ * Check of the on-demand backend registration
+ *
+ * rig_init() registers the rigs of the backend of its model only, for
+ * one backend after another, and rig_load_all_backends() registers the
+ * rest, once.  Threads that need the same backend at once all find their
+ * model.  rig_list_foreach() goes through the models in order, also when
+ * its callback unregisters them.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <hamlib/rig.h>
+#include "testcheck.h"
+
+
+struct walk
+{
+    rig_model_t last;
+    int count;
+    int unordered;
+    int unregister;
+};
+
+
+static int walk_caps(const struct rig_caps *caps, rig_ptr_t data)
+{
+    struct walk *w = data;
+
+    if (caps->rig_model <= w->last)
+    {
+        w->unordered++;
+    }
+
+    w->last = caps->rig_model;
+    w->count++;
+
+    if (w->unregister && RIG_BACKEND_NUM(caps->rig_model) == RIG_YAESU)
+    {
+        rig_unregister(caps->rig_model);
+    }
+
+    return 1;
+}
+
+
+static void *check_alinco(void *arg)
+{
+    *(int *)arg = rig_check_backend(RIG_MODEL_DX77);
+    return NULL;
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *kenwood, *icom;
+    struct walk w1 = { 0, 0, 0, 0 }, w2 = { 0, 0, 0, 1 }, w3 = { 0, 0, 0, 0 };
+    pthread_t threads[8];
+    int results[8];
+    int errors = 0;
+    int i;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    CHECK(rig_get_caps(RIG_MODEL_TS2000) == NULL);
+
+    kenwood = rig_init(RIG_MODEL_TS2000);
+    CHECK(kenwood != NULL);
+    CHECK(rig_get_caps(RIG_MODEL_TS590S) != NULL);
+    CHECK(rig_get_caps(RIG_MODEL_IC7300) == NULL);
+    CHECK(rig_get_caps(RIG_MODEL_FT991) == NULL);
+
+    /* a second backend */
+    icom = rig_init(RIG_MODEL_IC7300);
+    CHECK(icom != NULL);
+    CHECK(rig_get_caps(RIG_MODEL_FT991) == NULL);
+
+    /* a model its loaded backend does not have */
+    CHECK(rig_init(RIG_MAKE_MODEL(RIG_KENWOOD, 999)) == NULL);
+
+    /* none sees the backend loaded before its rigs are registered */
+    for (i = 0; i < 8; i++)
+    {
+        results[i] = -RIG_EINTERNAL;
+        CHECK(pthread_create(&threads[i], NULL, check_alinco, &results[i]) == 0);
+    }
+
+    for (i = 0; i < 8; i++)
+    {
+        pthread_join(threads[i], NULL);
+        CHECK(results[i] == RIG_OK);
+    }
+
+    CHECK(rig_load_all_backends() == RIG_OK);
+    CHECK(rig_get_caps(RIG_MODEL_FT991) != NULL);
+    CHECK(rig_load_all_backends() == RIG_OK);
+    CHECK(rig_check_backend(RIG_MODEL_TS2000) == RIG_OK);
+
+    CHECK(rig_list_foreach(walk_caps, &w1) == RIG_OK);
+    CHECK(w1.count > 200 && w1.unordered == 0);
+
+    /* the Yaesu are gone, nothing else is skipped */
+    CHECK(rig_list_foreach(walk_caps, &w2) == RIG_OK);
+    CHECK(w2.count == w1.count && w2.unordered == 0);
+    CHECK(rig_get_caps(RIG_MODEL_FT991) == NULL);
+    CHECK(rig_get_caps(RIG_MODEL_TS2000) != NULL);
+    CHECK(rig_list_foreach(walk_caps, &w3) == RIG_OK);
+    CHECK(w3.count < w1.count && w3.unordered == 0);
+
+    rig_cleanup(icom);
+    rig_cleanup(kenwood);
+
+    return check_result(errors);
+}
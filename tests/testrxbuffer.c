@@ -0,0 +1,111 @@
+/*
+ * Check of the port receive buffer
+ *
+ * Feeds several responses at once through a socket pair and reads them back
+ * with read_string() and read_block(), which must split them at the stop
+ * set and keep what follows for the next read.  Also checks that a flush
+ * drops the buffered bytes, and that a port that is not the rig port of
+ * a rig reads without reading ahead.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hamlib/rig.h>
+#include "iofunc.h"
+#include "testcheck.h"
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    hamlib_port_t *port, bare;
+    struct port_private *pp;
+    unsigned char buf[64];
+    int sv[2];
+    int errors = 0;
+    int n;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    rig = open_fake_rig(RIG_MODEL_DUMMY, sv, 100);
+
+    if (!rig)
+    {
+        fprintf(stderr, "cannot set up the dummy rig\n");
+        return 1;
+    }
+
+    port = &rig->state.rigport;
+    pp = port_private(port);
+
+    if (!pp)
+    {
+        fprintf(stderr, "the rig port has no receive buffer\n");
+        return 1;
+    }
+
+    /* two responses and the start of a third in one read */
+    CHECK(feed(sv[1], "FA00014074000;MD2;IF000"));
+
+    n = read_string(port, buf, sizeof(buf), ";", 1, 0, 1);
+    CHECK(n == 14 && strcmp((char *) buf, "FA00014074000;") == 0);
+    CHECK(pp->rx_count == 9);
+
+    n = read_string(port, buf, sizeof(buf), "\r;", 2, 0, 1);
+    CHECK(n == 4 && strcmp((char *) buf, "MD2;") == 0);
+
+    /* the rest of the third one arrives later */
+    CHECK(feed(sv[1], "14074000;\xfe\xfe\x94\xe0"));
+    n = read_string(port, buf, sizeof(buf), ";", 1, 0, 1);
+    CHECK(n == 14 && strcmp((char *) buf, "IF00014074000;") == 0);
+
+    /* a block picks up the buffered bytes first */
+    CHECK(feed(sv[1], "\x03\xfd"));
+    n = read_block(port, buf, 6);
+    CHECK(n == 6 && memcmp(buf, "\xfe\xfe\x94\xe0\x03\xfd", 6) == 0);
+    CHECK(pp->rx_count == 0);
+
+    /* no stop char within rxmax - 1 bytes */
+    CHECK(feed(sv[1], "0123456789;"));
+    n = read_string(port, buf, 5, ";", 1, 0, 1);
+    CHECK(n == 4 && strcmp((char *) buf, "0123") == 0);
+    n = read_string(port, buf, sizeof(buf), ";", 1, 0, 1);
+    CHECK(n == 7 && strcmp((char *) buf, "456789;") == 0);
+
+    /* nothing left, so this times out */
+    CHECK(read_string(port, buf, sizeof(buf), ";", 1, 1, 1) == -RIG_ETIMEOUT);
+
+    /* a flush drops what was read ahead */
+    CHECK(feed(sv[1], "FA00014074000;FB00007074000;"));
+    n = read_string(port, buf, sizeof(buf), ";", 1, 0, 1);
+    CHECK(n == 14 && pp->rx_count == 14);
+    port_rx_discard(port);
+    CHECK(pp->rx_count == 0);
+    CHECK(read_string(port, buf, sizeof(buf), ";", 1, 1, 1) == -RIG_ETIMEOUT);
+
+    close_fake_rig(rig, sv);
+
+    /* other ports read a byte at a time and keep nothing */
+    if (open_port_pair(&bare, sv, 100) != 0)
+    {
+        perror("socketpair");
+        return 1;
+    }
+
+    CHECK(port_private(&bare) == NULL);
+    CHECK(feed(sv[1], "FA00014074000;MD2;"));
+    n = read_string(&bare, buf, sizeof(buf), ";", 1, 0, 1);
+    CHECK(n == 14 && strcmp((char *) buf, "FA00014074000;") == 0);
+    n = read_string(&bare, buf, sizeof(buf), ";", 1, 0, 1);
+    CHECK(n == 4 && strcmp((char *) buf, "MD2;") == 0);
+
+    close(sv[0]);
+    close(sv[1]);
+
+    return check_result(errors);
+}
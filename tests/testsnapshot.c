@@ -0,0 +1,172 @@
+/*
+ * Round trip check of the binary multicast snapshot format
+ *
+ * Encodes a snapshot of the dummy rig with a spectrum line, decodes it
+ * with rig_snapshot_decode() and compares the result, then checks that
+ * delta packets update the decoded state and that lost packets are
+ * detected.  Also prints the size of the binary packet next to the JSON
+ * one.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hamlib/rig.h>
+#include "snapshot_data.h"
+#include "testcheck.h"
+
+
+int main(int argc, char *argv[])
+{
+    RIG *my_rig;
+    unsigned char spectrum_data[475];
+    unsigned char packet[HAMLIB_MAX_SNAPSHOT_PACKET_SIZE];
+    char json[HAMLIB_MAX_SNAPSHOT_PACKET_SIZE];
+    struct rig_spectrum_line line;
+    struct rig_snapshot snap;
+    struct snapshot_binary_state state;
+    size_t length = 0, keyframe_length;
+    int retcode;
+    int errors = 0;
+    int i;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    my_rig = rig_init(RIG_MODEL_DUMMY);
+
+    if (!my_rig || rig_open(my_rig) != RIG_OK)
+    {
+        fprintf(stderr, "cannot open the dummy rig\n");
+        return 1;
+    }
+
+    rig_set_freq(my_rig, RIG_VFO_A, 14074000);
+    rig_set_mode(my_rig, RIG_VFO_A, RIG_MODE_PKTUSB, 3000);
+    rig_set_freq(my_rig, RIG_VFO_B, 7074000);
+
+    for (i = 0; i < sizeof(spectrum_data); i++)
+    {
+        spectrum_data[i] = i & 0xff;
+    }
+
+    memset(&line, 0, sizeof(line));
+    line.id = 1;
+    line.data_level_min = 0;
+    line.data_level_max = 160;
+    line.signal_strength_min = -80;
+    line.signal_strength_max = -30;
+    line.spectrum_mode = RIG_SPECTRUM_MODE_CENTER;
+    line.center_freq = 14074000;
+    line.span_freq = 25000;
+    line.spectrum_data_length = sizeof(spectrum_data);
+    line.spectrum_data = spectrum_data;
+
+    my_rig->state.snapshot_packet_sequence_number = 41;
+
+    retcode = snapshot_serialize_binary(sizeof(packet), packet, &length, my_rig,
+                                        &line, NULL);
+    CHECK(retcode == RIG_OK);
+
+    memset(&snap, 0, sizeof(snap));
+    retcode = rig_snapshot_decode(packet, length, &snap);
+    CHECK(retcode == RIG_OK);
+
+    CHECK(snap.seq == 41);
+    CHECK(snap.keyframe && snap.synced);
+    CHECK(my_rig->state.snapshot_packet_sequence_number == 42);
+    CHECK(snap.model == RIG_MODEL_DUMMY);
+    CHECK(strcmp(snap.name, my_rig->caps->model_name) == 0);
+    CHECK(snap.status == 1);
+    CHECK(snap.vfo_count == 2);
+    CHECK(snap.vfos[0].vfo == RIG_VFO_A);
+    CHECK(snap.vfos[0].cached);
+    CHECK(snap.vfos[0].freq == 14074000);
+    CHECK(snap.vfos[0].mode == RIG_MODE_PKTUSB);
+    CHECK(snap.vfos[0].width == 3000);
+    CHECK(snap.vfos[1].vfo == RIG_VFO_B);
+    CHECK(snap.vfos[1].freq == 7074000);
+    CHECK(snap.has_spectrum);
+    CHECK(snap.spectrum.id == 1);
+    CHECK(snap.spectrum.data_level_max == 160);
+    CHECK(snap.spectrum.signal_strength_min == -80);
+    CHECK(snap.spectrum.spectrum_mode == RIG_SPECTRUM_MODE_CENTER);
+    CHECK(snap.spectrum.span_freq == 25000);
+    CHECK(snap.spectrum.spectrum_data_length == sizeof(spectrum_data));
+    CHECK(snap.spectrum.spectrum_data
+          && memcmp(snap.spectrum.spectrum_data, spectrum_data,
+                    sizeof(spectrum_data)) == 0);
+
+    /* truncated and foreign packets must be rejected */
+    CHECK(rig_snapshot_decode(packet, length - 1, &snap) == -RIG_EPROTO);
+    CHECK(rig_snapshot_decode((unsigned char *) "{\"app\":", 7,
+                              &snap) == -RIG_EPROTO);
+
+    /* the packet does not fit */
+    CHECK(snapshot_serialize_binary(64, packet, &length, my_rig,
+                                    &line, NULL) == -RIG_EINVAL);
+
+    /* keyframe, then only what changed */
+    memset(&state, 0, sizeof(state));
+    state.keyframe_interval_ms = 60000;
+    memset(&snap, 0, sizeof(snap));
+
+    CHECK(snapshot_serialize_binary(sizeof(packet), packet, &length, my_rig,
+                                    NULL, &state) == RIG_OK);
+    CHECK(rig_snapshot_decode(packet, length, &snap) == RIG_OK);
+    CHECK(snap.keyframe && snap.synced && snap.vfo_count == 2);
+    keyframe_length = length;
+
+    rig_set_freq(my_rig, RIG_VFO_A, 14075000);
+
+    CHECK(snapshot_serialize_binary(sizeof(packet), packet, &length, my_rig,
+                                    NULL, &state) == RIG_OK);
+    CHECK(length > 0 && length < keyframe_length);
+    CHECK(rig_snapshot_decode(packet, length, &snap) == RIG_OK);
+    CHECK(!snap.keyframe && snap.synced && snap.lost == 0);
+    CHECK(snap.vfos[0].freq == 14075000);
+    CHECK(snap.vfos[0].mode == RIG_MODE_PKTUSB);
+    CHECK(snap.vfos[1].freq == 7074000);
+    CHECK(strcmp(snap.name, my_rig->caps->model_name) == 0);
+    printf("keyframe %d bytes, freq delta %d bytes\n", (int) keyframe_length,
+           (int) length);
+
+    /* no change, no packet */
+    CHECK(snapshot_serialize_binary(sizeof(packet), packet, &length, my_rig,
+                                    NULL, &state) == RIG_OK);
+    CHECK(length == 0);
+
+    /* a delta that never arrives */
+    rig_set_freq(my_rig, RIG_VFO_B, 7076000);
+    CHECK(snapshot_serialize_binary(sizeof(packet), packet, &length, my_rig,
+                                    NULL, &state) == RIG_OK);
+    rig_set_freq(my_rig, RIG_VFO_A, 14076000);
+    CHECK(snapshot_serialize_binary(sizeof(packet), packet, &length, my_rig,
+                                    NULL, &state) == RIG_OK);
+    CHECK(rig_snapshot_decode(packet, length, &snap) == RIG_OK);
+    CHECK(!snap.synced && snap.lost == 1);
+    CHECK(snap.vfos[0].freq == 14076000);
+
+    /* the next keyframe brings the receiver back in sync */
+    state.keyframe_interval_ms = 0;
+    CHECK(snapshot_serialize_binary(sizeof(packet), packet, &length, my_rig,
+                                    NULL, &state) == RIG_OK);
+    CHECK(rig_snapshot_decode(packet, length, &snap) == RIG_OK);
+    CHECK(snap.keyframe && snap.synced && snap.lost == 1);
+    CHECK(snap.vfos[1].freq == 7076000);
+
+    if (snapshot_serialize(sizeof(json), json, my_rig, &line) == RIG_OK)
+    {
+        snapshot_serialize_binary(sizeof(packet), packet, &length, my_rig, &line,
+                                  NULL);
+        printf("snapshot with %d spectrum bytes: JSON %d bytes, binary %d bytes\n",
+               (int) sizeof(spectrum_data), (int) strlen(json), (int) length);
+    }
+
+    rig_close(my_rig);
+    rig_cleanup(my_rig);
+
+    return check_result(errors);
+}
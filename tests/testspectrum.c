@@ -0,0 +1,96 @@
+/*
+ * Check of the spectrum line ring
+ *
+ * Fires spectrum events on the dummy rig and borrows the lines back with
+ * rig_get_spectrum_lines(), both the latest ones and with a cursor, and
+ * checks that overwritten lines are reported by rig_spectrum_ref_valid().
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hamlib/rig.h>
+#include "event.h"
+#include "testcheck.h"
+
+#define LINE_LENGTH 689
+
+
+static void fire_lines(RIG *rig, int first, int count)
+{
+    unsigned char data[LINE_LENGTH];
+    struct rig_spectrum_line line;
+    int i;
+
+    memset(&line, 0, sizeof(line));
+    line.spectrum_data = data;
+    line.spectrum_data_length = sizeof(data);
+
+    for (i = first; i < first + count; i++)
+    {
+        line.center_freq = 14000000 + i;
+        memset(data, i & 0xff, sizeof(data));
+        rig_fire_spectrum_event(rig, &line);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *my_rig;
+    struct rig_spectrum_ref refs[2 * HAMLIB_SPECTRUM_RING_SIZE];
+    uint64_t cursor = 0;
+    int errors = 0;
+    int i, n;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    my_rig = rig_init(RIG_MODEL_DUMMY);
+
+    if (!my_rig)
+    {
+        fprintf(stderr, "rig_init failed\n");
+        return 1;
+    }
+
+    CHECK(rig_get_spectrum_lines(my_rig, NULL, refs, 8) == 0);
+
+    fire_lines(my_rig, 0, 100);
+
+    /* the latest lines, oldest first */
+    n = rig_get_spectrum_lines(my_rig, NULL, refs, 8);
+    CHECK(n == 8);
+
+    for (i = 0; i < n; i++)
+    {
+        CHECK(refs[i].seq == 92 + i);
+        CHECK(refs[i].line->center_freq == 14000000 + 92 + i);
+        CHECK(refs[i].line->spectrum_data_length == LINE_LENGTH);
+        CHECK(refs[i].line->spectrum_data[LINE_LENGTH - 1] == 92 + i);
+        CHECK(rig_spectrum_ref_valid(my_rig, &refs[i]));
+    }
+
+    /* a reader that fell behind gets what is left, then only new lines */
+    n = rig_get_spectrum_lines(my_rig, &cursor, refs, 2 * HAMLIB_SPECTRUM_RING_SIZE);
+    CHECK(n == HAMLIB_SPECTRUM_RING_SIZE - 1);
+    CHECK(refs[0].seq == 100 - (HAMLIB_SPECTRUM_RING_SIZE - 1));
+    CHECK(refs[n - 1].seq == 99);
+    CHECK(cursor == 100);
+
+    CHECK(rig_get_spectrum_lines(my_rig, &cursor, refs, 8) == 0);
+
+    fire_lines(my_rig, 100, 3);
+    n = rig_get_spectrum_lines(my_rig, &cursor, refs, 8);
+    CHECK(n == 3 && refs[0].seq == 100 && cursor == 103);
+
+    /* lines wrapped around by the producer are no longer valid */
+    fire_lines(my_rig, 103, HAMLIB_SPECTRUM_RING_SIZE);
+    CHECK(!rig_spectrum_ref_valid(my_rig, &refs[0]));
+
+    rig_cleanup(my_rig);
+
+    return check_result(errors);
+}
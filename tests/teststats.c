@@ -0,0 +1,153 @@
+/*
+ * Check of the latency statistics
+ *
+ * Times the calls of a dummy rig and reads of its port through a socket
+ * pair, then checks the counters of rig_get_call_stats() and
+ * rig_get_port_stats(), and that rig_stats_prometheus() prints them.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <hamlib/rig.h>
+#include "iofunc.h"
+#include "testcheck.h"
+
+
+/* the counters of func, or NULL if it was not timed */
+static const struct rig_call_stats *find(RIG *rig, const char *func)
+{
+    static struct rig_call_stats stats;
+    int i;
+
+    for (i = 0; rig_get_call_stats(rig, i, &stats) == RIG_OK; i++)
+    {
+        if (strcmp(stats.name, func) == 0)
+        {
+            return &stats;
+        }
+    }
+
+    return NULL;
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    hamlib_port_t *port;
+    struct rig_call_stats a, b;
+    struct rig_port_stats ps;
+    const struct rig_call_stats *call;
+    unsigned char buf[64];
+    char out[65536];
+    freq_t freq;
+    FILE *fp;
+    size_t len;
+    int sv[2];
+    int errors = 0;
+    int i;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    {
+        perror("socketpair");
+        return 1;
+    }
+
+    rig = rig_init(RIG_MODEL_DUMMY);
+
+    if (!rig || rig_open(rig) != RIG_OK)
+    {
+        fprintf(stderr, "cannot open the dummy rig\n");
+        return 1;
+    }
+
+    /* the first get after a set is answered from the cache */
+    CHECK(rig_set_freq(rig, RIG_VFO_A, 14074000) == RIG_OK);
+    CHECK(rig_get_freq(rig, RIG_VFO_A, &freq) == RIG_OK);
+    CHECK(rig_get_freq(rig, RIG_VFO_A, &freq) == RIG_OK);
+
+    call = find(rig, "rig_get_freq");
+    CHECK(call != NULL);
+
+    if (call)
+    {
+        CHECK(call->latency.count == 2);
+        CHECK(call->cache_hits >= 1);
+        CHECK(call->cache_hits + call->cache_misses == 2);
+    }
+
+    call = find(rig, "rig_set_freq");
+    CHECK(call != NULL && call->latency.count == 1 && call->cache_hits == 0);
+
+    /* by name, then the end */
+    for (i = 0; rig_get_call_stats(rig, i + 1, &b) == RIG_OK; i++)
+    {
+        CHECK(rig_get_call_stats(rig, i, &a) == RIG_OK);
+        CHECK(strcmp(a.name, b.name) < 0);
+    }
+
+    CHECK(i > 0);
+    CHECK(rig_get_call_stats(rig, -1, &a) == -RIG_EINVAL);
+
+    /* reads of the rig port */
+    port = &rig->state.rigport;
+    port->type.rig = RIG_PORT_DEVICE;
+    port->fd = sv[0];
+    port->timeout = 20;
+    port->asyncio = 0;
+
+    CHECK(write(sv[1], "FA00014074000;", 14) == 14);
+    CHECK(read_string(port, buf, sizeof(buf), ";", 1, 0, 1) == 14);
+    CHECK(read_string(port, buf, sizeof(buf), ";", 1, 0, 1) == -RIG_ETIMEOUT);
+
+    /* a flush that finds nothing is not a timeout */
+    CHECK(read_string(port, buf, sizeof(buf), ";", 1, 1, 1) == -RIG_ETIMEOUT);
+
+    CHECK(write(sv[1], "\xfe\xfe", 2) == 2);
+    CHECK(read_block(port, buf, 2) == 2);
+
+    CHECK(rig_get_port_stats(rig, &ps) == RIG_OK);
+    CHECK(ps.latency.count == 3);
+    CHECK(ps.timeouts == 1);
+    CHECK(ps.errors == 0);
+    /* the timeout took at least the 20 ms of the port */
+    CHECK(ps.latency.sum_us >= 20000);
+
+    port->type.rig = RIG_PORT_NONE;
+    port->fd = -1;
+
+    fp = tmpfile();
+    CHECK(rig_stats_prometheus(rig, fp) == RIG_OK);
+    rewind(fp);
+    len = fread(out, 1, sizeof(out) - 1, fp);
+    out[len] = '\0';
+    fclose(fp);
+
+    CHECK(strstr(out, "# TYPE hamlib_call_duration_seconds histogram\n") != NULL);
+    CHECK(strstr(out, "call=\"rig_get_freq\",le=\"+Inf\"} 2\n") != NULL);
+    CHECK(strstr(out, "hamlib_call_duration_seconds_count{") != NULL);
+    CHECK(strstr(out, "hamlib_cache_hits_total{") != NULL);
+    CHECK(strstr(out, "hamlib_port_read_duration_seconds_count{") != NULL);
+    CHECK(strstr(out, "hamlib_port_timeouts_total{") != NULL);
+    CHECK(strstr(out, "model=\"") != NULL);
+
+    rig_close(rig);
+    rig_cleanup(rig);
+    close(sv[0]);
+    close(sv[1]);
+
+    if (errors)
+    {
+        fputs(out, stderr);
+    }
+
+    return check_result(errors);
+}
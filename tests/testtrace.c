@@ -0,0 +1,143 @@
+/*
+ * Check of the debug message gate and of the binary trace
+ *
+ * Checks that a message nobody wants does not evaluate its arguments, that
+ * errors are still kept for rigerror(), and that recorded messages are
+ * formatted at dump time as printf would have done when recorded, in time
+ * order across threads and keeping only the latest of each thread.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <hamlib/rig.h>
+#include "testcheck.h"
+
+#define ENTRIES 8
+
+
+static int count(const char *s, const char *what)
+{
+    int n = 0;
+
+    while ((s = strstr(s, what)))
+    {
+        n++;
+        s++;
+    }
+
+    return n;
+}
+
+
+/* what rig_debug_trace_dump() prints, and how many messages */
+static const char *dump(int *n)
+{
+    static char buf[16384];
+    FILE *fp = tmpfile();
+    size_t len;
+
+    *n = rig_debug_trace_dump(fp);
+    rewind(fp);
+    len = fread(buf, 1, sizeof(buf) - 1, fp);
+    buf[len] = '\0';
+    fclose(fp);
+
+    return buf;
+}
+
+
+static void *worker(void *arg)
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "%s: worker %d\n", (const char *) arg, i);
+    }
+
+    return NULL;
+}
+
+
+int main(int argc, char *argv[])
+{
+    char name[16];
+    char big[200];
+    const char *out;
+    pthread_t thread;
+    int evaluated = 0;
+    int errors = 0;
+    int n;
+    int i;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+    CHECK(rig_debug_gate_level == RIG_DEBUG_ERR);
+
+    /* nothing printed nor recorded, not even the arguments */
+    rig_debug(RIG_DEBUG_TRACE, "%s: %d\n", __func__, ++evaluated);
+    CHECK(evaluated == 0);
+
+    /* errors are kept for rigerror() all the same */
+    rig_debug(RIG_DEBUG_ERR, "%s: port is %s\n", __func__, "gone");
+    CHECK(strstr(rigerror(-RIG_EIO), "port is gone") != NULL);
+
+    CHECK(rig_set_debug_trace(RIG_DEBUG_TRACE, -1) == -RIG_EINVAL);
+    CHECK(rig_set_debug_trace(RIG_DEBUG_TRACE, ENTRIES) == RIG_OK);
+    CHECK(rig_debug_gate_level == RIG_DEBUG_TRACE);
+
+    /* formatted at dump time as when recorded */
+    strcpy(name, "IC-7300");
+    rig_debug(RIG_DEBUG_TRACE, "%s: [%5.2f] [%-*s] [%.*s] [%lx] [%hhd] [%c] %d%%\n",
+              name, 3.14159, 6, "ab", 3, "abcdef", 0xdeadbeefUL, 300, 'z', -42);
+    strcpy(name, "changed");
+
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    rig_debug(RIG_DEBUG_TRACE, "long: %s %d\n", big, 7);
+
+    out = dump(&n);
+    CHECK(n == 2);
+    CHECK(strstr(out, "IC-7300: [ 3.14] [ab    ] [abc] [deadbeef] [44] [z] -42%\n")
+          != NULL);
+    CHECK(strstr(out, "changed") == NULL);
+    /* strings are cut, the other arguments are kept */
+    CHECK(strstr(out, "long: xxx") != NULL && strstr(out, "x 7\n") != NULL);
+    CHECK(strstr(out, big) == NULL);
+
+    /* the latest of each thread, oldest first */
+    for (i = 0; i < 2 * ENTRIES; i++)
+    {
+        rig_debug(RIG_DEBUG_VERBOSE, "main %d\n", i);
+    }
+
+    pthread_create(&thread, NULL, worker, "other");
+    pthread_join(thread, NULL);
+
+    out = dump(&n);
+    CHECK(n == ENTRIES + 3);
+    CHECK(count(out, "main ") == ENTRIES);
+    CHECK(strstr(out, "main 7\n") == NULL);
+    CHECK(strstr(out, "main 8\n") != NULL);
+    CHECK(strstr(out, "main 15\n") < strstr(out, "other: worker 0\n"));
+    CHECK(strstr(out, "other: worker 0\n") < strstr(out, "other: worker 2\n"));
+    CHECK(count(out, " T1: ") == ENTRIES);
+    CHECK(count(out, " T2: ") == 3);
+
+    /* only up to the trace level */
+    rig_set_debug_trace(RIG_DEBUG_WARN, ENTRIES);
+    rig_debug(RIG_DEBUG_VERBOSE, "not recorded\n");
+    rig_debug(RIG_DEBUG_WARN, "recorded\n");
+    out = dump(&n);
+    CHECK(strstr(out, "not recorded") == NULL);
+    CHECK(strstr(out, "recorded\n") != NULL);
+
+    CHECK(rig_set_debug_trace(RIG_DEBUG_NONE, 0) == RIG_OK);
+    CHECK(rig_debug_gate_level == RIG_DEBUG_ERR);
+
+    return check_result(errors);
+}
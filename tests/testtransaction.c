@@ -0,0 +1,196 @@
+/*
+ * Check of asynchronous port transactions
+ *
+ * Runs transactions with each kind of reply matcher on the ports of two
+ * rigs at once through socket pairs, with the replies already waiting,
+ * and checks the completion callbacks.  Then checks that a missing reply
+ * times out, that a transaction waits for the transaction lock of the
+ * rig, that a callback cannot wait, that closing the port completes what
+ * was not started and that other ports have no transactions.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hamlib/rig.h>
+#include "iofunc.h"
+#include "misc.h"
+#include "testcheck.h"
+
+
+struct result
+{
+    int status;
+    char reply[64];
+};
+
+static struct result results[10];
+
+
+static void done(hamlib_port_t *p, int status, const unsigned char *reply,
+                 rig_ptr_t arg)
+{
+    struct result *r = arg;
+
+    r->status = status;
+    strncpy(r->reply, (const char *) reply, sizeof(r->reply) - 1);
+}
+
+
+/* waiting from a callback would wait for itself */
+static void wait_done(hamlib_port_t *p, int status, const unsigned char *reply,
+                      rig_ptr_t arg)
+{
+    struct result *r = arg;
+
+    r->status = port_transaction_wait(p);
+}
+
+
+/* a CI-V frame ends with 0xfd */
+static int civ_match(const unsigned char *reply, size_t len, rig_ptr_t arg)
+{
+    return reply[len - 1] == 0xfd;
+}
+
+
+int main(int argc, char *argv[])
+{
+    RIG *krig, *irig;
+    hamlib_port_t *kenwood, *icom, bare;
+    struct port_transaction t;
+    int kv[2], iv[2];
+    unsigned char buf[64];
+    int errors = 0;
+    int i;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    krig = open_fake_rig(RIG_MODEL_DUMMY, kv, 200);
+    irig = open_fake_rig(RIG_MODEL_DUMMY, iv, 200);
+
+    if (!krig || !irig)
+    {
+        fprintf(stderr, "cannot set up the dummy rigs\n");
+        return 1;
+    }
+
+    kenwood = &krig->state.rigport;
+    icom = &irig->state.rigport;
+
+    for (i = 0; i < 10; i++)
+    {
+        results[i].status = 1;
+    }
+
+    CHECK(write(kv[1], "FA00014074000;MD2;", 18) == 18);
+    CHECK(write(iv[1], "\xfe\xfe\xe0\x94\xfb\xfd" "ABCD", 10) == 10);
+
+    memset(&t, 0, sizeof(t));
+    t.cmd = (unsigned char *) "FA;";
+    t.cmd_len = 3;
+    t.stopset = ";";
+    t.stopset_len = 1;
+    t.done = done;
+    t.done_arg = &results[0];
+    CHECK(port_transaction_submit(kenwood, &t) == RIG_OK);
+
+    t.cmd = (unsigned char *) "MD;";
+    t.done_arg = &results[1];
+    CHECK(port_transaction_submit(kenwood, &t) == RIG_OK);
+
+    memset(&t, 0, sizeof(t));
+    t.cmd = (unsigned char *) "\xfe\xfe\x94\xe0\x05\x00\x00\x00\x14\x00\xfd";
+    t.cmd_len = 11;
+    t.match = civ_match;
+    t.done = done;
+    t.done_arg = &results[2];
+    CHECK(port_transaction_submit(icom, &t) == RIG_OK);
+
+    memset(&t, 0, sizeof(t));
+    t.reply_len = 4;
+    t.done = done;
+    t.done_arg = &results[3];
+    CHECK(port_transaction_submit(icom, &t) == RIG_OK);
+
+    CHECK(port_transaction_wait(kenwood) == RIG_OK);
+    CHECK(port_transaction_wait(icom) == RIG_OK);
+
+    CHECK(results[0].status == 14 && strcmp(results[0].reply, "FA00014074000;") == 0);
+    CHECK(results[1].status == 4 && strcmp(results[1].reply, "MD2;") == 0);
+    CHECK(results[2].status == 6 && (unsigned char) results[2].reply[4] == 0xfb);
+    CHECK(results[3].status == 4 && strcmp(results[3].reply, "ABCD") == 0);
+
+    /* the commands went out in order */
+    CHECK(read(kv[1], buf, sizeof(buf)) == 6 && memcmp(buf, "FA;MD;", 6) == 0);
+    CHECK(read(iv[1], buf, sizeof(buf)) == 11 && buf[4] == 0x05);
+
+    /* the transactions take turns with the backend for the port */
+    CHECK(write(kv[1], "FA00014074000;", 14) == 14);
+    memset(&t, 0, sizeof(t));
+    t.stopset = ";";
+    t.stopset_len = 1;
+    t.done = done;
+    t.done_arg = &results[8];
+    rig_transaction_lock(krig);
+    CHECK(port_transaction_submit(kenwood, &t) == RIG_OK);
+    hl_usleep(50 * 1000);
+    CHECK(results[8].status == 1);
+    rig_transaction_unlock(krig);
+    CHECK(port_transaction_wait(kenwood) == RIG_OK);
+    CHECK(results[8].status == 14);
+
+    t.stopset = NULL;
+    t.done = wait_done;
+    t.done_arg = &results[9];
+    CHECK(port_transaction_submit(kenwood, &t) == RIG_OK);
+    CHECK(port_transaction_wait(kenwood) == RIG_OK);
+    CHECK(results[9].status == -RIG_EINVAL);
+
+    /* no reply */
+    memset(&t, 0, sizeof(t));
+    t.cmd = (unsigned char *) "IF;";
+    t.cmd_len = 3;
+    t.stopset = ";";
+    t.stopset_len = 1;
+    t.timeout = 50;
+    t.done = done;
+    t.done_arg = &results[4];
+    CHECK(port_transaction_submit(kenwood, &t) == RIG_OK);
+    CHECK(port_transaction_wait(kenwood) == RIG_OK);
+    CHECK(results[4].status == -RIG_ETIMEOUT);
+    CHECK(kenwood->timeout == 200);
+
+    /* closing completes what is still queued */
+    t.timeout = 0;
+
+    for (i = 5; i < 8; i++)
+    {
+        t.done_arg = &results[i];
+        CHECK(port_transaction_submit(kenwood, &t) == RIG_OK);
+    }
+
+    port_close(kenwood, RIG_PORT_DEVICE);
+    CHECK(port_private(kenwood)->transaction_queue == NULL);
+    CHECK(results[7].status == -RIG_EIO);
+    CHECK(port_transaction_submit(kenwood, &t) == -RIG_EIO);
+
+    port_close(icom, RIG_PORT_DEVICE);
+    close(kv[1]);
+    close(iv[1]);
+    rig_cleanup(krig);
+    rig_cleanup(irig);
+
+    if (open_port_pair(&bare, kv, 200) == 0)
+    {
+        CHECK(port_transaction_submit(&bare, &t) == -RIG_ENAVAIL);
+        close(kv[0]);
+        close(kv[1]);
+    }
+
+    return check_result(errors);
+}
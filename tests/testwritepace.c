@@ -0,0 +1,126 @@
+/*
+ * Check and measurement of write pacing
+ *
+ * Writes through a socket pair with a write_delay and checks that the
+ * bytes are spaced out while write_block() returns right away, that a
+ * read, a change of RTS or rig_set_ptt() waits for them, and that a post_write_delay
+ * only delays the next write.  Prints the time spent by
+ * the calling thread next to the time the bytes took to go out.
+ */
+
+#include <hamlib/config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hamlib/rig.h>
+#include "iofunc.h"
+#include "misc.h"
+#include "serial.h"
+#include "testcheck.h"
+
+#define WRITE_DELAY 2
+#define CMD_LEN 5
+#define CMD_COUNT 8
+
+
+int main(int argc, char *argv[])
+{
+    RIG *rig;
+    hamlib_port_t *port, peer;
+    unsigned char cmd[CMD_LEN] = { 0x00, 0x00, 0x00, 0x01, 0x0e };
+    unsigned char buf[CMD_LEN * CMD_COUNT + 1];
+    struct timespec start;
+    double caller_ms, sent_ms, paced_ms;
+    int sv[2];
+    int errors = 0;
+    int i, n;
+
+    rig_set_debug(RIG_DEBUG_NONE);
+
+    rig = open_fake_rig(RIG_MODEL_DUMMY, sv, 1000);
+
+    if (!rig || !port_private(&rig->state.rigport))
+    {
+        fprintf(stderr, "cannot set up the dummy rig\n");
+        return 1;
+    }
+
+    port = &rig->state.rigport;
+    port->write_delay = WRITE_DELAY;
+
+    memset(&peer, 0, sizeof(peer));
+    peer.type.rig = RIG_PORT_DEVICE;
+    peer.fd = sv[1];
+    peer.timeout = 1000;
+
+    /* a burst of Yaesu style set commands, which get no reply */
+    elapsed_ms(&start, HAMLIB_ELAPSED_SET);
+
+    for (i = 0; i < CMD_COUNT; i++)
+    {
+        CHECK(write_block(port, cmd, sizeof(cmd)) == RIG_OK);
+    }
+
+    caller_ms = elapsed_ms(&start, HAMLIB_ELAPSED_GET);
+
+    n = read_block(&peer, buf, CMD_LEN * CMD_COUNT);
+    sent_ms = elapsed_ms(&start, HAMLIB_ELAPSED_GET);
+    paced_ms = (CMD_LEN * CMD_COUNT - 1) * WRITE_DELAY;
+
+    CHECK(n == CMD_LEN * CMD_COUNT);
+    CHECK(memcmp(buf + CMD_LEN * (CMD_COUNT - 1), cmd, CMD_LEN) == 0);
+    CHECK(sent_ms >= paced_ms);
+    CHECK(caller_ms < paced_ms / 2);
+
+    printf("%d bytes at write_delay=%d: caller blocked %.1f ms, sent in %.1f ms\n",
+           CMD_LEN * CMD_COUNT, WRITE_DELAY, caller_ms, sent_ms);
+
+    /* a read waits for the queued bytes before its timeout starts */
+    CHECK(write_block(port, cmd, sizeof(cmd)) == RIG_OK);
+    CHECK(write(sv[1], "\xfe", 1) == 1);
+    CHECK(read_block(port, buf, 1) == 1);
+    CHECK(port_private(port)->tx_queue != NULL);
+    CHECK(read_block(&peer, buf, CMD_LEN) == CMD_LEN);
+
+    /* so does a change of RTS on the same device, e.g. for PTT */
+    CHECK(write_block(port, cmd, sizeof(cmd)) == RIG_OK);
+    rig->state.pttport.fd = port->fd;
+    ser_set_rts(&rig->state.pttport, 1);
+    CHECK(recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT) == CMD_LEN);
+    rig->state.pttport.fd = -1;
+
+    /* and rig_set_ptt(), whose CAT command may be the one still queued */
+    CHECK(write_block(port, cmd, sizeof(cmd)) == RIG_OK);
+    rig->state.comm_state = 1;
+    rig->state.pttport.type.ptt = RIG_PTT_RIG;
+    CHECK(rig_set_ptt(rig, RIG_VFO_CURR, RIG_PTT_ON) == RIG_OK);
+    rig->state.comm_state = 0;
+    CHECK(recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT) == CMD_LEN);
+
+    port_tx_stop(port);
+    CHECK(port_private(port)->tx_queue == NULL);
+
+    /* post_write_delay only holds back the next write */
+    port->write_delay = 0;
+    port->post_write_delay = 50;
+
+    elapsed_ms(&start, HAMLIB_ELAPSED_SET);
+    CHECK(write_block(port, cmd, sizeof(cmd)) == RIG_OK);
+    caller_ms = elapsed_ms(&start, HAMLIB_ELAPSED_GET);
+    CHECK(write_block(port, cmd, sizeof(cmd)) == RIG_OK);
+    sent_ms = elapsed_ms(&start, HAMLIB_ELAPSED_GET);
+
+    CHECK(caller_ms < 25);
+    CHECK(sent_ms >= 50);
+    CHECK(read_block(&peer, buf, 2 * CMD_LEN) == 2 * CMD_LEN);
+
+    printf("post_write_delay=50: first write returned after %.1f ms, second after %.1f ms\n",
+           caller_ms, sent_ms);
+
+    close_fake_rig(rig, sv);
+
+    return check_result(errors);
+}